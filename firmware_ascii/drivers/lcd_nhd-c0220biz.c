@@ -233,6 +233,9 @@ void LcdInitialize(void)
   Lcd_u32Timer = G_u32SystemTime1ms;
   while( !IsTimeUp(&Lcd_u32Timer, U8_LCD_STARTUP_DELAY_MS) );
   
+  /* The LCD controller supports Fast-mode IC */
+  TwiSetDeviceSpeed(U8_LCD_ADDRESS, TWI_SPEED_400KHZ);
+  
   /* Send Control Command */
   u8Byte = LCD_CONTROL_COMMAND;
   TwiWriteData(U8_LCD_ADDRESS, 1, &u8Byte, TWI_NO_STOP);
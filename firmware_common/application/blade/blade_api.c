@@ -14,11 +14,14 @@ TYPES
 - NONE
 
 PUBLIC FUNCTIONS
-- NONE
+- ErrorStatusType BladeRequestPin(BladePinType ePin_, BladePinIOType ePinFunction_)
+- ErrorStatusType BladeRequestPinInterrupt(BladePinType ePin_, BladePinEdgeType eEdge_, fnCode_type pfnHandler_)
+- bool BladePinIsHigh(BladePinType ePin_)
 
 PROTECTED FUNCTIONS
 - void BladeApiInitialize(void)
 - void BladeApiRunActiveState(void)
+- void BladePinInterrupt(PortOffsetType ePort_, u32 u32Sources_)
 
 
 **********************************************************************************************************************/
@@ -48,6 +51,7 @@ Variable names shall start with "BladeApi_<type>" and be declared as static.
 static fnCode_type BladeApi_pfStateMachine;                     /*!< @brief The state machine function pointer */
 
 static BladePinIOType BladeApi_auePinAllocated[U8_BLADE_PINS];  /*!< @brief Which Blade pins have been requested */
+static fnCode_type BladeApi_apfnPinHandlers[U8_BLADE_PINS];     /*!< @brief Edge interrupt handler of each DIGITAL_IN_INTERRUPT pin */
 
 static const u32 BladeApi_au32BladePins[U8_BLADE_PINS] = 
 {
@@ -108,6 +112,9 @@ BLADE_PIN9: GPIO 9 or I2C SCL
 Requests for I2C pin peripheral function are not denied if the pin is already requested
 as the peripheral function.
 
+DIGITAL_IN_INTERRUPT configures the pin as an input only; BladeRequestPinInterrupt()
+requests it this way and then arms the interrupt.
+
 Requires:
 @param ePin_ is one of the 10 Blade pins to request and configure
 @param ePinFunction_ specifies the desired configuration
@@ -145,38 +152,38 @@ ErrorStatusType BladeRequestPin(BladePinType ePin_, BladePinIOType ePinFunction_
   
   /* Pin is available, so claim it and configure */
   BladeApi_auePinAllocated[ePin_] = ePinFunction_;
-  (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_PDR = BladeApi_au32BladePins[ePin_];
+  BladeApiPinPio(ePin_)->PIO_PDR = BladeApi_au32BladePins[ePin_];
   
   /* Set IO or peripheral */
   if(ePinFunction_ == PERIPHERAL)
   {
     /* PIO does not control pin */
-    (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_PDR = BladeApi_au32BladePins[ePin_];
+    BladeApiPinPio(ePin_)->PIO_PDR = BladeApi_au32BladePins[ePin_];
     
     /* Select the peripheral function location */
     if(BladeApi_au32BladePinPeripherals[ePin_] == PERIPHERAL_A)
     {
-      (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_ABSR &= ~BladeApi_au32BladePins[ePin_];
+      BladeApiPinPio(ePin_)->PIO_ABSR &= ~BladeApi_au32BladePins[ePin_];
     }
     else
     {
-      (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_ABSR |= BladeApi_au32BladePins[ePin_];
+      BladeApiPinPio(ePin_)->PIO_ABSR |= BladeApi_au32BladePins[ePin_];
     }
   }
   /* Otherwise the pin is digital IO */
   else
   {
     /* PIO controller has pin */
-    (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_PER = BladeApi_au32BladePins[ePin_];
+    BladeApiPinPio(ePin_)->PIO_PER = BladeApi_au32BladePins[ePin_];
     
     /* Set input or output */
-    if(ePinFunction_ == DIGITAL_IN)
+    if(ePinFunction_ == DIGITAL_OUT)
     {
-      (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_ODR = BladeApi_au32BladePins[ePin_];
+      BladeApiPinPio(ePin_)->PIO_OER = BladeApi_au32BladePins[ePin_];
     }
     else
     {
-      (AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_])->PIO_OER = BladeApi_au32BladePins[ePin_];
+      BladeApiPinPio(ePin_)->PIO_ODR = BladeApi_au32BladePins[ePin_];
     }
   }
 
@@ -187,6 +194,100 @@ ErrorStatusType BladeRequestPin(BladePinType ePin_, BladePinIOType ePinFunction_
 } /* end BladeRequestPin() */
 
 
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn ErrorStatusType BladeRequestPinInterrupt(BladePinType ePin_, BladePinEdgeType eEdge_, fnCode_type pfnHandler_)
+
+@brief Requests a Blade pin as a digital input that runs pfnHandler_ on the selected edges.
+
+This is how a Blade sensor's interrupt line (data ready, FIFO watermark...) triggers
+its reads instead of a polling timer.  The handler runs from the PIOA or PIOB ISR
+alongside the button interrupts, so it should only note the event (set a flag) and
+leave the bus transfers to the Blade task.
+
+e.g.
+ErrorStatusType eStatus = BladeRequestPinInterrupt(BLADE_PIN2, BLADE_EDGE_RISING, Bladelsm6dslInt1Handler);
+
+Requires:
+@param ePin_ is one of the 10 Blade pins to request
+@param eEdge_ selects rising, falling or both edges
+@param pfnHandler_ is the function to run (in the ISR) on each selected edge
+
+Promises:
+- Returns SUCCESS if the pin was available: it is a DIGITAL_IN_INTERRUPT input, the PIO
+  interrupt is enabled on eEdge_ and pfnHandler_ runs on each one from now on
+- Returns ERROR if the pin has already been allocated or pfnHandler_ is NULL
+
+*/
+ErrorStatusType BladeRequestPinInterrupt(BladePinType ePin_, BladePinEdgeType eEdge_, fnCode_type pfnHandler_)
+{
+  AT91PS_PIO pPio = BladeApiPinPio(ePin_);
+  u32 u32Pin = BladeApi_au32BladePins[ePin_];
+  
+  if( (pfnHandler_ == NULL) || (BladeRequestPin(ePin_, DIGITAL_IN_INTERRUPT) != SUCCESS) )
+  {
+    return ERROR;
+  }
+  
+  BladeApi_apfnPinHandlers[ePin_] = pfnHandler_;
+  
+  /* Both edges is the default input change interrupt; a single edge needs the additional modes */
+  if(eEdge_ == BLADE_EDGE_BOTH)
+  {
+    pPio->PIO_AIMDR = u32Pin;
+  }
+  else
+  {
+    pPio->PIO_ESR = u32Pin;
+    if(eEdge_ == BLADE_EDGE_RISING)
+    {
+      pPio->PIO_REHLSR = u32Pin;
+    }
+    else
+    {
+      pPio->PIO_FELLSR = u32Pin;
+    }
+    pPio->PIO_AIMER = u32Pin;
+  }
+  
+  /* PIO_ISR is not read here as that would also clear pending button flags, so a change 
+  seen before the request may run the handler once */
+  pPio->PIO_IER = u32Pin;
+  if(BladeApi_au32BladePinPorts[ePin_] == PORTA)
+  {
+    NVIC_EnableIRQ(IRQn_PIOA);
+  }
+  else
+  {
+    NVIC_EnableIRQ(IRQn_PIOB);
+  }
+  
+  return SUCCESS;
+  
+} /* end BladeRequestPinInterrupt() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool BladePinIsHigh(BladePinType ePin_)
+
+@brief Returns the level on a Blade pin.
+
+A level-type interrupt line (e.g. a FIFO watermark) that is still high after it
+has been serviced will not give another edge, so the task can check it here.
+
+Requires:
+@param ePin_ is one of the 10 Blade pins
+
+Promises:
+- Returns TRUE if the pin is high (from PIO_PDSR)
+
+*/
+bool BladePinIsHigh(BladePinType ePin_)
+{
+  return( (BladeApiPinPio(ePin_)->PIO_PDSR & BladeApi_au32BladePins[ePin_]) != 0 );
+  
+} /* end BladePinIsHigh() */
+
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /*! @protectedsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -213,6 +314,7 @@ void BladeApiInitialize(void)
   for(u8 i = 0; i < U8_BLADE_PINS; i++)
   {
     BladeApi_auePinAllocated[i] = PIN_NOT_ASSIGNED;
+    BladeApi_apfnPinHandlers[i] = NULL;
   }
   
   /* If good initialization, set state to Idle */
@@ -253,10 +355,62 @@ void BladeApiRunActiveState(void)
 } /* end BladeApiRunActiveState */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn void BladePinInterrupt(PortOffsetType ePort_, u32 u32Sources_)
+
+@brief Runs the handler of every Blade interrupt pin that PIO_ISR reports.
+
+Called from PIOA_IrqHandler() and PIOB_IrqHandler() with the PIO_ISR snapshot they took.
+
+Requires:
+@param ePort_ is PORTA or PORTB
+@param u32Sources_ is the PIO_ISR value read by the ISR
+
+Promises:
+- The handler of each DIGITAL_IN_INTERRUPT pin on ePort_ with its bit set in u32Sources_ is called
+
+*/
+void BladePinInterrupt(PortOffsetType ePort_, u32 u32Sources_)
+{
+  for(u8 i = 0; i < U8_BLADE_PINS; i++)
+  {
+    if( (BladeApi_apfnPinHandlers[i] != NULL) && 
+        (BladeApi_au32BladePinPorts[i] == (u32)ePort_) &&
+        (u32Sources_ & BladeApi_au32BladePins[i]) )
+    {
+      BladeApi_apfnPinHandlers[i]();
+    }
+  }
+
+} /* end BladePinInterrupt() */
+
+
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static AT91PS_PIO BladeApiPinPio(BladePinType ePin_)
+
+@brief Returns the PIO controller of a Blade pin.
+
+The port offsets are in 32-bit registers (see PortOffsetType), so they are added to
+a u32 pointer rather than the AT91PS_PIO base.
+
+Requires:
+@param ePin_ is one of the 10 Blade pins
+
+Promises:
+- Returns AT91C_BASE_PIOA or AT91C_BASE_PIOB
+
+*/
+static AT91PS_PIO BladeApiPinPio(BladePinType ePin_)
+{
+  return (AT91PS_PIO)((u32*)AT91C_BASE_PIOA + BladeApi_au32BladePinPorts[ePin_]);
+
+} /* end BladeApiPinPio() */
+
+
 
 /**********************************************************************************************************************
 State Machine Function Definitions
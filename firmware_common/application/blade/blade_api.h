@@ -32,8 +32,18 @@ BLADE_PIN7   GPIO 7   SPI CS
 BLADE_PIN8   GPIO 8   I2C SDA              
 BLADE_PIN9   GPIO 9   I2C SCL 
 
+DIGITAL_IN_INTERRUPT is a digital input with an edge interrupt; request it
+with BladeRequestPinInterrupt().
+
+*/
+typedef enum {PIN_NOT_ASSIGNED, DIGITAL_IN, DIGITAL_OUT, PERIPHERAL, DIGITAL_IN_INTERRUPT} BladePinIOType;
+
+
+/*! 
+@enum BladePinEdgeType
+@brief Which edges of a DIGITAL_IN_INTERRUPT pin run its handler.
 */
-typedef enum {PIN_NOT_ASSIGNED, DIGITAL_IN, DIGITAL_OUT, PERIPHERAL} BladePinIOType;
+typedef enum {BLADE_EDGE_RISING, BLADE_EDGE_FALLING, BLADE_EDGE_BOTH} BladePinEdgeType;
 
 
 /*! 
@@ -54,6 +64,8 @@ Function Declarations
 /*! @publicsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
 ErrorStatusType BladeRequestPin(BladePinType ePin_, BladePinIOType ePinFunction_);
+ErrorStatusType BladeRequestPinInterrupt(BladePinType ePin_, BladePinEdgeType eEdge_, fnCode_type pfnHandler_);
+bool BladePinIsHigh(BladePinType ePin_);
 
 
 /*------------------------------------------------------------------------------------------------------------------*/
@@ -61,11 +73,13 @@ ErrorStatusType BladeRequestPin(BladePinType ePin_, BladePinIOType ePinFunction_
 /*--------------------------------------------------------------------------------------------------------------------*/
 void BladeApiInitialize(void);
 void BladeApiRunActiveState(void);
+void BladePinInterrupt(PortOffsetType ePort_, u32 u32Sources_);
 
 
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
+static AT91PS_PIO BladeApiPinPio(BladePinType ePin_);
 
 
 /***********************************************************************************************************************
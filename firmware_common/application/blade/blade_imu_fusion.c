@@ -0,0 +1,726 @@
+/*!*********************************************************************************************************************
+@file blade_imu_fusion.c
+@brief Fixed-point sensor fusion for the IMU blade: turns raw gyro and accelerometer samples into
+an orientation quaternion.
+
+This is a processing stage, not a task: the owner of the samples (the LSM6DSL driver for
+en+c imufusion) calls BladeImuFusionUpdate() for each one and collects an output every
+u16Decimation samples.  There is one fusion instance.
+
+Each sample goes through:
+1. Calibration: (raw - offset) x scale per axis (BladeImuFusionSetCalibration()), or the gyro
+   offsets can be measured by averaging samples while the device is still
+   (BladeImuFusionCalibrateGyro()).
+2. Low-pass: the accelerometer goes through a first-order IIR filter (1/2^u8AccelLowPassShift
+   per sample) so vibration does not pull the tilt around.
+3. Complementary filter (Mahony form): the gyro rate turns the quaternion, and the angle between
+   the filtered accelerometer and the gravity direction the quaternion predicts turns it back
+   towards gravity with time constant u16TauMs.  The correction is skipped while the
+   accelerometer is more than U8_BLADE_FUSION_ACCEL_GATE_PERCENT away from 1g.  For the first
+   U32_BLADE_FUSION_ALIGN_US the time constant is U16_BLADE_FUSION_ALIGN_TAU_MS so the tilt is
+   found quickly.  Yaw comes from the gyro only and drifts.
+4. Decimation: every u16Decimation samples the quaternion and the gyro rate averaged over those
+   samples are kept as the output.
+
+The quaternion and the per-sample half angles are Q30 in s32 and every product is a 32 x 32 -> 64
+bit multiply (one SMULL on the Cortex-M3).  The per-sample path has three 32-bit divides and a
+16-step square root for the accelerometer direction and no 64-bit division or floating point, so
+a sample costs a few hundred cycles.  firmware_host/bench/fusion_bench.c replays IMU traces through
+this file on the computer and checks it against a double precision model of the same filter.
+
+----------------------------------------------------------------------------------------------------------------------
+
+GLOBALS
+- NONE
+
+CONSTANTS
+- NONE
+
+TYPES
+- BladeImuFusionConfigType
+- BladeImuFusionCalibrationType
+- BladeImuFusionSampleType
+- BladeImuFusionOutputType
+- BladeImuFusionEulerType
+
+PUBLIC FUNCTIONS
+- bool BladeImuFusionStart(BladeImuFusionConfigType* psConfig_)
+- void BladeImuFusionSetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+- void BladeImuFusionGetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+- void BladeImuFusionCalibrateGyro(u16 u16Samples_)
+- bool BladeImuFusionUpdate(BladeImuFusionSampleType* psSample_)
+- void BladeImuFusionGetOutput(BladeImuFusionOutputType* psOutput_)
+- void BladeImuFusionToEuler(s16* ps16Quaternion_, BladeImuFusionEulerType* psEuler_)
+
+PROTECTED FUNCTIONS
+- NONE
+
+
+**********************************************************************************************************************/
+
+#include "configuration.h"
+#include "blade_imu_fusion.h"
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_<type>BladeImuFusion"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "BladeImuFusion_<type>" and be declared as static.
+***********************************************************************************************************************/
+static bool BladeImuFusion_bRunning;                      /*!< @brief BladeImuFusionStart() accepted a configuration */
+
+/*! @brief Per-axis corrections (no correction until BladeImuFusionSetCalibration()) */
+static BladeImuFusionCalibrationType BladeImuFusion_sCalibration =
+{
+  {0, 0, 0}, {0, 0, 0},
+  {U16_BLADE_FUSION_SCALE_ONE, U16_BLADE_FUSION_SCALE_ONE, U16_BLADE_FUSION_SCALE_ONE},
+  {U16_BLADE_FUSION_SCALE_ONE, U16_BLADE_FUSION_SCALE_ONE, U16_BLADE_FUSION_SCALE_ONE}
+};
+
+static s32 BladeImuFusion_as32Quaternion[4];              /*!< @brief Orientation W/X/Y/Z, Q30 */
+static u32 BladeImuFusion_u32GyroGain;                    /*!< @brief Half angle per gyro LSB per sample, Q44 */
+static u32 BladeImuFusion_u32CorrectionGain;              /*!< @brief dt / (2 x tau), Q30 */
+static u32 BladeImuFusion_u32AlignGain;                   /*!< @brief dt / (2 x U16_BLADE_FUSION_ALIGN_TAU_MS), Q30 */
+static u32 BladeImuFusion_u32AlignSamples;                /*!< @brief Samples in U32_BLADE_FUSION_ALIGN_US */
+static u32 BladeImuFusion_u32AlignLeft;                   /*!< @brief Samples left with the align gain */
+static u32 BladeImuFusion_u32GateLow;                     /*!< @brief Smallest |accel| used for the correction */
+static u32 BladeImuFusion_u32GateHigh;                    /*!< @brief Largest |accel| used for the correction */
+static u8 BladeImuFusion_u8LowPassShift;                  /*!< @brief Accelerometer IIR shift (0 = off) */
+static bool BladeImuFusion_bFilterPrimed;                 /*!< @brief The IIR holds a sample */
+static s32 BladeImuFusion_as32AccelFiltered[3];           /*!< @brief Low-pass accelerometer X/Y/Z in LSB, Q8 */
+
+static u16 BladeImuFusion_u16Decimation;                  /*!< @brief Samples per output */
+static u16 BladeImuFusion_u16DecimationCount;             /*!< @brief Samples since the last output */
+static s32 BladeImuFusion_as32RateSum[3];                 /*!< @brief Calibrated gyro summed since the last output */
+static BladeImuFusionOutputType BladeImuFusion_sOutput;   /*!< @brief Latest output */
+
+static u16 BladeImuFusion_u16CalibrationSamples;          /*!< @brief Samples BladeImuFusionCalibrateGyro() averages */
+static u16 BladeImuFusion_u16CalibrationLeft;             /*!< @brief Samples still to average (0 = not calibrating) */
+static s32 BladeImuFusion_as32GyroSum[3];                 /*!< @brief Raw gyro summed while calibrating */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool BladeImuFusionStart(BladeImuFusionConfigType* psConfig_)
+
+@brief Starts (or restarts) fusion with a new configuration.
+
+The gains are worked out here so BladeImuFusionUpdate() only multiplies.  The calibration is kept.
+
+e.g.
+BladeImuFusionConfigType sConfig = {2404, 1000, 16, 3};
+
+BladeImuFusionStart(&sConfig);
+
+Requires:
+@param psConfig_ points to the settings (see BladeImuFusionConfigType)
+
+Promises:
+- Returns TRUE, resets the orientation to level and starts the alignment period
+- Returns FALSE and stops fusion if u32PeriodUs is 0 or over U32_BLADE_FUSION_MAX_PERIOD_US, or
+  u16Decimation is 0
+
+*/
+bool BladeImuFusionStart(BladeImuFusionConfigType* psConfig_)
+{
+  BladeImuFusion_bRunning = FALSE;
+  if( (psConfig_->u32PeriodUs == 0) || (psConfig_->u32PeriodUs > U32_BLADE_FUSION_MAX_PERIOD_US) ||
+      (psConfig_->u16Decimation == 0) )
+  {
+    return FALSE;
+  }
+
+  /* Q48 x us = Q48 half angle per LSB; Q44 keeps 12.5Hz inside 32 bits */
+  BladeImuFusion_u32GyroGain = (u32)( ((u64)U32_BLADE_FUSION_GYRO_Q48 * psConfig_->u32PeriodUs) >> 4 );
+
+  BladeImuFusion_u32CorrectionGain = 0;
+  BladeImuFusion_u32AlignGain = 0;
+  if(psConfig_->u16TauMs != 0)
+  {
+    BladeImuFusion_u32CorrectionGain = BladeImuFusionGain(psConfig_->u32PeriodUs, psConfig_->u16TauMs);
+    BladeImuFusion_u32AlignGain = BladeImuFusionGain(psConfig_->u32PeriodUs, U16_BLADE_FUSION_ALIGN_TAU_MS);
+  }
+  BladeImuFusion_u32AlignSamples = U32_BLADE_FUSION_ALIGN_US / psConfig_->u32PeriodUs;
+  BladeImuFusion_u32AlignLeft = BladeImuFusion_u32AlignSamples;
+
+  BladeImuFusion_u32GateLow  = ((u32)U16_BLADE_FUSION_ACCEL_1G * (100 - U8_BLADE_FUSION_ACCEL_GATE_PERCENT)) / 100;
+  BladeImuFusion_u32GateHigh = ((u32)U16_BLADE_FUSION_ACCEL_1G * (100 + U8_BLADE_FUSION_ACCEL_GATE_PERCENT)) / 100;
+
+  BladeImuFusion_u8LowPassShift = psConfig_->u8AccelLowPassShift;
+  BladeImuFusion_bFilterPrimed = FALSE;
+
+  BladeImuFusion_as32Quaternion[0] = S32_BLADE_FUSION_ONE;
+  BladeImuFusion_as32Quaternion[1] = 0;
+  BladeImuFusion_as32Quaternion[2] = 0;
+  BladeImuFusion_as32Quaternion[3] = 0;
+
+  BladeImuFusion_u16Decimation = psConfig_->u16Decimation;
+  BladeImuFusion_u16DecimationCount = 0;
+  for(u8 i = 0; i < 3; i++)
+  {
+    BladeImuFusion_as32RateSum[i] = 0;
+    BladeImuFusion_sOutput.as16Rate[i] = 0;
+  }
+  BladeImuFusion_sOutput.as16Quaternion[0] = (s16)U16_BLADE_FUSION_SCALE_ONE;
+  BladeImuFusion_sOutput.as16Quaternion[1] = 0;
+  BladeImuFusion_sOutput.as16Quaternion[2] = 0;
+  BladeImuFusion_sOutput.as16Quaternion[3] = 0;
+
+  BladeImuFusion_u16CalibrationLeft = 0;
+  BladeImuFusion_bRunning = TRUE;
+
+  return TRUE;
+
+} /* end BladeImuFusionStart() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void BladeImuFusionSetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+
+@brief Sets the per-axis offsets and gains applied to every sample.
+
+Requires:
+@param psCalibration_ points to the new calibration
+
+Promises:
+- The calibration is copied and used from the next sample
+
+*/
+void BladeImuFusionSetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+{
+  BladeImuFusion_sCalibration = *psCalibration_;
+
+} /* end BladeImuFusionSetCalibration() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void BladeImuFusionGetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+
+@brief Copies out the calibration in use (e.g. to keep the offsets BladeImuFusionCalibrateGyro() found).
+
+Requires:
+@param psCalibration_ is where the calibration is copied
+
+Promises:
+- *psCalibration_ holds the current calibration
+
+*/
+void BladeImuFusionGetCalibration(BladeImuFusionCalibrationType* psCalibration_)
+{
+  *psCalibration_ = BladeImuFusion_sCalibration;
+
+} /* end BladeImuFusionGetCalibration() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void BladeImuFusionCalibrateGyro(u16 u16Samples_)
+
+@brief Measures the gyro offsets from the next u16Samples_ samples, which must be taken with the
+device still.
+
+BladeImuFusionUpdate() only averages during the calibration and gives no outputs.  The gyro
+scale is not changed.
+
+Requires:
+- BladeImuFusionStart() has been called
+@param u16Samples_ is the number of samples to average (0 cancels a calibration in progress)
+
+Promises:
+- After u16Samples_ more samples the gyro offsets are set to their average, the orientation is
+  reset to level and the alignment period starts again
+
+*/
+void BladeImuFusionCalibrateGyro(u16 u16Samples_)
+{
+  for(u8 i = 0; i < 3; i++)
+  {
+    BladeImuFusion_as32GyroSum[i] = 0;
+  }
+  BladeImuFusion_u16CalibrationSamples = u16Samples_;
+  BladeImuFusion_u16CalibrationLeft = u16Samples_;
+
+} /* end BladeImuFusionCalibrateGyro() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool BladeImuFusionUpdate(BladeImuFusionSampleType* psSample_)
+
+@brief Runs one sample through the filter (see the steps at the top of this file).
+
+Requires:
+- BladeImuFusionStart() has been called
+- Samples are given in order at the configured period
+@param psSample_ is the raw sample
+
+Promises:
+- Returns TRUE when this sample completes an output (see BladeImuFusionGetOutput())
+- Returns FALSE if fusion is not running, the gyro is being calibrated or the output is not due
+
+*/
+bool BladeImuFusionUpdate(BladeImuFusionSampleType* psSample_)
+{
+  s32* ps32Q = BladeImuFusion_as32Quaternion;
+  s32 as32Half[3];
+  s32 as32Error[3];
+  s32 as32Next[4];
+  s32 s32Accel;
+  s32 s32Gyro;
+  s32 s32Norm;
+  s32 s32Factor;
+  s64 s64Sum;
+  u32 u32Gain;
+
+  if(!BladeImuFusion_bRunning)
+  {
+    return FALSE;
+  }
+
+  /* Gyro calibration: average the raw rates while the device is still */
+  if(BladeImuFusion_u16CalibrationLeft != 0)
+  {
+    for(u8 i = 0; i < 3; i++)
+    {
+      BladeImuFusion_as32GyroSum[i] += psSample_->as16Gyro[i];
+    }
+
+    BladeImuFusion_u16CalibrationLeft--;
+    if(BladeImuFusion_u16CalibrationLeft == 0)
+    {
+      for(u8 i = 0; i < 3; i++)
+      {
+        BladeImuFusion_sCalibration.as16GyroOffset[i] =
+          (s16)(BladeImuFusion_as32GyroSum[i] / (s32)BladeImuFusion_u16CalibrationSamples);
+      }
+
+      ps32Q[0] = S32_BLADE_FUSION_ONE;
+      ps32Q[1] = 0;
+      ps32Q[2] = 0;
+      ps32Q[3] = 0;
+      BladeImuFusion_bFilterPrimed = FALSE;
+      BladeImuFusion_u32AlignLeft = BladeImuFusion_u32AlignSamples;
+    }
+    return FALSE;
+  }
+
+  /* Calibrate, low-pass the accelerometer and turn the rates into half angles for this sample */
+  for(u8 i = 0; i < 3; i++)
+  {
+    s32Gyro = BladeImuFusionCorrect(psSample_->as16Gyro[i], BladeImuFusion_sCalibration.as16GyroOffset[i],
+                                    BladeImuFusion_sCalibration.au16GyroScale[i]);
+    s32Accel = BladeImuFusionCorrect(psSample_->as16Accel[i], BladeImuFusion_sCalibration.as16AccelOffset[i],
+                                     BladeImuFusion_sCalibration.au16AccelScale[i]);
+
+    /* Multiply rather than shift: left shifts of negative values are undefined */
+    if( (BladeImuFusion_u8LowPassShift == 0) || !BladeImuFusion_bFilterPrimed )
+    {
+      BladeImuFusion_as32AccelFiltered[i] = s32Accel * 256;
+    }
+    else
+    {
+      BladeImuFusion_as32AccelFiltered[i] += ((s32Accel * 256) - BladeImuFusion_as32AccelFiltered[i]) >>
+                                             BladeImuFusion_u8LowPassShift;
+    }
+
+    BladeImuFusion_as32RateSum[i] += s32Gyro;
+    as32Half[i] = (s32)( ((s64)s32Gyro * (s32)BladeImuFusion_u32GyroGain) >> 14 );
+  }
+  BladeImuFusion_bFilterPrimed = TRUE;
+
+  /* Turn towards gravity */
+  u32Gain = BladeImuFusion_u32CorrectionGain;
+  if(BladeImuFusion_u32AlignLeft != 0)
+  {
+    BladeImuFusion_u32AlignLeft--;
+    u32Gain = BladeImuFusion_u32AlignGain;
+  }
+
+  if( (u32Gain != 0) && BladeImuFusionAccelError(as32Error) )
+  {
+    for(u8 i = 0; i < 3; i++)
+    {
+      as32Half[i] += (s32)( ((s64)as32Error[i] * (s32)u32Gain) >> 30 );
+    }
+  }
+
+  for(u8 i = 0; i < 3; i++)
+  {
+    if(as32Half[i] > S32_BLADE_FUSION_MAX_HALF_ANGLE)
+    {
+      as32Half[i] = S32_BLADE_FUSION_MAX_HALF_ANGLE;
+    }
+    if(as32Half[i] < -S32_BLADE_FUSION_MAX_HALF_ANGLE)
+    {
+      as32Half[i] = -S32_BLADE_FUSION_MAX_HALF_ANGLE;
+    }
+  }
+
+  /* q = q x (1, half angles): first-order integration of the rotation */
+  as32Next[0] = ps32Q[0] - (s32)( ((s64)ps32Q[1] * as32Half[0] + (s64)ps32Q[2] * as32Half[1] +
+                                   (s64)ps32Q[3] * as32Half[2]) >> 30 );
+  as32Next[1] = ps32Q[1] + (s32)( ((s64)ps32Q[0] * as32Half[0] + (s64)ps32Q[2] * as32Half[2] -
+                                   (s64)ps32Q[3] * as32Half[1]) >> 30 );
+  as32Next[2] = ps32Q[2] + (s32)( ((s64)ps32Q[0] * as32Half[1] - (s64)ps32Q[1] * as32Half[2] +
+                                   (s64)ps32Q[3] * as32Half[0]) >> 30 );
+  as32Next[3] = ps32Q[3] + (s32)( ((s64)ps32Q[0] * as32Half[2] + (s64)ps32Q[1] * as32Half[1] -
+                                   (s64)ps32Q[2] * as32Half[0]) >> 30 );
+
+  /* Back to unit length: one Newton step of 1/sqrt(n), which is exact enough as n is close to 1 */
+  s64Sum = 0;
+  for(u8 i = 0; i < 4; i++)
+  {
+    s64Sum += (s64)as32Next[i] * as32Next[i];
+  }
+  s32Norm = (s32)(s64Sum >> 30);
+  s32Factor = S32_BLADE_FUSION_ONE + ((S32_BLADE_FUSION_ONE - s32Norm) >> 1);
+  for(u8 i = 0; i < 4; i++)
+  {
+    ps32Q[i] = (s32)( ((s64)as32Next[i] * s32Factor) >> 30 );
+  }
+
+  /* Decimate */
+  BladeImuFusion_u16DecimationCount++;
+  if(BladeImuFusion_u16DecimationCount < BladeImuFusion_u16Decimation)
+  {
+    return FALSE;
+  }
+  BladeImuFusion_u16DecimationCount = 0;
+
+  /* q and -q are the same orientation: output the one with W >= 0 */
+  for(u8 i = 0; i < 4; i++)
+  {
+    s32Norm = (ps32Q[0] < 0) ? -ps32Q[i] : ps32Q[i];
+    BladeImuFusion_sOutput.as16Quaternion[i] = (s16)((s32Norm + 0x8000) >> 16);
+  }
+  for(u8 i = 0; i < 3; i++)
+  {
+    BladeImuFusion_sOutput.as16Rate[i] = (s16)(BladeImuFusion_as32RateSum[i] / (s32)BladeImuFusion_u16Decimation);
+    BladeImuFusion_as32RateSum[i] = 0;
+  }
+
+  return TRUE;
+
+} /* end BladeImuFusionUpdate() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void BladeImuFusionGetOutput(BladeImuFusionOutputType* psOutput_)
+
+@brief Copies out the latest output.
+
+Requires:
+@param psOutput_ is where the output is copied
+
+Promises:
+- *psOutput_ holds the output from the last time BladeImuFusionUpdate() returned TRUE (level and
+  still before the first one)
+
+*/
+void BladeImuFusionGetOutput(BladeImuFusionOutputType* psOutput_)
+{
+  *psOutput_ = BladeImuFusion_sOutput;
+
+} /* end BladeImuFusionGetOutput() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void BladeImuFusionToEuler(s16* ps16Quaternion_, BladeImuFusionEulerType* psEuler_)
+
+@brief Converts an output quaternion to Z-Y-X (yaw, pitch, roll) Euler angles.
+
+The arctangent is a polynomial approximation good to about 0.1 degree.  This is for display and
+logging; it is not needed by the filter.
+
+e.g.
+BladeImuFusionOutputType sOutput;
+BladeImuFusionEulerType sAngles;
+
+BladeImuFusionGetOutput(&sOutput);
+BladeImuFusionToEuler(sOutput.as16Quaternion, &sAngles);
+
+Requires:
+@param ps16Quaternion_ points to a unit quaternion W/X/Y/Z in Q14
+@param psEuler_ is where the angles are written
+
+Promises:
+- *psEuler_ holds roll, pitch and yaw in 0.01 degrees
+
+*/
+void BladeImuFusionToEuler(s16* ps16Quaternion_, BladeImuFusionEulerType* psEuler_)
+{
+  s32 s32W = ps16Quaternion_[0];
+  s32 s32X = ps16Quaternion_[1];
+  s32 s32Y = ps16Quaternion_[2];
+  s32 s32Z = ps16Quaternion_[3];
+  s32 s32SinPitch;
+  s32 s32CosPitch;
+
+  /* Products are Q28; both atan2() arguments are halved, which does not change the angle */
+  psEuler_->s16Roll = BladeImuFusionAtan2( (s32W * s32X + s32Y * s32Z) >> 14,
+                                           (((s32)1 << 27) - s32X * s32X - s32Y * s32Y) >> 14 );
+  psEuler_->s16Yaw  = BladeImuFusionAtan2( (s32W * s32Z + s32X * s32Y) >> 14,
+                                           (((s32)1 << 27) - s32Y * s32Y - s32Z * s32Z) >> 14 );
+
+  s32SinPitch = (s32W * s32Y - s32Z * s32X) >> 13;
+  if(s32SinPitch > (s32)U16_BLADE_FUSION_SCALE_ONE)
+  {
+    s32SinPitch = (s32)U16_BLADE_FUSION_SCALE_ONE;
+  }
+  if(s32SinPitch < -(s32)U16_BLADE_FUSION_SCALE_ONE)
+  {
+    s32SinPitch = -(s32)U16_BLADE_FUSION_SCALE_ONE;
+  }
+  s32CosPitch = (s32)BladeImuFusionSqrt( (u32)(((s32)1 << 28) - s32SinPitch * s32SinPitch) );
+  psEuler_->s16Pitch = BladeImuFusionAtan2(s32SinPitch, s32CosPitch);
+
+} /* end BladeImuFusionToEuler() */
+
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static s32 BladeImuFusionCorrect(s16 s16Raw_, s16 s16Offset_, u16 u16Scale_)
+
+@brief Applies one axis of the calibration.
+
+Requires:
+@param s16Raw_ is the raw reading
+@param s16Offset_ is the reading at zero
+@param u16Scale_ is the gain in Q14
+
+Promises:
+- Returns (s16Raw_ - s16Offset_) x u16Scale_ limited to the s16 range, so the squares used for
+  |accel| fit in 32 bits
+
+*/
+static s32 BladeImuFusionCorrect(s16 s16Raw_, s16 s16Offset_, u16 u16Scale_)
+{
+  s32 s32Value = (s32)( ((s64)((s32)s16Raw_ - s16Offset_) * u16Scale_) >> 14 );
+
+  if(s32Value > 32767)
+  {
+    return 32767;
+  }
+  if(s32Value < -32767)
+  {
+    return -32767;
+  }
+
+  return s32Value;
+
+} /* end BladeImuFusionCorrect() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u32 BladeImuFusionSqrt(u32 u32Value_)
+
+@brief Integer square root (bit by bit, 16 steps at most).
+
+Requires:
+@param u32Value_ is the value
+
+Promises:
+- Returns floor(sqrt(u32Value_))
+
+*/
+static u32 BladeImuFusionSqrt(u32 u32Value_)
+{
+  u32 u32Root = 0;
+  u32 u32Bit = 0x40000000;
+
+  while(u32Bit > u32Value_)
+  {
+    u32Bit >>= 2;
+  }
+
+  while(u32Bit != 0)
+  {
+    if(u32Value_ >= (u32Root + u32Bit))
+    {
+      u32Value_ -= u32Root + u32Bit;
+      u32Root = (u32Root >> 1) + u32Bit;
+    }
+    else
+    {
+      u32Root >>= 1;
+    }
+    u32Bit >>= 2;
+  }
+
+  return u32Root;
+
+} /* end BladeImuFusionSqrt() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static s16 BladeImuFusionAtan2(s32 s32Y_, s32 s32X_)
+
+@brief Four-quadrant arctangent in 0.01 degrees.
+
+atan(z) for 0 <= z <= 1 is approximated by pi/4 z + z (1 - z) (0.2447 + 0.0663 z), which is within
+0.0015 rad; the other octants are folded onto it.
+
+Requires:
+@param s32Y_ and s32X_ are within +/-65535
+
+Promises:
+- Returns -18000 to 18000 (0 if both are 0)
+
+*/
+static s16 BladeImuFusionAtan2(s32 s32Y_, s32 s32X_)
+{
+  u32 u32AbsX = (s32X_ < 0) ? (u32)-s32X_ : (u32)s32X_;
+  u32 u32AbsY = (s32Y_ < 0) ? (u32)-s32Y_ : (u32)s32Y_;
+  u32 u32Ratio;
+  u32 u32Radians;
+  s32 s32Angle;
+
+  if( (u32AbsX == 0) && (u32AbsY == 0) )
+  {
+    return 0;
+  }
+
+  /* Ratio of the smaller to the larger in Q15, then atan() of it in Q15 radians */
+  if(u32AbsX >= u32AbsY)
+  {
+    u32Ratio = (u32AbsY << 15) / u32AbsX;
+  }
+  else
+  {
+    u32Ratio = (u32AbsX << 15) / u32AbsY;
+  }
+  u32Radians = ((u32Ratio * U16_BLADE_FUSION_ATAN_PI_4) >> 15) +
+               ((((u32Ratio * (32768 - u32Ratio)) >> 15) *
+                (U16_BLADE_FUSION_ATAN_A + ((u32Ratio * U16_BLADE_FUSION_ATAN_B) >> 15))) >> 15);
+  s32Angle = (s32)((u32Radians * U16_BLADE_FUSION_CENTIDEG_PER_RAD + 0x4000) >> 15);
+
+  if(u32AbsY > u32AbsX)
+  {
+    s32Angle = 9000 - s32Angle;
+  }
+  if(s32X_ < 0)
+  {
+    s32Angle = 18000 - s32Angle;
+  }
+  if(s32Y_ < 0)
+  {
+    s32Angle = -s32Angle;
+  }
+
+  return (s16)s32Angle;
+
+} /* end BladeImuFusionAtan2() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u32 BladeImuFusionGain(u32 u32PeriodUs_, u16 u16TauMs_)
+
+@brief Works out the correction applied per sample for a time constant.
+
+Requires:
+@param u32PeriodUs_ is the sample period (up to U32_BLADE_FUSION_MAX_PERIOD_US)
+@param u16TauMs_ is the time constant (not 0)
+
+Promises:
+- Returns dt / (2 x tau) in Q30, at most 0.5
+
+*/
+static u32 BladeImuFusionGain(u32 u32PeriodUs_, u16 u16TauMs_)
+{
+  u32 u32Gain = (u32PeriodUs_ * U16_BLADE_FUSION_GAIN_Q24) / u16TauMs_;
+
+  if(u32Gain > 0x00800000)
+  {
+    u32Gain = 0x00800000;
+  }
+
+  return (u32Gain << 6);
+
+} /* end BladeImuFusionGain() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static bool BladeImuFusionAccelError(s32* ps32Error_)
+
+@brief Compares the filtered accelerometer direction with the gravity direction the quaternion
+predicts.
+
+Requires:
+@param ps32Error_ points to three s32 for the error
+
+Promises:
+- Returns TRUE with ps32Error_ = accel x predicted gravity (unit vectors, Q30): the axis and sine
+  of the angle between them, in the sensor frame
+- Returns FALSE if |accel| is outside the gate (the device is accelerating or in free fall)
+
+*/
+static bool BladeImuFusionAccelError(s32* ps32Error_)
+{
+  s32* ps32Q = BladeImuFusion_as32Quaternion;
+  s32 as32Accel[3];
+  s32 as32Unit[3];
+  s32 as32Gravity[3];
+  u32 u32Square = 0;
+  u32 u32Norm;
+
+  for(u8 i = 0; i < 3; i++)
+  {
+    as32Accel[i] = BladeImuFusion_as32AccelFiltered[i] >> 8;
+    u32Square += (u32)(as32Accel[i] * as32Accel[i]);
+  }
+
+  u32Norm = BladeImuFusionSqrt(u32Square);
+  if( (u32Norm < BladeImuFusion_u32GateLow) || (u32Norm > BladeImuFusion_u32GateHigh) )
+  {
+    return FALSE;
+  }
+
+  /* Measured direction in Q14 */
+  for(u8 i = 0; i < 3; i++)
+  {
+    as32Unit[i] = (as32Accel[i] * 16384) / (s32)u32Norm;
+  }
+
+  /* Predicted gravity: the world Z axis seen from the sensor, Q30 */
+  as32Gravity[0] = (s32)( ((s64)ps32Q[1] * ps32Q[3] - (s64)ps32Q[0] * ps32Q[2]) >> 29 );
+  as32Gravity[1] = (s32)( ((s64)ps32Q[0] * ps32Q[1] + (s64)ps32Q[2] * ps32Q[3]) >> 29 );
+  as32Gravity[2] = (s32)( ((s64)ps32Q[0] * ps32Q[0] - (s64)ps32Q[1] * ps32Q[1] -
+                           (s64)ps32Q[2] * ps32Q[2] + (s64)ps32Q[3] * ps32Q[3]) >> 30 );
+
+  /* Q14 x Q30 = Q44 */
+  ps32Error_[0] = (s32)( ((s64)as32Unit[1] * as32Gravity[2] - (s64)as32Unit[2] * as32Gravity[1]) >> 14 );
+  ps32Error_[1] = (s32)( ((s64)as32Unit[2] * as32Gravity[0] - (s64)as32Unit[0] * as32Gravity[2]) >> 14 );
+  ps32Error_[2] = (s32)( ((s64)as32Unit[0] * as32Gravity[1] - (s64)as32Unit[1] * as32Gravity[0]) >> 14 );
+
+  return TRUE;
+
+} /* end BladeImuFusionAccelError() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,131 @@
+/*!*********************************************************************************************************************
+@file blade_imu_fusion.h
+@brief Header file for the fixed-point IMU sensor fusion stage.
+
+**********************************************************************************************************************/
+
+#ifndef __BLADE_IMU_FUSION_H
+#define __BLADE_IMU_FUSION_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+/*!
+@struct BladeImuFusionConfigType
+@brief Settings for BladeImuFusionStart()
+*/
+typedef struct
+{
+  u32 u32PeriodUs;          /*!< @brief Sample period in us */
+  u16 u16TauMs;             /*!< @brief Accelerometer correction time constant (0 = gyro only) */
+  u16 u16Decimation;        /*!< @brief Samples per output (1 = every sample) */
+  u8 u8AccelLowPassShift;   /*!< @brief Accelerometer low-pass: each sample moves 1/2^n of the way (0 = off) */
+} BladeImuFusionConfigType;
+
+
+/*!
+@struct BladeImuFusionCalibrationType
+@brief Per-axis corrections applied to each raw sample: (raw - offset) x scale
+*/
+typedef struct
+{
+  s16 as16GyroOffset[3];    /*!< @brief Gyro X/Y/Z zero rate in LSB */
+  s16 as16AccelOffset[3];   /*!< @brief Accelerometer X/Y/Z zero g in LSB */
+  u16 au16GyroScale[3];     /*!< @brief Gyro X/Y/Z gain, Q14 (16384 = 1.0) */
+  u16 au16AccelScale[3];    /*!< @brief Accelerometer X/Y/Z gain, Q14 (16384 = 1.0) */
+} BladeImuFusionCalibrationType;
+
+
+/*!
+@struct BladeImuFusionSampleType
+@brief One raw gyro and accelerometer sample (LSM6DSL at 1000dps and 8g)
+*/
+typedef struct
+{
+  s16 as16Gyro[3];          /*!< @brief Gyro X/Y/Z */
+  s16 as16Accel[3];         /*!< @brief Accelerometer X/Y/Z */
+} BladeImuFusionSampleType;
+
+
+/*!
+@struct BladeImuFusionOutputType
+@brief One decimated output
+*/
+typedef struct
+{
+  s16 as16Quaternion[4];    /*!< @brief Orientation W/X/Y/Z (sensor to world), Q14, W >= 0 */
+  s16 as16Rate[3];          /*!< @brief Calibrated gyro X/Y/Z averaged over the output period, in LSB */
+} BladeImuFusionOutputType;
+
+
+/*!
+@struct BladeImuFusionEulerType
+@brief Orientation as Z-Y-X Euler angles in 0.01 degrees
+*/
+typedef struct
+{
+  s16 s16Roll;              /*!< @brief Rotation about X: -18000 to 18000 */
+  s16 s16Pitch;             /*!< @brief Rotation about Y: -9000 to 9000 */
+  s16 s16Yaw;               /*!< @brief Rotation about Z: -18000 to 18000 (drifts: there is no magnetometer) */
+} BladeImuFusionEulerType;
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool BladeImuFusionStart(BladeImuFusionConfigType* psConfig_);
+void BladeImuFusionSetCalibration(BladeImuFusionCalibrationType* psCalibration_);
+void BladeImuFusionGetCalibration(BladeImuFusionCalibrationType* psCalibration_);
+void BladeImuFusionCalibrateGyro(u16 u16Samples_);
+bool BladeImuFusionUpdate(BladeImuFusionSampleType* psSample_);
+void BladeImuFusionGetOutput(BladeImuFusionOutputType* psOutput_);
+void BladeImuFusionToEuler(s16* ps16Quaternion_, BladeImuFusionEulerType* psEuler_);
+
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+static s32 BladeImuFusionCorrect(s16 s16Raw_, s16 s16Offset_, u16 u16Scale_);
+static u32 BladeImuFusionSqrt(u32 u32Value_);
+static s16 BladeImuFusionAtan2(s32 s32Y_, s32 s32X_);
+static u32 BladeImuFusionGain(u32 u32PeriodUs_, u16 u16TauMs_);
+static bool BladeImuFusionAccelError(s32* ps32Error_);
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define S32_BLADE_FUSION_ONE                  (s32)0x40000000  /*!< @brief 1.0 in Q30 (quaternion and half-angle format) */
+#define U16_BLADE_FUSION_SCALE_ONE            (u16)16384       /*!< @brief 1.0 in Q14 (calibration gains, output quaternion) */
+
+#define U32_BLADE_FUSION_GYRO_Q48             (u32)85972       /*!< @brief Half angle per LSB per us, Q48: 35mdps/LSB at 1000dps = 610.865urad/s */
+#define U32_BLADE_FUSION_MAX_PERIOD_US        (u32)100000      /*!< @brief Slowest sample rate accepted (10Hz) */
+#define U16_BLADE_FUSION_GAIN_Q24             (u16)8389        /*!< @brief 2^24 / 2000: correction gain dt / (2 x tau) in Q24 from dt in us and tau in ms */
+#define U16_BLADE_FUSION_ACCEL_1G             (u16)4098        /*!< @brief Accelerometer LSB per g: 0.244mg/LSB at 8g */
+#define U8_BLADE_FUSION_ACCEL_GATE_PERCENT    (u8)25           /*!< @brief No correction while |accel| is further than this from 1g (the device is accelerating) */
+#define U32_BLADE_FUSION_ALIGN_US             (u32)1000000     /*!< @brief Time after BladeImuFusionStart() (or the gyro calibration) with the fast correction */
+#define U16_BLADE_FUSION_ALIGN_TAU_MS         (u16)50          /*!< @brief Correction time constant while aligning to gravity */
+#define S32_BLADE_FUSION_MAX_HALF_ANGLE       (s32)0x20000000  /*!< @brief Largest half angle per sample (0.5 rad, Q30) */
+
+#define U16_BLADE_FUSION_CENTIDEG_PER_RAD     (u16)5730        /*!< @brief 18000 / pi */
+#define U16_BLADE_FUSION_ATAN_PI_4            (u16)25736       /*!< @brief atan() approximation: pi/4 in Q15 */
+#define U16_BLADE_FUSION_ATAN_A               (u16)8018        /*!< @brief atan() approximation: 0.2447 in Q15 */
+#define U16_BLADE_FUSION_ATAN_B               (u16)2173        /*!< @brief atan() approximation: 0.0663 in Q15 */
+
+
+#endif /* __BLADE_IMU_FUSION_H */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -4,6 +4,32 @@
 
 Provides configuration service and up to 1kHz of 3-axis acceleration, gyro, and compass data.
 
+The LSM6DSL's INT1 line is wired to Blade IO2 and requested as a rising edge interrupt, so reads
+follow the sensor instead of a software timer.  By default INT1 signals accelerometer data ready 
+and each new sample (12.5Hz) is read once.  If INT1 is not available the output registers are read 
+every U32_MEASUREMENT_RATE_MS, and with INT1 a read is still made if it has been quiet for 
+U32_LSM6DSL_INT1_TIMEOUT_MS so a missed edge cannot stop the data.
+
+FIFO STREAMING:
+Bladelsm6dslFifoStart() runs the gyro and accelerometer at up to 1.66kHz into the LSM6DSL's own FIFO 
+with a watermark of U8_LSM6DSL_FIFO_BURST_SAMPLES samples, which INT1 signals.  The task reads 
+FIFO_STATUS on each INT1 edge (or every U32_LSM6DSL_FIFO_POLL_MS without INT1) and, once the 
+watermark is reached (or U32_LSM6DSL_FIFO_MAX_LATENCY_MS has passed), reads the samples out in one 
+TWI burst from FIFO_DATA_OUT.  With INT1 the status is also read every U32_LSM6DSL_FIFO_MAX_LATENCY_MS
+to keep that latency at low rates.  The samples go into a ring of 
+U16_LSM6DSL_SAMPLE_RING_SIZE timestamped lsm6dslSampleType that another task empties with 
+Bladelsm6dslFifoGetSample().  Samples that do not fit in the ring are dropped and counted.
+en+c imufifo starts FIFO streaming at 416Hz, consumes the samples itself and logs the rate.
+
+SENSOR FUSION:
+en+c imufusion starts FIFO streaming at 416Hz and runs the samples through the fixed-point 
+orientation filter in blade_imu_fusion.c, U8_LSM6DSL_FUSION_SAMPLES_PER_PASS at a time so a burst 
+is spread over a few loop passes.  The first U16_LSM6DSL_FUSION_CALIBRATION samples measure the
+gyro offsets, so the board should be still for half a second.  Every U16_LSM6DSL_FUSION_DECIMATION
+samples there is an output (26Hz): with en+c telemetry it goes out as a DEBUG_TELEMETRY_ORIENTATION 
+frame (14 bytes instead of 16 x 12 bytes of samples), otherwise the Euler angles are logged every 
+U32_LSM6DSL_FUSION_REPORT_MS.
+
 ----------------------------------------------------------------------------------------------------------------------
 
 BLADE TASK MAIN FUNCTION CALLS
@@ -12,16 +38,23 @@ BLADE TASK MAIN FUNCTION CALLS
 
 ------------------------------------------------------------------------------------------------------------------------
 GLOBALS
-- G_u32Bladelsm6dslData holds the current IMU data (updated per U16_MEASUREMENT_RATE_MS)
+- G_u32Bladelsm6dslData holds the current IMU data (updated per U16_MEASUREMENT_RATE_MS, or per 
+  FIFO burst in FIFO streaming mode without the temperature)
+- G_u32Bladelsm6dslFlags
 
 CONSTANTS
 - NONE
 
 TYPES
 - lsm6dslDataType
+- lsm6dslRateType
+- lsm6dslSampleType
 
 PUBLIC FUNCTIONS
-- NONE
+- bool Bladelsm6dslFifoStart(lsm6dslRateType eRate_)
+- bool Bladelsm6dslFifoStop(void)
+- u16 Bladelsm6dslFifoSamplesAvailable(void)
+- bool Bladelsm6dslFifoGetSample(lsm6dslSampleType* psSample_)
 
 PROTECTED FUNCTIONS
 - void Bladelsm6dslInitialize(void)
@@ -32,6 +65,7 @@ PROTECTED FUNCTIONS
 
 #include "configuration.h"
 #include "blade_imu_lsm6dsl.h"
+#include "blade_imu_fusion.h"
 
 
 /***********************************************************************************************************************
@@ -49,6 +83,8 @@ extern volatile u32 G_u32SystemTime1ms;                   /*!< @brief From main.
 extern volatile u32 G_u32SystemTime1s;                    /*!< @brief From main.c */
 extern volatile u32 G_u32SystemFlags;                     /*!< @brief From main.c */
 
+extern u32 G_u32DebugFlags;                               /*!< @brief From debug.c */
+
 
 /***********************************************************************************************************************
 Global variable definitions with scope limited to this local application.
@@ -56,6 +92,41 @@ Variable names shall start with "Bladelsm6dsl_<type>" and be declared as static.
 ***********************************************************************************************************************/
 static fnCode_type Bladelsm6dsl_pfStateMachine;           /*!< @brief The state machine function pointer */
 static u32 Bladelsm6dsl_u32Timeout;                       /*!< @brief Timeout counter used across states */
+static volatile bool Bladelsm6dsl_bReadDue;               /*!< @brief Set by INT1 (or the task) when the sensor has data to read */
+
+static TwiTransactionType Bladelsm6dsl_sDataRead;         /*!< @brief Queued read of the output registers */
+static u8 Bladelsm6dsl_au8DataRead[sizeof(lsm6dslDataType)]; /*!< @brief Where the read lands before it is published */
+static volatile bool Bladelsm6dsl_bNewData;               /*!< @brief Set when G_u32Bladelsm6dslData holds a sample not yet reported */
+
+static TwiTransactionType Bladelsm6dsl_sFifoStatusRead;   /*!< @brief Queued read of FIFO_STATUS1 to FIFO_STATUS4 */
+static u8 Bladelsm6dsl_au8FifoStatus[4];                  /*!< @brief FIFO_STATUS1 to FIFO_STATUS4 */
+static TwiTransactionType Bladelsm6dsl_sFifoBurstRead;    /*!< @brief Queued burst read of FIFO_DATA_OUT */
+static u8 Bladelsm6dsl_au8FifoBurst[U16_LSM6DSL_FIFO_BURST_SIZE]; /*!< @brief Where the burst lands */
+static u8 Bladelsm6dsl_u8BurstSkipWords;                  /*!< @brief Words of a partial sample at the start of the burst */
+static u8 Bladelsm6dsl_u8BurstSamples;                    /*!< @brief Whole samples in the burst */
+static u16 Bladelsm6dsl_u16BacklogSamples;                /*!< @brief Samples left in the FIFO after the burst */
+static u32 Bladelsm6dsl_u32StatusTimeUs;                  /*!< @brief When FIFO_STATUS was read (the newest sample's time) */
+static u32 Bladelsm6dsl_u32SamplePeriodUs;                /*!< @brief Sample period at the FIFO rate */
+static u32 Bladelsm6dsl_u32DrainTimer;                    /*!< @brief Last time the FIFO was drained */
+
+static lsm6dslSampleType Bladelsm6dsl_asSampleRing[U16_LSM6DSL_SAMPLE_RING_SIZE]; /*!< @brief Samples waiting for the consumer */
+static u16 Bladelsm6dsl_u16RingHead;                      /*!< @brief Samples written (free running) */
+static u16 Bladelsm6dsl_u16RingTail;                      /*!< @brief Samples taken (free running) */
+
+static u32 Bladelsm6dsl_u32FifoBursts;                    /*!< @brief Statistics: bursts read */
+static u32 Bladelsm6dsl_u32FifoStatusReads;               /*!< @brief Statistics: FIFO_STATUS reads */
+static u32 Bladelsm6dsl_u32FifoOverruns;                  /*!< @brief Statistics: FIFO_STATUS2 OVER_RUN seen */
+static u32 Bladelsm6dsl_u32FifoReadErrors;                /*!< @brief Statistics: status or burst reads that failed */
+static u32 Bladelsm6dsl_u32RingLost;                      /*!< @brief Statistics: samples dropped because the ring was full */
+static u32 Bladelsm6dsl_u32MonitorSamples;                /*!< @brief en+c imufifo: samples consumed this report period */
+static u32 Bladelsm6dsl_u32MonitorBursts;                 /*!< @brief en+c imufifo: Bladelsm6dsl_u32FifoBursts at the last report */
+static u32 Bladelsm6dsl_u32MonitorStatusReads;            /*!< @brief en+c imufifo: Bladelsm6dsl_u32FifoStatusReads at the last report */
+static u32 Bladelsm6dsl_u32MonitorTimer;                  /*!< @brief en+c imufifo: start of the report period */
+static u32 Bladelsm6dsl_u32FusionOutputs;                 /*!< @brief en+c imufusion: outputs this report period */
+static u32 Bladelsm6dsl_u32FusionTimer;                   /*!< @brief en+c imufusion: start of the report period */
+
+/*! @brief Sample period in us for each lsm6dslRateType (starting at LSM6DSL_RATE_12HZ5) */
+static const u32 Bladelsm6dsl_au32RatePeriodUs[] = {80000, 38462, 19231, 9615, 4808, 2404, 1200, 602};
 
 
 /**********************************************************************************************************************
@@ -66,6 +137,169 @@ Function Definitions
 /*! @publicsection */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool Bladelsm6dslFifoStart(lsm6dslRateType eRate_)
+
+@brief Switches the IMU to FIFO streaming at eRate_ (see FIFO STREAMING above).
+
+The gyro and accelerometer output rates are set to eRate_ as well, and the FIFO is emptied first.
+Samples are available from Bladelsm6dslFifoGetSample() once the first burst has been read.
+
+e.g.
+Bladelsm6dslFifoStart(LSM6DSL_RATE_416HZ);
+
+Requires:
+- Bladelsm6dslInitialize() found the IMU
+@param eRate_ is the sample rate
+
+Promises:
+- Returns TRUE and queues the FIFO configuration; the task goes to FIFO streaming and the sample 
+  ring and statistics are cleared
+- Returns FALSE if the IMU is not running, eRate_ is not valid or the TWI could not take the 
+  whole configuration; nothing is queued and the task stays in data ready mode
+
+*/
+bool Bladelsm6dslFifoStart(lsm6dslRateType eRate_)
+{
+  u8 au8Bypass[] = {U8_FIFO_CTRL5, U8_FIFO_CTRL5_BYPASS};
+  u8 au8Odr[] = {U8_CTRL1_XL, 
+                 (U8_CTRL1_XL_INIT & ~U8_CTRL_ODR_MASK) | ((u8)eRate_ << U8_CTRL_ODR_SHIFT), 
+                 (U8_CTRL2_G_INIT & ~U8_CTRL_ODR_MASK) | ((u8)eRate_ << U8_CTRL_ODR_SHIFT)};
+  u8 au8Fifo[] = {U8_FIFO_CTRL1, 
+                  (u8)(U16_LSM6DSL_FIFO_WATERMARK_WORDS & 0xFF), 
+                  (u8)(U16_LSM6DSL_FIFO_WATERMARK_WORDS >> 8), 
+                  U8_FIFO_CTRL3_INIT, 
+                  0x00,
+                  ((u8)eRate_ << U8_FIFO_CTRL5_ODR_SHIFT) | U8_FIFO_CTRL5_CONTINUOUS};
+  u8 au8Int1[] = {U8_INT1_CTRL, U8_INT1_CTRL_FTH};
+  u8* apu8Writes[] = {au8Bypass, au8Odr, au8Fifo, au8Int1};
+  u8 au8Sizes[] = {sizeof(au8Bypass), sizeof(au8Odr), sizeof(au8Fifo), sizeof(au8Int1)};
+
+  if( (Bladelsm6dsl_pfStateMachine == Bladelsm6dslSM_Error) || 
+      (eRate_ < LSM6DSL_RATE_12HZ5) || (eRate_ > LSM6DSL_RATE_1660HZ) )
+  {
+    return FALSE;
+  }
+
+  /* Bypass mode empties the FIFO; the FIFO registers are sequential so they go in one write */
+  if( !Bladelsm6dslWriteSequence(apu8Writes, au8Sizes, (u8)(sizeof(au8Sizes))) )
+  {
+    return FALSE;
+  }
+
+  Bladelsm6dsl_u32SamplePeriodUs = Bladelsm6dsl_au32RatePeriodUs[eRate_ - LSM6DSL_RATE_12HZ5];
+  Bladelsm6dsl_u16RingHead = 0;
+  Bladelsm6dsl_u16RingTail = 0;
+  Bladelsm6dsl_u32FifoBursts = 0;
+  Bladelsm6dsl_u32FifoStatusReads = 0;
+  Bladelsm6dsl_u32FifoOverruns = 0;
+  Bladelsm6dsl_u32FifoReadErrors = 0;
+  Bladelsm6dsl_u32RingLost = 0;
+
+  Bladelsm6dsl_u32Timeout = G_u32SystemTime1ms;
+  Bladelsm6dsl_u32DrainTimer = G_u32SystemTime1ms;
+  G_u32Bladelsm6dslFlags |= _LSM6DSL_FLAGS_FIFO_MODE;
+  Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_FifoIdle;
+
+  return TRUE;
+
+} /* end Bladelsm6dslFifoStart() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool Bladelsm6dslFifoStop(void)
+
+@brief Turns FIFO streaming off and goes back to reading the output registers on data ready
+(or every U32_MEASUREMENT_RATE_MS without INT1).
+
+Requires:
+- NONE
+
+Promises:
+- If FIFO streaming was running, the FIFO is bypassed, the output rates go back to the 
+  U8_CTRL1_XL_INIT / U8_CTRL2_G_INIT values, INT1 goes back to data ready and the task 
+  returns to Idle
+- Returns FALSE if the TWI could not take the whole configuration; nothing is queued, streaming 
+  carries on and the call can be made again
+- Samples still in the ring can be taken
+
+*/
+bool Bladelsm6dslFifoStop(void)
+{
+  u8 au8Bypass[] = {U8_FIFO_CTRL5, U8_FIFO_CTRL5_BYPASS};
+  u8 au8Odr[] = {U8_CTRL1_XL, U8_CTRL1_XL_INIT, U8_CTRL2_G_INIT};
+  u8 au8Int1[] = {U8_INT1_CTRL, U8_INT1_CTRL_DRDY_XL};
+  u8* apu8Writes[] = {au8Bypass, au8Odr, au8Int1};
+  u8 au8Sizes[] = {sizeof(au8Bypass), sizeof(au8Odr), sizeof(au8Int1)};
+
+  if( !(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_FIFO_MODE) )
+  {
+    return TRUE;
+  }
+
+  if( !Bladelsm6dslWriteSequence(apu8Writes, au8Sizes, (u8)(sizeof(au8Sizes))) )
+  {
+    return FALSE;
+  }
+
+  /* Data ready is latched and probably high already, so read once to get the edges going */
+  G_u32Bladelsm6dslFlags &= ~(_LSM6DSL_FLAGS_FIFO_MODE | _LSM6DSL_FLAGS_FIFO_MONITOR | _LSM6DSL_FLAGS_FUSION);
+  Bladelsm6dsl_bReadDue = TRUE;
+  Bladelsm6dsl_u32Timeout = G_u32SystemTime1ms;
+  Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_Idle;
+
+  return TRUE;
+
+} /* end Bladelsm6dslFifoStop() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u16 Bladelsm6dslFifoSamplesAvailable(void)
+
+@brief Returns the number of FIFO samples waiting in the ring.
+
+Requires:
+- Called from a task (not an ISR)
+
+Promises:
+- Returns 0 to U16_LSM6DSL_SAMPLE_RING_SIZE
+
+*/
+u16 Bladelsm6dslFifoSamplesAvailable(void)
+{
+  return( (u16)(Bladelsm6dsl_u16RingHead - Bladelsm6dsl_u16RingTail) );
+
+} /* end Bladelsm6dslFifoSamplesAvailable() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool Bladelsm6dslFifoGetSample(lsm6dslSampleType* psSample_)
+
+@brief Takes the oldest FIFO sample from the ring.
+
+Requires:
+- Called from a task (not an ISR)
+@param psSample_ is where the sample is copied
+
+Promises:
+- Returns TRUE and fills psSample_ if a sample was waiting
+- Returns FALSE and leaves psSample_ alone if the ring is empty
+
+*/
+bool Bladelsm6dslFifoGetSample(lsm6dslSampleType* psSample_)
+{
+  if(Bladelsm6dsl_u16RingHead == Bladelsm6dsl_u16RingTail)
+  {
+    return FALSE;
+  }
+
+  *psSample_ = Bladelsm6dsl_asSampleRing[Bladelsm6dsl_u16RingTail & (U16_LSM6DSL_SAMPLE_RING_SIZE - 1)];
+  Bladelsm6dsl_u16RingTail++;
+
+  return TRUE;
+
+} /* end Bladelsm6dslFifoGetSample() */
+
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /*! @protectedsection */
@@ -81,11 +315,10 @@ Queries the IMU to check ID byte, then proceeds to send configuration data.
 Note: Defaults for CTRL3_C, CTRL4_C, CTRL5_C, CTRL6_C, CTRL7_G, CTRL8_XL,
       CTRL9_X, CTRL10_C, and MASTER_CONFIG are ok and thus not configured.
 
-The IMU is set for basic operation with values updated at 12.5Hz.  No interrupts or special
-functionality is configured -- see the configuration registers for options.  The FIFO is
-also not enabled. The idea is that the device will be polled at an interval maybe 10x per second
-to update and display the data received.  This rate *should* be ok for the LCD refresh and/or
-debug output.
+The IMU is set for basic operation with values updated at 12.5Hz.  Accelerometer data ready
+is routed to INT1 so each sample is read once; no other special functionality is configured -- 
+see the configuration registers for options.  The FIFO is also not enabled.  12.5Hz *should* be 
+ok for the LCD refresh and/or debug output.
 
 Requires:
 - Blade pins (at least for I�C comms) are configured)
@@ -98,6 +331,7 @@ void Bladelsm6dslInitialize(void)
 {
   u8 u8RxMessage = 0;
   u8 au8TxMessage[] = {U8_CTRL1_XL, U8_CTRL1_XL_INIT, U8_CTRL2_G_INIT};
+  u8 au8Int1[] = {U8_INT1_CTRL, U8_INT1_CTRL_DRDY_XL};
   ErrorStatusType eErrorStatus = SUCCESS;
 
   /* Initialize the IMU data global */
@@ -116,8 +350,50 @@ void Bladelsm6dslInitialize(void)
   G_u32Bladelsm6dslData.u8AccelZL = 0;
   G_u32Bladelsm6dslData.u8AccelZH = 0;
 
-  /* Blade resource requests: I2C SCL, SDA, IO2 and IO3 interrupt lines */
-  eErrorStatus += BladeRequestPin(BLADE_PIN2, DIGITAL_IN);
+  /* The measurement read is queued as a transaction so the task knows when the data is valid */
+  Bladelsm6dsl_sDataRead.u8Address = U8_LSM6DSL_I2C_ADDRESS;
+  Bladelsm6dsl_sDataRead.eDirection = TWI_READ;
+  Bladelsm6dsl_sDataRead.u8RegisterSize = 1;
+  Bladelsm6dsl_sDataRead.u32Register = U8_OUT_TEMP_L;
+  Bladelsm6dsl_sDataRead.pu8Data = Bladelsm6dsl_au8DataRead;
+  Bladelsm6dsl_sDataRead.u32Size = sizeof(Bladelsm6dsl_au8DataRead);
+  Bladelsm6dsl_sDataRead.pfnCallback = Bladelsm6dslDataReadDone;
+  Bladelsm6dsl_sDataRead.eState = EMPTY;
+  Bladelsm6dsl_bNewData = FALSE;
+  Bladelsm6dsl_bReadDue = FALSE;
+
+  Bladelsm6dsl_sFifoStatusRead.u8Address = U8_LSM6DSL_I2C_ADDRESS;
+  Bladelsm6dsl_sFifoStatusRead.eDirection = TWI_READ;
+  Bladelsm6dsl_sFifoStatusRead.u8RegisterSize = 1;
+  Bladelsm6dsl_sFifoStatusRead.u32Register = U8_FIFO_STATUS1;
+  Bladelsm6dsl_sFifoStatusRead.pu8Data = Bladelsm6dsl_au8FifoStatus;
+  Bladelsm6dsl_sFifoStatusRead.u32Size = sizeof(Bladelsm6dsl_au8FifoStatus);
+  Bladelsm6dsl_sFifoStatusRead.pfnCallback = NULL;
+  Bladelsm6dsl_sFifoStatusRead.eState = EMPTY;
+
+  /* FIFO_DATA_OUT_H rolls back to FIFO_DATA_OUT_L, so a burst of any length reads the FIFO */
+  Bladelsm6dsl_sFifoBurstRead.u8Address = U8_LSM6DSL_I2C_ADDRESS;
+  Bladelsm6dsl_sFifoBurstRead.eDirection = TWI_READ;
+  Bladelsm6dsl_sFifoBurstRead.u8RegisterSize = 1;
+  Bladelsm6dsl_sFifoBurstRead.u32Register = U8_FIFO_DATA_OUT_L;
+  Bladelsm6dsl_sFifoBurstRead.pu8Data = Bladelsm6dsl_au8FifoBurst;
+  Bladelsm6dsl_sFifoBurstRead.pfnCallback = NULL;
+  Bladelsm6dsl_sFifoBurstRead.eState = EMPTY;
+
+  G_u32Bladelsm6dslFlags = 0;
+  DebugCommandRegister("imufifo", Bladelsm6dslFifoToggle, "Toggle LSM6DSL FIFO streaming at 416Hz");
+  DebugCommandRegister("imufusion", Bladelsm6dslFusionToggle, "Toggle LSM6DSL orientation output (hold still 0.5s)");
+
+  /* Blade resource requests: I2C SCL, SDA, IO2 and IO3 interrupt lines.  INT1 on IO2 starts the reads; 
+  without it the task still runs by polling. */
+  if(BladeRequestPinInterrupt(BLADE_PIN2, BLADE_EDGE_RISING, Bladelsm6dslInt1Handler) == SUCCESS)
+  {
+    G_u32Bladelsm6dslFlags |= _LSM6DSL_FLAGS_INT1;
+  }
+  else
+  {
+    DebugPrintf("LSM6DSL INT1 not available, polling\n\r");
+  }
   eErrorStatus += BladeRequestPin(BLADE_PIN3, DIGITAL_IN);
   eErrorStatus += BladeRequestPin(BLADE_PIN8, PERIPHERAL);
   eErrorStatus += BladeRequestPin(BLADE_PIN9, PERIPHERAL);
@@ -130,6 +406,9 @@ void Bladelsm6dslInitialize(void)
     DebugPrintf("LSM6DSL Blade pin resources allocated\n\r");
   }
 
+  /* The LSM6DSL supports Fast-mode, which cuts the time of each 14-byte data read by more than half */
+  TwiSetDeviceSpeed(U8_LSM6DSL_I2C_ADDRESS, TWI_SPEED_400KHZ);
+
   /* Ping the accelerometer to check it's responding by reading its ID byte */
   TwiWriteReadData(U8_LSM6DSL_I2C_ADDRESS, U8_WHO_AM_I, &u8RxMessage, 1);
   if(u8RxMessage != U8_LSM6DSL_ID)
@@ -145,6 +424,7 @@ void Bladelsm6dslInitialize(void)
 
     /* Send basic configuration - the two registers are sequential so can be done in a single write */
     TwiWriteData(U8_LSM6DSL_I2C_ADDRESS, 3, au8TxMessage, TWI_STOP);
+    TwiWriteData(U8_LSM6DSL_I2C_ADDRESS, sizeof(au8Int1), au8Int1, TWI_STOP);
   }
 
   /* If good initialization, set state to Idle */
@@ -181,6 +461,16 @@ void Bladelsm6dslRunActiveState(void)
 {
   Bladelsm6dsl_pfStateMachine();
 
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_FIFO_MONITOR)
+  {
+    Bladelsm6dslFifoMonitor();
+  }
+
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_FUSION)
+  {
+    Bladelsm6dslFusionRun();
+  }
+
 } /* end Bladelsm6dslRunActiveState */
 
 
@@ -188,69 +478,563 @@ void Bladelsm6dslRunActiveState(void)
 /*! @privatesection */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslInt1Handler(void)
+
+@brief Blade IO2 rising edge handler (from the PIO ISR): INT1 says there is data to read.
+
+Requires:
+- INT1_CTRL routes data ready (Idle) or the FIFO watermark (FIFO streaming) to INT1
+
+Promises:
+- Bladelsm6dsl_bReadDue is set; the state machine queues the read
+
+*/
+static void Bladelsm6dslInt1Handler(void)
+{
+  Bladelsm6dsl_bReadDue = TRUE;
+
+} /* end Bladelsm6dslInt1Handler() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslDataReadDone(TwiTransactionType* psTransaction_)
+
+@brief TWI transaction callback (from the TWI ISR) for the measurement read.
+
+Requires:
+@param psTransaction_ is Bladelsm6dsl_sDataRead
+
+Promises:
+- A complete read is copied to G_u32Bladelsm6dslData and Bladelsm6dsl_bNewData is set; a failed
+  read leaves the last sample in place
+
+*/
+static void Bladelsm6dslDataReadDone(TwiTransactionType* psTransaction_)
+{
+  u8* pu8Sample = &G_u32Bladelsm6dslData.u8TempL;
+
+  if(psTransaction_->eState == COMPLETE)
+  {
+    for(u8 i = 0; i < sizeof(lsm6dslDataType); i++)
+    {
+      pu8Sample[i] = psTransaction_->pu8Data[i];
+    }
+    Bladelsm6dsl_bNewData = TRUE;
+  }
+
+} /* end Bladelsm6dslDataReadDone() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static bool Bladelsm6dslWriteSequence(u8* apu8Writes_[], u8* au8Sizes_, u8 u8Count_)
+
+@brief Queues a sequence of register writes to the IMU, either all of them or none.
+
+A sequence that stops part way (e.g. FIFO bypassed but INT1 still on data ready) leaves the sensor
+out of step with G_u32Bladelsm6dslFlags, so every message is borrowed and the TWI message queue is
+checked for room before the first write is committed.
+
+Requires:
+- Task context: nothing else queues TWI messages between the check and the commits
+- u8Count_ is at most U8_LSM6DSL_MAX_SEQUENCE_WRITES
+
+@param apu8Writes_ Register address followed by the data for each write
+@param au8Sizes_ Bytes in each write
+@param u8Count_ Number of writes
+
+Promises:
+- Returns TRUE with all the writes queued in order
+- Returns FALSE with nothing queued if the messaging arena or the TWI could not take them all
+
+*/
+static bool Bladelsm6dslWriteSequence(u8* apu8Writes_[], u8* au8Sizes_, u8 u8Count_)
+{
+  MessageType* apsMessages[U8_LSM6DSL_MAX_SEQUENCE_WRITES];
+  u8 u8Reserved = 0;
+
+  if(u8Count_ > U8_LSM6DSL_MAX_SEQUENCE_WRITES)
+  {
+    return FALSE;
+  }
+
+  while(u8Reserved < u8Count_)
+  {
+    apsMessages[u8Reserved] = ReserveMessage();
+    if(apsMessages[u8Reserved] == NULL)
+    {
+      break;
+    }
+    u8Reserved++;
+  }
+
+  if( (u8Reserved < u8Count_) || (TwiGetFreeMessages() < u8Count_) )
+  {
+    while(u8Reserved != 0)
+    {
+      u8Reserved--;
+      ReleaseMessage(apsMessages[u8Reserved]);
+    }
+    return FALSE;
+  }
+
+  /* The checks above leave TwiCommitData() nothing to refuse */
+  for(u8 i = 0; i < u8Count_; i++)
+  {
+    for(u8 j = 0; j < au8Sizes_[i]; j++)
+    {
+      apsMessages[i]->pu8Data[j] = apu8Writes_[i][j];
+    }
+    (void)TwiCommitData(U8_LSM6DSL_I2C_ADDRESS, apsMessages[i], au8Sizes_[i], TWI_STOP);
+  }
+
+  return TRUE;
+
+} /* end Bladelsm6dslWriteSequence() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslFifoToggle(void)
+
+@brief Debug command (en+c imufifo) that starts or stops FIFO streaming at 416Hz.
+
+While the command has streaming on, the task takes the samples itself and logs the rate every 
+U32_LSM6DSL_FIFO_REPORT_MS (see Bladelsm6dslFifoMonitor()), so do not use it alongside another 
+consumer.
+
+Requires:
+- NONE
+
+Promises:
+- FIFO streaming with _LSM6DSL_FLAGS_FIFO_MONITOR is started, or stopped if it was running
+
+*/
+static void Bladelsm6dslFifoToggle(void)
+{
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_FIFO_MODE)
+  {
+    if(Bladelsm6dslFifoStop())
+    {
+      DebugPrintf("\n\rLSM6DSL FIFO streaming off\n\r");
+    }
+    else
+    {
+      DebugPrintf("\n\rLSM6DSL TWI busy, try again\n\r");
+    }
+    return;
+  }
+
+  if(!Bladelsm6dslFifoStart(LSM6DSL_RATE_416HZ))
+  {
+    DebugPrintf("\n\rLSM6DSL not running or TWI busy\n\r");
+    return;
+  }
+
+  Bladelsm6dsl_u32MonitorSamples = 0;
+  Bladelsm6dsl_u32MonitorBursts = 0;
+  Bladelsm6dsl_u32MonitorTimer = G_u32SystemTime1ms;
+  G_u32Bladelsm6dslFlags |= _LSM6DSL_FLAGS_FIFO_MONITOR;
+  DebugPrintf("\n\rLSM6DSL FIFO streaming on\n\r");
+
+} /* end Bladelsm6dslFifoToggle() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslFifoUnpack(void)
+
+@brief Moves the samples of a finished burst into the ring.
+
+The FIFO holds gyro X/Y/Z then accelerometer X/Y/Z for each sample, least significant byte first.
+The newest sample in the FIFO was taken about when FIFO_STATUS was read, so each sample's time is 
+counted back from there in sample periods.
+
+Requires:
+- Bladelsm6dsl_au8FifoBurst holds Bladelsm6dsl_u8BurstSkipWords words to ignore followed by 
+  Bladelsm6dsl_u8BurstSamples samples
+
+Promises:
+- Samples are added to the ring; those that do not fit are counted in Bladelsm6dsl_u32RingLost
+- G_u32Bladelsm6dslData gyro and accelerometer bytes hold the newest sample
+
+*/
+static void Bladelsm6dslFifoUnpack(void)
+{
+  u8* pu8Word = &Bladelsm6dsl_au8FifoBurst[Bladelsm6dsl_u8BurstSkipWords * 2];
+  s16 as16Words[U8_LSM6DSL_FIFO_SAMPLE_WORDS];
+  lsm6dslSampleType* psSample;
+  u32 u32SamplesBack;
+  u8* pu8Data = &G_u32Bladelsm6dslData.u8GyroXL;
+
+  for(u8 i = 0; i < Bladelsm6dsl_u8BurstSamples; i++)
+  {
+    for(u8 j = 0; j < U8_LSM6DSL_FIFO_SAMPLE_WORDS; j++)
+    {
+      as16Words[j] = (s16)((u16)pu8Word[0] | ((u16)pu8Word[1] << 8));
+      pu8Word += 2;
+    }
+
+    if( (u16)(Bladelsm6dsl_u16RingHead - Bladelsm6dsl_u16RingTail) == U16_LSM6DSL_SAMPLE_RING_SIZE )
+    {
+      Bladelsm6dsl_u32RingLost++;
+      continue;
+    }
+
+    u32SamplesBack = (u32)(Bladelsm6dsl_u8BurstSamples - 1 - i) + Bladelsm6dsl_u16BacklogSamples;
+    psSample = &Bladelsm6dsl_asSampleRing[Bladelsm6dsl_u16RingHead & (U16_LSM6DSL_SAMPLE_RING_SIZE - 1)];
+    psSample->u32TimeUs = Bladelsm6dsl_u32StatusTimeUs - (u32SamplesBack * Bladelsm6dsl_u32SamplePeriodUs);
+    psSample->s16GyroX  = as16Words[0];
+    psSample->s16GyroY  = as16Words[1];
+    psSample->s16GyroZ  = as16Words[2];
+    psSample->s16AccelX = as16Words[3];
+    psSample->s16AccelY = as16Words[4];
+    psSample->s16AccelZ = as16Words[5];
+    Bladelsm6dsl_u16RingHead++;
+  }
+
+  /* Keep the polled-mode global current (bytes are in register order) */
+  pu8Word -= (U8_LSM6DSL_FIFO_SAMPLE_WORDS * 2);
+  for(u8 i = 0; i < (U8_LSM6DSL_FIFO_SAMPLE_WORDS * 2); i++)
+  {
+    pu8Data[i] = pu8Word[i];
+  }
+
+} /* end Bladelsm6dslFifoUnpack() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslFifoMonitor(void)
+
+@brief en+c imufifo consumer: takes every sample from the ring and logs the rate.
+
+Requires:
+- _LSM6DSL_FLAGS_FIFO_MONITOR is set
+
+Promises:
+- The ring is emptied
+- Every U32_LSM6DSL_FIFO_REPORT_MS, DEBUG_LOG_LSM6DSL_FIFO is logged with the samples, bursts and 
+  FIFO_STATUS reads of the period and the overrun, lost-sample and read-error totals
+
+*/
+static void Bladelsm6dslFifoMonitor(void)
+{
+  lsm6dslSampleType sSample;
+
+  while(Bladelsm6dslFifoGetSample(&sSample))
+  {
+    Bladelsm6dsl_u32MonitorSamples++;
+  }
+
+  if( IsTimeUp(&Bladelsm6dsl_u32MonitorTimer, U32_LSM6DSL_FIFO_REPORT_MS) )
+  {
+    Bladelsm6dsl_u32MonitorTimer = G_u32SystemTime1ms;
+    DebugLog(DEBUG_LOG_LSM6DSL_FIFO, Bladelsm6dsl_u32MonitorSamples, 
+             Bladelsm6dsl_u32FifoBursts - Bladelsm6dsl_u32MonitorBursts,
+             Bladelsm6dsl_u32FifoStatusReads - Bladelsm6dsl_u32MonitorStatusReads,
+             Bladelsm6dsl_u32FifoOverruns, Bladelsm6dsl_u32RingLost, Bladelsm6dsl_u32FifoReadErrors);
+    Bladelsm6dsl_u32MonitorSamples = 0;
+    Bladelsm6dsl_u32MonitorBursts = Bladelsm6dsl_u32FifoBursts;
+    Bladelsm6dsl_u32MonitorStatusReads = Bladelsm6dsl_u32FifoStatusReads;
+  }
+
+} /* end Bladelsm6dslFifoMonitor() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslFusionToggle(void)
+
+@brief Debug command (en+c imufusion) that starts or stops FIFO streaming at 416Hz with the 
+samples going through the orientation filter.
+
+Like en+c imufifo, the task takes the samples itself, so do not use it alongside another consumer.
+
+Requires:
+- NONE
+
+Promises:
+- FIFO streaming with _LSM6DSL_FLAGS_FUSION is started and the fusion is set up to measure the 
+  gyro offsets first, or FIFO streaming is stopped if it was running
+
+*/
+static void Bladelsm6dslFusionToggle(void)
+{
+  BladeImuFusionConfigType sConfig;
+
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_FIFO_MODE)
+  {
+    if(Bladelsm6dslFifoStop())
+    {
+      DebugPrintf("\n\rLSM6DSL FIFO streaming off\n\r");
+    }
+    else
+    {
+      DebugPrintf("\n\rLSM6DSL TWI busy, try again\n\r");
+    }
+    return;
+  }
+
+  if(!Bladelsm6dslFifoStart(LSM6DSL_RATE_416HZ))
+  {
+    DebugPrintf("\n\rLSM6DSL not running or TWI busy\n\r");
+    return;
+  }
+
+  sConfig.u32PeriodUs = Bladelsm6dsl_u32SamplePeriodUs;
+  sConfig.u16TauMs = U16_LSM6DSL_FUSION_TAU_MS;
+  sConfig.u16Decimation = U16_LSM6DSL_FUSION_DECIMATION;
+  sConfig.u8AccelLowPassShift = U8_LSM6DSL_FUSION_LOW_PASS_SHIFT;
+  BladeImuFusionStart(&sConfig);
+  BladeImuFusionCalibrateGyro(U16_LSM6DSL_FUSION_CALIBRATION);
+
+  Bladelsm6dsl_u32FusionOutputs = 0;
+  Bladelsm6dsl_u32FusionTimer = G_u32SystemTime1ms;
+  G_u32Bladelsm6dslFlags |= _LSM6DSL_FLAGS_FUSION;
+  DebugPrintf("\n\rLSM6DSL fusion on: hold still\n\r");
+
+} /* end Bladelsm6dslFusionToggle() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void Bladelsm6dslFusionRun(void)
+
+@brief en+c imufusion consumer: feeds FIFO samples to the orientation filter and publishes the outputs.
+
+At most U8_LSM6DSL_FUSION_SAMPLES_PER_PASS samples are fused per call, which is still many times 
+the sample rate, so a 32-sample burst is worked off over a few passes and the ring never backs up.
+
+Requires:
+- _LSM6DSL_FLAGS_FUSION is set
+
+Promises:
+- Up to U8_LSM6DSL_FUSION_SAMPLES_PER_PASS samples are taken from the ring and fused
+- With telemetry on, each output is sent as a DEBUG_TELEMETRY_ORIENTATION frame; otherwise 
+  DEBUG_LOG_IMU_FUSION is logged every U32_LSM6DSL_FUSION_REPORT_MS with the latest Euler angles
+
+*/
+static void Bladelsm6dslFusionRun(void)
+{
+  lsm6dslSampleType sSample;
+  BladeImuFusionSampleType sFusionSample;
+  BladeImuFusionOutputType sOutput;
+  BladeImuFusionEulerType sAngles;
+
+  for(u8 i = 0; i < U8_LSM6DSL_FUSION_SAMPLES_PER_PASS; i++)
+  {
+    if(!Bladelsm6dslFifoGetSample(&sSample))
+    {
+      break;
+    }
+
+    sFusionSample.as16Gyro[0]  = sSample.s16GyroX;
+    sFusionSample.as16Gyro[1]  = sSample.s16GyroY;
+    sFusionSample.as16Gyro[2]  = sSample.s16GyroZ;
+    sFusionSample.as16Accel[0] = sSample.s16AccelX;
+    sFusionSample.as16Accel[1] = sSample.s16AccelY;
+    sFusionSample.as16Accel[2] = sSample.s16AccelZ;
+    if(BladeImuFusionUpdate(&sFusionSample))
+    {
+      Bladelsm6dsl_u32FusionOutputs++;
+      if(G_u32DebugFlags & _DEBUG_TELEMETRY_ENABLE)
+      {
+        BladeImuFusionGetOutput(&sOutput);
+        DebugTelemetrySend(DEBUG_TELEMETRY_ORIENTATION, (u8*)&sOutput, sizeof(sOutput));
+      }
+    }
+  }
+
+  if( IsTimeUp(&Bladelsm6dsl_u32FusionTimer, U32_LSM6DSL_FUSION_REPORT_MS) )
+  {
+    Bladelsm6dsl_u32FusionTimer = G_u32SystemTime1ms;
+    if( !(G_u32DebugFlags & _DEBUG_TELEMETRY_ENABLE) )
+    {
+      BladeImuFusionGetOutput(&sOutput);
+      BladeImuFusionToEuler(sOutput.as16Quaternion, &sAngles);
+      DebugLog(DEBUG_LOG_IMU_FUSION, (u32)(s32)sAngles.s16Roll, (u32)(s32)sAngles.s16Pitch, 
+               (u32)(s32)sAngles.s16Yaw, (Bladelsm6dsl_u32FusionOutputs * 1000) / U32_LSM6DSL_FUSION_REPORT_MS);
+    }
+    Bladelsm6dsl_u32FusionOutputs = 0;
+  }
+
+} /* end Bladelsm6dslFusionRun() */
+
 
 /**********************************************************************************************************************
 State Machine Function Definitions
 **********************************************************************************************************************/
 /*-------------------------------------------------------------------------------------------------------------------*/
-/* Read the IMU every U32_MEASUREMENT_RATE_MS and send out the values on the debug port.
-Currently this makes no attempt to format or process the values.
+/* Read the IMU on each INT1 data ready edge (or every U32_MEASUREMENT_RATE_MS without INT1) and send out
+the values on the debug port once each read has finished.  Currently this makes no attempt to format or 
+process the values.  DebugLog() only stores the raw words here; the debug task formats them later.
 Be careful with data processing -- if you refresh the IMU at too fast an interval, the TWI message system
 will be overwhelmed.  Similarily, if you send the results out the debug port (or to the LCD) too quickly,
-the messaging system will get overwhelmed.  */
+the messaging system will get overwhelmed.  The log records at least wait in the debug task's ring while
+its "log" output budget is used up (see OUTPUT BUDGETS in debug.c); a full ring drops them.  */
 static void Bladelsm6dslSM_Idle(void)
 {
-  static u8 au8Outputmessage[] = "00000 00000 00000 00000 00000 00000 00000\n\r";
-  u32 u32Number;
-  u8 au8NumberString[11];
-  u8* pu8NumberIndex;
-  u8* pu8NumberParser;
-  u8* pu8StringParser;
-  u8  u8Digits;
+  u8* pu8Data;
+  u32 u32PollMs = U32_MEASUREMENT_RATE_MS;
+
+  /* With INT1 the timer only covers a missed edge */
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_INT1)
+  {
+    u32PollMs = U32_LSM6DSL_INT1_TIMEOUT_MS;
+  }
 
-  /* Read the latest IMU data if it's time */
-  if( IsTimeUp(&Bladelsm6dsl_u32Timeout, U32_MEASUREMENT_RATE_MS) )
+  /* Read the latest IMU data when it's ready (a data ready edge stays due until its read is queued; 
+  a timed read that cannot be queued just skips a period) */
+  if( Bladelsm6dsl_bReadDue || IsTimeUp(&Bladelsm6dsl_u32Timeout, u32PollMs) )
   {
     Bladelsm6dsl_u32Timeout = G_u32SystemTime1ms;
-    TwiWriteReadData(U8_LSM6DSL_I2C_ADDRESS, U8_OUT_TEMP_L, &G_u32Bladelsm6dslData.u8TempL, 14);
+    if(TwiQueueTransaction(&Bladelsm6dsl_sDataRead))
+    {
+      Bladelsm6dsl_bReadDue = FALSE;
+    }
+  }
+
+  /* Report each sample once its read is done.  The telemetry stream carries the raw registers, 
+  otherwise they are logged as text. */
+  if(Bladelsm6dsl_bNewData)
+  {
+    Bladelsm6dsl_bNewData = FALSE;
+    pu8Data = &G_u32Bladelsm6dslData.u8TempL;
+    if(G_u32DebugFlags & _DEBUG_TELEMETRY_ENABLE)
+    {
+      DebugTelemetrySend(DEBUG_TELEMETRY_LSM6DSL, pu8Data, sizeof(G_u32Bladelsm6dslData));
+    }
+    else
+    {
+      DebugLog(DEBUG_LOG_LSM6DSL_DATA,
+               (u32)pu8Data[0]  | ((u32)pu8Data[1] << 8),
+               (u32)pu8Data[2]  | ((u32)pu8Data[3] << 8),
+               (u32)pu8Data[4]  | ((u32)pu8Data[5] << 8),
+               (u32)pu8Data[6]  | ((u32)pu8Data[7] << 8),
+               (u32)pu8Data[8]  | ((u32)pu8Data[9] << 8),
+               (u32)pu8Data[10] | ((u32)pu8Data[11] << 8),
+               (u32)pu8Data[12] | ((u32)pu8Data[13] << 8));
+    }
+  } /* end if(Bladelsm6dsl_bNewData) */
+
+} /* end Bladelsm6dslSM_Idle() */
+
+
+/*-------------------------------------------------------------------------------------------------------------------*/
+/* FIFO streaming: read FIFO_STATUS on each INT1 watermark edge, or every U32_LSM6DSL_FIFO_POLL_MS 
+without INT1.  With INT1 the timer only keeps U32_LSM6DSL_FIFO_MAX_LATENCY_MS below the watermark. */
+static void Bladelsm6dslSM_FifoIdle(void)
+{
+  u32 u32PollMs = U32_LSM6DSL_FIFO_POLL_MS;
 
-    /* Write data to debug this will be 1 write behind newest data since the command will not yet be queued */
-    pu8NumberIndex = &G_u32Bladelsm6dslData.u8TempL;
-    pu8StringParser = au8Outputmessage;
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_INT1)
+  {
+    u32PollMs = U32_LSM6DSL_FIFO_MAX_LATENCY_MS;
+  }
 
-    for(u8 i = 0; i < 7; i++)
+  if( Bladelsm6dsl_bReadDue || IsTimeUp(&Bladelsm6dsl_u32Timeout, u32PollMs) )
+  {
+    if(TwiQueueTransaction(&Bladelsm6dsl_sFifoStatusRead))
     {
-      u32Number = 0;
-      u32Number |= (u32)*pu8NumberIndex;
-      pu8NumberIndex++;
-      u32Number |= ((u32)(*pu8NumberIndex << 8)) & 0x0000FF00;
-      pu8NumberIndex++;
-      u8Digits = NumberToAscii(u32Number, au8NumberString);
-      pu8NumberParser = au8NumberString;
-
-      /* Copy ASCII number into result string including leading 0s */
-      u8Digits = 5 - u8Digits;
-      for(u8 j= 0; j < u8Digits; j++)
-      {
-        *pu8StringParser = '0';
-        pu8StringParser++;
-      }
-      u8Digits = 5 - u8Digits;
-      for(u8 j = 0; j < u8Digits; j++)
-      {
-        *pu8StringParser = *pu8NumberParser;
-        pu8StringParser++;
-        pu8NumberParser++;
-      }
+      Bladelsm6dsl_bReadDue = FALSE;
+      Bladelsm6dsl_u32FifoStatusReads++;
+      Bladelsm6dsl_u32Timeout = G_u32SystemTime1ms;
+      Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_FifoStatus;
+    }
+  }
 
-      /* Skip the space */
-      pu8StringParser++;
-    } /* end for(u8 i = 0; i < 7; i++) */
+} /* end Bladelsm6dslSM_FifoIdle() */
 
-    DebugPrintf(au8Outputmessage);
-  } /* end if( IsTimeUp(&Bladelsm6dsl_u32Timeout, U32_MEASUREMENT_RATE_MS) ) */
 
-} /* end Bladelsm6dslSM_Idle() */
+/*-------------------------------------------------------------------------------------------------------------------*/
+/* FIFO streaming: decide from FIFO_STATUS whether to drain and how much.  The burst starts on a 
+sample boundary: FIFO_PATTERN says which word comes next, so a partial sample is read and skipped. */
+static void Bladelsm6dslSM_FifoStatus(void)
+{
+  u16 u16Words;
+  u16 u16Pattern;
+  u16 u16Samples;
+
+  if( (Bladelsm6dsl_sFifoStatusRead.eState == WAITING) || (Bladelsm6dsl_sFifoStatusRead.eState == SENDING) )
+  {
+    return;
+  }
+
+  Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_FifoIdle;
+  if(Bladelsm6dsl_sFifoStatusRead.eState != COMPLETE)
+  {
+    Bladelsm6dsl_u32FifoReadErrors++;
+    return;
+  }
+
+  /* Wraps every 71.6 minutes with the product; sample times are only compared by subtraction */
+  Bladelsm6dsl_u32StatusTimeUs = G_u32SystemTime1ms * 1000;
+  u16Words = (u16)Bladelsm6dsl_au8FifoStatus[0] | 
+             ((u16)(Bladelsm6dsl_au8FifoStatus[1] & U8_FIFO_STATUS2_DIFF_MASK) << 8);
+  u16Pattern = (u16)Bladelsm6dsl_au8FifoStatus[2] | 
+               ((u16)(Bladelsm6dsl_au8FifoStatus[3] & U8_FIFO_STATUS4_PATTERN_MASK) << 8);
+  if(Bladelsm6dsl_au8FifoStatus[1] & U8_FIFO_STATUS2_OVER_RUN)
+  {
+    Bladelsm6dsl_u32FifoOverruns++;
+  }
+
+  /* Wait for the watermark unless the oldest samples have waited long enough */
+  if( !(Bladelsm6dsl_au8FifoStatus[1] & U8_FIFO_STATUS2_WATERM) &&
+      !IsTimeUp(&Bladelsm6dsl_u32DrainTimer, U32_LSM6DSL_FIFO_MAX_LATENCY_MS) )
+  {
+    return;
+  }
+
+  Bladelsm6dsl_u8BurstSkipWords = (u16Pattern == 0) ? 0 : (u8)(U8_LSM6DSL_FIFO_SAMPLE_WORDS - u16Pattern);
+  if(u16Words < (Bladelsm6dsl_u8BurstSkipWords + U8_LSM6DSL_FIFO_SAMPLE_WORDS))
+  {
+    return;
+  }
+
+  u16Samples = (u16Words - Bladelsm6dsl_u8BurstSkipWords) / U8_LSM6DSL_FIFO_SAMPLE_WORDS;
+  Bladelsm6dsl_u8BurstSamples = (u16Samples > U8_LSM6DSL_FIFO_BURST_SAMPLES) ? 
+                                U8_LSM6DSL_FIFO_BURST_SAMPLES : (u8)u16Samples;
+  Bladelsm6dsl_u16BacklogSamples = u16Samples - Bladelsm6dsl_u8BurstSamples;
+
+  Bladelsm6dsl_sFifoBurstRead.u32Size = 2 * ((u32)Bladelsm6dsl_u8BurstSkipWords + 
+                                        ((u32)Bladelsm6dsl_u8BurstSamples * U8_LSM6DSL_FIFO_SAMPLE_WORDS));
+  if(TwiQueueTransaction(&Bladelsm6dsl_sFifoBurstRead))
+  {
+    Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_FifoBurst;
+  }
+
+} /* end Bladelsm6dslSM_FifoStatus() */
+
+
+/*-------------------------------------------------------------------------------------------------------------------*/
+/* FIFO streaming: unpack the burst once it is in.  The FIFO is checked again straight away if it 
+still holds the watermark, as INT1 will not rise again (without INT1: if more than a burst was waiting).
+INT1 can also bounce across the watermark while the burst is read, so edges from then are dropped. */
+static void Bladelsm6dslSM_FifoBurst(void)
+{
+  if( (Bladelsm6dsl_sFifoBurstRead.eState == WAITING) || (Bladelsm6dsl_sFifoBurstRead.eState == SENDING) )
+  {
+    return;
+  }
+
+  if(Bladelsm6dsl_sFifoBurstRead.eState == COMPLETE)
+  {
+    Bladelsm6dsl_u32FifoBursts++;
+    Bladelsm6dslFifoUnpack();
+  }
+  else
+  {
+    Bladelsm6dsl_u32FifoReadErrors++;
+  }
+
+  Bladelsm6dsl_u32DrainTimer = G_u32SystemTime1ms;
+  if(G_u32Bladelsm6dslFlags & _LSM6DSL_FLAGS_INT1)
+  {
+    Bladelsm6dsl_bReadDue = BladePinIsHigh(BLADE_PIN2);
+  }
+  else if(Bladelsm6dsl_u16BacklogSamples != 0)
+  {
+    Bladelsm6dsl_bReadDue = TRUE;
+  }
+  Bladelsm6dsl_pfStateMachine = Bladelsm6dslSM_FifoIdle;
+
+} /* end Bladelsm6dslSM_FifoBurst() */
 
 
 /*-------------------------------------------------------------------------------------------------------------------*/
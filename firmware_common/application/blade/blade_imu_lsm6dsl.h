@@ -33,6 +33,31 @@ typedef struct
 } lsm6dslDataType;
 
 
+/*! 
+@enum lsm6dslRateType
+@brief Sample rates for Bladelsm6dslFifoStart().  The values are the ODR codes of CTRL1_XL, CTRL2_G 
+and FIFO_CTRL5.
+*/
+typedef enum {LSM6DSL_RATE_12HZ5 = 1, LSM6DSL_RATE_26HZ, LSM6DSL_RATE_52HZ, LSM6DSL_RATE_104HZ, 
+              LSM6DSL_RATE_208HZ, LSM6DSL_RATE_416HZ, LSM6DSL_RATE_833HZ, LSM6DSL_RATE_1660HZ} lsm6dslRateType;
+
+
+/*! 
+@struct lsm6dslSampleType
+@brief One gyro and accelerometer sample taken from the LSM6DSL FIFO 
+*/
+typedef struct
+{
+  u32 u32TimeUs;            /*!< @brief Estimated sample time in us on a G_u32SystemTime1ms x 1000 time base.  Wraps every 2^32 us (71.6 minutes), so only differences are meaningful */
+  s16 s16GyroX;             /*!< @brief Gyro X */
+  s16 s16GyroY;             /*!< @brief Gyro Y */
+  s16 s16GyroZ;             /*!< @brief Gyro Z */
+  s16 s16AccelX;            /*!< @brief Accelerometer X */
+  s16 s16AccelY;            /*!< @brief Accelerometer Y */
+  s16 s16AccelZ;            /*!< @brief Accelerometer Z */
+} lsm6dslSampleType;
+
+
 /**********************************************************************************************************************
 Function Declarations
 **********************************************************************************************************************/
@@ -40,6 +65,10 @@ Function Declarations
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @publicsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
+bool Bladelsm6dslFifoStart(lsm6dslRateType eRate_);
+bool Bladelsm6dslFifoStop(void);
+u16 Bladelsm6dslFifoSamplesAvailable(void);
+bool Bladelsm6dslFifoGetSample(lsm6dslSampleType* psSample_);
 
 
 /*------------------------------------------------------------------------------------------------------------------*/
@@ -52,12 +81,23 @@ void Bladelsm6dslRunActiveState(void);
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
+static void Bladelsm6dslInt1Handler(void);
+static void Bladelsm6dslDataReadDone(TwiTransactionType* psTransaction_);
+static bool Bladelsm6dslWriteSequence(u8* apu8Writes_[], u8* au8Sizes_, u8 u8Count_);
+static void Bladelsm6dslFifoToggle(void);
+static void Bladelsm6dslFifoUnpack(void);
+static void Bladelsm6dslFifoMonitor(void);
+static void Bladelsm6dslFusionToggle(void);
+static void Bladelsm6dslFusionRun(void);
 
 
 /***********************************************************************************************************************
 State Machine Declarations
 ***********************************************************************************************************************/
 static void Bladelsm6dslSM_Idle(void);    
+static void Bladelsm6dslSM_FifoIdle(void);
+static void Bladelsm6dslSM_FifoStatus(void);
+static void Bladelsm6dslSM_FifoBurst(void);
 static void Bladelsm6dslSM_Error(void);         
 
 
@@ -65,7 +105,60 @@ static void Bladelsm6dslSM_Error(void);
 /**********************************************************************************************************************
 Constants / Definitions
 **********************************************************************************************************************/
-#define U32_MEASUREMENT_RATE_MS               (u32)100  /*!< @brief Rate at which IMU data is updated to G_u32Bladelsm6dslData*/
+#define U32_MEASUREMENT_RATE_MS               (u32)100  /*!< @brief Rate at which IMU data is updated to G_u32Bladelsm6dslData without INT1 */
+#define U32_LSM6DSL_INT1_TIMEOUT_MS           (u32)200  /*!< @brief Read anyway if INT1 has not fired for this long (a missed edge) */
+
+/* G_u32Bladelsm6dslFlags */
+#define _LSM6DSL_FLAGS_FIFO_MODE              (u32)0x00000001  /*!< @brief FIFO streaming mode is running */
+#define _LSM6DSL_FLAGS_FIFO_MONITOR           (u32)0x00000002  /*!< @brief en+c imufifo: the task consumes the samples and logs the rate */
+#define _LSM6DSL_FLAGS_INT1                   (u32)0x00000004  /*!< @brief INT1 (Blade IO2) has an edge interrupt, so reads follow the sensor */
+#define _LSM6DSL_FLAGS_FUSION                 (u32)0x00000008  /*!< @brief en+c imufusion: the task runs the FIFO samples through blade_imu_fusion.c */
+/* end G_u32Bladelsm6dslFlags */
+
+/* FIFO streaming mode (see Bladelsm6dslFifoStart()) */
+#define U8_LSM6DSL_FIFO_SAMPLE_WORDS          (u8)6     /*!< @brief FIFO words per sample: gyro X/Y/Z then accelerometer X/Y/Z */
+#define U8_LSM6DSL_FIFO_BURST_SAMPLES         (u8)32    /*!< @brief Most samples read in one TWI burst; also the FIFO watermark */
+#define U16_LSM6DSL_FIFO_WATERMARK_WORDS      (u16)(U8_LSM6DSL_FIFO_BURST_SAMPLES * U8_LSM6DSL_FIFO_SAMPLE_WORDS)
+#define U16_LSM6DSL_FIFO_BURST_SIZE           (u16)((U16_LSM6DSL_FIFO_WATERMARK_WORDS + U8_LSM6DSL_FIFO_SAMPLE_WORDS - 1) * 2) /*!< @brief Burst bytes incl. a partial sample to skip */
+#define U16_LSM6DSL_SAMPLE_RING_SIZE          (u16)128  /*!< @brief Samples held for the consumer (power of 2) */
+#define U32_LSM6DSL_FIFO_POLL_MS              (u32)10   /*!< @brief How often FIFO_STATUS is read without INT1 */
+#define U32_LSM6DSL_FIFO_MAX_LATENCY_MS       (u32)100  /*!< @brief Drain the FIFO below the watermark if it has waited this long */
+#define U32_LSM6DSL_FIFO_REPORT_MS            (u32)1000 /*!< @brief en+c imufifo report period */
+#define U8_LSM6DSL_MAX_SEQUENCE_WRITES        (u8)4     /*!< @brief Most register writes Bladelsm6dslWriteSequence() queues together */
+
+/* en+c imufusion (see Bladelsm6dslFusionRun()) */
+#define U8_LSM6DSL_FUSION_SAMPLES_PER_PASS    (u8)8     /*!< @brief Most samples fused per task pass, to stay inside the 1ms loop */
+#define U16_LSM6DSL_FUSION_CALIBRATION        (u16)208  /*!< @brief Samples averaged for the gyro offsets (0.5s at 416Hz: hold still) */
+#define U16_LSM6DSL_FUSION_TAU_MS             (u16)1000 /*!< @brief Accelerometer correction time constant */
+#define U16_LSM6DSL_FUSION_DECIMATION         (u16)16   /*!< @brief Samples per output: 416Hz in, 26Hz out */
+#define U8_LSM6DSL_FUSION_LOW_PASS_SHIFT      (u8)3     /*!< @brief Accelerometer IIR: 1/8 per sample (about 8Hz at 416Hz) */
+#define U32_LSM6DSL_FUSION_REPORT_MS          (u32)500  /*!< @brief en+c imufusion log period (without telemetry) */
+
+#define U8_FIFO_STATUS2_WATERM                (u8)0x80  /*!< @brief FIFO_STATUS2: watermark reached */
+#define U8_FIFO_STATUS2_OVER_RUN              (u8)0x40  /*!< @brief FIFO_STATUS2: FIFO full and samples were overwritten */
+#define U8_FIFO_STATUS2_DIFF_MASK             (u8)0x07  /*!< @brief FIFO_STATUS2: DIFF_FIFO[10:8] */
+#define U8_FIFO_STATUS4_PATTERN_MASK          (u8)0x03  /*!< @brief FIFO_STATUS4: FIFO_PATTERN[9:8] */
+
+#define U8_INT1_CTRL_DRDY_XL                  (u8)0x01  /*!< @brief INT1_CTRL: accelerometer data ready on INT1 (latched until the data is read) */
+#define U8_INT1_CTRL_FTH                      (u8)0x08  /*!< @brief INT1_CTRL: FIFO watermark on INT1 (high while the watermark is reached) */
+
+#define U8_FIFO_CTRL3_INIT                    (u8)0x09
+/*
+  [7-6]: b'00'   Reserved
+  [5-3]: b'001'  DEC_FIFO_GYRO: gyro in the FIFO, no decimation
+  [2-0]: b'001'  DEC_FIFO_XL: accelerometer in the FIFO, no decimation
+*/
+
+#define U8_FIFO_CTRL5_CONTINUOUS              (u8)0x06
+/*
+  [7]:   b'0'    Reserved
+  [6-3]: ODR_FIFO (lsm6dslRateType, added by Bladelsm6dslFifoStart())
+  [2-0]: b'110'  FIFO_MODE: continuous, newest samples overwrite the oldest
+*/
+#define U8_FIFO_CTRL5_BYPASS                  (u8)0x00  /*!< @brief FIFO_MODE bypass: FIFO off and emptied */
+#define U8_FIFO_CTRL5_ODR_SHIFT               (u8)3     /*!< @brief << for ODR_FIFO */
+#define U8_CTRL_ODR_SHIFT                     (u8)4     /*!< @brief << for ODR_XL and ODR_G */
+#define U8_CTRL_ODR_MASK                      (u8)0xF0  /*!< @brief ODR_XL and ODR_G bits */
 
 #define U8_LSM6DSL_I2C_ADDRESS                (u8)0x6b  /*!< @brief I2C address (assumes SDO tied high) */
 #define U8_LSM6DSL_ID                         (u8)0x6a  /*!< @brief Expected Who I am returned ID */     
@@ -11,19 +11,104 @@ behavior. ****
 Provides the terminal interface and also a local command-driven debugging
 system for teh system.
 
-Since the system is small, debugger commands will be strictly numerical, 
-though each command will have a string name that can
-be requested by the user.  The debugger will print a list of these commands if 
-requested using en+c00.  Commands range from 01 to 99 (must include the leading 0
-for single-digit commands) and all commands must have the prefix en+c. 
-The current command list can be quickly checked in debug_x.h (where x is application-specific)
+All commands have the prefix en+c followed by either the command number (two digits, 
+e.g. en+c00) or the command name (e.g. en+c msgstats).  The debugger prints the list of 
+commands with en+c00 or en+c list.  Commands are numbered in the order they are registered.
+
+COMMAND REGISTRY:
+Any task can add its own commands from its initialize function instead of editing debug.h/.c:
+
+  static void UserApp1DebugToggle(void);
+  ...
+  DebugCommandRegister("app1", UserApp1DebugToggle, "Toggle UserApp1 debug output");
+
+The name is a single word of up to DEBUG_CMD_NAME_LENGTH characters that does not start with a
+digit.  Only the pointers are stored, so the name and help strings must stay valid (use string
+literals).  Names are kept sorted in Debug_au8CommandsByName[] so a typed name is found with a 
+binary search.  The command list is sent one line per pass of the Debug task so that it never
+needs more than one line of buffer or more than a few message slots at a time.
 
 This application requires a UART resource for input/output data.
 
 The terminal program used to interface to the debugger should be set to:
 - no local echo
 - send "CR" for new line
-- 115200-8-N-1
+- 115200-8-N-1 (DEBUG_UART_BAUD in debug.h; en+c uarttest measures the throughput)
+
+OUTPUT BUDGETS:
+Every line is charged to an output source with a byte budget per DEBUG_BUDGET_WINDOW_MS.  
+DebugPrintf(), DebugPrintNumber() and DebugLineFeed() use the built-in "system" source; DebugLog()
+records use "log".  A task that prints a lot registers its own source and prints through it:
+
+  UserApp1_u8DebugSource = DebugSourceRegister("app1", 2000);
+  ...
+  DebugPrintfFrom(UserApp1_u8DebugSource, DEBUG_PRINT_LOW, au8Sample);
+
+A line is sent while its source has budget left in the current window (HIGH lines always are).  
+DEBUG_PRINT_LOW lines are also shed when fewer than DEBUG_RESERVE_SLOTS message slots (or 
+DEBUG_RESERVE_BYTES of the pool) are free, so bulk debug output gives way before the LCD, ANT or
+TWI drivers find the pool full.  Log records are not dropped by either limit, they wait in the 
+ring.  Dropped lines are counted per source and reported at most every DEBUG_REPORT_MS:
+
+  Debug output dropped: app1 12 lines (480 bytes)
+
+LINE EDITOR:
+The command line can be edited like a shell prompt on a VT100-compatible terminal: Left/Right
+(Ctrl-B/Ctrl-F), Home/End (Ctrl-A/Ctrl-E), Backspace and Delete (Ctrl-D) work anywhere in the line,
+Ctrl-U clears it, Up/Down (Ctrl-P/Ctrl-N) recall the last DEBUG_CMD_HISTORY_LINES commands and Tab
+completes "en+c" and command names (pressed again with several matches, it lists them).  A full
+line rings the terminal bell instead of being thrown away.  Everything the editor prints in one
+pass of the Idle state goes out in a single UART write, so typing costs one message slot per pass
+no matter how many keys arrived or how much of the line was redrawn.
+
+DEFERRED LOGGING:
+DebugLog() is for time-critical code that should not spend time formatting text.  It only stores
+the format ID, the low 16 bits of G_u32SystemTime1ms and the raw u32 arguments as a record in
+Debug_au32LogRing[].  The Idle state outputs a few records per pass: rendered to text with the 
+format string from Debug_apu8LogFormats[], or, after en+c logbin, as binary frames that 
+firmware_host/tools/debug_log_decode.py turns back into text on the computer:
+
+  0xA5 | format ID | argument count | time (u16, little endian) | arguments
+
+Each argument is sent 7 bits per byte, least significant first, with bit 7 set on every byte
+but the last, so small values take one or two bytes instead of up to ten characters.  Text 
+sent with DebugPrintf() in binary mode still comes through since it never contains 0xA5.
+
+Formats support %u, %d, %x, %c and %% with an optional 0 flag and width (e.g. %05u).  To add 
+one, add its ID to DebugLogFormatType in debug.h and its string to Debug_apu8LogFormats[].
+If the ring is full the record is dropped and the count is reported as DEBUG_LOG_DROPPED.
+
+TELEMETRY:
+DebugTelemetrySend() sends sensor data as binary frames on the same UART after en+c telemetry so a host
+can capture it without parsing console text:
+
+  0xA6 | channel | sequence number | payload size | payload | CRC-16/CCITT (u16, little endian)
+
+The CRC covers everything after the sync byte.  Each channel has its own sequence number that 
+counts every frame offered while telemetry is on, so the host sees a gap for any frame that could 
+not be queued.  Telemetry is limited to DEBUG_TELEMETRY_BYTES_PER_MS so it cannot fill the message
+queue and starve the console; frames over the budget are dropped (and show up as gaps).  firmware_host/tools/telemetry_record.py writes each channel to its own CSV file 
+and shows the console text (and DebugLog() frames) as usual.
+
+BINARY TRANSFER:
+en+c xfer switches the UART to a framed binary mode for moving blocks of memory to and from the 
+board (firmware_host/tools/debug_xfer.py is the host side).  Frames in both directions are:
+
+  0xA7 | type | sequence number | payload size | payload | CRC-16/CCITT (u16, little endian)
+
+with the CRC over everything after the sync byte and at most DEBUG_XFER_MAX_PAYLOAD bytes of payload
+so that a frame fits one message.  The host does not get raw addresses: tasks register named
+regions with DebugXferRegister() and the host lists them and reads or writes a range of one.
+The built-in regions are "scratch" (DEBUG_XFER_SCRATCH_SIZE bytes of RAM that may be written) and
+"log" (the DebugLog() ring).
+
+DATA frames are sent go-back-N: up to DEBUG_XFER_WINDOW frames ahead of the last ACK, each ACK 
+naming the next sequence number the receiver wants.  A receiver that sees a gap sends one NAK and
+the sender starts again from there; if no ACK comes for DEBUG_XFER_RETRY_MS the sender goes back on
+its own.  The console does not run in transfer mode (DebugLog() records wait in the ring and other
+tasks' DebugPrintf() text still goes out between frames).  A QUIT frame, or DEBUG_XFER_IDLE_MS 
+without a good frame, returns to the console.  The frame types are listed with DEBUG_XFER_SYNC in 
+debug.h.
 
 ------------------------------------------------------------------------------------------------------------------------
 GLOBALS
@@ -41,12 +126,20 @@ CONSTANTS
 - DEBUG_SCANF_BUFFER_SIZE is the size of G_au8DebugScanfBuffer and thus the max of G_u8DebugScanfCharCount
 
 TYPES
-- NONE
+- DebugPrintLevelType
+- DebugLogFormatType
+- DebugTelemetryChannelType
 
 PUBLIC FUNCTIONS
 - u32 DebugPrintf(u8* u8String_)
+- u32 DebugPrintfFrom(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8String_)
+- u8 DebugSourceRegister(u8* pu8Name_, u32 u32Budget_)
 - void DebugLineFeed(void)
 - void DebugPrintNumber(u32 u32Number_)
+- bool DebugLog(DebugLogFormatType eFormat_, ...)
+- bool DebugTelemetrySend(DebugTelemetryChannelType eChannel_, u8* pu8Payload_, u8 u8Size_)
+- u8 DebugCommandRegister(u8* pu8Name_, fnCode_type pfnCommand_, u8* pu8Help_)
+- u8 DebugXferRegister(u8* pu8Name_, u8* pu8Data_, u32 u32Size_, bool bWritable_)
 - u8 DebugScanf(u8* pu8Buffer_)
 - void DebugSetPassthrough(void)
 - void DebugClearPassthrough(void)
@@ -90,46 +183,102 @@ static UartPeripheralType* Debug_Uart;                   /*!< @brief Pointer to
 static u8 Debug_u8ErrorCode;                             /*!< @brief Error code */
 
 static u8 Debug_au8RxBuffer[DEBUG_RX_BUFFER_SIZE];       /*!< @brief Space for incoming characters of debug commands */
-static u8 *Debug_pu8RxBufferNextChar;                    /*!< @brief Pointer to next spot in the Rxbuffer */
+static u8 *Debug_pu8RxBufferNextChar;                    /*!< @brief Pointer to next spot in the Rxbuffer (moved by the UART driver) */
 static u8 *Debug_pu8RxBufferParser;                      /*!< @brief Pointer to loop through the Rx buffer */
+static u8 Debug_au8TxRing[DEBUG_TX_RING_SIZE];           /*!< @brief UART transmit ring that merges echoes and short prints */
 
 static u32 Debug_au32MsgTokens[DEBUG_TOKEN_ARRAY_SIZE];  /*!< @brief Message tokens for transfers */
 static u8 Debug_u8TokenCounter;                          /*!< @brief Number of stored tokens */
 
 static u8 Debug_au8CommandBuffer[DEBUG_CMD_BUFFER_SIZE]; /*!< @brief Space to store chars as they build up to the next command */ 
-static u8 *Debug_pu8CmdBufferNextChar;                   /*!< @brief Pointer to incoming char location in the command buffer */
 static u16 Debug_u16CommandSize;                         /*!< @brief Number of characters in the command buffer */
+static u8 Debug_u8CmdCursor;                             /*!< @brief Cursor position in the command line */
+static u8 Debug_u8EscapeState;                           /*!< @brief Progress through a terminal escape sequence (DEBUG_ESC_...) */
+static u8 Debug_u8EscapeParameter;                       /*!< @brief Number read from the escape sequence so far */
+static u8 Debug_aau8CmdHistory[DEBUG_CMD_HISTORY_LINES][DEBUG_CMD_BUFFER_SIZE]; /*!< @brief Previous command lines (NULL-terminated) */
+static u8 Debug_u8HistoryCount;                          /*!< @brief Number of lines in the history */
+static u8 Debug_u8HistoryNewest;                         /*!< @brief Index of the newest history line */
+static u8 Debug_u8HistoryRecall;                         /*!< @brief History line shown (1 = newest), 0 while typing a new line */
+static u8 Debug_au8EchoBuffer[DEBUG_ECHO_BUFFER_SIZE];   /*!< @brief Echo and redraw for the terminal, sent once per Idle pass */
+static u8 Debug_u8EchoSize;                              /*!< @brief Bytes in Debug_au8EchoBuffer[] */
 static u8 Debug_u8Command;                               /*!< @brief A validated command number */
 
-/*! @brief Add commands by updating debug.h in the Command-Specific Definitions section, then update this list
-with the function name to call for the corresponding command: */
-#ifdef EIE_ASCII
-DebugCommandType Debug_au8Commands[DEBUG_COMMANDS] = 
-{ {DEBUG_CMD_NAME00, DebugCommandPrepareList},
-  {DEBUG_CMD_NAME01, DebugCommandLedTestToggle},
-  {DEBUG_CMD_NAME02, DebugCommandSysTimeToggle},
-  {DEBUG_CMD_NAME03, DebugCommandDummy},
-  {DEBUG_CMD_NAME04, DebugCommandDummy},
-  {DEBUG_CMD_NAME05, DebugCommandDummy},
-  {DEBUG_CMD_NAME06, DebugCommandDummy},
-  {DEBUG_CMD_NAME07, DebugCommandDummy} 
+static DebugCommandType Debug_asCommands[DEBUG_CMD_MAX]; /*!< @brief Registered commands in command number order */
+static u8 Debug_au8CommandsByName[DEBUG_CMD_MAX];        /*!< @brief Command numbers sorted by command name */
+static u8 Debug_u8CommandCount;                          /*!< @brief Number of registered commands */
+static u8 Debug_u8ListIndex;                             /*!< @brief Next command to print in DebugSM_ListCommands() */
+
+static DebugSourceType Debug_asSources[DEBUG_SOURCES];   /*!< @brief Registered output sources in ID order */
+static u8 Debug_u8SourceCount;                           /*!< @brief Number of registered output sources */
+static u32 Debug_u32BudgetWindowStart;                   /*!< @brief G_u32SystemTime1ms when the current budget window started */
+static u32 Debug_u32ReportTime;                          /*!< @brief G_u32SystemTime1ms of the last dropped output report */
+
+static u32 Debug_au32LogRing[DEBUG_LOG_RING_WORDS];      /*!< @brief DebugLog() records waiting to be output */
+static volatile u16 Debug_u16LogHead;                    /*!< @brief Index where DebugLog() writes the next record */
+static volatile u16 Debug_u16LogTail;                    /*!< @brief Index of the next record to output */
+static volatile u32 Debug_u32LogDropped;                 /*!< @brief Records dropped since the last DEBUG_LOG_DROPPED report */
+static u8 Debug_au8LogArgCounts[DEBUG_LOG_FORMATS];      /*!< @brief Number of arguments each log format uses */
+
+static u8 Debug_au8TelemetrySequence[DEBUG_TELEMETRY_CHANNELS]; /*!< @brief Next sequence number of each telemetry channel */
+static u32 Debug_u32TelemetryCredit;                     /*!< @brief Bytes of telemetry that may still be queued */
+static u32 Debug_u32TelemetryCreditTime;                 /*!< @brief G_u32SystemTime1ms when the credit was last topped up */
+
+static u8 Debug_au8UartTestBlock[DEBUG_UART_TEST_BLOCK_SIZE]; /*!< @brief Lines sent over and over by the UART self-test */
+static u16 Debug_u16UartTestBlocks;                      /*!< @brief Number of blocks the UART self-test sends */
+static u16 Debug_u16UartTestQueued;                      /*!< @brief Self-test blocks queued so far */
+static volatile u16 Debug_u16UartTestDone;               /*!< @brief Self-test blocks finished (counted in the UART ISR) */
+static volatile u16 Debug_u16UartTestFailed;             /*!< @brief Self-test blocks that did not complete */
+static volatile u32 Debug_u32UartTestFirstDone;          /*!< @brief G_u32SystemTime1ms when the first block finished */
+static volatile u32 Debug_u32UartTestLastDone;           /*!< @brief G_u32SystemTime1ms when the latest block finished */
+static u32 Debug_u32UartTestTimer;                       /*!< @brief Start of the self-test for its time-out */
+
+static DebugXferRegionType Debug_asXferRegions[DEBUG_XFER_REGIONS]; /*!< @brief Registered transfer regions in ID order */
+static u8 Debug_u8XferRegionCount;                       /*!< @brief Number of registered transfer regions */
+static u8 Debug_au8XferScratch[DEBUG_XFER_SCRATCH_SIZE]; /*!< @brief Built-in writable transfer region */
+static u8 Debug_au8XferFrame[DEBUG_XFER_FRAME_SIZE];     /*!< @brief Transfer frame being received */
+static u8 Debug_u8XferFrameSize;                         /*!< @brief Bytes of Debug_au8XferFrame[] received so far */
+static u8 Debug_u8XferListIndex;                         /*!< @brief Next region to send in the list (DEBUG_XFER_NONE = not listing) */
+static u8* Debug_pu8XferData;                            /*!< @brief First byte of the range being read or written */
+static u32 Debug_u32XferLength;                          /*!< @brief Bytes in the range being read or written */
+static u32 Debug_u32XferFrames;                          /*!< @brief DATA frames needed for the range */
+static u32 Debug_u32XferBase;                            /*!< @brief Read: oldest unacknowledged frame.  Write: next frame expected */
+static u32 Debug_u32XferNext;                            /*!< @brief Read: next frame to send */
+static bool Debug_bXferReading;                          /*!< @brief TRUE while DATA frames of a read are going out */
+static bool Debug_bXferReadDone;                         /*!< @brief TRUE once the DONE frame of a read has been sent */
+static bool Debug_bXferWriting;                          /*!< @brief TRUE while DATA frames of a write are expected */
+static bool Debug_bXferNakSent;                          /*!< @brief TRUE if the current gap in a write was already NAKed */
+static u32 Debug_u32XferRetryTimer;                      /*!< @brief Time of the last read progress for the retry time-out */
+static u32 Debug_u32XferIdleTimer;                       /*!< @brief Time of the last good frame for the idle time-out */
+
+/*! @brief Log format strings in DebugLogFormatType order.  debug_log_decode.py reads this list to 
+decode binary frames, so keep one string literal per entry. */
+static const u8* Debug_apu8LogFormats[DEBUG_LOG_FORMATS] =
+{ "\n\r*** %u log records dropped ***\n\r",            /* DEBUG_LOG_DROPPED */
+  "%05u %05u %05u %05u %05u %05u %05u\n\r",               /* DEBUG_LOG_LSM6DSL_DATA */
+  "TWI bench: %u kHz, %u reads in %u ms = %u bytes/s, 1 kHz sampling uses %u%% of the bus\n\r", /* DEBUG_LOG_TWI_BENCH */
+  "LSM6DSL FIFO: %u samples/s in %u bursts from %u status reads, %u overruns, %u lost, %u read errors\n\r", /* DEBUG_LOG_LSM6DSL_FIFO */
+  "IMU fusion: roll %d pitch %d yaw %d (0.01 deg), %u outputs/s\n\r" /* DEBUG_LOG_IMU_FUSION */
+};
+
+/*! @brief Commands of the debug task itself, registered first by DebugInitialize().  Other tasks
+register their own commands with DebugCommandRegister(). */
+static const DebugCommandType Debug_asBuiltInCommands[] =
+{ {"list",      DebugCommandPrepareList,     "Show debug command list"},
+  {"ledtest",   DebugCommandLedTestToggle,   "Toggle LED test"},
+  {"systime",   DebugCommandSysTimeToggle,   "Toggle system timing warning"},
+  {"msgstats",  DebugCommandMessagingStats,  "Show messaging statistics"},
+  {"msgdump",   DebugCommandMessagingDump,   "Dump messaging stats (binary)"},
+  {"logbin",    DebugCommandLogBinaryToggle, "Toggle binary log output"},
+  {"telemetry", DebugCommandTelemetryToggle, "Toggle telemetry stream"},
+  {"uarttest",  DebugCommandUartTest,        "Measure debug UART throughput"},
+  {"xfer",      DebugCommandTransfer,        "Binary transfer mode (debug_xfer.py)"}
 };
 
+#ifdef EIE_ASCII
 static u8 Debug_au8StartupMsg[] = "\n\n\r*** RAZOR SAM3U2 ASCII LCD DEVELOPMENT BOARD ***\n\n\r";
 #endif /* EIE_ASCII */
 
 #ifdef EIE_DOTMATRIX
-DebugCommandType Debug_au8Commands[DEBUG_COMMANDS] = 
-{ {DEBUG_CMD_NAME00, DebugCommandPrepareList},
-  {DEBUG_CMD_NAME01, DebugCommandLedTestToggle},
-  {DEBUG_CMD_NAME02, DebugCommandSysTimeToggle},
-  {DEBUG_CMD_NAME03, DebugCommandCaptouchValuesToggle},
-  {DEBUG_CMD_NAME04, DebugCommandDummy},
-  {DEBUG_CMD_NAME05, DebugCommandDummy},
-  {DEBUG_CMD_NAME06, DebugCommandDummy},
-  {DEBUG_CMD_NAME07, DebugCommandDummy} 
-};
-
 static u8 Debug_au8StartupMsg[] = "\n\n\r*** RAZOR SAM3U2 DOT MATRIX LCD DEVELOPMENT BOARD ***\n\n\r";
 #endif /* EIE_DOTMATRIX */
 
@@ -164,8 +313,9 @@ Requires:
 @param u8String_ is a NULL-terminated C-string
 
 Promises:
-- The string is queued to the debug UART.
-- The message token is returned
+- The string is queued to the debug UART unless the "system" source is out of budget
+  (see DebugPrintfFrom())
+- The message token is returned (0 if the string was dropped)
 
 */
 u32 DebugPrintf(u8* u8String_)
@@ -179,11 +329,113 @@ u32 DebugPrintf(u8* u8String_)
     pu8Parser++;
   }
     
-  return( UartWriteData(Debug_Uart, u32Size, u8String_) );
+  return( DebugOutput(DEBUG_SOURCE_SYSTEM, DEBUG_PRINT_NORMAL, u8String_, u32Size) );
  
 } /* end DebugPrintf() */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn u32 DebugPrintfFrom(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8String_)
+
+@brief Queues a string to the Debug port on behalf of a registered output source.  
+
+Example:
+u8 au8Sample[] = "x=12 y=-3\n\r";
+
+DebugPrintfFrom(UserApp1_u8DebugSource, DEBUG_PRINT_LOW, au8Sample);
+
+Requires:
+@param u8Source_ is an ID from DebugSourceRegister() (anything else is charged to "system")
+@param eLevel_ is the importance of the line
+@param pu8String_ is a NULL-terminated C-string
+
+Promises:
+- DEBUG_PRINT_HIGH: the string is queued
+- DEBUG_PRINT_NORMAL: the string is queued if the source has budget left in this window
+- DEBUG_PRINT_LOW: as NORMAL, and only while at least DEBUG_RESERVE_SLOTS message slots and 
+  DEBUG_RESERVE_BYTES of the pool are free
+- A string that is not queued is counted for the dropped output report
+- Returns the message token, or 0 if the string was dropped
+
+*/
+u32 DebugPrintfFrom(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8String_)
+{
+  u32 u32Size = 0;
+  
+  while(pu8String_[u32Size] != '\0') 
+  {
+    u32Size++;
+  }
+    
+  return( DebugOutput(u8Source_, eLevel_, pu8String_, u32Size) );
+ 
+} /* end DebugPrintfFrom() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn u8 DebugSourceRegister(u8* pu8Name_, u32 u32Budget_)
+
+@brief Adds an output source with its own byte budget for DebugPrintfFrom().
+
+Call it from the task's initialize function and keep the ID:
+
+UserApp1_u8DebugSource = DebugSourceRegister("app1", 2000);
+
+Requires:
+@param pu8Name_ is a NULL-terminated single word of 1 to DEBUG_SOURCE_NAME_LENGTH characters; 
+       it must stay valid (only the pointer is kept)
+@param u32Budget_ is the bytes the source may queue per DEBUG_BUDGET_WINDOW_MS (0 = no limit)
+
+Promises:
+- If the name is valid and not already used and there is room, the source is added to 
+  Debug_asSources[]
+- Returns the source ID, or DEBUG_SOURCE_NONE if the source was not added
+
+*/
+u8 DebugSourceRegister(u8* pu8Name_, u32 u32Budget_)
+{
+  DebugSourceType* psSource;
+  u8 u8Length = 0;
+  
+  if( (pu8Name_ == NULL) || (Debug_u8SourceCount >= DEBUG_SOURCES) )
+  {
+    return(DEBUG_SOURCE_NONE);
+  }
+  
+  while(pu8Name_[u8Length] != '\0')
+  {
+    if( (pu8Name_[u8Length] == ' ') || (u8Length == DEBUG_SOURCE_NAME_LENGTH) )
+    {
+      return(DEBUG_SOURCE_NONE);
+    }
+    u8Length++;
+  }
+  
+  if(u8Length == 0)
+  {
+    return(DEBUG_SOURCE_NONE);
+  }
+  
+  for(u8 i = 0; i < Debug_u8SourceCount; i++)
+  {
+    if(strcmp((char*)Debug_asSources[i].pu8Name, (char*)pu8Name_) == 0)
+    {
+      return(DEBUG_SOURCE_NONE);
+    }
+  }
+  
+  psSource = &Debug_asSources[Debug_u8SourceCount];
+  psSource->pu8Name         = pu8Name_;
+  psSource->u32Budget       = u32Budget_;
+  psSource->u32Used         = 0;
+  psSource->u32DroppedLines = 0;
+  psSource->u32DroppedBytes = 0;
+  
+  return(Debug_u8SourceCount++);
+  
+} /* end DebugSourceRegister() */
+
+
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn void DebugLineFeed(void)
 
@@ -203,7 +455,7 @@ void DebugLineFeed(void)
 {
   u8 au8Linefeed[] = {ASCII_LINEFEED, ASCII_CARRIAGE_RETURN};
   
-  UartWriteData(Debug_Uart, sizeof(au8Linefeed), &au8Linefeed[0]);
+  DebugOutput(DEBUG_SOURCE_SYSTEM, DEBUG_PRINT_NORMAL, &au8Linefeed[0], sizeof(au8Linefeed));
 
 } /* end DebugLineFeed() */
 
@@ -276,12 +528,317 @@ void DebugPrintNumber(u32 u32Number_)
   }
     
   /* Print the ascii string and free the memory */
-  UartWriteData(Debug_Uart, u8CharCount, pu8Data);
+  DebugOutput(DEBUG_SOURCE_SYSTEM, DEBUG_PRINT_NORMAL, pu8Data, u8CharCount);
   free(pu8Data);
   
 } /* end DebugDebugPrintNumber() */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn bool DebugLog(DebugLogFormatType eFormat_, ...)
+
+@brief Captures a log record to be formatted and sent later by the debug task.
+
+Only the format ID, a timestamp and the raw arguments are stored, so this is cheap enough
+for time-critical code and interrupt handlers.  The text is built in the Idle state.
+
+Example:
+
+DebugLog(DEBUG_LOG_DROPPED, u32Count);
+
+
+Requires:
+- DebugInitialize() has run
+- Pass exactly as many arguments as the format uses; each is read as a u32
+
+@param eFormat_ is the log format to use
+@param ... are the values for the format
+
+Promises:
+- If the ring has room, the record is added and TRUE is returned
+- Otherwise the record is counted as dropped and FALSE is returned
+
+*/
+bool DebugLog(DebugLogFormatType eFormat_, ...)
+{
+  va_list Args;
+  u8 u8Args;
+  u16 u16Head;
+  u16 u16Used;
+  bool bLogged = FALSE;
+  
+  if( (eFormat_ >= DEBUG_LOG_FORMATS) || (Debug_Uart == NULL) )
+  {
+    return(FALSE);
+  }
+  
+  u8Args = Debug_au8LogArgCounts[eFormat_];
+  
+  __disable_irq();
+  u16Head = Debug_u16LogHead;
+  u16Used = (u16Head - Debug_u16LogTail) & (DEBUG_LOG_RING_WORDS - 1);
+  
+  /* One word for the header and one per argument, and the ring is never completely filled */
+  if( (u16Used + u8Args + 1) < DEBUG_LOG_RING_WORDS )
+  {
+    Debug_au32LogRing[u16Head] = (u32)eFormat_ | ((u32)u8Args << 8) | (G_u32SystemTime1ms << 16);
+    u16Head = (u16Head + 1) & (DEBUG_LOG_RING_WORDS - 1);
+    
+    va_start(Args, eFormat_);
+    for(u8 i = 0; i < u8Args; i++)
+    {
+      Debug_au32LogRing[u16Head] = va_arg(Args, u32);
+      u16Head = (u16Head + 1) & (DEBUG_LOG_RING_WORDS - 1);
+    }
+    va_end(Args);
+    
+    Debug_u16LogHead = u16Head;
+    bLogged = TRUE;
+  }
+  else
+  {
+    Debug_u32LogDropped++;
+  }
+  __enable_irq();
+  
+  return(bLogged);
+  
+} /* end DebugLog() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn bool DebugTelemetrySend(DebugTelemetryChannelType eChannel_, u8* pu8Payload_, u8 u8Size_)
+
+@brief Queues one telemetry frame on the debug UART if telemetry is on.
+
+The payload is sent as it is, so use the layout listed for the channel in DebugTelemetryChannelType.
+Several samples can be sent in one frame to save the 6 bytes of framing on each.
+
+Example:
+
+u8 au8Sliders[] = {u8Horizontal, u8Vertical};
+
+DebugTelemetrySend(DEBUG_TELEMETRY_CAPTOUCH, au8Sliders, sizeof(au8Sliders));
+
+
+Requires:
+- Do not call from an ISR
+
+@param eChannel_ is the channel the payload belongs to
+@param pu8Payload_ points to the payload
+@param u8Size_ is the payload size, up to DEBUG_TELEMETRY_MAX_PAYLOAD
+
+Promises:
+- If telemetry is off or the arguments are bad, nothing is sent and FALSE is returned
+- Otherwise the channel's sequence number advances and TRUE is returned if the frame fit in the 
+  telemetry budget and was queued
+
+*/
+bool DebugTelemetrySend(DebugTelemetryChannelType eChannel_, u8* pu8Payload_, u8 u8Size_)
+{
+  u8 au8Frame[DEBUG_TELEMETRY_HEADER_SIZE + DEBUG_TELEMETRY_MAX_PAYLOAD + DEBUG_TELEMETRY_CRC_SIZE];
+  u8* pu8Next = &au8Frame[DEBUG_TELEMETRY_HEADER_SIZE];
+  u32 u32FrameSize = DEBUG_TELEMETRY_HEADER_SIZE + u8Size_ + DEBUG_TELEMETRY_CRC_SIZE;
+  u32 u32Elapsed;
+  u16 u16Crc;
+  
+  if( !(G_u32DebugFlags & _DEBUG_TELEMETRY_ENABLE) || (Debug_Uart == NULL) || 
+      (eChannel_ >= DEBUG_TELEMETRY_CHANNELS) || (u8Size_ > DEBUG_TELEMETRY_MAX_PAYLOAD) )
+  {
+    return(FALSE);
+  }
+  
+  au8Frame[0] = DEBUG_TELEMETRY_SYNC;
+  au8Frame[1] = (u8)eChannel_;
+  au8Frame[2] = Debug_au8TelemetrySequence[eChannel_]++;
+  au8Frame[3] = u8Size_;
+  
+  /* Add the budget for the time since the last frame, then check this one fits */
+  u32Elapsed = G_u32SystemTime1ms - Debug_u32TelemetryCreditTime;
+  Debug_u32TelemetryCreditTime = G_u32SystemTime1ms;
+  if(u32Elapsed > DEBUG_TELEMETRY_MAX_CREDIT)
+  {
+    u32Elapsed = DEBUG_TELEMETRY_MAX_CREDIT;
+  }
+  
+  Debug_u32TelemetryCredit += u32Elapsed * DEBUG_TELEMETRY_BYTES_PER_MS;
+  if(Debug_u32TelemetryCredit > DEBUG_TELEMETRY_MAX_CREDIT)
+  {
+    Debug_u32TelemetryCredit = DEBUG_TELEMETRY_MAX_CREDIT;
+  }
+  
+  if(Debug_u32TelemetryCredit < u32FrameSize)
+  {
+    return(FALSE);
+  }
+  Debug_u32TelemetryCredit -= u32FrameSize;
+  for(u8 i = 0; i < u8Size_; i++)
+  {
+    *pu8Next++ = pu8Payload_[i];
+  }
+  
+  u16Crc = Crc16Ccitt(U16_CRC16_CCITT_INIT, &au8Frame[1], (u32)(pu8Next - &au8Frame[1]));
+  *pu8Next++ = (u8)u16Crc;
+  *pu8Next++ = (u8)(u16Crc >> 8);
+  
+  return( UartWriteData(Debug_Uart, (u32)(pu8Next - au8Frame), au8Frame) != 0 );
+  
+} /* end DebugTelemetrySend() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn u8 DebugCommandRegister(u8* pu8Name_, fnCode_type pfnCommand_, u8* pu8Help_)
+
+@brief Adds a command that the user can run with en+c<name> or en+c<number>.
+
+Call from a task's initialize function, e.g.
+
+DebugCommandRegister("app1", UserApp1DebugToggle, "Toggle UserApp1 debug output");
+
+pfnCommand_ runs in the Debug task's ProcessCmd state, with the Debug state machine 
+already set back to Idle.
+
+Requires:
+@param pu8Name_ is a NULL-terminated single word of 1 to DEBUG_CMD_NAME_LENGTH characters 
+       that does not start with a digit; it must stay valid (only the pointer is kept)
+@param pfnCommand_ is the function to run
+@param pu8Help_ is one NULL-terminated line for the command list (or NULL); it must stay valid
+
+Promises:
+- If the name is valid and not already used and the registry is not full, the command is 
+  added to Debug_asCommands[] and its name to the sorted Debug_au8CommandsByName[]
+- Returns the command number, or DEBUG_CMD_NONE if the command was not added
+
+*/
+u8 DebugCommandRegister(u8* pu8Name_, fnCode_type pfnCommand_, u8* pu8Help_)
+{
+  u8 u8Length = 0;
+  u8 u8Position = 0;
+  s32 s32Compare = 1;
+  
+  if( (pu8Name_ == NULL) || (pfnCommand_ == NULL) || (Debug_u8CommandCount >= DEBUG_CMD_MAX) )
+  {
+    return(DEBUG_CMD_NONE);
+  }
+  
+  /* Names are one word that cannot be mistaken for a command number */
+  if( (pu8Name_[0] >= '0') && (pu8Name_[0] <= '9') )
+  {
+    return(DEBUG_CMD_NONE);
+  }
+  
+  while(pu8Name_[u8Length] != '\0')
+  {
+    if( (pu8Name_[u8Length] == ' ') || (u8Length == DEBUG_CMD_NAME_LENGTH) )
+    {
+      return(DEBUG_CMD_NONE);
+    }
+    u8Length++;
+  }
+  
+  if(u8Length == 0)
+  {
+    return(DEBUG_CMD_NONE);
+  }
+
+  /* Find where the name goes in the sorted index; duplicates are refused */
+  while(u8Position < Debug_u8CommandCount)
+  {
+    s32Compare = strcmp((char*)Debug_asCommands[Debug_au8CommandsByName[u8Position]].pu8CommandName, (char*)pu8Name_);
+    if(s32Compare >= 0)
+    {
+      break;
+    }
+    u8Position++;
+  }
+  
+  if(s32Compare == 0)
+  {
+    return(DEBUG_CMD_NONE);
+  }
+
+  for(u8 i = Debug_u8CommandCount; i > u8Position; i--)
+  {
+    Debug_au8CommandsByName[i] = Debug_au8CommandsByName[i - 1];
+  }
+  Debug_au8CommandsByName[u8Position] = Debug_u8CommandCount;
+  
+  Debug_asCommands[Debug_u8CommandCount].pu8CommandName = pu8Name_;
+  Debug_asCommands[Debug_u8CommandCount].DebugFunction  = pfnCommand_;
+  Debug_asCommands[Debug_u8CommandCount].pu8CommandHelp = pu8Help_;
+  
+  return(Debug_u8CommandCount++);
+  
+} /* end DebugCommandRegister() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn u8 DebugXferRegister(u8* pu8Name_, u8* pu8Data_, u32 u32Size_, bool bWritable_)
+
+@brief Adds a block of memory that the host can read (and optionally write) in binary transfer mode.
+
+Call from a task's initialize function, e.g.
+
+DebugXferRegister("trace", (u8*)UserApp1_asTrace, sizeof(UserApp1_asTrace), FALSE);
+
+A writable region is written while the task that owns it keeps running, so the owner should only
+use its contents once it knows a transfer is finished (e.g. from a command it registered).
+
+Requires:
+@param pu8Name_ is a NULL-terminated single word of 1 to DEBUG_XFER_NAME_LENGTH characters; 
+       it must stay valid (only the pointer is kept)
+@param pu8Data_ is the first byte of the region
+@param u32Size_ is the size of the region in bytes
+@param bWritable_ is TRUE if the host may write the region
+
+Promises:
+- If the name is valid and not already used and there is room, the region is added to 
+  Debug_asXferRegions[]
+- Returns the region ID, or DEBUG_XFER_NONE if the region was not added
+
+*/
+u8 DebugXferRegister(u8* pu8Name_, u8* pu8Data_, u32 u32Size_, bool bWritable_)
+{
+  u8 u8Length = 0;
+  
+  if( (pu8Name_ == NULL) || (pu8Data_ == NULL) || (u32Size_ == 0) || 
+      (Debug_u8XferRegionCount >= DEBUG_XFER_REGIONS) )
+  {
+    return(DEBUG_XFER_NONE);
+  }
+  
+  while(pu8Name_[u8Length] != '\0')
+  {
+    if( (pu8Name_[u8Length] == ' ') || (u8Length == DEBUG_XFER_NAME_LENGTH) )
+    {
+      return(DEBUG_XFER_NONE);
+    }
+    u8Length++;
+  }
+  
+  if(u8Length == 0)
+  {
+    return(DEBUG_XFER_NONE);
+  }
+  
+  for(u8 i = 0; i < Debug_u8XferRegionCount; i++)
+  {
+    if(strcmp((char*)Debug_asXferRegions[i].pu8Name, (char*)pu8Name_) == 0)
+    {
+      return(DEBUG_XFER_NONE);
+    }
+  }
+  
+  Debug_asXferRegions[Debug_u8XferRegionCount].pu8Name   = pu8Name_;
+  Debug_asXferRegions[Debug_u8XferRegionCount].pu8Data   = pu8Data_;
+  Debug_asXferRegions[Debug_u8XferRegionCount].u32Size   = u32Size_;
+  Debug_asXferRegions[Debug_u8XferRegionCount].bWritable = bWritable_;
+  
+  return(Debug_u8XferRegionCount++);
+  
+} /* end DebugXferRegister() */
+
+
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn u8 DebugScanf(u8* pu8Buffer_)
 
@@ -483,15 +1040,63 @@ void DebugInitialize(void)
     G_au8DebugScanfBuffer[i] = 0;
   }
 
-  /* Initailze the command array as needed */
-  Debug_pu8CmdBufferNextChar = &Debug_au8CommandBuffer[0]; 
+  /* Initailze the command line editor as needed */
+  Debug_u16CommandSize = 0;
+  Debug_u8CmdCursor = 0;
+  Debug_u8EscapeState = DEBUG_ESC_NONE;
+  Debug_u8HistoryCount = 0;
+  Debug_u8HistoryNewest = 0;
+  Debug_u8HistoryRecall = 0;
+  Debug_u8EchoSize = 0;
+
+  /* Register the built-in commands first so their numbers do not depend on other tasks */
+  Debug_u8CommandCount = 0;
+  for(u8 i = 0; i < (sizeof(Debug_asBuiltInCommands) / sizeof(DebugCommandType)); i++)
+  {
+    DebugCommandRegister(Debug_asBuiltInCommands[i].pu8CommandName, 
+                         Debug_asBuiltInCommands[i].DebugFunction,
+                         Debug_asBuiltInCommands[i].pu8CommandHelp);
+  }
+
+  /* Built-in output sources; other tasks add theirs with DebugSourceRegister() */
+  Debug_u8SourceCount = 0;
+  DebugSourceRegister("system", DEBUG_SYSTEM_BUDGET);
+  DebugSourceRegister("log", DEBUG_LOG_BUDGET);
+  Debug_u32BudgetWindowStart = G_u32SystemTime1ms;
+  Debug_u32ReportTime = G_u32SystemTime1ms;
+
+  /* Empty the log ring and find how many arguments each log format takes */
+  Debug_u16LogHead    = 0;
+  Debug_u16LogTail    = 0;
+  Debug_u32LogDropped = 0;
+  for(u8 i = 0; i < DEBUG_LOG_FORMATS; i++)
+  {
+    Debug_au8LogArgCounts[i] = DebugLogCountArguments(Debug_apu8LogFormats[i]);
+  }
+  
+  for(u8 i = 0; i < DEBUG_TELEMETRY_CHANNELS; i++)
+  {
+    Debug_au8TelemetrySequence[i] = 0;
+  }
+  Debug_u32TelemetryCredit     = DEBUG_TELEMETRY_MAX_CREDIT;
+  Debug_u32TelemetryCreditTime = 0;
+
+  /* Built-in transfer regions; other tasks add theirs with DebugXferRegister() */
+  Debug_u8XferRegionCount = 0;
+  DebugXferRegister("scratch", Debug_au8XferScratch, sizeof(Debug_au8XferScratch), TRUE);
+  DebugXferRegister("log", (u8*)Debug_au32LogRing, sizeof(Debug_au32LogRing), FALSE);
 
   /* Request the UART resource to be used for the Debug application */
   sUartConfig.UartPeripheral     = DEBUG_UART;
   sUartConfig.pu8RxBufferAddress = &Debug_au8RxBuffer[0];
   sUartConfig.pu8RxNextByte      = &Debug_pu8RxBufferNextChar;
   sUartConfig.u16RxBufferSize    = DEBUG_RX_BUFFER_SIZE;
-  sUartConfig.fnRxCallback       = DebugRxCallback;
+  sUartConfig.fnRxCallback       = NULL;
+  sUartConfig.u16RxIdleBits      = DEBUG_RX_IDLE_BITS;
+  sUartConfig.bHandshake         = DEBUG_UART_HANDSHAKE;
+  sUartConfig.u32BaudRate        = DEBUG_UART_BAUD;
+  sUartConfig.pu8TxRingAddress   = &Debug_au8TxRing[0];
+  sUartConfig.u16TxRingSize      = DEBUG_TX_RING_SIZE;
   
   Debug_Uart = UartRequest(&sUartConfig);
   
@@ -535,30 +1140,6 @@ void DebugRunActiveState(void)
 } /* end DebugRunActiveState */
 
 
-/*!----------------------------------------------------------------------------------------------------------------------
-@fn void DebugRxCallback(void)
-
-@brief Callback function used when character received.
-
-Requires:
-- None
-
-Promises:
-@param Debug_pu8RxBufferNextChar is advanced safely
-
-*/
-void DebugRxCallback(void)
-{
-  /* Safely advance the NextChar pointer */
-  Debug_pu8RxBufferNextChar++;
-  if(Debug_pu8RxBufferNextChar == &Debug_au8RxBuffer[DEBUG_RX_BUFFER_SIZE])
-  {
-    Debug_pu8RxBufferNextChar = &Debug_au8RxBuffer[0];
-  }
-  
-} /* end DebugRxCallback() */
-
-
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -592,386 +1173,2335 @@ inline static void AdvanceTokenCounter(void)
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn static void DebugCommandPrepareList(void)
 
-@brief Queues the entire list of debug commands available in the system so 
-they will be sent out the debug UART for the user to view.
+@brief Starts sending the list of debug commands available in the system out the
+debug UART for the user to view.
 
+Only the heading is queued here; DebugSM_ListCommands() sends one command per pass so
+the list does not need a large buffer or a burst of message slots.
 
 Requires:
 - Message Sender application is running
 
 Promises:
-- Command numbers and names of all installed commands are queued to messagesender.
+- The list heading is queued and the Debug state machine goes to DebugSM_ListCommands 
+  starting from command 0
 
 */
 static void DebugCommandPrepareList(void)
 {
   u8 au8ListHeading[] = "\n\n\rAvailable commands:\n\r";
-  u8 au8CommandLine[DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH + DEBUG_CMD_POSTFIX_LENGTH];
   
-  /* Write static characters to command list line */
-  au8CommandLine[2] = ':';
-  au8CommandLine[3] = ' ';
-  au8CommandLine[DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH] = '\n';
-  au8CommandLine[DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH + 1] = '\r';
-  au8CommandLine[DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH + 2] = '\0';
-
-  /* Prepare a nicely formatted list of commands */
   DebugPrintf(au8ListHeading);
   
-  /* Loop through the array of commands parsing out the command number
-  and printing it along with the command name. */  
-  for(u8 i = 0; i < DEBUG_COMMANDS; i++)
-  {
-    /* Get the command number in ASCII */
-    if(i >= 10)
-    {
-      au8CommandLine[0] = (i / 10) + NUMBER_ASCII_TO_DEC;
-    }
-    else
-    {
-      au8CommandLine[0] = NUMBER_ASCII_TO_DEC;
-    }
-    
-    au8CommandLine[1] = (i % 10) + NUMBER_ASCII_TO_DEC;
-    
-    /* Read the command name */
-    for(u8 j = 0; j < DEBUG_CMD_NAME_LENGTH; j++)
-    {
-      au8CommandLine[DEBUG_CMD_PREFIX_LENGTH + j] = Debug_au8Commands[i].pu8CommandName[j];
-    }
-    
-    /* Queue the command name to the UART */
-    DebugPrintf(au8CommandLine);
-  }
-
-  DebugLineFeed();
+  Debug_u8ListIndex = 0;
+  Debug_pfnStateMachine = DebugSM_ListCommands;
   
 } /* end DebugCommandPrepareList() */
 
 
 /*!----------------------------------------------------------------------------------------------------------------------
-@fn static void DebugCommandDummy(void)
-
-@brief A command place-holder.
-
-Use this function when adding new commands that do not exist yet.  This is 
-handy if you are out of space in the command list and might as well add a 
-group of new commands instead of just one.  Or perhaps you just need a
-temporary place holder.
+@fn static u8 DebugCommandFind(u8* pu8Name_)
 
+@brief Looks up a command by name with a binary search of Debug_au8CommandsByName[].
 
 Requires:
-- NONE
+@param pu8Name_ is the NULL-terminated name to find
 
 Promises:
-- A string is printed to tell the user they are using a command 
-that does not exist.
+- Returns the command number, or DEBUG_CMD_NONE if no command has that name
 
 */
-static void DebugCommandDummy(void)
+static u8 DebugCommandFind(u8* pu8Name_)
 {
-  u8 au8DummyCommand[] = "\n\rDummy!\n\n\r";
-  
-  DebugPrintf(au8DummyCommand);
+  u8 u8Low = 0;
+  u8 u8High = Debug_u8CommandCount;
+  u8 u8Middle;
+  s32 s32Compare;
   
-} /* end DebugCommandDummy() */
-
-
-#ifdef EIE_ASCII
-/*!----------------------------------------------------------------------------------------------------------------------
+  while(u8Low < u8High)
+  {
+    u8Middle = (u8Low + u8High) / 2;
+    s32Compare = strcmp((char*)Debug_asCommands[Debug_au8CommandsByName[u8Middle]].pu8CommandName, (char*)pu8Name_);
+    
+    if(s32Compare == 0)
+    {
+      return(Debug_au8CommandsByName[u8Middle]);
+    }
+    
+    if(s32Compare < 0)
+    {
+      u8Low = u8Middle + 1;
+    }
+    else
+    {
+      u8High = u8Middle;
+    }
+  }
+  
+  return(DEBUG_CMD_NONE);
+  
+} /* end DebugCommandFind() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static bool DebugLineEdit(u8 u8Char_)
+
+@brief Applies one received character to the command line in Debug_au8CommandBuffer[].
+
+Printable characters are inserted at the cursor.  Backspace/Delete, the cursor keys, Home/End, 
+history recall, Ctrl-U and Tab (name completion) edit the line; the keys are listed with 
+DEBUG_KEY_HOME in debug.h.  VT100 escape sequences are collected over as many calls as they 
+take.  The terminal is updated through the echo buffer, which is sent once per pass of the Idle
+state.
+
+Requires:
+- Passthrough mode is off
+@param u8Char_ is the character received
+
+Promises:
+- Returns TRUE when CR ends the line: the line is in Debug_au8CommandBuffer[] followed by CR and
+  is stored in the history
+- Otherwise returns FALSE
+
+*/
+static bool DebugLineEdit(u8 u8Char_)
+{
+  u8 u8Key = u8Char_;
+  static u8 au8Empty[] = "";
+
+  /* Turn an escape sequence into the matching control key once its final byte arrives */
+  if(Debug_u8EscapeState == DEBUG_ESC_START)
+  {
+    Debug_u8EscapeParameter = 0;
+    Debug_u8EscapeState = DEBUG_ESC_NONE;
+    if( (u8Char_ == '[') || (u8Char_ == 'O') )
+    {
+      Debug_u8EscapeState = DEBUG_ESC_SEQUENCE;
+    }
+    return(FALSE);
+  }
+  
+  if(Debug_u8EscapeState == DEBUG_ESC_SEQUENCE)
+  {
+    /* Parameters: only the last number matters (ESC[1;5C is Ctrl-Right) */
+    if( (u8Char_ >= '0') && (u8Char_ <= '9') )
+    {
+      Debug_u8EscapeParameter = (u8)( (Debug_u8EscapeParameter * 10) + (u8Char_ - NUMBER_ASCII_TO_DEC) );
+      return(FALSE);
+    }
+    
+    if(u8Char_ == ';')
+    {
+      Debug_u8EscapeParameter = 0;
+      return(FALSE);
+    }
+    
+    Debug_u8EscapeState = DEBUG_ESC_NONE;
+    switch(u8Char_)
+    {
+      case 'A': u8Key = DEBUG_KEY_PREVIOUS; break;
+      case 'B': u8Key = DEBUG_KEY_NEXT;     break;
+      case 'C': u8Key = DEBUG_KEY_RIGHT;    break;
+      case 'D': u8Key = DEBUG_KEY_LEFT;     break;
+      case 'H': u8Key = DEBUG_KEY_HOME;     break;
+      case 'F': u8Key = DEBUG_KEY_END;      break;
+      
+      case '~':
+      {
+        switch(Debug_u8EscapeParameter)
+        {
+          case 1:
+          case 7: u8Key = DEBUG_KEY_HOME;   break;
+          case 3: u8Key = DEBUG_KEY_DELETE; break;
+          case 4:
+          case 8: u8Key = DEBUG_KEY_END;    break;
+          default: return(FALSE);
+        }
+        break;
+      }
+      
+      /* Function keys and anything else are ignored */
+      default:
+        return(FALSE);
+    }
+  }
+
+  switch(u8Key)
+  {
+    case ASCII_ESCAPE:
+    {
+      Debug_u8EscapeState = DEBUG_ESC_START;
+      break;
+    }
+    
+    /* CR ends the line wherever the cursor is */
+    case ASCII_CARRIAGE_RETURN:
+    {
+      DebugLineHistoryAdd();
+      Debug_au8CommandBuffer[Debug_u16CommandSize] = ASCII_CARRIAGE_RETURN;
+      Debug_u8HistoryRecall = 0;
+      DebugEchoByte(ASCII_CARRIAGE_RETURN);
+      return(TRUE);
+    }
+    
+    case ASCII_BACKSPACE:
+    case ASCII_DELETE:
+    {
+      if(Debug_u8CmdCursor != 0)
+      {
+        DebugLineCursorTo(Debug_u8CmdCursor - 1);
+        DebugLineErase();
+      }
+      break;
+    }
+    
+    case DEBUG_KEY_DELETE:
+    {
+      DebugLineErase();
+      break;
+    }
+    
+    case DEBUG_KEY_LEFT:
+    {
+      if(Debug_u8CmdCursor != 0)
+      {
+        DebugLineCursorTo(Debug_u8CmdCursor - 1);
+      }
+      break;
+    }
+    
+    case DEBUG_KEY_RIGHT:
+    {
+      if(Debug_u8CmdCursor < Debug_u16CommandSize)
+      {
+        DebugLineCursorTo(Debug_u8CmdCursor + 1);
+      }
+      break;
+    }
+    
+    case DEBUG_KEY_HOME:
+    {
+      DebugLineCursorTo(0);
+      break;
+    }
+    
+    case DEBUG_KEY_END:
+    {
+      DebugLineCursorTo( (u8)Debug_u16CommandSize );
+      break;
+    }
+    
+    case DEBUG_KEY_PREVIOUS:
+    {
+      DebugLineRecall(TRUE);
+      break;
+    }
+    
+    case DEBUG_KEY_NEXT:
+    {
+      DebugLineRecall(FALSE);
+      break;
+    }
+    
+    case DEBUG_KEY_CLEAR:
+    {
+      DebugLineReplace(au8Empty);
+      break;
+    }
+    
+    case ASCII_TAB:
+    {
+      DebugLineComplete();
+      break;
+    }
+    
+    /* Printable characters are inserted; other control characters (e.g. LF) are dropped */
+    default:
+    {
+      if( (u8Key >= ' ') && (u8Key < ASCII_DELETE) )
+      {
+        DebugLineInsert(&u8Key, 1);
+      }
+      break;
+    }
+  } /* end switch(u8Key) */
+  
+  return(FALSE);
+  
+} /* end DebugLineEdit() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineInsert(u8* pu8Text_, u8 u8Count_)
+
+@brief Inserts characters at the cursor and redraws the rest of the line.
+
+Requires:
+@param pu8Text_ points to the characters (not necessarily NULL-terminated)
+@param u8Count_ is the number of characters
+
+Promises:
+- As many characters as fit are inserted (one byte is always kept for the CR); the terminal bell
+  is sent if any did not fit
+- The cursor is left after the inserted characters
+
+*/
+static void DebugLineInsert(u8* pu8Text_, u8 u8Count_)
+{
+  u8 u8Room = (u8)( (DEBUG_CMD_BUFFER_SIZE - 1) - Debug_u16CommandSize );
+  u8 u8Tail = (u8)(Debug_u16CommandSize - Debug_u8CmdCursor);
+  
+  if(u8Count_ > u8Room)
+  {
+    u8Count_ = u8Room;
+    DebugEchoByte(ASCII_BELL);
+  }
+  
+  if(u8Count_ == 0)
+  {
+    return;
+  }
+  
+  /* Open a gap at the cursor (from the end so nothing is overwritten) */
+  for(u8 i = u8Tail; i != 0; i--)
+  {
+    Debug_au8CommandBuffer[Debug_u8CmdCursor + u8Count_ + i - 1] = Debug_au8CommandBuffer[Debug_u8CmdCursor + i - 1];
+  }
+  
+  for(u8 i = 0; i < u8Count_; i++)
+  {
+    Debug_au8CommandBuffer[Debug_u8CmdCursor + i] = pu8Text_[i];
+  }
+  Debug_u16CommandSize += u8Count_;
+
+  /* Print from the new characters to the end of the line, then step back over the old tail */
+  DebugEchoText(&Debug_au8CommandBuffer[Debug_u8CmdCursor], u8Count_ + u8Tail);
+  DebugEchoCursorLeft(u8Tail);
+  Debug_u8CmdCursor += u8Count_;
+  
+} /* end DebugLineInsert() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineErase(void)
+
+@brief Deletes the character under the cursor and redraws the rest of the line.
+
+Requires:
+- NONE
+
+Promises:
+- If the cursor is before the end of the line, the character there is removed and the rest of
+  the line moves left; the cursor does not move
+
+*/
+static void DebugLineErase(void)
+{
+  u8 u8Tail;
+  
+  if(Debug_u8CmdCursor >= Debug_u16CommandSize)
+  {
+    return;
+  }
+  
+  Debug_u16CommandSize--;
+  u8Tail = (u8)(Debug_u16CommandSize - Debug_u8CmdCursor);
+  for(u8 i = 0; i < u8Tail; i++)
+  {
+    Debug_au8CommandBuffer[Debug_u8CmdCursor + i] = Debug_au8CommandBuffer[Debug_u8CmdCursor + i + 1];
+  }
+  
+  /* Print the tail and a space over the old last character, then return to the cursor */
+  DebugEchoText(&Debug_au8CommandBuffer[Debug_u8CmdCursor], u8Tail);
+  DebugEchoByte(' ');
+  DebugEchoCursorLeft(u8Tail + 1);
+  
+} /* end DebugLineErase() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineCursorTo(u8 u8Position_)
+
+@brief Moves the cursor within the line.
+
+Requires:
+@param u8Position_ is the new cursor position, at most Debug_u16CommandSize
+
+Promises:
+- Moving left uses the cursor-left sequence; moving right prints the characters passed over
+- Debug_u8CmdCursor is u8Position_
+
+*/
+static void DebugLineCursorTo(u8 u8Position_)
+{
+  if(u8Position_ < Debug_u8CmdCursor)
+  {
+    DebugEchoCursorLeft(Debug_u8CmdCursor - u8Position_);
+  }
+  else
+  {
+    DebugEchoText(&Debug_au8CommandBuffer[Debug_u8CmdCursor], u8Position_ - Debug_u8CmdCursor);
+  }
+  
+  Debug_u8CmdCursor = u8Position_;
+  
+} /* end DebugLineCursorTo() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineReplace(u8* pu8Text_)
+
+@brief Replaces the whole line with new text.
+
+Requires:
+@param pu8Text_ is the NULL-terminated new line (shorter than DEBUG_CMD_BUFFER_SIZE)
+
+Promises:
+- The old line is erased on the terminal and the new one is printed with the cursor at its end
+
+*/
+static void DebugLineReplace(u8* pu8Text_)
+{
+  static u8 au8DeleteRight[] = TERM_DELETE_RIGHT;
+  
+  DebugLineCursorTo(0);
+  
+  Debug_u16CommandSize = 0;
+  while( (pu8Text_[Debug_u16CommandSize] != '\0') && (Debug_u16CommandSize < (DEBUG_CMD_BUFFER_SIZE - 1)) )
+  {
+    Debug_au8CommandBuffer[Debug_u16CommandSize] = pu8Text_[Debug_u16CommandSize];
+    Debug_u16CommandSize++;
+  }
+  
+  DebugEchoText(Debug_au8CommandBuffer, (u8)Debug_u16CommandSize);
+  DebugEchoText(au8DeleteRight, sizeof(au8DeleteRight) - 1);
+  Debug_u8CmdCursor = (u8)Debug_u16CommandSize;
+  
+} /* end DebugLineReplace() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineRecall(bool bOlder_)
+
+@brief Steps through the command history.
+
+Requires:
+@param bOlder_ is TRUE for the previous (older) line, FALSE for the next (newer) one
+
+Promises:
+- The line is replaced with the history line; stepping past the newest gives an empty line
+- The terminal bell is sent if there is nothing further in that direction
+
+*/
+static void DebugLineRecall(bool bOlder_)
+{
+  static u8 au8Empty[] = "";
+  u8 u8Index;
+  
+  if(bOlder_)
+  {
+    if(Debug_u8HistoryRecall == Debug_u8HistoryCount)
+    {
+      DebugEchoByte(ASCII_BELL);
+      return;
+    }
+    Debug_u8HistoryRecall++;
+  }
+  else
+  {
+    if(Debug_u8HistoryRecall == 0)
+    {
+      DebugEchoByte(ASCII_BELL);
+      return;
+    }
+    Debug_u8HistoryRecall--;
+  }
+  
+  if(Debug_u8HistoryRecall == 0)
+  {
+    DebugLineReplace(au8Empty);
+  }
+  else
+  {
+    u8Index = (u8)( (Debug_u8HistoryNewest + DEBUG_CMD_HISTORY_LINES - (Debug_u8HistoryRecall - 1)) % DEBUG_CMD_HISTORY_LINES );
+    DebugLineReplace(Debug_aau8CmdHistory[u8Index]);
+  }
+  
+} /* end DebugLineRecall() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineHistoryAdd(void)
+
+@brief Stores the current line as the newest history line.
+
+Requires:
+- Debug_au8CommandBuffer[] holds Debug_u16CommandSize characters (no CR yet)
+
+Promises:
+- Empty lines and repeats of the newest line are not stored
+- The oldest line is dropped once there are DEBUG_CMD_HISTORY_LINES
+
+*/
+static void DebugLineHistoryAdd(void)
+{
+  u8* pu8Newest = Debug_aau8CmdHistory[Debug_u8HistoryNewest];
+  u8 u8Index;
+  
+  if(Debug_u16CommandSize == 0)
+  {
+    return;
+  }
+  
+  if(Debug_u8HistoryCount != 0)
+  {
+    for(u8Index = 0; u8Index < Debug_u16CommandSize; u8Index++)
+    {
+      if(pu8Newest[u8Index] != Debug_au8CommandBuffer[u8Index])
+      {
+        break;
+      }
+    }
+    
+    if( (u8Index == Debug_u16CommandSize) && (pu8Newest[u8Index] == '\0') )
+    {
+      return;
+    }
+  }
+  
+  Debug_u8HistoryNewest = (u8)( (Debug_u8HistoryNewest + 1) % DEBUG_CMD_HISTORY_LINES );
+  pu8Newest = Debug_aau8CmdHistory[Debug_u8HistoryNewest];
+  for(u8Index = 0; u8Index < Debug_u16CommandSize; u8Index++)
+  {
+    pu8Newest[u8Index] = Debug_au8CommandBuffer[u8Index];
+  }
+  pu8Newest[u8Index] = '\0';
+  
+  if(Debug_u8HistoryCount < DEBUG_CMD_HISTORY_LINES)
+  {
+    Debug_u8HistoryCount++;
+  }
+  
+} /* end DebugLineHistoryAdd() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLineComplete(void)
+
+@brief Completes the command name being typed (Tab).
+
+A partial "en+c" is completed first.  After "en+c" (and any spaces) the word is matched against
+the registered command names.  Since Debug_au8CommandsByName[] is sorted, the matches are next to
+each other and what they have in common is what the first and last match share.
+
+Requires:
+- NONE
+
+Promises:
+- A single match is completed; several matches are completed as far as they agree, or listed 
+  under the line if they already differ at the cursor
+- The terminal bell is sent if there is no match or the cursor is not at the end of the line
+
+*/
+static void DebugLineComplete(void)
+{
+  static u8 au8CommandHeader[] = "en+c";
+  static u8 au8NewLine[] = "\r\n";
+  static u8 au8Gap[] = "  ";
+  u8* pu8Word;
+  u8* pu8First = NULL;
+  u8* pu8Last = NULL;
+  u8* pu8Name;
+  u8 u8WordLength;
+  u8 u8FirstIndex = 0;
+  u8 u8LastIndex = 0;
+  u8 u8Index;
+  u8 u8Common;
+  
+  if(Debug_u8CmdCursor != Debug_u16CommandSize)
+  {
+    DebugEchoByte(ASCII_BELL);
+    return;
+  }
+  
+  /* The header itself */
+  for(u8Index = 0; (u8Index < Debug_u16CommandSize) && (u8Index < 4); u8Index++)
+  {
+    if(Debug_au8CommandBuffer[u8Index] != au8CommandHeader[u8Index])
+    {
+      DebugEchoByte(ASCII_BELL);
+      return;
+    }
+  }
+  
+  if(Debug_u16CommandSize < 4)
+  {
+    DebugLineInsert(&au8CommandHeader[Debug_u16CommandSize], (u8)(4 - Debug_u16CommandSize));
+    return;
+  }
+  
+  /* The command name after the header and spaces */
+  while( (u8Index < Debug_u16CommandSize) && (Debug_au8CommandBuffer[u8Index] == ' ') )
+  {
+    u8Index++;
+  }
+  pu8Word = &Debug_au8CommandBuffer[u8Index];
+  u8WordLength = (u8)(Debug_u16CommandSize - u8Index);
+  
+  for(u8Index = 0; u8Index < Debug_u8CommandCount; u8Index++)
+  {
+    pu8Name = Debug_asCommands[Debug_au8CommandsByName[u8Index]].pu8CommandName;
+    if(strncmp((char*)pu8Name, (char*)pu8Word, u8WordLength) == 0)
+    {
+      if(pu8First == NULL)
+      {
+        pu8First = pu8Name;
+        u8FirstIndex = u8Index;
+      }
+      pu8Last = pu8Name;
+      u8LastIndex = u8Index;
+    }
+  }
+  
+  if(pu8First == NULL)
+  {
+    DebugEchoByte(ASCII_BELL);
+    return;
+  }
+  
+  /* Extend the word as far as the matches agree (all of it for a single match) */
+  u8Common = u8WordLength;
+  while( (pu8First[u8Common] != '\0') && (pu8First[u8Common] == pu8Last[u8Common]) )
+  {
+    u8Common++;
+  }
+  
+  if(u8Common > u8WordLength)
+  {
+    DebugLineInsert(&pu8First[u8WordLength], u8Common - u8WordLength);
+    return;
+  }
+  
+  /* Already complete, or nothing to add: list the matches and draw the line again */
+  if(u8FirstIndex != u8LastIndex)
+  {
+    DebugEchoText(au8NewLine, sizeof(au8NewLine) - 1);
+    for(u8Index = u8FirstIndex; u8Index <= u8LastIndex; u8Index++)
+    {
+      pu8Name = Debug_asCommands[Debug_au8CommandsByName[u8Index]].pu8CommandName;
+      DebugEchoText(pu8Name, (u8)strlen((char*)pu8Name));
+      DebugEchoText(au8Gap, sizeof(au8Gap) - 1);
+    }
+    DebugEchoText(au8NewLine, sizeof(au8NewLine) - 1);
+    DebugEchoText(Debug_au8CommandBuffer, (u8)Debug_u16CommandSize);
+  }
+  
+} /* end DebugLineComplete() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugEchoByte(u8 u8Byte_)
+
+@brief Adds a byte to the echo buffer that DebugEchoFlush() sends at the end of the Idle pass.
+
+Requires:
+@param u8Byte_ is the byte to send
+
+Promises:
+- The byte is in Debug_au8EchoBuffer[]; a full buffer is sent first so nothing is lost
+
+*/
+static void DebugEchoByte(u8 u8Byte_)
+{
+  if(Debug_u8EchoSize == DEBUG_ECHO_BUFFER_SIZE)
+  {
+    DebugEchoFlush();
+  }
+  
+  Debug_au8EchoBuffer[Debug_u8EchoSize++] = u8Byte_;
+  
+} /* end DebugEchoByte() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugEchoText(u8* pu8Text_, u8 u8Count_)
+
+@brief Adds characters to the echo buffer.
+
+Requires:
+@param pu8Text_ points to the characters
+@param u8Count_ is the number of characters
+
+Promises:
+- The characters are added with DebugEchoByte()
+
+*/
+static void DebugEchoText(u8* pu8Text_, u8 u8Count_)
+{
+  while(u8Count_ != 0)
+  {
+    DebugEchoByte(*pu8Text_++);
+    u8Count_--;
+  }
+  
+} /* end DebugEchoText() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugEchoCursorLeft(u8 u8Count_)
+
+@brief Adds the sequence that moves the terminal cursor left.
+
+Requires:
+@param u8Count_ is the number of columns (less than 100)
+
+Promises:
+- One column is a backspace; more use ESC [ n D
+
+*/
+static void DebugEchoCursorLeft(u8 u8Count_)
+{
+  if(u8Count_ == 0)
+  {
+    return;
+  }
+  
+  if(u8Count_ == 1)
+  {
+    DebugEchoByte(ASCII_BACKSPACE);
+    return;
+  }
+  
+  DebugEchoByte(ASCII_ESCAPE);
+  DebugEchoByte('[');
+  if(u8Count_ >= 10)
+  {
+    DebugEchoByte( (u8)((u8Count_ / 10) + NUMBER_ASCII_TO_DEC) );
+  }
+  DebugEchoByte( (u8)((u8Count_ % 10) + NUMBER_ASCII_TO_DEC) );
+  DebugEchoByte('D');
+  
+} /* end DebugEchoCursorLeft() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugEchoFlush(void)
+
+@brief Sends the echo buffer as a single UART write.
+
+Requires:
+- NONE
+
+Promises:
+- Anything in Debug_au8EchoBuffer[] is queued with UartWriteData() (which copies it) and the 
+  buffer is empty
+
+*/
+static void DebugEchoFlush(void)
+{
+  if(Debug_u8EchoSize != 0)
+  {
+    Debug_au32MsgTokens[Debug_u8TokenCounter] = UartWriteData(Debug_Uart, Debug_u8EchoSize, Debug_au8EchoBuffer);
+    AdvanceTokenCounter();
+    Debug_u8EchoSize = 0;
+  }
+  
+} /* end DebugEchoFlush() */
+
+
+#ifdef EIE_ASCII
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandLedTestToggle(void)
+
+@brief Toggles and reports the active state of the LED test.
+
+This implementation is specific to the target hardware.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_LED_TEST_ENABLE is toggled
+
+*/
+static void DebugCommandLedTestToggle(void)
+{
+  u8 au8LedTestMessage[] = "\n\rLed Test ";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8LedTestMessage);
+  if(G_u32DebugFlags & _DEBUG_LED_TEST_ENABLE)
+  {
+    G_u32DebugFlags &= ~_DEBUG_LED_TEST_ENABLE;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_LED_TEST_ENABLE;
+    DebugPrintf(G_au8UtilMessageON);
+    
+    LedOn(WHITE);
+    LedOn(PURPLE);
+    LedOn(BLUE);
+    LedOn(CYAN);
+    LedOn(GREEN);
+    LedOn(YELLOW);
+    LedOn(ORANGE);
+    LedOn(RED);
+  }
+  
+} /* end DebugCommandLedTestToggle() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLedTestCharacter(u8 u8Char_)
+
+@brief Checks the character and toggles associated LED if applicable.
+
+Only responds to UPPER CASE characters.
+This implementation is specific to the target hardware.
+
+For EIE_ASCII: W, P, B, C, G, Y, O, R
+
+Requires:
+@param u8Char_ is the character to check
+
+Promises:
+- If u8Char_ is a valid toggling character, the corresponding LED will be toggled.
+
+*/
+static void DebugLedTestCharacter(u8 u8Char_)
+{
+  LedNameType eLed;
+  bool bValidLed = TRUE;
+  
+  /* Check the char to see if an LED should be toggled */  
+  switch (u8Char_)
+  {
+    case 'W':
+    {
+      eLed = WHITE;
+      break;
+    }  
+
+    case 'P':
+    {
+      eLed = PURPLE;
+      break;
+    }  
+
+    case 'B':
+    {
+      eLed = BLUE;
+      break;
+    }  
+
+    case 'C':
+    {
+      eLed = CYAN;
+      break;
+    }  
+
+    case 'G':
+    {
+      eLed = GREEN;
+      break;
+    }  
+
+    case 'Y':
+    {
+      eLed = YELLOW;
+      break;
+    }  
+
+    case 'O':
+    {
+      eLed = ORANGE;
+      break;
+    }  
+
+    case 'R':
+    {
+      eLed = RED;
+      break;
+    }  
+    
+  default:
+    {
+      bValidLed = FALSE;
+      break;
+    }
+  } /* end switch */
+  
+  if(bValidLed)
+  {
+    LedToggle(eLed);
+  }
+    
+} /* end DebugCommandLedTestToggle() */
+#endif /* EIE_ASCII */
+
+
+#ifdef EIE_DOTMATRIX
+/*!----------------------------------------------------------------------------------------------------------------------
 @fn static void DebugCommandLedTestToggle(void)
 
-@brief Toggles and reports the active state of the LED test.
+@brief Toggles and reports the active state of the LED test.
+
+This implementation is specific to the target hardware.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_LED_TEST_ENABLE is toggled
+
+*/
+static void DebugCommandLedTestToggle(void)
+{
+  u8 au8LedTestMessage[] = "\n\rLed Test ";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8LedTestMessage);
+  if(G_u32DebugFlags & _DEBUG_LED_TEST_ENABLE)
+  {
+    G_u32DebugFlags &= ~_DEBUG_LED_TEST_ENABLE;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_LED_TEST_ENABLE;
+    DebugPrintf(G_au8UtilMessageON);
+    
+    LedOn(RED0);
+    LedOn(RED1);
+    LedOn(RED2);
+    LedOn(RED3);
+    LedOn(GREEN0);
+    LedOn(GREEN1);
+    LedOn(GREEN2);
+    LedOn(GREEN3);
+    LedOn(BLUE0);
+    LedOn(BLUE1);
+    LedOn(BLUE2);
+    LedOn(BLUE3);
+  }
+  
+} /* end DebugCommandLedTestToggle() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugLedTestCharacter(u8 u8Char_)
+
+@brief Checks the character and toggles associated LED if applicable.
+
+Only responds to UPPER CASE characters.
+This implementation is specific to the target hardware.
+
+For EIE_DOTMATRIX: R, G, B
+
+Requires:
+@param u8Char_ is the character to check
+
+Promises:
+- If u8Char_ is a valid toggling character, the corresponding LEDs will be toggled.
+
+*/
+static void DebugLedTestCharacter(u8 u8Char_)
+{
+  /* Check the char to see if an LED group should be toggled */  
+  if(u8Char_ == 'R')
+  {
+    LedToggle(RED0);
+    LedToggle(RED1);
+    LedToggle(RED2);
+    LedToggle(RED3);
+  }  
+  
+  if(u8Char_ == 'G')
+  {
+    LedToggle(GREEN0);
+    LedToggle(GREEN1);
+    LedToggle(GREEN2);
+    LedToggle(GREEN3);
+  }  
+
+  if(u8Char_ == 'B')
+  {
+    LedToggle(BLUE0);
+    LedToggle(BLUE1);
+    LedToggle(BLUE2);
+    LedToggle(BLUE3);
+  }  
+
+} /* end DebugCommandLedTestToggle() */
+#endif /* EIE_DOTMATRIX */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandSysTimeToggle(void)
+
+@brief Toggles the active state of the 1ms violation warning.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_TIME_WARNING_ENABLE is toggled
+
+*/
+static void DebugCommandSysTimeToggle(void)
+{
+  u8 au8SysTimeTestMessage[] = "\n\rSystem time violation reporting ";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8SysTimeTestMessage);
+  if(G_u32DebugFlags & _DEBUG_TIME_WARNING_ENABLE)
+  {
+    G_u32DebugFlags &= ~_DEBUG_TIME_WARNING_ENABLE;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_TIME_WARNING_ENABLE;
+    DebugPrintf(G_au8UtilMessageON);
+  }
+  
+} /* end DebugCommandSysTimeToggle() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandMessagingStats(void)
+
+@brief Prints the messaging load counters from MessagingGetStats().
+
+The report is built into whole lines so it only takes a few message slots.
+
+Requires:
+- NONE
+
+Promises:
+- The enqueue, dequeue, full rejection and peak slot counts, both latency histograms and the 
+  bytes queued to each peripheral are printed
+
+*/
+static void DebugCommandMessagingStats(void)
+{
+  u8 au8Title[] = "\n\rMessaging statistics\n\r";
+  u8 au8Enqueues[] = "Queued ";
+  u8 au8Dequeues[] = "  Dequeued ";
+  u8 au8Full[] = "  Full rejections ";
+  u8 au8Peak[] = "  Peak slots ";
+  u8 au8Of[] = " of ";
+  u8 au8WaitingLabel[] = "Waiting to sending ms:";
+  u8 au8SendingLabel[] = "Sending to complete ms:";
+  u8 au8Bytes[] = "Bytes queued by peripheral ID:";
+  u8 au8Space[] = " ";
+  u8 au8Equals[] = "=";
+  u8 au8LineEnd[] = "\n\r";
+  u8 au8Line[DEBUG_STATS_LINE_SIZE];
+  MessagingStatsType sStats;
+  u8* pu8Next;
+  
+  MessagingGetStats(&sStats);
+  DebugPrintf(au8Title);
+  
+  pu8Next = DebugAppendNumber(au8Line, au8Enqueues, sStats.u32Enqueues);
+  pu8Next = DebugAppendNumber(pu8Next, au8Dequeues, sStats.u32Dequeues);
+  pu8Next = DebugAppendNumber(pu8Next, au8Full, sStats.u32FullRejections);
+  pu8Next = DebugAppendNumber(pu8Next, au8Peak, sStats.u32PeakQueuedMessages);
+  pu8Next = DebugAppendNumber(pu8Next, au8Of, U8_TX_QUEUE_SIZE);
+  DebugAppendText(pu8Next, au8LineEnd);
+  DebugPrintf(au8Line);
+  
+  DebugPrintLatency(au8WaitingLabel, &sStats.sWaitingToSending);
+  DebugPrintLatency(au8SendingLabel, &sStats.sSendingToComplete);
+  
+  /* Start a new line before one could overflow */
+  pu8Next = DebugAppendText(au8Line, au8Bytes);
+  for(u8 i = 0; i < U8_MSG_STATS_PERIPHERALS; i++)
+  {
+    if(sStats.au32PeripheralBytes[i] != 0)
+    {
+      if( (pu8Next - au8Line) > (DEBUG_STATS_LINE_SIZE - 20) )
+      {
+        DebugAppendText(pu8Next, au8LineEnd);
+        DebugPrintf(au8Line);
+        pu8Next = au8Line;
+      }
+      pu8Next = DebugAppendNumber(pu8Next, au8Space, i);
+      pu8Next = DebugAppendNumber(pu8Next, au8Equals, sStats.au32PeripheralBytes[i]);
+    }
+  }
+  DebugAppendText(pu8Next, au8LineEnd);
+  DebugPrintf(au8Line);
+  
+} /* end DebugCommandMessagingStats() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugPrintLatency(u8* pu8Label_, MessageLatencyStatsType* psLatency_)
+
+@brief Prints the summary and histogram of one messaging latency measurement.
+
+Requires:
+@param pu8Label_ is the NULL-terminated name of the measurement
+@param psLatency_ is the measurement to print
+
+Promises:
+- Two lines are printed: the count, min, average and max, then the count in each histogram bin 
+  labelled with the lowest time in ms that it holds
+
+*/
+static void DebugPrintLatency(u8* pu8Label_, MessageLatencyStatsType* psLatency_)
+{
+  u8 au8Count[] = " n ";
+  u8 au8Min[] = "  min ";
+  u8 au8Avg[] = "  avg ";
+  u8 au8Max[] = "  max ";
+  u8 au8Space[] = " ";
+  u8 au8Colon[] = ":";
+  u8 au8Longer[] = "+";
+  u8 au8LineEnd[] = "\n\r";
+  u8 au8Line[DEBUG_STATS_LINE_SIZE];
+  u8* pu8Next;
+  u32 u32Average = 0;
+  
+  if(psLatency_->u32Count != 0)
+  {
+    u32Average = psLatency_->u32Total / psLatency_->u32Count;
+  }
+  
+  pu8Next = DebugAppendText(au8Line, pu8Label_);
+  pu8Next = DebugAppendNumber(pu8Next, au8Count, psLatency_->u32Count);
+  pu8Next = DebugAppendNumber(pu8Next, au8Min, psLatency_->u32Min);
+  pu8Next = DebugAppendNumber(pu8Next, au8Avg, u32Average);
+  pu8Next = DebugAppendNumber(pu8Next, au8Max, psLatency_->u32Max);
+  DebugAppendText(pu8Next, au8LineEnd);
+  DebugPrintf(au8Line);
+  
+  /* Bin 0 is 0 ms and bin n holds 2^(n-1) ms and up */
+  pu8Next = DebugAppendText(au8Line, au8Space);
+  for(u8 i = 0; i < U8_MSG_LATENCY_BINS; i++)
+  {
+    pu8Next = DebugAppendNumber(pu8Next, au8Space, (i == 0) ? 0 : ((u32)1 << (i - 1)));
+    if(i == (U8_MSG_LATENCY_BINS - 1))
+    {
+      pu8Next = DebugAppendText(pu8Next, au8Longer);
+    }
+    pu8Next = DebugAppendNumber(pu8Next, au8Colon, psLatency_->au32Bins[i]);
+  }
+  DebugAppendText(pu8Next, au8LineEnd);
+  DebugPrintf(au8Line);
+  
+} /* end DebugPrintLatency() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u8* DebugAppendText(u8* pu8Line_, u8* pu8Text_)
+
+@brief Copies a string to the end of a line being built.
+
+Requires:
+@param pu8Line_ points to the NULL at the end of the line with room for the text
+@param pu8Text_ is the NULL-terminated text to add
+
+Promises:
+- The text and a NULL are written at pu8Line_
+- Returns a pointer to the new NULL
+
+*/
+static u8* DebugAppendText(u8* pu8Line_, u8* pu8Text_)
+{
+  while(*pu8Text_ != '\0')
+  {
+    *pu8Line_++ = *pu8Text_++;
+  }
+  *pu8Line_ = '\0';
+  
+  return(pu8Line_);
+  
+} /* end DebugAppendText() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u8* DebugAppendNumber(u8* pu8Line_, u8* pu8Label_, u32 u32Number_)
+
+@brief Adds a label and a number to the end of a line being built.
+
+Requires:
+@param pu8Line_ points to the NULL at the end of the line with room for the label and 10 digits
+@param pu8Label_ is the NULL-terminated text to put in front of the number
+@param u32Number_ is the number to add (no leading zeros)
+
+Promises:
+- The label, the number and a NULL are written at pu8Line_
+- Returns a pointer to the new NULL
+
+*/
+static u8* DebugAppendNumber(u8* pu8Line_, u8* pu8Label_, u32 u32Number_)
+{
+  pu8Line_ = DebugAppendText(pu8Line_, pu8Label_);
+  
+  return( pu8Line_ + NumberToAscii(u32Number_, pu8Line_) );
+  
+} /* end DebugAppendNumber() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandMessagingDump(void)
+
+@brief Sends the messaging load counters as the binary record from MessagingDumpStats().
+
+The record starts with "MS" and is meant for a host tool capturing the debug port rather than
+for a terminal.
+
+Requires:
+- NONE
+
+Promises:
+- The record is queued on the debug UART
+
+*/
+static void DebugCommandMessagingDump(void)
+{
+  u8 au8Record[U16_MSG_STATS_DUMP_SIZE];
+  u32 u32Size;
+  
+  u32Size = MessagingDumpStats(au8Record, sizeof(au8Record));
+  UartWriteData(Debug_Uart, u32Size, au8Record);
+  
+} /* end DebugCommandMessagingDump() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandLogBinaryToggle(void)
+
+@brief Toggles sending DebugLog() records as binary frames instead of text.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_LOG_BINARY is toggled
+
+*/
+static void DebugCommandLogBinaryToggle(void)
+{
+  u8 au8LogBinaryMessage[] = "\n\rBinary log output ";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8LogBinaryMessage);
+  if(G_u32DebugFlags & _DEBUG_LOG_BINARY)
+  {
+    G_u32DebugFlags &= ~_DEBUG_LOG_BINARY;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_LOG_BINARY;
+    DebugPrintf(G_au8UtilMessageON);
+  }
+  
+} /* end DebugCommandLogBinaryToggle() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandTelemetryToggle(void)
+
+@brief Toggles sending DebugTelemetrySend() frames.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_TELEMETRY_ENABLE is toggled
+
+*/
+static void DebugCommandTelemetryToggle(void)
+{
+  u8 au8TelemetryMessage[] = "\n\rTelemetry stream ";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8TelemetryMessage);
+  if(G_u32DebugFlags & _DEBUG_TELEMETRY_ENABLE)
+  {
+    G_u32DebugFlags &= ~_DEBUG_TELEMETRY_ENABLE;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_TELEMETRY_ENABLE;
+    DebugPrintf(G_au8UtilMessageON);
+  }
+  
+} /* end DebugCommandTelemetryToggle() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandUartTest(void)
+
+@brief Starts the debug UART throughput self-test.
+
+Enough DEBUG_UART_TEST_BLOCK_SIZE blocks of test lines to fill about DEBUG_UART_TEST_MS of line 
+time are sent with UartWriteDataNoCopy(), keeping up to DEBUG_UART_TEST_IN_FLIGHT of them queued 
+(see DebugSM_UartTest()).  The rate is measured from the end of the first block to the end of the 
+last one, so it shows whether the driver keeps the transmitter busy at the configured baud rate.
+
+Requires:
+- NONE
+
+Promises:
+- The test heading is queued and the Debug state machine goes to DebugSM_UartTest
+
+*/
+static void DebugCommandUartTest(void)
+{
+  u8 au8Title[] = "\n\rUART test: ";
+  u8 au8Bytes[] = " bytes at ";
+  u8 au8Baud[] = " baud\n\r";
+  u8 au8Line[DEBUG_STATS_LINE_SIZE];
+  u8* pu8Next;
+  u16 u16Column;
+  
+  /* Lines of printable characters so a terminal shows the test as it runs */
+  for(u16 i = 0; i < DEBUG_UART_TEST_BLOCK_SIZE; i++)
+  {
+    u16Column = i % DEBUG_UART_TEST_LINE_SIZE;
+    if(u16Column == (DEBUG_UART_TEST_LINE_SIZE - 2))
+    {
+      Debug_au8UartTestBlock[i] = ASCII_CARRIAGE_RETURN;
+    }
+    else if(u16Column == (DEBUG_UART_TEST_LINE_SIZE - 1))
+    {
+      Debug_au8UartTestBlock[i] = ASCII_LINEFEED;
+    }
+    else
+    {
+      Debug_au8UartTestBlock[i] = '0' + (u8)u16Column;
+    }
+  }
+  
+  /* 10 bits per character; at least two blocks so there is something to time */
+  Debug_u16UartTestBlocks = (u16)( ( (Debug_Uart->u32BaudRate / 10) * DEBUG_UART_TEST_MS ) / 
+                                   (1000 * DEBUG_UART_TEST_BLOCK_SIZE) );
+  if(Debug_u16UartTestBlocks < 2)
+  {
+    Debug_u16UartTestBlocks = 2;
+  }
+  Debug_u16UartTestQueued = 0;
+  Debug_u16UartTestDone   = 0;
+  Debug_u16UartTestFailed = 0;
+  Debug_u32UartTestTimer  = G_u32SystemTime1ms;
+  
+  pu8Next = DebugAppendNumber(au8Line, au8Title, (u32)Debug_u16UartTestBlocks * DEBUG_UART_TEST_BLOCK_SIZE);
+  pu8Next = DebugAppendNumber(pu8Next, au8Bytes, Debug_Uart->u32BaudRate);
+  DebugAppendText(pu8Next, au8Baud);
+  DebugPrintf(au8Line);
+  
+  Debug_pfnStateMachine = DebugSM_UartTest;
+  
+} /* end DebugCommandUartTest() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugUartTestDone(u32 u32Token_, MessageStateType eState_)
+
+@brief Message callback for the self-test blocks (runs in the UART ISR).
+
+Requires:
+@param u32Token_ is the token of the block (not used)
+@param eState_ is how the block ended
+
+Promises:
+- Debug_u16UartTestDone is incremented and the time of the first and latest block is kept
+- Debug_u16UartTestFailed is incremented if the block did not complete
+
+*/
+static void DebugUartTestDone(u32 u32Token_, MessageStateType eState_)
+{
+  if(eState_ != COMPLETE)
+  {
+    Debug_u16UartTestFailed++;
+  }
+  
+  if(Debug_u16UartTestDone == 0)
+  {
+    Debug_u32UartTestFirstDone = G_u32SystemTime1ms;
+  }
+  Debug_u32UartTestLastDone = G_u32SystemTime1ms;
+  Debug_u16UartTestDone++;
+  
+} /* end DebugUartTestDone() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugCommandTransfer(void)
+
+@brief Switches the debug UART to binary transfer mode.
+
+Requires:
+- NONE
+
+Promises:
+- Any earlier transfer is forgotten, a HELLO frame is queued and the Debug state machine goes to 
+  DebugSM_Transfer
+
+*/
+static void DebugCommandTransfer(void)
+{
+  Debug_u8XferFrameSize   = 0;
+  Debug_u8XferListIndex   = DEBUG_XFER_NONE;
+  Debug_bXferReading      = FALSE;
+  Debug_bXferReadDone     = FALSE;
+  Debug_bXferWriting      = FALSE;
+  Debug_u32XferIdleTimer  = G_u32SystemTime1ms;
+  
+  DebugXferHandleFrame(DEBUG_XFER_HELLO, 0, NULL, 0);
+  Debug_pfnStateMachine = DebugSM_Transfer;
+  
+} /* end DebugCommandTransfer() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static bool DebugXferSend(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+
+@brief Builds a transfer frame and queues it on the debug UART.
+
+Requires:
+@param u8Type_ is the DEBUG_XFER_xxx frame type
+@param u8Sequence_ is the sequence number for the frame
+@param pu8Payload_ points to the payload (may be NULL if u8Size_ is 0)
+@param u8Size_ is the payload size, at most DEBUG_XFER_MAX_PAYLOAD
+
+Promises:
+- Returns TRUE if the frame was queued; FALSE if the message queue was full (try again later)
+
+*/
+static bool DebugXferSend(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+{
+  u8 au8Frame[DEBUG_XFER_FRAME_SIZE];
+  u8* pu8Next = &au8Frame[DEBUG_XFER_HEADER_SIZE];
+  u16 u16Crc;
+  
+  au8Frame[0] = DEBUG_XFER_SYNC;
+  au8Frame[1] = u8Type_;
+  au8Frame[2] = u8Sequence_;
+  au8Frame[3] = u8Size_;
+  for(u8 i = 0; i < u8Size_; i++)
+  {
+    *pu8Next++ = pu8Payload_[i];
+  }
+  
+  u16Crc = Crc16Ccitt(U16_CRC16_CCITT_INIT, &au8Frame[1], (u32)(pu8Next - &au8Frame[1]));
+  *pu8Next++ = (u8)u16Crc;
+  *pu8Next++ = (u8)(u16Crc >> 8);
+  
+  return( UartWriteData(Debug_Uart, (u32)(pu8Next - au8Frame), au8Frame) != 0 );
+  
+} /* end DebugXferSend() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugXferParse(u8 u8Byte_)
+
+@brief Adds a received byte to the transfer frame being collected.
+
+Bytes outside a frame are ignored until the next DEBUG_XFER_SYNC.  A frame with a payload size over
+DEBUG_XFER_MAX_PAYLOAD or a bad CRC is dropped; the sender finds out from the missing ACK.
+
+Requires:
+@param u8Byte_ is the next byte from the debug UART
+
+Promises:
+- A complete frame with a good CRC is passed to DebugXferHandleFrame() and restarts the idle time-out
+
+*/
+static void DebugXferParse(u8 u8Byte_)
+{
+  u8 u8Size;
+  u16 u16Crc;
+  
+  if( (Debug_u8XferFrameSize == 0) && (u8Byte_ != DEBUG_XFER_SYNC) )
+  {
+    return;
+  }
+  
+  Debug_au8XferFrame[Debug_u8XferFrameSize++] = u8Byte_;
+  if(Debug_u8XferFrameSize < DEBUG_XFER_HEADER_SIZE)
+  {
+    return;
+  }
+  
+  u8Size = Debug_au8XferFrame[3];
+  if(u8Size > DEBUG_XFER_MAX_PAYLOAD)
+  {
+    Debug_u8XferFrameSize = 0;
+    return;
+  }
+  
+  if(Debug_u8XferFrameSize == (DEBUG_XFER_HEADER_SIZE + u8Size + DEBUG_XFER_CRC_SIZE))
+  {
+    Debug_u8XferFrameSize = 0;
+    u16Crc = Crc16Ccitt(U16_CRC16_CCITT_INIT, &Debug_au8XferFrame[1], (u32)(DEBUG_XFER_HEADER_SIZE - 1 + u8Size));
+    if( (Debug_au8XferFrame[DEBUG_XFER_HEADER_SIZE + u8Size] == (u8)u16Crc) &&
+        (Debug_au8XferFrame[DEBUG_XFER_HEADER_SIZE + u8Size + 1] == (u8)(u16Crc >> 8)) )
+    {
+      Debug_u32XferIdleTimer = G_u32SystemTime1ms;
+      DebugXferHandleFrame(Debug_au8XferFrame[1], Debug_au8XferFrame[2], 
+                           &Debug_au8XferFrame[DEBUG_XFER_HEADER_SIZE], u8Size);
+    }
+  }
+  
+} /* end DebugXferParse() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugXferHandleFrame(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+
+@brief Acts on a good transfer frame from the host.
+
+Requires:
+@param u8Type_ is the DEBUG_XFER_xxx frame type
+@param u8Sequence_ is the frame's sequence number
+@param pu8Payload_ points to the payload
+@param u8Size_ is the payload size
+
+Promises:
+- HELLO is answered; LIST starts the region list; READ, WRITE, DATA, ACK and NAK go to their 
+  handlers; QUIT is answered and the Debug state machine goes back to Idle
+- Any other frame is answered with DEBUG_XFER_ERROR_REQUEST
+
+*/
+static void DebugXferHandleFrame(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+{
+  u8 au8Hello[] = {DEBUG_XFER_VERSION, (u8)DEBUG_XFER_WINDOW, DEBUG_XFER_MAX_PAYLOAD, Debug_u8XferRegionCount};
+  u8 u8Error = DEBUG_XFER_ERROR_REQUEST;
+  u8 au8Off[] = "\n\rBinary transfer mode off\n\r";
+  
+  switch(u8Type_)
+  {
+    case DEBUG_XFER_HELLO:
+    {
+      DebugXferSend(DEBUG_XFER_HELLO, u8Sequence_, au8Hello, sizeof(au8Hello));
+      break;
+    }
+    
+    case DEBUG_XFER_LIST:
+    {
+      Debug_u8XferListIndex = 0;
+      break;
+    }
+    
+    case DEBUG_XFER_READ:
+    case DEBUG_XFER_WRITE:
+    {
+      DebugXferStart(u8Type_, pu8Payload_, u8Size_);
+      break;
+    }
+    
+    case DEBUG_XFER_DATA:
+    {
+      DebugXferReceive(u8Sequence_, pu8Payload_, u8Size_);
+      break;
+    }
+    
+    case DEBUG_XFER_ACK:
+    case DEBUG_XFER_NAK:
+    {
+      DebugXferAcknowledge(u8Type_, u8Sequence_);
+      break;
+    }
+    
+    case DEBUG_XFER_QUIT:
+    {
+      Debug_bXferReading = FALSE;
+      Debug_bXferWriting = FALSE;
+      DebugXferSend(DEBUG_XFER_QUIT, u8Sequence_, NULL, 0);
+      DebugPrintf(au8Off);
+      Debug_pfnStateMachine = DebugSM_Idle;
+      break;
+    }
+    
+    default:
+    {
+      DebugXferSend(DEBUG_XFER_ERROR, u8Sequence_, &u8Error, 1);
+      break;
+    }
+  } /* end switch(u8Type_) */
+  
+} /* end DebugXferHandleFrame() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugXferStart(u8 u8Type_, u8* pu8Payload_, u8 u8Size_)
+
+@brief Checks a READ or WRITE request and sets up the transfer.
+
+A new request replaces any transfer still in progress, so the host can simply ask again if its
+request or the first answer was lost.
+
+Requires:
+@param u8Type_ is DEBUG_XFER_READ or DEBUG_XFER_WRITE
+@param pu8Payload_ is region ID, offset (u32) and length (u32, 0 = to the end of the region)
+@param u8Size_ is the payload size
+
+Promises:
+- A bad request is answered with an ERROR frame
+- READ: DebugSM_Transfer() starts sending DATA frames
+- WRITE: the board answers ACK 0 and waits for DATA frames
+
+*/
+static void DebugXferStart(u8 u8Type_, u8* pu8Payload_, u8 u8Size_)
+{
+  DebugXferRegionType* psRegion = NULL;
+  u32 u32Offset = 0;
+  u32 u32Length = 0;
+  u8 u8Error = DEBUG_XFER_ERROR_NONE;
+  
+  Debug_bXferReading  = FALSE;
+  Debug_bXferReadDone = FALSE;
+  Debug_bXferWriting  = FALSE;
+  
+  if(u8Size_ != 9)
+  {
+    u8Error = DEBUG_XFER_ERROR_REQUEST;
+  }
+  else if(pu8Payload_[0] >= Debug_u8XferRegionCount)
+  {
+    u8Error = DEBUG_XFER_ERROR_REGION;
+  }
+  else
+  {
+    psRegion  = &Debug_asXferRegions[pu8Payload_[0]];
+    u32Offset = DebugXferGetU32(&pu8Payload_[1]);
+    u32Length = DebugXferGetU32(&pu8Payload_[5]);
+    if(u32Length == 0)
+    {
+      u32Length = psRegion->u32Size - u32Offset;
+    }
+    
+    if( (u32Offset > psRegion->u32Size) || (u32Length > (psRegion->u32Size - u32Offset)) )
+    {
+      u8Error = DEBUG_XFER_ERROR_RANGE;
+    }
+    else if( (u8Type_ == DEBUG_XFER_WRITE) && !psRegion->bWritable )
+    {
+      u8Error = DEBUG_XFER_ERROR_READ_ONLY;
+    }
+  }
+  
+  if(u8Error != DEBUG_XFER_ERROR_NONE)
+  {
+    DebugXferSend(DEBUG_XFER_ERROR, 0, &u8Error, 1);
+    return;
+  }
+  
+  Debug_pu8XferData   = psRegion->pu8Data + u32Offset;
+  Debug_u32XferLength = u32Length;
+  Debug_u32XferFrames = (u32Length + DEBUG_XFER_MAX_PAYLOAD - 1) / DEBUG_XFER_MAX_PAYLOAD;
+  Debug_u32XferBase   = 0;
+  Debug_u32XferNext   = 0;
+  Debug_bXferNakSent  = FALSE;
+  Debug_u32XferRetryTimer = G_u32SystemTime1ms;
+  
+  if(u8Type_ == DEBUG_XFER_READ)
+  {
+    Debug_bXferReading = TRUE;
+  }
+  else
+  {
+    Debug_bXferWriting = (Debug_u32XferFrames != 0);
+    DebugXferSend(DEBUG_XFER_ACK, 0, NULL, 0);
+  }
+  
+} /* end DebugXferStart() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugXferAcknowledge(u8 u8Type_, u8 u8Sequence_)
+
+@brief Handles an ACK or NAK from the host for the DATA frames of a read.
+
+Sequence numbers are the low 8 bits of the frame number; the window is far smaller than 256 so
+the distance from the oldest unacknowledged frame tells which frame is meant.
+
+Requires:
+@param u8Type_ is DEBUG_XFER_ACK or DEBUG_XFER_NAK
+@param u8Sequence_ is the next frame the host wants
+
+Promises:
+- Frames before u8Sequence_ are acknowledged; a NAK also makes the next frame sent u8Sequence_
+- An ACK for the end of a finished read gets the DONE frame again (the first one was lost)
+
+*/
+static void DebugXferAcknowledge(u8 u8Type_, u8 u8Sequence_)
+{
+  u8 u8Distance = (u8)(u8Sequence_ - (u8)Debug_u32XferBase);
+  u8 au8Done[4];
+  
+  if(Debug_bXferReading)
+  {
+    if(u8Distance <= (Debug_u32XferNext - Debug_u32XferBase))
+    {
+      if(u8Distance != 0)
+      {
+        Debug_u32XferBase += u8Distance;
+        Debug_u32XferRetryTimer = G_u32SystemTime1ms;
+      }
+      
+      if(u8Type_ == DEBUG_XFER_NAK)
+      {
+        Debug_u32XferNext = Debug_u32XferBase;
+      }
+    }
+  }
+  else if( Debug_bXferReadDone && (u8Type_ == DEBUG_XFER_ACK) && (u8Distance == 0) )
+  {
+    DebugXferPutU32(au8Done, Debug_u32XferLength);
+    DebugXferSend(DEBUG_XFER_DONE, u8Sequence_, au8Done, sizeof(au8Done));
+  }
+  
+} /* end DebugXferAcknowledge() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugXferReceive(u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+
+@brief Handles a DATA frame of a write.
+
+Requires:
+@param u8Sequence_ is the frame's sequence number
+@param pu8Payload_ points to the data
+@param u8Size_ is the data size
+
+Promises:
+- The frame that was expected is copied into the region and acknowledged
+- The first frame after a gap is answered with a NAK; later ones until the gap is filled are ignored
+- A frame that was already received (or any frame when no write is in progress) is answered with 
+  an ACK so a sender that missed the ACK can move on
+
+*/
+static void DebugXferReceive(u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_)
+{
+  u8 u8Distance = (u8)(u8Sequence_ - (u8)Debug_u32XferBase);
+  u32 u32Offset = Debug_u32XferBase * DEBUG_XFER_MAX_PAYLOAD;
+  u32 u32Expected;
+  
+  if(!Debug_bXferWriting || (u8Distance >= 128))
+  {
+    DebugXferSend(DEBUG_XFER_ACK, (u8)Debug_u32XferBase, NULL, 0);
+    return;
+  }
+  
+  if(u8Distance != 0)
+  {
+    if(!Debug_bXferNakSent)
+    {
+      Debug_bXferNakSent = DebugXferSend(DEBUG_XFER_NAK, (u8)Debug_u32XferBase, NULL, 0);
+    }
+    return;
+  }
+  
+  /* Every frame but the last is full */
+  u32Expected = Debug_u32XferLength - u32Offset;
+  if(u32Expected > DEBUG_XFER_MAX_PAYLOAD)
+  {
+    u32Expected = DEBUG_XFER_MAX_PAYLOAD;
+  }
+  if(u8Size_ != u32Expected)
+  {
+    return;
+  }
+  
+  for(u8 i = 0; i < u8Size_; i++)
+  {
+    Debug_pu8XferData[u32Offset + i] = pu8Payload_[i];
+  }
+  
+  Debug_u32XferBase++;
+  Debug_bXferNakSent = FALSE;
+  if(Debug_u32XferBase == Debug_u32XferFrames)
+  {
+    Debug_bXferWriting = FALSE;
+  }
+  DebugXferSend(DEBUG_XFER_ACK, (u8)Debug_u32XferBase, NULL, 0);
+  
+} /* end DebugXferReceive() */
+
 
-This implementation is specific to the target hardware.
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u32 DebugXferGetU32(u8* pu8Bytes_)
+
+@brief Reads a little endian u32 from a frame payload (which has no alignment).
 
 Requires:
-- NONE
+@param pu8Bytes_ points to the first of four bytes
 
 Promises:
-@param G_u32DebugFlags flag _DEBUG_LED_TEST_ENABLE is toggled
+- Returns the value
 
 */
-static void DebugCommandLedTestToggle(void)
+static u32 DebugXferGetU32(u8* pu8Bytes_)
 {
-  u8 au8LedTestMessage[] = "\n\rLed Test ";
+  return( (u32)pu8Bytes_[0] | ((u32)pu8Bytes_[1] << 8) | 
+          ((u32)pu8Bytes_[2] << 16) | ((u32)pu8Bytes_[3] << 24) );
   
-  /* Print message and toggle the flag */
-  DebugPrintf(au8LedTestMessage);
-  if(G_u32DebugFlags & _DEBUG_LED_TEST_ENABLE)
+} /* end DebugXferGetU32() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u8* DebugXferPutU32(u8* pu8Bytes_, u32 u32Value_)
+
+@brief Writes a u32 into a frame payload, little endian.
+
+Requires:
+@param pu8Bytes_ points to room for four bytes
+@param u32Value_ is the value
+
+Promises:
+- Returns a pointer to the byte after the value
+
+*/
+static u8* DebugXferPutU32(u8* pu8Bytes_, u32 u32Value_)
+{
+  for(u8 i = 0; i < 4; i++)
   {
-    G_u32DebugFlags &= ~_DEBUG_LED_TEST_ENABLE;
-    DebugPrintf(G_au8UtilMessageOFF);
+    *pu8Bytes_++ = (u8)u32Value_;
+    u32Value_ >>= 8;
+  }
+  
+  return(pu8Bytes_);
+  
+} /* end DebugXferPutU32() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u32 DebugOutput(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8Data_, u32 u32Size_)
+
+@brief Queues output for a source if its budget and the message pool allow it.
+
+Requires:
+@param u8Source_ is a registered source ID (anything else is charged to DEBUG_SOURCE_SYSTEM)
+@param eLevel_ is the importance of the output
+@param pu8Data_ points to the bytes to send
+@param u32Size_ is the number of bytes
+
+Promises:
+- If DebugOutputAllowed() agrees, the bytes are queued to the debug UART and charged to the source
+- Otherwise, or if the UART could not queue them, the line is counted in the source's dropped output
+- Returns the message token, or 0 if nothing was queued
+
+*/
+static u32 DebugOutput(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8Data_, u32 u32Size_)
+{
+  DebugSourceType* psSource;
+  u32 u32Token = 0;
+  
+  if(u8Source_ >= Debug_u8SourceCount)
+  {
+    u8Source_ = DEBUG_SOURCE_SYSTEM;
+  }
+  psSource = &Debug_asSources[u8Source_];
+  
+  if( DebugOutputAllowed(u8Source_, eLevel_) )
+  {
+    u32Token = UartWriteData(Debug_Uart, u32Size_, pu8Data_);
+  }
+  
+  if(u32Token != 0)
+  {
+    psSource->u32Used += u32Size_;
   }
   else
   {
-    G_u32DebugFlags |= _DEBUG_LED_TEST_ENABLE;
-    DebugPrintf(G_au8UtilMessageON);
-    
-    LedOn(WHITE);
-    LedOn(PURPLE);
-    LedOn(BLUE);
-    LedOn(CYAN);
-    LedOn(GREEN);
-    LedOn(YELLOW);
-    LedOn(ORANGE);
-    LedOn(RED);
+    psSource->u32DroppedLines++;
+    psSource->u32DroppedBytes += u32Size_;
   }
   
-} /* end DebugCommandLedTestToggle() */
+  return(u32Token);
+  
+} /* end DebugOutput() */
 
 
 /*!----------------------------------------------------------------------------------------------------------------------
-@fn static void DebugLedTestCharacter(u8 u8Char_)
+@fn static bool DebugOutputAllowed(u8 u8Source_, DebugPrintLevelType eLevel_)
 
-@brief Checks the character and toggles associated LED if applicable.
-
-Only responds to UPPER CASE characters.
-This implementation is specific to the target hardware.
+@brief Decides if a source may queue output now.
 
-For EIE_ASCII: W, P, B, C, G, Y, O, R
+The budgets are reset together every DEBUG_BUDGET_WINDOW_MS.  A source may go over its budget by 
+the size of its last line so lines are never cut.
 
 Requires:
-@param u8Char_ is the character to check
+@param u8Source_ is a registered source ID
+@param eLevel_ is the importance of the output
 
 Promises:
-- If u8Char_ is a valid toggling character, the corresponding LED will be toggled.
+- Returns TRUE for DEBUG_PRINT_HIGH
+- Returns FALSE if the source has used its budget in this window
+- Returns FALSE for DEBUG_PRINT_LOW if fewer than DEBUG_RESERVE_SLOTS message slots or 
+  DEBUG_RESERVE_BYTES of the pool are free
+- Returns TRUE otherwise
 
 */
-static void DebugLedTestCharacter(u8 u8Char_)
+static bool DebugOutputAllowed(u8 u8Source_, DebugPrintLevelType eLevel_)
 {
-  LedNameType eLed;
-  bool bValidLed = TRUE;
+  DebugSourceType* psSource = &Debug_asSources[u8Source_];
+  MessagePoolStatsType sPool;
   
-  /* Check the char to see if an LED should be toggled */  
-  switch (u8Char_)
+  if( (G_u32SystemTime1ms - Debug_u32BudgetWindowStart) >= DEBUG_BUDGET_WINDOW_MS )
   {
-    case 'W':
+    Debug_u32BudgetWindowStart = G_u32SystemTime1ms;
+    for(u8 i = 0; i < Debug_u8SourceCount; i++)
     {
-      eLed = WHITE;
-      break;
-    }  
-
-    case 'P':
+      Debug_asSources[i].u32Used = 0;
+    }
+  }
+  
+  if(eLevel_ == DEBUG_PRINT_HIGH)
+  {
+    return(TRUE);
+  }
+  
+  if( (psSource->u32Budget != 0) && (psSource->u32Used >= psSource->u32Budget) )
+  {
+    return(FALSE);
+  }
+  
+  /* Leave the rest of the pool to traffic that cannot be shed */
+  if(eLevel_ == DEBUG_PRINT_LOW)
+  {
+    if(MessagingGetFreeSlots() < DEBUG_RESERVE_SLOTS)
     {
-      eLed = PURPLE;
-      break;
-    }  
-
-    case 'B':
+      return(FALSE);
+    }
+    
+    MessagingGetPoolStats(&sPool);
+    if( (sPool.u32Size - sPool.u32BytesInUse) < DEBUG_RESERVE_BYTES )
     {
-      eLed = BLUE;
-      break;
-    }  
+      return(FALSE);
+    }
+  }
+  
+  return(TRUE);
+  
+} /* end DebugOutputAllowed() */
 
-    case 'C':
-    {
-      eLed = CYAN;
-      break;
-    }  
 
-    case 'G':
-    {
-      eLed = GREEN;
-      break;
-    }  
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void DebugOutputReport(void)
 
-    case 'Y':
-    {
-      eLed = YELLOW;
-      break;
-    }  
+@brief Prints one line with the output each source dropped, at most every DEBUG_REPORT_MS.
 
-    case 'O':
-    {
-      eLed = ORANGE;
-      break;
-    }  
+Requires:
+- NONE
 
-    case 'R':
+Promises:
+- If any source dropped output and the report is due, a line with the dropped lines and bytes
+  per source is queued (not charged to any budget) and those counters are cleared
+- Sources that do not fit on the line keep their counts for the next report
+
+*/
+static void DebugOutputReport(void)
+{
+  static u8 au8Title[] = "\n\rDebug output dropped:";
+  static u8 au8Space[] = " ";
+  static u8 au8Lines[] = " lines (";
+  static u8 au8Bytes[] = " bytes)";
+  static u8 au8LineEnd[] = "\n\r";
+  u8 au8Line[DEBUG_REPORT_LINE_SIZE];
+  DebugSourceType* psSource;
+  u32 u32Reported = 0;
+  u8* pu8Next;
+  
+  if( (G_u32SystemTime1ms - Debug_u32ReportTime) < DEBUG_REPORT_MS )
+  {
+    return;
+  }
+  
+  pu8Next = DebugAppendText(au8Line, au8Title);
+  for(u8 i = 0; i < Debug_u8SourceCount; i++)
+  {
+    psSource = &Debug_asSources[i];
+    if(psSource->u32DroppedLines == 0)
     {
-      eLed = RED;
-      break;
-    }  
+      continue;
+    }
     
-  default:
+    if( (pu8Next - au8Line) > (DEBUG_REPORT_LINE_SIZE - DEBUG_REPORT_ENTRY_SIZE) )
     {
-      bValidLed = FALSE;
       break;
     }
-  } /* end switch */
+    
+    pu8Next = DebugAppendText(pu8Next, au8Space);
+    pu8Next = DebugAppendText(pu8Next, psSource->pu8Name);
+    pu8Next = DebugAppendNumber(pu8Next, au8Space, psSource->u32DroppedLines);
+    pu8Next = DebugAppendNumber(pu8Next, au8Lines, psSource->u32DroppedBytes);
+    pu8Next = DebugAppendText(pu8Next, au8Bytes);
+    u32Reported |= (u32)1 << i;
+  }
   
-  if(bValidLed)
+  if(u32Reported == 0)
   {
-    LedToggle(eLed);
+    return;
   }
-    
-} /* end DebugCommandLedTestToggle() */
-#endif /* EIE_ASCII */
+  
+  pu8Next = DebugAppendText(pu8Next, au8LineEnd);
+  if(UartWriteData(Debug_Uart, (u32)(pu8Next - au8Line), au8Line) != 0)
+  {
+    Debug_u32ReportTime = G_u32SystemTime1ms;
+    for(u8 i = 0; i < Debug_u8SourceCount; i++)
+    {
+      if(u32Reported & ((u32)1 << i))
+      {
+        Debug_asSources[i].u32DroppedLines = 0;
+        Debug_asSources[i].u32DroppedBytes = 0;
+      }
+    }
+  }
+  
+} /* end DebugOutputReport() */
 
 
-#ifdef EIE_DOTMATRIX
 /*!----------------------------------------------------------------------------------------------------------------------
-@fn static void DebugCommandLedTestToggle(void)
-
-@brief Toggles and reports the active state of the LED test.
+@fn static void DebugLogService(void)
 
-This implementation is specific to the target hardware.
+@brief Outputs records captured by DebugLog().
 
 Requires:
-- NONE
+- Called from the Idle state only
 
 Promises:
-@param G_u32DebugFlags flag _DEBUG_LED_TEST_ENABLE is toggled
+- Nothing is output while the "log" source is out of budget or the message pool is low
+- Any dropped records are reported with DEBUG_LOG_DROPPED
+- Up to DEBUG_LOG_RECORDS_PER_PASS records are output and removed from the ring; a record the UART
+  could not queue stays in the ring for the next pass
 
 */
-static void DebugCommandLedTestToggle(void)
+static void DebugLogService(void)
 {
-  u8 au8LedTestMessage[] = "\n\rLed Test ";
+  u32 au32Args[DEBUG_LOG_MAX_ARGS];
+  u32 u32Header;
+  u16 u16Tail;
+  u8 u8Args;
   
-  /* Print message and toggle the flag */
-  DebugPrintf(au8LedTestMessage);
-  if(G_u32DebugFlags & _DEBUG_LED_TEST_ENABLE)
+  /* Records wait in the ring while the log source is out of budget or the message pool is low */
+  if( !DebugOutputAllowed(DEBUG_SOURCE_LOG, DEBUG_PRINT_LOW) )
   {
-    G_u32DebugFlags &= ~_DEBUG_LED_TEST_ENABLE;
-    DebugPrintf(G_au8UtilMessageOFF);
+    return;
   }
-  else
+  
+  /* The drop report does not go through the ring since it is the ring that is full */
+  if(Debug_u32LogDropped != 0)
   {
-    G_u32DebugFlags |= _DEBUG_LED_TEST_ENABLE;
-    DebugPrintf(G_au8UtilMessageON);
+    __disable_irq();
+    au32Args[0] = Debug_u32LogDropped;
+    Debug_u32LogDropped = 0;
+    __enable_irq();
     
-    LedOn(RED0);
-    LedOn(RED1);
-    LedOn(RED2);
-    LedOn(RED3);
-    LedOn(GREEN0);
-    LedOn(GREEN1);
-    LedOn(GREEN2);
-    LedOn(GREEN3);
-    LedOn(BLUE0);
-    LedOn(BLUE1);
-    LedOn(BLUE2);
-    LedOn(BLUE3);
+    if(DebugLogOutput(DEBUG_LOG_DROPPED, G_u32SystemTime1ms, 1, au32Args) == 0)
+    {
+      /* Report them again next time with any new drops */
+      __disable_irq();
+      Debug_u32LogDropped += au32Args[0];
+      __enable_irq();
+      return;
+    }
   }
   
-} /* end DebugCommandLedTestToggle() */
-
+  u16Tail = Debug_u16LogTail;
+  for(u8 i = 0; (i < DEBUG_LOG_RECORDS_PER_PASS) && (u16Tail != Debug_u16LogHead) && 
+              DebugOutputAllowed(DEBUG_SOURCE_LOG, DEBUG_PRINT_LOW); i++)
+  {
+    u32Header = Debug_au32LogRing[u16Tail];
+    u16Tail = (u16Tail + 1) & (DEBUG_LOG_RING_WORDS - 1);
 
-/*!----------------------------------------------------------------------------------------------------------------------
-@fn static void DebugLedTestCharacter(u8 u8Char_)
+    u8Args = (u8)(u32Header >> 8);
+    for(u8 j = 0; j < u8Args; j++)
+    {
+      au32Args[j] = Debug_au32LogRing[u16Tail];
+      u16Tail = (u16Tail + 1) & (DEBUG_LOG_RING_WORDS - 1);
+    }
+    
+    /* Only free the space once the record is queued */
+    if(DebugLogOutput((u8)u32Header, u32Header >> 16, u8Args, au32Args) == 0)
+    {
+      return;
+    }
+    Debug_u16LogTail = u16Tail;
+  }
+  
+} /* end DebugLogService() */
 
-@brief Checks the character and toggles associated LED if applicable.
 
-Only responds to UPPER CASE characters.
-This implementation is specific to the target hardware.
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u32 DebugLogOutput(u8 u8Format_, u32 u32Time_, u8 u8Args_, u32* pu32Args_)
 
-For EIE_DOTMATRIX: R, G, B
+@brief Sends one log record as text or as a binary frame.
 
 Requires:
-@param u8Char_ is the character to check
+@param u8Format_ is the record's DebugLogFormatType
+@param u32Time_ is the time the record was captured (only the low 16 bits are sent)
+@param u8Args_ is the number of arguments
+@param pu32Args_ points to the arguments
 
 Promises:
-- If u8Char_ is a valid toggling character, the corresponding LEDs will be toggled.
+- If _DEBUG_LOG_BINARY is set, the binary frame described at the top of this file is queued
+- Otherwise the rendered text is queued
+- Returns the message token, or 0 if the UART could not queue the record (the caller keeps it, so 
+  it is not counted as dropped output)
 
 */
-static void DebugLedTestCharacter(u8 u8Char_)
+static u32 DebugLogOutput(u8 u8Format_, u32 u32Time_, u8 u8Args_, u32* pu32Args_)
 {
-  /* Check the char to see if an LED group should be toggled */  
-  if(u8Char_ == 'R')
-  {
-    LedToggle(RED0);
-    LedToggle(RED1);
-    LedToggle(RED2);
-    LedToggle(RED3);
-  }  
+  u8 au8Line[DEBUG_LOG_LINE_SIZE];
+  u8* pu8Next;
+  u32 u32Size;
+  u32 u32Token;
   
-  if(u8Char_ == 'G')
-  {
-    LedToggle(GREEN0);
-    LedToggle(GREEN1);
-    LedToggle(GREEN2);
-    LedToggle(GREEN3);
-  }  
-
-  if(u8Char_ == 'B')
+  if(G_u32DebugFlags & _DEBUG_LOG_BINARY)
   {
-    LedToggle(BLUE0);
-    LedToggle(BLUE1);
-    LedToggle(BLUE2);
-    LedToggle(BLUE3);
-  }  
-
-} /* end DebugCommandLedTestToggle() */
-#endif /* EIE_DOTMATRIX */
+    au8Line[0] = DEBUG_LOG_FRAME_SYNC;
+    au8Line[1] = u8Format_;
+    au8Line[2] = u8Args_;
+    au8Line[3] = (u8)u32Time_;
+    au8Line[4] = (u8)(u32Time_ >> 8);
+    
+    pu8Next = &au8Line[DEBUG_LOG_FRAME_HEADER_SIZE];
+    for(u8 i = 0; i < u8Args_; i++)
+    {
+      pu8Next = DebugLogEncode(pu8Next, pu32Args_[i]);
+    }
+    
+    u32Size = (u32)(pu8Next - au8Line);
+  }
+  else
+  {
+    u32Size = DebugLogRender(au8Line, Debug_apu8LogFormats[u8Format_], pu32Args_);
+  }
+  
+  /* A record that is not queued stays with the caller and is sent again, so it is not dropped output */
+  u32Token = DebugOutput(DEBUG_SOURCE_LOG, DEBUG_PRINT_LOW, au8Line, u32Size);
+  if(u32Token == 0)
+  {
+    Debug_asSources[DEBUG_SOURCE_LOG].u32DroppedLines--;
+    Debug_asSources[DEBUG_SOURCE_LOG].u32DroppedBytes -= u32Size;
+  }
+  
+  return(u32Token);
+  
+} /* end DebugLogOutput() */
 
 
 /*!----------------------------------------------------------------------------------------------------------------------
-@fn static void DebugCommandSysTimeToggle(void)
+@fn static u8 DebugLogCountArguments(const u8* pu8Format_)
 
-@brief Toggles the active state of the 1ms violation warning.
+@brief Counts the conversions in a log format string.
 
 Requires:
-- NONE
+@param pu8Format_ is a NULL-terminated log format
 
 Promises:
-@param G_u32DebugFlags flag _DEBUG_TIME_WARNING_ENABLE is toggled
+- Returns the number of conversions other than %%, up to DEBUG_LOG_MAX_ARGS
 
 */
-static void DebugCommandSysTimeToggle(void)
+static u8 DebugLogCountArguments(const u8* pu8Format_)
 {
-  u8 au8SysTimeTestMessage[] = "\n\rSystem time violation reporting ";
+  u8 u8Count = 0;
   
-  /* Print message and toggle the flag */
-  DebugPrintf(au8SysTimeTestMessage);
-  if(G_u32DebugFlags & _DEBUG_TIME_WARNING_ENABLE)
+  while(*pu8Format_ != '\0')
   {
-    G_u32DebugFlags &= ~_DEBUG_TIME_WARNING_ENABLE;
-    DebugPrintf(G_au8UtilMessageOFF);
-  }
-  else
-  {
-    G_u32DebugFlags |= _DEBUG_TIME_WARNING_ENABLE;
-    DebugPrintf(G_au8UtilMessageON);
+    if(*pu8Format_++ == '%')
+    {
+      /* Skip the flag and width */
+      while( (*pu8Format_ >= '0') && (*pu8Format_ <= '9') )
+      {
+        pu8Format_++;
+      }
+      
+      if( (*pu8Format_ != '%') && (*pu8Format_ != '\0') && (u8Count < DEBUG_LOG_MAX_ARGS) )
+      {
+        u8Count++;
+      }
+      
+      if(*pu8Format_ != '\0')
+      {
+        pu8Format_++;
+      }
+    }
   }
   
-} /* end DebugCommandSysTimeToggle() */
+  return(u8Count);
+  
+} /* end DebugLogCountArguments() */
+
 
-/* EIE_DOTMATRIX only tests */
-#ifdef EIE_DOTMATRIX 
 /*!----------------------------------------------------------------------------------------------------------------------
-@fn DebugCommandCaptouchValuesToggle
+@fn static u8 DebugLogRender(u8* pu8Line_, const u8* pu8Format_, u32* pu32Args_)
 
-@brief Toggles printing the current Captouch horizontal and vertical values.
+@brief Builds the text of a log record.
 
 Requires:
-- NONE
+@param pu8Line_ points to DEBUG_LOG_LINE_SIZE bytes for the text
+@param pu8Format_ is the NULL-terminated log format
+@param pu32Args_ holds one value for each conversion in the format
 
 Promises:
-@param G_u32DebugFlags flag _DEBUG_CAPTOUCH_VALUES_ENABLE is toggled
+- The text is written to pu8Line_ (cut short if it does not fit) and NULL-terminated
+- Returns the number of characters not counting the NULL
 
 */
-static void DebugCommandCaptouchValuesToggle(void)
+static u8 DebugLogRender(u8* pu8Line_, const u8* pu8Format_, u32* pu32Args_)
 {
-  u8 au8CaptouchDisplayMessage[] = "\n\rDisplay Captouch values ";
-  u8 au8CaptouchOnMessage[] = "No values displayed if Captouch is OFF\n\r";
+  u8 au8Number[12];
+  u8* pu8Next = pu8Line_;
+  u8* pu8End = pu8Line_ + (DEBUG_LOG_LINE_SIZE - 1);
+  u8* pu8Number;
+  u8* pu8Digits;
+  u32 u32Value;
+  u8 u8Width;
+  u8 u8Pad;
   
-  /* Print message and toggle the flag */
-  DebugPrintf(au8CaptouchDisplayMessage);
-  if(G_u32DebugFlags & _DEBUG_CAPTOUCH_VALUES_ENABLE)
+  while( (*pu8Format_ != '\0') && (pu8Next < pu8End) )
   {
-    G_u32DebugFlags &= ~_DEBUG_CAPTOUCH_VALUES_ENABLE;
-    DebugPrintf(G_au8UtilMessageOFF);
+    /* Plain characters are copied as they are */
+    if(*pu8Format_ != '%')
+    {
+      *pu8Next++ = *pu8Format_++;
+    }
+    else
+    {
+      /* Read the flag and width */
+      pu8Format_++;
+      u8Pad = ' ';
+      u8Width = 0;
+      if(*pu8Format_ == '0')
+      {
+        u8Pad = '0';
+      }
+      while( (*pu8Format_ >= '0') && (*pu8Format_ <= '9') )
+      {
+        u8Width = (u8Width * 10) + (*pu8Format_++ - NUMBER_ASCII_TO_DEC);
+      }
+      
+      /* Convert the value into au8Number with any sign kept apart from the digits */
+      pu8Number = &au8Number[0];
+      switch(*pu8Format_)
+      {
+        case 'd':
+        {
+          u32Value = *pu32Args_++;
+          if( (s32)u32Value < 0 )
+          {
+            *pu8Number++ = '-';
+            u32Value = (u32)0 - u32Value;
+          }
+          pu8Digits = pu8Number;
+          pu8Number += NumberToAscii(u32Value, pu8Number);
+          break;
+        }
+        
+        case 'u':
+        {
+          pu8Digits = pu8Number;
+          pu8Number += NumberToAscii(*pu32Args_++, pu8Number);
+          break;
+        }
+        
+        case 'x':
+        {
+          /* Skip leading zeros but keep at least one digit */
+          u32Value = *pu32Args_++;
+          pu8Digits = pu8Number;
+          for(s8 i = 28; i >= 0; i -= 4)
+          {
+            if( ((u32Value >> i) != 0) || (i == 0) )
+            {
+              *pu8Number++ = HexToASCIICharLower((u8)((u32Value >> i) & 0x0F));
+            }
+          }
+          break;
+        }
+        
+        case 'c':
+        {
+          pu8Digits = pu8Number;
+          *pu8Number++ = (u8)*pu32Args_++;
+          break;
+        }
+        
+        /* "%%" and anything unknown print the character itself */
+        default:
+        {
+          pu8Digits = pu8Number;
+          if(*pu8Format_ != '\0')
+          {
+            *pu8Number++ = *pu8Format_;
+          }
+          break;
+        }
+      } /* end switch(*pu8Format_) */
+      
+      if(*pu8Format_ != '\0')
+      {
+        pu8Format_++;
+      }
+      
+      /* A zero-padded negative number keeps its sign in front */
+      if( (u8Pad == '0') && (pu8Digits != &au8Number[0]) && (pu8Next < pu8End) )
+      {
+        *pu8Next++ = au8Number[0];
+      }
+      else
+      {
+        pu8Digits = &au8Number[0];
+      }
+      
+      for(u8 i = (u8)(pu8Number - &au8Number[0]); (i < u8Width) && (pu8Next < pu8End); i++)
+      {
+        *pu8Next++ = u8Pad;
+      }
+      
+      while( (pu8Digits < pu8Number) && (pu8Next < pu8End) )
+      {
+        *pu8Next++ = *pu8Digits++;
+      }
+    }
   }
-  else
+  
+  *pu8Next = '\0';
+  return( (u8)(pu8Next - pu8Line_) );
+  
+} /* end DebugLogRender() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u8* DebugLogEncode(u8* pu8Frame_, u32 u32Value_)
+
+@brief Adds one argument to a binary log frame, 7 bits per byte.
+
+Requires:
+@param pu8Frame_ points to at least 5 free bytes
+@param u32Value_ is the argument
+
+Promises:
+- The value is written least significant group first with bit 7 set on all but the last byte
+- Returns a pointer to the byte after the value
+
+*/
+static u8* DebugLogEncode(u8* pu8Frame_, u32 u32Value_)
+{
+  while(u32Value_ > 0x7F)
   {
-    G_u32DebugFlags |= _DEBUG_CAPTOUCH_VALUES_ENABLE;
-    DebugPrintf(G_au8UtilMessageON);
-    DebugPrintf(au8CaptouchOnMessage);
+    *pu8Frame_++ = (u8)(u32Value_ | 0x80);
+    u32Value_ >>= 7;
   }
+  *pu8Frame_++ = (u8)u32Value_;
   
-} /* end DebugCommandCaptouchValuesToggle() */
-#endif /* EIE_DOTMATRIX only tests */
+  return(pu8Frame_);
+  
+} /* end DebugLogEncode() */
+
 
 
 /***********************************************************************************************************************
@@ -992,16 +3522,16 @@ checked and reacted to accordingly.
 
 @brief Waits for a byte to appear in the Rx buffer.  
 
-The BufferParser is always moved through all new characters placing them into 
-the command buffer until it hits a CR or there are no new characters to read. 
-If there is no CR in this iteration, nothing else occurs.
-
-Backspace: Echo the backspace and a space character to clear the character on 
-screen; move Debug_pu8BufferCurrentChar back.
+The BufferParser is always moved through all new characters until it hits a CR or there are no
+new characters to read.  Each character is copied to the scanf buffer (Backspace removes the last
+one) and given to the line editor, DebugLineEdit(), which builds the command in 
+Debug_au8CommandBuffer[] with cursor movement, history and Tab completion.  
 
 CR: Advance states to process the command.
 
-Any other character: Echo it to the UART Tx and place a copy in Debug_au8CommandBuffer.
+All echo and redraw of the pass is collected and sent with a single UART write at the end, so 
+a burst of typing or a pasted line costs one message instead of one per character.  In 
+Passthrough mode the characters are only echoed and copied to the scanf buffer.
 
 */
 void DebugSM_Idle(void)               
@@ -1010,7 +3540,9 @@ void DebugSM_Idle(void)
   u8 u8CurrentByte;
   u8 u8Counter;
   static u8 au8BackspaceSequence[] = {ASCII_BACKSPACE, ' ', ASCII_BACKSPACE};
-  static u8 au8CommandOverflow[] = "\r\n*** Command too long ***\r\n\n";
+  
+  /* Pick up characters received since the last burst ended so they are echoed as they arrive */
+  UartRxPoll(Debug_Uart);
   
   /* Parse any new characters that have come in until no more chars or a command is found */
   while( (Debug_pu8RxBufferParser != Debug_pu8RxBufferNextChar) && (bCommandFound == FALSE) )
@@ -1018,93 +3550,48 @@ void DebugSM_Idle(void)
     /* Grab a copy of the current byte */
     u8CurrentByte = *Debug_pu8RxBufferParser;
         
-    /* Process the character */
-    switch (u8CurrentByte)
+    /* Passthrough mode: every character is kept for scanf and echoed as it is */
+    if( G_u32DebugFlags & _DEBUG_PASSTHROUGH )
     {
-      /* Backspace: update command buffer pointer and send sequence to delete the char on the terminal */
-      case(ASCII_BACKSPACE): 
+      if(G_u8DebugScanfCharCount < DEBUG_SCANF_BUFFER_SIZE)
       {
-        /* Process for scanf as long as we are not in Passthrough mode */
-        if( G_u32DebugFlags & _DEBUG_PASSTHROUGH )
-        {        
-          if(G_u8DebugScanfCharCount < DEBUG_SCANF_BUFFER_SIZE)
-          {
-            G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = u8CurrentByte;
-            G_u8DebugScanfCharCount++;
-          }
-        }
-        else
-        {
-          /* Process for scanf */
-          if(G_u8DebugScanfCharCount != 0)
-          {
-            G_u8DebugScanfCharCount--;
-            G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = '\0';
-          }
-
-          /* Process for command */
-          if(Debug_pu8CmdBufferNextChar != &Debug_au8CommandBuffer[0])
-          {
-            Debug_pu8CmdBufferNextChar--;
-            Debug_u16CommandSize--;
-          }
-        }
-                
-        /* Send the Backspace sequence to clear the character on the terminal */
-        Debug_au32MsgTokens[Debug_u8TokenCounter] = DebugPrintf(au8BackspaceSequence);
-        AdvanceTokenCounter();
-        break;
-      } /* end case(ASCII_BACKSPACE) */
-
-      /* Carriage return: change states to process new command and fall through to echo character */
-      case(ASCII_CARRIAGE_RETURN): 
+        G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = u8CurrentByte;
+        G_u8DebugScanfCharCount++;
+      }
+      
+      if(u8CurrentByte == ASCII_BACKSPACE)
       {
-        if( !( G_u32DebugFlags & _DEBUG_PASSTHROUGH) )
-        {
-          bCommandFound = TRUE;
-          Debug_pfnStateMachine = DebugSM_CheckCmd;
-        }
-        
-        /* Fall through to default */        
-      } /* end case(ASCII_CARRIAGE_RETURN) */
-        
-      /* Add to command buffer and echo */
-      default: 
+        DebugEchoText(au8BackspaceSequence, sizeof(au8BackspaceSequence));
+      }
+      else
       {
-        /* Process for scanf */
-        if(G_u8DebugScanfCharCount < DEBUG_SCANF_BUFFER_SIZE)
-        {
-          G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = u8CurrentByte;
-          G_u8DebugScanfCharCount++;
-        }
-        
-        /* Echo the character back to the terminal */
-        Debug_au32MsgTokens[Debug_u8TokenCounter] = UartWriteByte(Debug_Uart, u8CurrentByte);
-        AdvanceTokenCounter();
-        
-        /* As long as Passthrough mode is not active, then update the command buffer */
-        if( !( G_u32DebugFlags & _DEBUG_PASSTHROUGH) )
+        DebugEchoByte(u8CurrentByte);
+      }
+    }
+    else
+    {
+      /* Process for scanf */
+      if( (u8CurrentByte == ASCII_BACKSPACE) || (u8CurrentByte == ASCII_DELETE) )
+      {
+        if(G_u8DebugScanfCharCount != 0)
         {
-          *Debug_pu8CmdBufferNextChar = u8CurrentByte;
-          Debug_pu8CmdBufferNextChar++;
-          Debug_u16CommandSize++;
-
-          /* If the command buffer is now full but the last character was not ASCII_CARRIAGE_RETURN, throw out the whole
-          buffer and report an error message */
-          if( (Debug_pu8CmdBufferNextChar >= &Debug_au8CommandBuffer[DEBUG_CMD_BUFFER_SIZE]) &&
-              (u8CurrentByte != ASCII_CARRIAGE_RETURN) )
-          {
-            Debug_pu8CmdBufferNextChar = &Debug_au8CommandBuffer[0];
-            Debug_u16CommandSize = 0;
-
-            Debug_au32MsgTokens[Debug_u8TokenCounter] = DebugPrintf(au8CommandOverflow);
-            AdvanceTokenCounter();
-          }
+          G_u8DebugScanfCharCount--;
+          G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = '\0';
         }
-        break;
-      } /* end default */
-
-    } /* end switch (u8CurrentByte) */
+      }
+      else if(G_u8DebugScanfCharCount < DEBUG_SCANF_BUFFER_SIZE)
+      {
+        G_au8DebugScanfBuffer[G_u8DebugScanfCharCount] = u8CurrentByte;
+        G_u8DebugScanfCharCount++;
+      }
+      
+      /* Process for command: change states once CR ends the line */
+      if( DebugLineEdit(u8CurrentByte) )
+      {
+        bCommandFound = TRUE;
+        Debug_pfnStateMachine = DebugSM_CheckCmd;
+      }
+    }
 
     /* If the LED test is active, toggle LEDs based on characters */
     if(G_u32DebugFlags & _DEBUG_LED_TEST_ENABLE)
@@ -1121,6 +3608,13 @@ void DebugSM_Idle(void)
     
   } /* end while */
   
+  /* Send this pass's echo and redraw as one write */
+  DebugEchoFlush();
+  
+  /* Send out any deferred log records and report any output that was dropped */
+  DebugLogService();
+  DebugOutputReport();
+  
   /* Clear out any completed messages (Query automatically removes if complete ) */
   u8Counter = 0;
   while ( (u8Counter < DEBUG_TOKEN_ARRAY_SIZE) &&
@@ -1139,17 +3633,19 @@ void DebugSM_Idle(void)
 @brief Checks to see if a string entered is a valid command.
 
 At the start of this state, the command buffer has a candidate command terminated in CR.
-There is a strict rule that commands are of the form en+cxx where xx is any number
-from 0 to DEBUG_COMMANDS, so parsing can be done based on that rule.  All other 
-strings are invalid.  
+Commands are of the form en+cxx where xx is a registered command number (two digits), or
+en+c<name> where name is a registered command name.  Spaces are allowed before and after
+the name.  All other strings are invalid.  
 
 */
 void DebugSM_CheckCmd(void)        
 {
   static u8 au8CommandHeader[] = "en+c";
-  static u8 au8InvalidCommand[] = "\nInvalid command.  Use en+c##\n\n\r"; 
+  static u8 au8InvalidCommand[] = "\nInvalid command.  Use en+c## or en+c<name> (en+c00 for the list)\n\n\r"; 
+  u8 au8Name[DEBUG_CMD_NAME_LENGTH + 1];
   bool bGoodCommand = TRUE;
   u8 u8Index;
+  u8 u8Length;
   s8 s8Temp;
   
   /* Verify that the command starts with en+c */
@@ -1164,13 +3660,18 @@ void DebugSM_CheckCmd(void)
     u8Index++;
   } while ( bGoodCommand && (u8Index < 4) );
   
-  /* On good header, read the command number */
+  /* On good header, read the command number or name */
   if(bGoodCommand)
   {
     /* Make an assumption */
     bGoodCommand = FALSE;
 
-    /* Verify the next char is a digit */
+    while(Debug_au8CommandBuffer[u8Index] == ' ')
+    {
+      u8Index++;
+    }
+    
+    /* A digit starts a command number */
     s8Temp = Debug_au8CommandBuffer[u8Index++] - NUMBER_ASCII_TO_DEC;
   
     if( (s8Temp >= 0) && (s8Temp <= 9) )
@@ -1184,12 +3685,36 @@ void DebugSM_CheckCmd(void)
         Debug_u8Command += s8Temp;
         
         /* Check that the command number is within the range of commands available and the last char is CR */
-        if( (Debug_u8Command < DEBUG_COMMANDS) && (Debug_au8CommandBuffer[u8Index] == ASCII_CARRIAGE_RETURN) )
+        if( (Debug_u8Command < Debug_u8CommandCount) && (Debug_au8CommandBuffer[u8Index] == ASCII_CARRIAGE_RETURN) )
         {
           bGoodCommand = TRUE;
         }
       }
     }
+    /* Anything else is a command name: copy the word and look it up */
+    else
+    {
+      u8Index--;
+      u8Length = 0;
+      while( (Debug_au8CommandBuffer[u8Index] != ' ') && 
+             (Debug_au8CommandBuffer[u8Index] != ASCII_CARRIAGE_RETURN) &&
+             (u8Length < DEBUG_CMD_NAME_LENGTH) )
+      {
+        au8Name[u8Length++] = Debug_au8CommandBuffer[u8Index++];
+      }
+      au8Name[u8Length] = '\0';
+      
+      while(Debug_au8CommandBuffer[u8Index] == ' ')
+      {
+        u8Index++;
+      }
+      
+      if( (u8Length != 0) && (Debug_au8CommandBuffer[u8Index] == ASCII_CARRIAGE_RETURN) )
+      {
+        Debug_u8Command = DebugCommandFind(au8Name);
+        bGoodCommand = (Debug_u8Command != DEBUG_CMD_NONE);
+      }
+    }
   }
            
   /* If still good command */
@@ -1204,8 +3729,9 @@ void DebugSM_CheckCmd(void)
     Debug_pfnStateMachine = DebugSM_Idle;
   }
 
-  /* Reset the command buffer next char pointer */
-  Debug_pu8CmdBufferNextChar = &Debug_au8CommandBuffer[0];
+  /* Start a new line */
+  Debug_u16CommandSize = 0;
+  Debug_u8CmdCursor = 0;
 
 } /* end DebugSM_CheckCmd() */
 
@@ -1221,12 +3747,243 @@ void DebugSM_ProcessCmd(void)
   /* Setup for return to Idle state */
   Debug_pfnStateMachine = DebugSM_Idle;
 
-  /* Call the command function in the function array (may change next state ) */
-  Debug_au8Commands[Debug_u8Command].DebugFunction();
+  /* Call the registered command function (may change next state ) */
+  Debug_asCommands[Debug_u8Command].DebugFunction();
   
 } /* end DebugSM_ProcessCmd() */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn void DebugSM_ListCommands(void)         
+
+@brief Sends one line of the command list per pass: "nn: name         help".
+
+Input is left in the receive buffer until the list is done and Idle picks it up.
+
+*/
+void DebugSM_ListCommands(void)         
+{
+  u8 au8Line[DEBUG_CMD_LINE_SIZE];
+  u8 au8LineEnd[] = "\n\r";
+  DebugCommandType* psCommand;
+  u8* pu8Next;
+  u8* pu8Help;
+  
+  if(Debug_u8ListIndex >= Debug_u8CommandCount)
+  {
+    DebugLineFeed();
+    Debug_pfnStateMachine = DebugSM_Idle;
+  }
+  else
+  {
+    psCommand = &Debug_asCommands[Debug_u8ListIndex];
+
+    au8Line[0] = (Debug_u8ListIndex / 10) + NUMBER_ASCII_TO_DEC;
+    au8Line[1] = (Debug_u8ListIndex % 10) + NUMBER_ASCII_TO_DEC;
+    au8Line[2] = ':';
+    au8Line[3] = ' ';
+    au8Line[DEBUG_CMD_PREFIX_LENGTH] = '\0';
+    
+    /* Pad the name so the help text lines up */
+    pu8Next = DebugAppendText(&au8Line[DEBUG_CMD_PREFIX_LENGTH], psCommand->pu8CommandName);
+    while(pu8Next < &au8Line[DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH + 1])
+    {
+      *pu8Next++ = ' ';
+    }
+    
+    pu8Help = psCommand->pu8CommandHelp;
+    if(pu8Help != NULL)
+    {
+      while( (*pu8Help != '\0') && (pu8Next < &au8Line[DEBUG_CMD_LINE_SIZE - DEBUG_CMD_POSTFIX_LENGTH]) )
+      {
+        *pu8Next++ = *pu8Help++;
+      }
+    }
+    *pu8Next = '\0';
+    
+    DebugAppendText(pu8Next, au8LineEnd);
+    DebugPrintf(au8Line);
+    Debug_u8ListIndex++;
+  }
+  
+} /* end DebugSM_ListCommands() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn void DebugSM_UartTest(void)         
+
+@brief Keeps the UART self-test blocks queued and reports the result when the last one is sent.
+
+Input is left in the receive buffer until the test is done.  The test gives up if the blocks 
+are not all sent within DEBUG_UART_TIMEOUT of the expected time (e.g. CTS held off).
+
+*/
+void DebugSM_UartTest(void)         
+{
+  u8 au8Result[] = "UART test: ";
+  u8 au8Bytes[] = " bytes in ";
+  u8 au8Rate[] = " ms = ";
+  u8 au8Line[] = " bytes/s (line ";
+  u8 au8Failed[] = " bytes/s), failed ";
+  u8 au8Stalled[] = "UART test: stalled, sent ";
+  u8 au8LineEnd[] = "\n\r";
+  u8 au8Report[DEBUG_STATS_LINE_SIZE];
+  u8* pu8Next;
+  u32 u32Bytes;
+  u32 u32Time;
+  
+  /* Queue more blocks while there is room; a full message queue just means try again next pass */
+  while( (Debug_u16UartTestQueued < Debug_u16UartTestBlocks) && 
+         ((u16)(Debug_u16UartTestQueued - Debug_u16UartTestDone) < DEBUG_UART_TEST_IN_FLIGHT) )
+  {
+    if(UartWriteDataNoCopy(Debug_Uart, DEBUG_UART_TEST_BLOCK_SIZE, Debug_au8UartTestBlock, DebugUartTestDone) == 0)
+    {
+      break;
+    }
+    Debug_u16UartTestQueued++;
+  }
+  
+  if(Debug_u16UartTestDone == Debug_u16UartTestBlocks)
+  {
+    /* The first block only starts the clock */
+    u32Bytes = (u32)(Debug_u16UartTestBlocks - 1) * DEBUG_UART_TEST_BLOCK_SIZE;
+    u32Time = Debug_u32UartTestLastDone - Debug_u32UartTestFirstDone;
+    
+    pu8Next = DebugAppendNumber(au8Report, au8Result, u32Bytes);
+    pu8Next = DebugAppendNumber(pu8Next, au8Bytes, u32Time);
+    pu8Next = DebugAppendNumber(pu8Next, au8Rate, (u32Time == 0) ? 0 : ((u32Bytes * 1000) / u32Time));
+    pu8Next = DebugAppendNumber(pu8Next, au8Line, Debug_Uart->u32BaudRate / 10);
+    pu8Next = DebugAppendNumber(pu8Next, au8Failed, Debug_u16UartTestFailed);
+    DebugAppendText(pu8Next, au8LineEnd);
+    DebugPrintf(au8Report);
+    
+    Debug_pfnStateMachine = DebugSM_Idle;
+  }
+  else if( IsTimeUp(&Debug_u32UartTestTimer, DEBUG_UART_TEST_MS + DEBUG_UART_TIMEOUT) )
+  {
+    pu8Next = DebugAppendNumber(au8Report, au8Stalled, (u32)Debug_u16UartTestDone * DEBUG_UART_TEST_BLOCK_SIZE);
+    DebugAppendText(pu8Next, au8LineEnd);
+    DebugPrintf(au8Report);
+    
+    Debug_pfnStateMachine = DebugSM_Idle;
+  }
+  
+} /* end DebugSM_UartTest() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn void DebugSM_Transfer(void)         
+
+@brief Binary transfer mode: parses frames from the host and keeps list and read frames going out.
+
+*/
+void DebugSM_Transfer(void)         
+{
+  DebugXferRegionType* psRegion;
+  u8 au8Payload[DEBUG_XFER_MAX_PAYLOAD];
+  u8* pu8Next;
+  u32 u32Offset;
+  u32 u32Size;
+  u8 au8TimedOut[] = "\n\rBinary transfer mode timed out\n\r";
+  
+  UartRxPoll(Debug_Uart);
+  while( (Debug_pu8RxBufferParser != Debug_pu8RxBufferNextChar) && 
+         (Debug_pfnStateMachine == DebugSM_Transfer) )
+  {
+    DebugXferParse(*Debug_pu8RxBufferParser);
+    
+    Debug_pu8RxBufferParser++;
+    if(Debug_pu8RxBufferParser >= &Debug_au8RxBuffer[DEBUG_RX_BUFFER_SIZE])
+    {
+      Debug_pu8RxBufferParser = &Debug_au8RxBuffer[0];
+    }
+  }
+  
+  /* QUIT was received */
+  if(Debug_pfnStateMachine != DebugSM_Transfer)
+  {
+    return;
+  }
+  
+  /* One region per pass; an empty INFO frame ends the list */
+  if(Debug_u8XferListIndex < Debug_u8XferRegionCount)
+  {
+    psRegion = &Debug_asXferRegions[Debug_u8XferListIndex];
+    au8Payload[0] = Debug_u8XferListIndex;
+    au8Payload[1] = (u8)psRegion->bWritable;
+    pu8Next = DebugXferPutU32(&au8Payload[2], psRegion->u32Size);
+    for(u8 i = 0; psRegion->pu8Name[i] != '\0'; i++)
+    {
+      *pu8Next++ = psRegion->pu8Name[i];
+    }
+    
+    if( DebugXferSend(DEBUG_XFER_INFO, Debug_u8XferListIndex, au8Payload, (u8)(pu8Next - au8Payload)) )
+    {
+      Debug_u8XferListIndex++;
+    }
+  }
+  else if(Debug_u8XferListIndex != DEBUG_XFER_NONE)
+  {
+    if( DebugXferSend(DEBUG_XFER_INFO, Debug_u8XferListIndex, NULL, 0) )
+    {
+      Debug_u8XferListIndex = DEBUG_XFER_NONE;
+    }
+  }
+  
+  if(Debug_bXferReading)
+  {
+    /* Go back to the oldest unacknowledged frame if the host has gone quiet */
+    if( (Debug_u32XferNext != Debug_u32XferBase) && IsTimeUp(&Debug_u32XferRetryTimer, DEBUG_XFER_RETRY_MS) )
+    {
+      Debug_u32XferNext = Debug_u32XferBase;
+      Debug_u32XferRetryTimer = G_u32SystemTime1ms;
+    }
+    
+    /* Fill the window; a full message queue just means try again next pass */
+    while( (Debug_u32XferNext < Debug_u32XferFrames) && 
+           ((Debug_u32XferNext - Debug_u32XferBase) < DEBUG_XFER_WINDOW) )
+    {
+      u32Offset = Debug_u32XferNext * DEBUG_XFER_MAX_PAYLOAD;
+      u32Size = Debug_u32XferLength - u32Offset;
+      if(u32Size > DEBUG_XFER_MAX_PAYLOAD)
+      {
+        u32Size = DEBUG_XFER_MAX_PAYLOAD;
+      }
+      
+      if( !DebugXferSend(DEBUG_XFER_DATA, (u8)Debug_u32XferNext, Debug_pu8XferData + u32Offset, (u8)u32Size) )
+      {
+        break;
+      }
+      
+      if(Debug_u32XferNext == Debug_u32XferBase)
+      {
+        Debug_u32XferRetryTimer = G_u32SystemTime1ms;
+      }
+      Debug_u32XferNext++;
+    }
+    
+    if(Debug_u32XferBase == Debug_u32XferFrames)
+    {
+      DebugXferPutU32(au8Payload, Debug_u32XferLength);
+      if( DebugXferSend(DEBUG_XFER_DONE, (u8)Debug_u32XferBase, au8Payload, 4) )
+      {
+        Debug_bXferReading  = FALSE;
+        Debug_bXferReadDone = TRUE;
+      }
+    }
+  }
+  
+  if( IsTimeUp(&Debug_u32XferIdleTimer, DEBUG_XFER_IDLE_MS) )
+  {
+    Debug_bXferReading = FALSE;
+    Debug_bXferWriting = FALSE;
+    DebugPrintf(au8TimedOut);
+    Debug_pfnStateMachine = DebugSM_Idle;
+  }
+  
+} /* end DebugSM_Transfer() */
+
+
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn void DebugSM_Error(void)         
 
@@ -1248,7 +4005,7 @@ void DebugSM_Error(void)
   
   /* Return to Idle state */
   Debug_u16CommandSize = 0;
-  Debug_pu8CmdBufferNextChar = &Debug_au8CommandBuffer[0];
+  Debug_u8CmdCursor = 0;
   Debug_pfnStateMachine = DebugSM_Idle;
 
 } /* end DebugSM_Error() */
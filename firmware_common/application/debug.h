@@ -13,14 +13,79 @@ Type Definitions
 
 /*! 
 @struct DebugCommandType
-@brief Required members of a Debug command. 
+@brief Required members of a Debug command (see DebugCommandRegister()). 
 */
 typedef struct
 {
   u8 *pu8CommandName;               /*!< @brief Pointer to command mnemonic */
   fnCode_type DebugFunction;        /*!< @brief Function pointer to command function */
+  u8 *pu8CommandHelp;               /*!< @brief Pointer to one line of help shown in the command list */
 } DebugCommandType;
 
+/*! 
+@struct DebugXferRegionType
+@brief A block of memory the host can read or write in binary transfer mode (see DebugXferRegister()). 
+*/
+typedef struct
+{
+  u8 *pu8Name;                      /*!< @brief Pointer to the region name the host asks for */
+  u8 *pu8Data;                      /*!< @brief First byte of the region */
+  u32 u32Size;                      /*!< @brief Size of the region in bytes */
+  bool bWritable;                   /*!< @brief TRUE if the host may write the region */
+} DebugXferRegionType;
+
+/*! 
+@enum DebugPrintLevelType
+@brief Importance of a line sent with DebugPrintfFrom(); decides what is shed first when output is limited.
+*/
+typedef enum
+{
+  DEBUG_PRINT_LOW = 0,              /*!< @brief Bulk output: shed once the message pool runs low, before other tasks' traffic is refused */
+  DEBUG_PRINT_NORMAL,               /*!< @brief Normal output: sent while the source has budget left (DebugPrintf() lines) */
+  DEBUG_PRINT_HIGH                  /*!< @brief Errors: not limited by the budget (still charged to it) */
+} DebugPrintLevelType;
+
+/*! 
+@struct DebugSourceType
+@brief A task's debug output budget and the output it lost (see DebugSourceRegister()). 
+*/
+typedef struct
+{
+  u8 *pu8Name;                      /*!< @brief Pointer to the source name shown in the dropped output report */
+  u32 u32Budget;                    /*!< @brief Bytes the source may queue per DEBUG_BUDGET_WINDOW_MS (0 = no limit) */
+  u32 u32Used;                      /*!< @brief Bytes queued in the current window */
+  u32 u32DroppedLines;              /*!< @brief Lines dropped since the last report */
+  u32 u32DroppedBytes;              /*!< @brief Bytes in those lines */
+} DebugSourceType;
+
+/*! 
+@enum DebugLogFormatType
+@brief Format string IDs for DebugLog().  The order must match Debug_apu8LogFormats[] in debug.c.
+*/
+typedef enum
+{
+  DEBUG_LOG_DROPPED = 0,            /*!< @brief Reported by the debug task when the log ring was full */
+  DEBUG_LOG_LSM6DSL_DATA,           /*!< @brief Raw LSM6DSL temperature, gyro and accelerometer words */
+  DEBUG_LOG_TWI_BENCH,              /*!< @brief en+c twibench result for one bus speed */
+  DEBUG_LOG_LSM6DSL_FIFO,           /*!< @brief en+c imufifo sample rate and error counts */
+  DEBUG_LOG_IMU_FUSION,             /*!< @brief en+c imufusion Euler angles and output rate */
+  DEBUG_LOG_FORMATS                 /*!< @brief Number of log formats (must be last) */
+} DebugLogFormatType;
+
+/*! 
+@enum DebugTelemetryChannelType
+@brief Channel IDs for DebugTelemetrySend().  firmware_host/tools/telemetry_record.py has the payload 
+layout of each channel and must be updated with this list.
+*/
+typedef enum
+{
+  DEBUG_TELEMETRY_LSM6DSL = 0,      /*!< @brief 7 x s16: LSM6DSL temperature, gyro X/Y/Z, accelerometer X/Y/Z */
+  DEBUG_TELEMETRY_CAPTOUCH,         /*!< @brief 2 x u8: Captouch horizontal and vertical slider values */
+  DEBUG_TELEMETRY_ANT,              /*!< @brief 6 x u32: ANT byte, timeout and message counters */
+  DEBUG_TELEMETRY_ORIENTATION,      /*!< @brief 7 x s16: IMU fusion quaternion W/X/Y/Z (Q14) and mean gyro X/Y/Z */
+  DEBUG_TELEMETRY_CHANNELS          /*!< @brief Number of telemetry channels (must be last) */
+} DebugTelemetryChannelType;
+
 
 /***********************************************************************************************************************
 * Function Declarations
@@ -30,8 +95,14 @@ typedef struct
 /*! @publicsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
 u32 DebugPrintf(u8* u8String_);
+u32 DebugPrintfFrom(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8String_);
+u8 DebugSourceRegister(u8* pu8Name_, u32 u32Budget_);
 void DebugLineFeed(void);
 void DebugPrintNumber(u32 u32Number_);
+bool DebugLog(DebugLogFormatType eFormat_, ...);
+bool DebugTelemetrySend(DebugTelemetryChannelType eChannel_, u8* pu8Payload_, u8 u8Size_);
+u8 DebugCommandRegister(u8* pu8Name_, fnCode_type pfnCommand_, u8* pu8Help_);
+u8 DebugXferRegister(u8* pu8Name_, u8* pu8Data_, u32 u32Size_, bool bWritable_);
 
 u8 DebugScanf(u8* pu8Buffer_);
 
@@ -47,8 +118,6 @@ void SystemStatusReport(void);
 void DebugInitialize(void);                   
 void DebugRunActiveState(void);
 
-void DebugRxCallback(void);
-
 
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
@@ -56,17 +125,58 @@ void DebugRxCallback(void);
 inline static void AdvanceTokenCounter(void);
 
 static void DebugCommandPrepareList(void);
-static void DebugCommandDummy(void);
+static u8 DebugCommandFind(u8* pu8Name_);
+
+static bool DebugLineEdit(u8 u8Char_);
+static void DebugLineInsert(u8* pu8Text_, u8 u8Count_);
+static void DebugLineErase(void);
+static void DebugLineCursorTo(u8 u8Position_);
+static void DebugLineReplace(u8* pu8Text_);
+static void DebugLineRecall(bool bOlder_);
+static void DebugLineHistoryAdd(void);
+static void DebugLineComplete(void);
+static void DebugEchoByte(u8 u8Byte_);
+static void DebugEchoText(u8* pu8Text_, u8 u8Count_);
+static void DebugEchoCursorLeft(u8 u8Count_);
+static void DebugEchoFlush(void);
+
+static u32 DebugOutput(u8 u8Source_, DebugPrintLevelType eLevel_, u8* pu8Data_, u32 u32Size_);
+static bool DebugOutputAllowed(u8 u8Source_, DebugPrintLevelType eLevel_);
+static void DebugOutputReport(void);
 
 static void DebugCommandLedTestToggle(void);
 static void DebugLedTestCharacter(u8 u8Char_);
 static void DebugCommandSysTimeToggle(void);
+static void DebugCommandMessagingStats(void);
+static void DebugPrintLatency(u8* pu8Label_, MessageLatencyStatsType* psLatency_);
+static u8* DebugAppendText(u8* pu8Line_, u8* pu8Text_);
+static u8* DebugAppendNumber(u8* pu8Line_, u8* pu8Label_, u32 u32Number_);
+static void DebugCommandMessagingDump(void);
+static void DebugCommandLogBinaryToggle(void);
+static void DebugCommandTelemetryToggle(void);
+static void DebugCommandUartTest(void);
+static void DebugUartTestDone(u32 u32Token_, MessageStateType eState_);
+
+static void DebugCommandTransfer(void);
+static bool DebugXferSend(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_);
+static void DebugXferParse(u8 u8Byte_);
+static void DebugXferHandleFrame(u8 u8Type_, u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_);
+static void DebugXferStart(u8 u8Type_, u8* pu8Payload_, u8 u8Size_);
+static void DebugXferAcknowledge(u8 u8Type_, u8 u8Sequence_);
+static void DebugXferReceive(u8 u8Sequence_, u8* pu8Payload_, u8 u8Size_);
+static u32 DebugXferGetU32(u8* pu8Bytes_);
+static u8* DebugXferPutU32(u8* pu8Bytes_, u32 u32Value_);
+
+static void DebugLogService(void);
+static u32 DebugLogOutput(u8 u8Format_, u32 u32Time_, u8 u8Args_, u32* pu32Args_);
+static u8 DebugLogCountArguments(const u8* pu8Format_);
+static u8 DebugLogRender(u8* pu8Line_, const u8* pu8Format_, u32* pu32Args_);
+static u8* DebugLogEncode(u8* pu8Frame_, u32 u32Value_);
 
 #ifdef EIE_ASCII /* EIE_ASCII-specific debug functions */
 #endif /* EIE_ASCII */
 
 #ifdef EIE_DOTMATRIX /* EIE_DOTMATRIX-specific debug functions  */
-static void DebugCommandCaptouchValuesToggle(void);
 #endif /* EIE_DOTMATRIX */
 
 
@@ -76,6 +186,9 @@ static void DebugCommandCaptouchValuesToggle(void);
 static void DebugSM_Idle(void);                       
 static void DebugSM_CheckCmd(void);                   
 static void DebugSM_ProcessCmd(void);                 
+static void DebugSM_ListCommands(void);
+static void DebugSM_UartTest(void);
+static void DebugSM_Transfer(void);
 
 static void DebugSM_Error(void);
 
@@ -83,16 +196,93 @@ static void DebugSM_Error(void);
 /***********************************************************************************************************************
 * Constants / Definitions
 ***********************************************************************************************************************/
-#define DEBUG_RX_BUFFER_SIZE           (u16)128             /*!< @brief Size of debug buffer for incoming messages */
+#define DEBUG_RX_BUFFER_SIZE           (u16)256             /*!< @brief Size of debug buffer for incoming messages (two transfer frames) */
+#define DEBUG_TX_RING_SIZE             (u16)256             /*!< @brief Size of the debug UART transmit ring */
+#define DEBUG_RX_IDLE_BITS             (u16)20              /*!< @brief Idle time (bit periods, 2 characters) that ends a receive burst */
+#define DEBUG_UART_BAUD                (u32)115200          /*!< @brief Debug UART baud rate (the terminal and host tools must match) */
+#define DEBUG_UART_HANDSHAKE           FALSE                /*!< @brief TRUE for RTS/CTS on the debug UART (the board must route the pins) */
 #define DEBUG_CMD_BUFFER_SIZE          (u8)64               /*!< @brief Size of debug buffer for a command */
+#define DEBUG_CMD_HISTORY_LINES        (u8)4                /*!< @brief Number of previous command lines kept for recall */
+#define DEBUG_ECHO_BUFFER_SIZE         (u8)64               /*!< @brief Echo and redraw bytes collected in one pass of the Idle state */
 #define DEBUG_SCANF_BUFFER_SIZE        (u8)128              /*!< @brief Size of buffer for scanf messages */
 #define DEBUG_TOKEN_ARRAY_SIZE         (u8)16               /*!< @brief Number of cached tokens */
+#define DEBUG_STATS_LINE_SIZE          (u8)128              /*!< @brief Size of a line built by the messaging statistics command */
+
+#define DEBUG_SOURCES                  (u8)8                /*!< @brief Max number of registered output sources */
+#define DEBUG_SOURCE_NONE              (u8)0xFF             /*!< @brief DebugSourceRegister() result when the source was not added */
+#define DEBUG_SOURCE_SYSTEM            (u8)0                /*!< @brief Built-in source for DebugPrintf(), DebugPrintNumber() and DebugLineFeed() */
+#define DEBUG_SOURCE_LOG               (u8)1                /*!< @brief Built-in source for DebugLog() records */
+#define DEBUG_SOURCE_NAME_LENGTH       (u8)12               /*!< @brief Max size of a source name */
+#define DEBUG_BUDGET_WINDOW_MS         (u32)1000            /*!< @brief Time each source's byte budget covers */
+#define DEBUG_SYSTEM_BUDGET            (u32)(DEBUG_UART_BAUD / 10)  /*!< @brief "system" budget: the whole line rate, so only a runaway task is cut off */
+#define DEBUG_LOG_BUDGET               (u32)(DEBUG_UART_BAUD / 20)  /*!< @brief "log" budget: half the line rate (records wait in the ring) */
+#define DEBUG_RESERVE_SLOTS            (u8)(U8_TX_QUEUE_SIZE / 4)   /*!< @brief DEBUG_PRINT_LOW lines are shed with fewer free message slots than this */
+#define DEBUG_RESERVE_BYTES            (u32)(4 * U16_MAX_TX_MESSAGE_LENGTH) /*!< @brief ... or fewer free pool bytes than this (EIE_MSG_ARENA) */
+#define DEBUG_REPORT_MS                (u32)5000            /*!< @brief Shortest time between dropped output reports */
+#define DEBUG_REPORT_LINE_SIZE         (u8)128              /*!< @brief Size of the dropped output report line */
+#define DEBUG_REPORT_ENTRY_SIZE        (u8)(DEBUG_SOURCE_NAME_LENGTH + 40) /*!< @brief Room one source takes in the report line */
+
+#define DEBUG_LOG_RING_WORDS           (u16)128             /*!< @brief Size of the DebugLog() record ring in u32 words (power of 2) */
+#define DEBUG_LOG_MAX_ARGS             (u8)8                /*!< @brief Most arguments a log format may use */
+#define DEBUG_LOG_RECORDS_PER_PASS     (u8)4                /*!< @brief Most log records output by one pass of the Idle state */
+#define DEBUG_LOG_LINE_SIZE            (u8)128              /*!< @brief Size of a rendered log line including the NULL */
+#define DEBUG_LOG_FRAME_SYNC           (u8)0xA5             /*!< @brief First byte of a binary log frame (never part of ASCII text) */
+#define DEBUG_LOG_FRAME_HEADER_SIZE    (u8)5                /*!< @brief Sync, format ID, argument count and 16-bit time */
+#define DEBUG_LOG_FRAME_SIZE           (u8)(DEBUG_LOG_FRAME_HEADER_SIZE + (5 * DEBUG_LOG_MAX_ARGS)) /*!< @brief Largest binary log frame */
+
+#define DEBUG_TELEMETRY_SYNC           (u8)0xA6             /*!< @brief First byte of a telemetry frame */
+#define DEBUG_TELEMETRY_HEADER_SIZE    (u8)4                /*!< @brief Sync, channel, sequence number and payload size */
+#define DEBUG_TELEMETRY_CRC_SIZE       (u8)2                /*!< @brief CRC-16/CCITT at the end of a telemetry frame */
+#define DEBUG_TELEMETRY_MAX_PAYLOAD    (u8)120              /*!< @brief Largest payload DebugTelemetrySend() accepts */
+#define DEBUG_TELEMETRY_BYTES_PER_MS   (u32)((DEBUG_UART_BAUD * 8) / 100000) /*!< @brief Telemetry byte budget per ms: about 80% of the line so the console still gets through */
+#define DEBUG_TELEMETRY_MAX_CREDIT     (u32)256             /*!< @brief Most unused budget that can build up for a burst of frames */
+
+#define DEBUG_UART_TEST_MS             (u32)250             /*!< @brief Line time the UART self-test fills at the current baud rate */
+#define DEBUG_UART_TEST_LINE_SIZE      (u16)64              /*!< @brief Characters in each self-test line including CR LF */
+#define DEBUG_UART_TEST_BLOCK_SIZE     (u16)(4 * DEBUG_UART_TEST_LINE_SIZE) /*!< @brief Bytes in each self-test message */
+#define DEBUG_UART_TEST_IN_FLIGHT      (u16)4               /*!< @brief Most self-test messages queued at once */
+
+#define DEBUG_XFER_SYNC                (u8)0xA7             /*!< @brief First byte of a binary transfer frame (both directions) */
+#define DEBUG_XFER_HEADER_SIZE         (u8)4                /*!< @brief Sync, frame type, sequence number and payload size */
+#define DEBUG_XFER_CRC_SIZE            (u8)2                /*!< @brief CRC-16/CCITT at the end of a transfer frame */
+#define DEBUG_XFER_MAX_PAYLOAD         (u8)120              /*!< @brief Most data bytes in one frame (the frame must fit a 128-byte message) */
+#define DEBUG_XFER_FRAME_SIZE          (u8)(DEBUG_XFER_HEADER_SIZE + DEBUG_XFER_MAX_PAYLOAD + DEBUG_XFER_CRC_SIZE) /*!< @brief Largest transfer frame */
+#define DEBUG_XFER_VERSION             (u8)1                /*!< @brief Protocol version reported in the HELLO frame */
+#define DEBUG_XFER_WINDOW              (u32)4               /*!< @brief Most DATA frames sent ahead of the last ACK */
+#define DEBUG_XFER_RETRY_MS            (u32)250             /*!< @brief Time without an ACK before unacknowledged frames are sent again */
+#define DEBUG_XFER_IDLE_MS             (u32)10000           /*!< @brief Time without a good frame before transfer mode ends by itself */
+#define DEBUG_XFER_REGIONS             (u8)8                /*!< @brief Max number of registered transfer regions */
+#define DEBUG_XFER_NONE                (u8)0xFF             /*!< @brief DebugXferRegister() result when the region was not added */
+#define DEBUG_XFER_NAME_LENGTH         (u8)12               /*!< @brief Max size for a region name */
+#define DEBUG_XFER_SCRATCH_SIZE        (u16)1024            /*!< @brief Size of the built-in writable "scratch" region */
+
+/* Transfer frame types (ASCII so a capture is easy to read) */
+#define DEBUG_XFER_HELLO               (u8)'H'              /*!< @brief Board: version, window, max payload, region count.  Host: ask for HELLO again */
+#define DEBUG_XFER_LIST                (u8)'L'              /*!< @brief Host: send the region list */
+#define DEBUG_XFER_INFO                (u8)'I'              /*!< @brief Board: region ID, writable, size (u32) and name; empty payload ends the list */
+#define DEBUG_XFER_READ                (u8)'R'              /*!< @brief Host: region ID, offset (u32), length (u32, 0 = to the end) */
+#define DEBUG_XFER_WRITE               (u8)'W'              /*!< @brief Host: same payload as READ; the board answers ACK 0 */
+#define DEBUG_XFER_DATA                (u8)'D'              /*!< @brief Either side: the next block of the transfer */
+#define DEBUG_XFER_ACK                 (u8)'A'              /*!< @brief Either side: sequence number of the next DATA frame expected */
+#define DEBUG_XFER_NAK                 (u8)'N'              /*!< @brief Either side: a DATA frame was missed, send again from this sequence number */
+#define DEBUG_XFER_DONE                (u8)'Z'              /*!< @brief Board: every DATA frame of a read was acknowledged; payload is the length (u32) */
+#define DEBUG_XFER_ERROR               (u8)'X'              /*!< @brief Board: the request was refused; payload is a DEBUG_XFER_ERROR_xxx code */
+#define DEBUG_XFER_QUIT                (u8)'Q'              /*!< @brief Host: leave transfer mode.  Board: answered, back to the console */
+
+/* Transfer error codes */
+#define DEBUG_XFER_ERROR_NONE          (u8)0                /*!< @brief Request accepted (never sent) */
+#define DEBUG_XFER_ERROR_REGION        (u8)1                /*!< @brief No region with that ID */
+#define DEBUG_XFER_ERROR_RANGE         (u8)2                /*!< @brief Offset or length is outside the region */
+#define DEBUG_XFER_ERROR_READ_ONLY     (u8)3                /*!< @brief WRITE to a region that is not writable */
+#define DEBUG_XFER_ERROR_REQUEST       (u8)4                /*!< @brief Unknown frame type or bad payload size */
 
 
 /* G_u32DebugFlags */
 #define _DEBUG_LED_TEST_ENABLE         (u32)0x00000001      /*!< @brief G_u32DebugFlags set if LED test is enabled */
 #define _DEBUG_TIME_WARNING_ENABLE     (u32)0x00000002      /*!< @brief G_u32DebugFlags set if system time check is enabled */
 #define _DEBUG_PASSTHROUGH             (u32)0x00000004      /*!< @brief G_u32DebugFlags set if Passthrough mode is enabled */
+#define _DEBUG_LOG_BINARY              (u32)0x00000008      /*!< @brief G_u32DebugFlags set if DebugLog() records are sent as binary frames */
+#define _DEBUG_TELEMETRY_ENABLE        (u32)0x00000010      /*!< @brief G_u32DebugFlags set if DebugTelemetrySend() frames are sent */
 
 #ifdef EIE_ASCII /* EIE_ASCII-specific G_u32DebugFlags flags */
 #endif /* EIE_ASCII */
@@ -115,38 +305,33 @@ static void DebugSM_Error(void);
 /***********************************************************************************************************************
 * Command-Specific Definitions
 ***********************************************************************************************************************/
+#define DEBUG_CMD_MAX             (u8)32                    /*!< @brief Max number of registered commands (numbers stay two digits) */
+#define DEBUG_CMD_NONE            (u8)0xFF                  /*!< @brief DebugCommandRegister() result when the command was not added */
+
 #define DEBUG_CMD_PREFIX_LENGTH   (u8)4                     /*!< @brief Size of command list prefix "00: " */
-#define DEBUG_CMD_NAME_LENGTH     (u8)32                    /*!< @brief Max size for command name */
+#define DEBUG_CMD_NAME_LENGTH     (u8)12                    /*!< @brief Max size for command name */
+#define DEBUG_CMD_HELP_LENGTH     (u8)48                    /*!< @brief Max help characters shown in the command list */
 #define DEBUG_CMD_POSTFIX_LENGTH  (u8)3                     /*!< @brief Size of command list postfix "<CR><LF>\0" */
+#define DEBUG_CMD_LINE_SIZE       (u8)(DEBUG_CMD_PREFIX_LENGTH + DEBUG_CMD_NAME_LENGTH + 1 + DEBUG_CMD_HELP_LENGTH + DEBUG_CMD_POSTFIX_LENGTH)
+
+/* Commands are added at run time with DebugCommandRegister(), usually from a task's 
+initialize function.  The built-in commands are listed in Debug_asBuiltInCommands[] in debug.c. */
+
+/* Line editor keys: control characters, and what DebugLineEdit() turns the VT100 arrow and 
+editing key sequences (ESC [ x or ESC O x) into */
+#define DEBUG_KEY_HOME            (u8)0x01                  /*!< @brief Ctrl-A, Home, ESC[H, ESC[1~: cursor to start of line */
+#define DEBUG_KEY_LEFT            (u8)0x02                  /*!< @brief Ctrl-B, Left arrow, ESC[D: cursor left */
+#define DEBUG_KEY_DELETE          (u8)0x04                  /*!< @brief Ctrl-D, Delete, ESC[3~: delete the character under the cursor */
+#define DEBUG_KEY_END             (u8)0x05                  /*!< @brief Ctrl-E, End, ESC[F, ESC[4~: cursor to end of line */
+#define DEBUG_KEY_RIGHT           (u8)0x06                  /*!< @brief Ctrl-F, Right arrow, ESC[C: cursor right */
+#define DEBUG_KEY_NEXT            (u8)0x0E                  /*!< @brief Ctrl-N, Down arrow, ESC[B: newer history line */
+#define DEBUG_KEY_PREVIOUS        (u8)0x10                  /*!< @brief Ctrl-P, Up arrow, ESC[A: older history line */
+#define DEBUG_KEY_CLEAR           (u8)0x15                  /*!< @brief Ctrl-U: clear the line */
+
+#define DEBUG_ESC_NONE            (u8)0                     /*!< @brief Not in an escape sequence */
+#define DEBUG_ESC_START           (u8)1                     /*!< @brief ESC received */
+#define DEBUG_ESC_SEQUENCE        (u8)2                     /*!< @brief ESC [ or ESC O received, reading parameters */
 
-/* New commands must update the definitions below. Valid commands are in the range
-00 - 99.  Command name string is a maximum of DEBUG_CMD_NAME_LENGTH characters. */
-
-#ifdef EIE_ASCII
-#define DEBUG_COMMANDS          (u8)8   /*!< @brief Total number of debug commands */
-/*                              "0123456789ABCDEF0123456789ABCDEF"  Character position reference */
-#define DEBUG_CMD_NAME00        "Show debug command list         "  /* Command 0: List all commands */
-#define DEBUG_CMD_NAME01        "Toggle LED test                 "  /* Command 1: Test that allows characters to toggle LEDs */
-#define DEBUG_CMD_NAME02        "Toggle system timing warning    "  /* Command 2: Prints message if system tick has advanced more than 1 between main loop sleeps (i.e. tasks are taking too long) */
-#define DEBUG_CMD_NAME03        "Dummy3                          "  /* Command 3: */
-#define DEBUG_CMD_NAME04        "Dummy4                          "  /* Command 4: */
-#define DEBUG_CMD_NAME05        "Dummy5                          "  /* Command 5: */
-#define DEBUG_CMD_NAME06        "Dummy6                          "  /* Command 6: */
-#define DEBUG_CMD_NAME07        "Dummy7                          "  /* Command 7: */
-#endif /* EIE_ASCII */
-
-#ifdef EIE_DOTMATRIX
-#define DEBUG_COMMANDS          8   /* Total number of debug commands */
-/*                              "0123456789ABCDEF0123456789ABCDEF"  Character position reference */
-#define DEBUG_CMD_NAME00        "Show debug command list         "  /* Command 0: List all commands */
-#define DEBUG_CMD_NAME01        "Toggle LED test                 "  /* Command 1: Test that allows characters to toggle LEDs */
-#define DEBUG_CMD_NAME02        "Toggle system timing warning    "  /* Command 2: Prints message if system tick has advanced more than 1 between main loop sleeps (i.e. tasks are taking too long) */
-#define DEBUG_CMD_NAME03        "Toggle Captouch value display   "  /* Command 2: Test that shows Captouch sense values on debug port */
-#define DEBUG_CMD_NAME04        "Dummy4                          "  /* Command 4: */
-#define DEBUG_CMD_NAME05        "Dummy5                          "  /* Command 5: */
-#define DEBUG_CMD_NAME06        "Dummy6                          "  /* Command 6: */
-#define DEBUG_CMD_NAME07        "Dummy7                          "  /* Command 7: */
-#endif /* EIE_ASCII */
 
 
 
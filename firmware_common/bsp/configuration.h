@@ -45,6 +45,7 @@ typedef enum {SPI0, UART, USART0, USART1, USART2, USART3} PeripheralType;
 Includes
 ***********************************************************************************************************************/
 /* Common header files */
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include "AT91SAM3U4.h"
@@ -61,6 +62,14 @@ Includes
 #include "typedefs.h"
 #include "utilities.h"
 
+/* Host-native build: simulated SAM3U peripherals (firmware_host/sim) */
+#ifdef EIE_HOST
+#include "sim.h"
+#endif /* EIE_HOST */
+
+/* Messaging types are used by the board-specific drivers */
+#include "messaging.h"
+
 /* EIEF1-PCB-01 specific header files */
 #ifdef EIE_ASCII
 #include "eief1-pcb-01.h"
@@ -87,7 +96,6 @@ Includes
 #include "ant_api.h"
 #include "buttons.h"
 #include "leds.h" 
-#include "messaging.h"
 #include "timer.h"
 
 #include "sam3u_i2c.h"
@@ -32,21 +32,29 @@ typedef char CHAR;              /* Signed 8-bits */
 typedef unsigned char UCHAR;    /* Unsigned 8-bits */
 typedef short SHORT;            /* Signed 16-bits */
 typedef unsigned short USHORT;  /* Unsigned 16-bits */
+#ifdef EIE_HOST
+/* long is 64 bits on the host, so use int to keep the 32-bit register and pointer-cast semantics */
+typedef int LONG;               /* Signed 32-bits */
+typedef unsigned int ULONG;     /* Unsigned 32-bits */
+#else
 typedef long LONG;              /* Signed 32-bits */
 typedef unsigned long ULONG;    /* Unsigned 32-bits */
+#endif /* EIE_HOST */
 typedef unsigned char BOOL;     /* Boolean */
 /*! @endcond */
 
 
 /* Standard Peripheral Library old types (maintained for legacy purpose) */
-typedef long s32;           /*!< @brief EiE standard variable type name for signed 32-bit variables */ 
+typedef long long s64;      /*!< @brief EiE standard variable type name for signed 64-bit variables (e.g. 32 x 32 bit products) */
+typedef LONG s32;           /*!< @brief EiE standard variable type name for signed 32-bit variables */ 
 typedef short s16;          /*!< @brief EiE standard variable type name for signed 16-bit variables */
 typedef signed char  s8;    /*!< @brief EiE standard variable type name for signed  8-bit variables */
 
-typedef const long sc32;    /*!< @brief EiE standard variable type name for read-only signed 32-bit variables */
+typedef const LONG sc32;    /*!< @brief EiE standard variable type name for read-only signed 32-bit variables */
 typedef const short sc16;   /*!< @brief EiE standard variable type name for read-only signed 16-bit variables */
 typedef const char sc8;     /*!< @brief EiE standard variable type name for read-only signed  8-bit variables */
 
+typedef unsigned long long u64; /*!< @brief EiE standard variable type name for unsigned 64-bit variables */
 typedef ULONG  u32;         /*!< @brief EiE standard variable type name for unsigned 32-bit variables */
 typedef USHORT u16;         /*!< @brief EiE standard variable type name for unsigned 16-bit variables */
 typedef UCHAR  u8;          /*!< @brief EiE standard variable type name for unsigned  8-bit variables */
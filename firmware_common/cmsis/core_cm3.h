@@ -793,6 +793,30 @@ static void __set_FPSCR(uint32_t fpscr)
 
 #endif                 // __VER__ >= 6020000
 
+#elif (defined (EIE_HOST)) /*------------------ Host simulation ------------------*/
+/* The host build has no Cortex-M3 core: the intrinsics are implemented by the
+   simulated SAM3U in firmware_host/sim so PRIMASK, WFI and the bit tricks used
+   by the drivers behave like the target. */
+
+extern void __NOP(void);
+extern void __enable_irq(void);
+extern void __disable_irq(void);
+extern void __enable_fault_irq(void);
+extern void __disable_fault_irq(void);
+extern void __WFI(void);
+extern void __WFE(void);
+extern void __SEV(void);
+extern void __ISB(void);
+extern void __DSB(void);
+extern void __DMB(void);
+extern void __CLREX(void);
+extern uint32_t __get_PRIMASK(void);
+extern void __set_PRIMASK(uint32_t priMask);
+extern uint32_t __REV(uint32_t value);
+extern uint32_t __REV16(uint16_t value);
+extern int32_t __REVSH(int16_t value);
+extern uint32_t __RBIT(uint32_t value);
+
 #elif (defined (__GNUC__)) /*------------------ GNU Compiler ---------------------*/
 /* GNU gcc specific functions */
 
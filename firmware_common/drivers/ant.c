@@ -154,6 +154,8 @@ static u8 Ant_u8SlaveMissedMessageHigh = 0;             /*!< @brief Counter for
 static u8 Ant_u8SlaveMissedMessageMid = 0;              /*!< @brief Counter for missed messages if device is a slave */
 static u8 Ant_u8SlaveMissedMessageLow = 0;              /*!< @brief Counter for missed messages if device is a slave */
 
+static u32 Ant_u32TelemetryTimer;                       /*!< @brief Timer for sending the counters as telemetry */
+
 static u8 Ant_au8AddMessageFailMsg[] = "\n\rNo space in AntQueueOutgoingMessage\n\r";
 
 
@@ -1788,6 +1790,7 @@ static void AntSM_Idle(void)
 {
   u32 u32MsgBitMask = 0x01;
   u8 u8MsgIndex = 0;
+  u32 au32Counters[6];
   static u8 au8AntFlagAlert[] = "ANT flags:\n\r"; 
   
   /* Error messages: must match order of G_u32AntFlags Error / event flags */
@@ -1820,6 +1823,20 @@ static void AntSM_Idle(void)
     G_u32AntFlags &= ~ANT_ERROR_FLAGS_MASK;
   }
   
+  /* Send the counters on the DEBUG_TELEMETRY_ANT channel (nothing is sent unless telemetry is on) */
+  if( IsTimeUp(&Ant_u32TelemetryTimer, ANT_TELEMETRY_PERIOD_MS) )
+  {
+    Ant_u32TelemetryTimer = G_u32SystemTime1ms;
+    
+    au32Counters[0] = Ant_u32TxByteCounter;
+    au32Counters[1] = Ant_u32RxByteCounter;
+    au32Counters[2] = Ant_u32RxTimeoutCounter;
+    au32Counters[3] = Ant_u32UnexpectedByteCounter;
+    au32Counters[4] = Ant_u32ApplicationMessageCount;
+    au32Counters[5] = Ant_u32OutgoingMessageCount;
+    DebugTelemetrySend(DEBUG_TELEMETRY_ANT, (u8*)au32Counters, sizeof(au32Counters));
+  }
+  
   /* Process messages received from ANT */
   AntProcessMessage();
 
@@ -154,6 +154,7 @@ Constants / Definitions
 #define ANT_RESET_WAIT_MS                 (u32)100
 #define ANT_RESTART_DELAY_MS              (u32)1000
 #define ANT_MSG_TIMEOUT_MS                (u32)1000
+#define ANT_TELEMETRY_PERIOD_MS           (u32)1000                       /*!< @brief Time between DEBUG_TELEMETRY_ANT frames */
 
 /* G_u32AntFlags */
 /* Error / event flags */
@@ -138,6 +138,8 @@ Requires:
 Promises:
 - Buttons: sets the active button's debouncing flag, clears the interrupt
   and initializes the button's debounce timer.
+- Blade pins: runs the handler of each Blade pin interrupt that fired
+  (see BladeRequestPinInterrupt())
 
 */
 void PIOA_IrqHandler(void)
@@ -174,6 +176,9 @@ void PIOA_IrqHandler(void)
         
   } /* end port A button interrupt checking */
   
+  /* Blade pin interrupts (e.g. a sensor's data ready line) */
+  BladePinInterrupt(PORTA, u32GPIOInterruptSources);
+  
   /* Clear the PIOA pending flag and exit */
   NVIC_ClearPendingIRQ(IRQn_PIOA);
   
@@ -194,6 +199,8 @@ Requires:
 Promises:
 - Buttons: sets the active button's debouncing flag, clears the interrupt
   and initializes the button's debounce timer.
+- Blade pins: runs the handler of each Blade pin interrupt that fired
+  (see BladeRequestPinInterrupt())
 
 */
 void PIOB_IrqHandler(void)
@@ -230,6 +237,9 @@ void PIOB_IrqHandler(void)
         
   } /* end port B button interrupt checking */
   
+  /* Blade pin interrupts (e.g. a sensor's data ready line) */
+  BladePinInterrupt(PORTB, u32GPIOInterruptSources);
+  
   /* Clear the PIOB pending flag and exit */
   NVIC_ClearPendingIRQ(IRQn_PIOB);
   
@@ -13,14 +13,79 @@ The API is simplified and provides just a single function for high-level client
 status of their message based on a provided unique token.  If the status of a message is such that
 it will no longer change (i.e. COMPLETE, TIMOEOUT, ABANDONDED) then that message's status in the loop
 will be cleared automatically.  There is ample room in the message status array to keep sufficient message 
-status history given the processing time of the firmware.  However, the status array is circular so 
-message statuses can be lost eventually.  If a task waits too long and received a "NOT FOUND" status 
+status history given the processing time of the firmware.  However, the status array is indexed directly
+by token (token modulo U16_STATUS_QUEUE_SIZE) so message statuses can be lost eventually when a newer 
+token lands on the same entry.  If a task waits too long and received a "NOT FOUND" status 
 because they have waited too long, the task should increase the frequency at which it queries the 
-message status.
+message status.  G_u32MessagingStatusEvictions counts the statuses that were overwritten before
+their final state was queried and can be used to size the status array.
+
+Messages and statuses also have a time-to-live.  Every U32_MSG_STATUS_CLEANING_TIME the state machine
+sweeps the pool and the status queue, U8_MSG_CLEANING_STEPS entries of each per 1ms pass.  A message
+that has been WAITING for U32_MSG_STATUS_WAITING_TIME is unlinked from its peripheral queue, marked
+TIMEOUT and returned to the pool so a peripheral that has stopped cannot hold every slot.  The message
+at the front of a queue is never removed since its peripheral may already be sending it.  Statuses
+nobody has collected are cleared after U32_MSG_STATUS_COMPLETE_TIME (COMPLETE) or 
+U32_MSG_STATUS_TIMEOUT_TIME (TIMEOUT, ABANDONED or FAILED).
+
+QueueMessage() takes a MessagePriorityType.  A MSG_PRIORITY_HIGH message is linked after the message
+at the front of the queue (which may already be sending) and after any earlier high priority messages,
+so it waits for at most one message instead of the whole backlog.  A message that QueueMessage() split
+into pieces is never separated.  MessagingGetPriorityStats() reports the occupancy and queued-to-sent
+latency of each level.
+
+A peripheral with a second DMA buffer (the PDC "next" registers) can load the message after the one
+it is sending with StartNextMessage() so the two go out back to back.  That message is marked 
+SENDING and is treated like the front of the queue: high priority messages are linked after it and 
+it never times out.
+
+Peripheral drivers normally copy the caller's data into the pool with QueueMessage().  Two other ways
+avoid that copy: a producer can borrow a slot with ReserveMessage(), build the payload directly in it
+and hand it to the driver's commit function (which calls CommitMessage()), or the driver can queue
+the caller's own buffer by reference with QueueMessageNoCopy() and report completion through a
+MessageCallbackType callback.  A driver that collects small writes in a buffer of its own can queue
+the first one with QueueMessageNoCopy() and add later ones with ExtendMessage() for as long as the 
+message is the last in its queue and has not been started, so they all go out in one transfer.
+
+Instead of polling QueryMessageStatus() every pass, a client can register a MessageCallbackType for
+a token with MessageSetCallback().  UpdateMessageStatus() calls it as soon as the status becomes 
+COMPLETE, TIMEOUT, ABANDONED or FAILED, which is usually from the peripheral ISR, so a task waiting on a
+transfer can react in its next pass without a lookup.  A COMPLETE, TIMEOUT or ABANDONED status is
+collected by the callback just as QueryMessageStatus() would collect it.  If the status is overwritten
+by a newer token before it is final, the callback is called with NOT_FOUND.  Tokens are assigned with 
+interrupts off, so a callback may queue the next message of a chained transfer.
+
+Payload storage is selected at build time.  By default every message in Msg_asPool carries its own
+U16_MAX_TX_MESSAGE_LENGTH byte array, so a 1-byte message uses as much RAM as a full one and a long
+message is split across several slots.  If EIE_MSG_ARENA is defined, the messages only hold a pointer
+and the payloads are packed one after the other into a ring of U16_MSG_ARENA_SIZE bytes.  Each block
+has a 4-byte header and is rounded up to 4 bytes.  Blocks are normally freed in the order they were
+allocated; a block freed early (e.g. on another peripheral's queue) is reclaimed once the blocks
+in front of it are freed.  MessagingGetPoolStats() reports the bytes in use and the bytes lost to
+headers, padding and unreclaimed blocks for either backend so the two can be compared.
+
+MessagingGetStats() reports how hard the system is driving the pool: enqueues, dequeues, requests 
+refused because the pool was full, the peak number of slots in use, the bytes queued to each 
+peripheral (by the AT91C_ID_ in MessageQueueType) and min / avg / max with a power-of-two histogram 
+of the time each message spent WAITING before its peripheral started it and SENDING before it was 
+COMPLETE.  The times come from the status timestamps, so a status that is overwritten before it 
+changes is not measured.  MessagingDumpStats() packs the same figures into a little-endian record 
+for a host tool:
+
+  Byte 0-1   'M' 'S'
+  Byte 2     U8_MSG_STATS_DUMP_VERSION
+  Byte 3     u32PeakQueuedMessages
+  Byte 4     u32Enqueues, u32Dequeues, u32FullRejections (u32 each)
+  Byte 16    sWaitingToSending: u32Count, u32Total, u32Min, u32Max, au32Bins[8] (u32 each)
+  Byte 64    sSendingToComplete (same layout)
+  Byte 112   n: number of peripherals that have queued data
+  Byte 113   n entries of the peripheral ID (u8) followed by its bytes queued (u32)
 
 ------------------------------------------------------------------------------------------------------------------------
 GLOBALS
-- NONE
+- G_u32MessagingFlags
+- G_u32MessagingStatusEvictions
+- G_u32MessagingTimeouts
 
 CONSTANTS
 - NONE
@@ -28,14 +93,32 @@ CONSTANTS
 TYPES
 - MessageStateType {EMPTY, WAITING, SENDING, COMPLETE, 
                     TIMEOUT, ABANDONED, NOT_FOUND}
+- MessageCallbackType
+- MessagePoolStatsType
+- MessagePriorityType {MSG_PRIORITY_NORMAL, MSG_PRIORITY_HIGH}
+- MessagePriorityStatsType
+- MessageLatencyStatsType
+- MessagingStatsType
 
 PUBLIC FUNCTIONS
 - MessageStateType QueryMessageStatus(u32 u32Token_)
+- MessageStateType MessageSetCallback(u32 u32Token_, MessageCallbackType pfnCallback_)
+- MessageType* ReserveMessage(void)
+- void ReleaseMessage(MessageType* psMessage_)
+- void MessagingGetPoolStats(MessagePoolStatsType* psStats_)
+- u8 MessagingGetFreeSlots(void)
+- void MessagingGetPriorityStats(MessagePriorityType ePriority_, MessagePriorityStatsType* psStats_)
+- void MessagingGetStats(MessagingStatsType* psStats_)
+- u32 MessagingDumpStats(u8* pu8Buffer_, u32 u32Size_)
 
 PROTECTED FUNCTIONS
 - void MessagingInitialize(void)
-- u32 QueueMessage(MessageType** ppsTargetTxBuffer_, u32 u32MessageSize_, u8* pu8MessageData_)
-- void DeQueueMessage(MessageType** pTargetQueue_)
+- u32 QueueMessage(MessageQueueType* psTargetQueue_, u32 u32MessageSize_, u8* pu8MessageData_, MessagePriorityType ePriority_)
+- u32 CommitMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Size_)
+- u32 QueueMessageNoCopy(MessageQueueType* psTargetQueue_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+- void DeQueueMessage(MessageQueueType* psTargetQueue_)
+- MessageType* StartNextMessage(MessageQueueType* psTargetQueue_, bool bContinuationOnly_)
+- bool ExtendMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Token_, u32 u32Size_)
 - void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_)
 
 
@@ -49,6 +132,8 @@ All Global variable names shall start with "G_<type>Messaging"
 ***********************************************************************************************************************/
 /* New variables */
 u32 G_u32MessagingFlags;                               /*!< @brief Global state flags */
+u32 G_u32MessagingStatusEvictions;                     /*!< @brief Statuses overwritten before they were queried */
+u32 G_u32MessagingTimeouts;                            /*!< @brief Messages removed from a queue after waiting too long */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -68,13 +153,30 @@ static fnCode_type Messaging_pfnStateMachine;          /*!< @brief The state mac
 static u32 Msg_u32Token;                               /*!< @brief Incrementing message token used for all external communications */
 
 static MessageSlotType Msg_asPool[U8_TX_QUEUE_SIZE];   /*!< @brief Array of MessageSlotType used for the transmit queue */
+static MessageSlotType* Msg_psFreeSlots;               /*!< @brief Singly-linked list of free slots in Msg_asPool */
 static u8 Msg_u8QueuedMessageCount;                    /*!< @brief Number of messages slots currently occupied */
 
+#ifdef EIE_MSG_ARENA
+static u32 Msg_au32Arena[U16_MSG_ARENA_SIZE / 4];      /*!< @brief Payload ring (u32 so every block header is aligned) */
+static u32 Msg_u32ArenaHead;                           /*!< @brief Offset where the next block will start */
+static u32 Msg_u32ArenaTail;                           /*!< @brief Offset of the oldest block (valid when Msg_u32ArenaUsed is not 0) */
+static u32 Msg_u32ArenaUsed;                           /*!< @brief Bytes from tail to head, including skip and unreclaimed blocks */
+#endif /* EIE_MSG_ARENA */
+
+static u32 Msg_u32PayloadBytes;                        /*!< @brief Bytes of queued data held in the pool */
+static u32 Msg_u32PeakBytesInUse;                      /*!< @brief Most payload storage allocated at once */
+static u32 Msg_u32PeakFragmentedBytes;                 /*!< @brief Most allocated payload storage not holding queued data */
+
+static u16 Msg_u16CleaningIndex;                       /*!< @brief Next pool slot / status entry to check in a sweep */
+
+static MessagePriorityStatsType Msg_asPriorityStats[U8_MSG_PRIORITY_LEVELS]; /*!< @brief Occupancy and latency counters per priority */
+static MessagingStatsType Msg_sStats;                  /*!< @brief Load counters reported by MessagingGetStats() */
+
 /* A separate status queue needs to be maintained since the message information in Msg_asPool will be lost when the message
 has been dequeued.  Applications must be able to query to determine the status of their message, particularly if
-it has been sent. */
-static MessageStatusType  Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE]; /*!< @brief Array of MessageStatusType used to monitor message status */
-static MessageStatusType* Msg_psNextStatus;                        /*!< @brief Pointer to next available message status */
+it has been sent.  Tokens are handed out sequentially, so indexing the array by token keeps the most recent
+U16_STATUS_QUEUE_SIZE statuses just like a circular buffer while making every lookup a single access. */
+static MessageStatusType  Msg_asStatusQueue[U16_STATUS_QUEUE_SIZE]; /*!< @brief Array of MessageStatusType used to monitor message status */
 
 
 
@@ -93,8 +195,8 @@ Function Definitions
 
 If the state is COMPLETE, TIMEOUT or ABANDONED, calling this function
 forces the associated status to be cleared from the message queue.
-Since the queue is quite short, most of the time it will hold very little entries.  
-New entries are always filled at the front, using a simple linear search starting at index 0.
+The status can only be in the entry that the token maps to, so this takes the
+same time regardless of U16_STATUS_QUEUE_SIZE.
 
 Requires:
 @param u32Token_ is the token (ID) of the message of interest
@@ -108,18 +210,12 @@ the queue and time-stamped for debugging purposes.
 MessageStateType QueryMessageStatus(u32 u32Token_)
 {
   MessageStateType eStatus = NOT_FOUND;
-  MessageStatusType* pListParser = &Msg_asStatusQueue[0];
+  MessageStatusType* pListParser = MessageStatusEntry(u32Token_);
   
-  /* Brute force search for the token - the queue will never be large enough on this system to require a more
-  intelligent search algorithm */
-  while( (pListParser->u32Token != u32Token_) && 
-         (pListParser != &Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE]) )
-  {
-    pListParser++;
-  }
-
-  /* If the token was found pListParser is pointing at it, take appropriate action */
-  if(pListParser != &Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE])
+  /* A callback in an ISR can queue a message that takes this entry, so check and clear atomically.
+  If the entry still holds the token, take appropriate action (token 0 is never valid) */
+  __disable_irq();
+  if( (u32Token_ != 0) && (pListParser->u32Token == u32Token_) )
   {
     /* Save the status */
     eStatus = pListParser->eState;
@@ -130,8 +226,10 @@ MessageStateType QueryMessageStatus(u32 u32Token_)
       pListParser->u32Token = 0;
       pListParser->eState = EMPTY;
       pListParser->u32Timestamp = G_u32SystemTime1ms;
+      pListParser->pfnCallback = NULL;
     }
   }
+  __enable_irq();
 
   /* If the message was not found, the state is already set correctly, so just return */
   return(eStatus);
@@ -139,6 +237,295 @@ MessageStateType QueryMessageStatus(u32 u32Token_)
 } /* end QueryMessageStatus() */
 
 
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn MessageStateType MessageSetCallback(u32 u32Token_, MessageCallbackType pfnCallback_)
+
+@brief Registers a function to be called when a message's status reaches a final state so the
+client does not have to poll QueryMessageStatus().
+
+The callback is called by UpdateMessageStatus() with the token and the new state (COMPLETE, TIMEOUT,
+ABANDONED or FAILED), or with NOT_FOUND if the status is overwritten by a newer token first.  It is 
+usually called from the peripheral ISR, so it should only record the result (e.g. set a flag the
+client's state machine checks) or queue a follow-on message; it must not wait on the peripheral.
+A COMPLETE, TIMEOUT or ABANDONED status is cleared after the callback, so QueryMessageStatus() and the
+callback of a QueueMessageNoCopy() message then see NOT_FOUND for the token.
+
+Requires:
+@param u32Token_ is the token returned when the message was queued
+@param pfnCallback_ is the function to call (NULL removes a registered callback)
+
+Promises:
+- Returns the state of the message when the call is made.  The callback is only registered if the
+  state is WAITING or SENDING; for any other state (including NOT_FOUND) it will never be called
+  and the client must act on the returned state itself.
+
+*/
+MessageStateType MessageSetCallback(u32 u32Token_, MessageCallbackType pfnCallback_)
+{
+  MessageStateType eStatus = NOT_FOUND;
+  MessageStatusType* psStatus = MessageStatusEntry(u32Token_);
+  
+  /* The peripheral ISR can finish the message at any time, so check and register atomically */
+  __disable_irq();
+  if( (u32Token_ != 0) && (psStatus->u32Token == u32Token_) )
+  {
+    eStatus = psStatus->eState;
+    if( !MessageStateIsFinal(eStatus) )
+    {
+      psStatus->pfnCallback = pfnCallback_;
+    }
+  }
+  __enable_irq();
+  
+  return(eStatus);
+  
+} /* end MessageSetCallback() */
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn MessageType* ReserveMessage(void)
+
+@brief Loans a message slot to the caller so the payload can be written in place.
+
+The caller writes up to U16_MAX_TX_MESSAGE_LENGTH bytes to psMessage->pu8Data and then
+passes the message to a peripheral (e.g. UartCommitData(), SspCommitData(), TwiCommitData())
+which queues it without copying.  A reserved slot counts against the pool until it is
+committed or returned with ReleaseMessage(), so it should not be held across task iterations.
+With EIE_MSG_ARENA the full U16_MAX_TX_MESSAGE_LENGTH is taken from the ring and the unused end
+is given back when the message is committed (if nothing was allocated after it).
+
+Requires:
+- NONE
+
+Promises:
+- Returns a pointer to an unused message, or NULL if the pool is full (in which case
+  _MESSAGING_TX_QUEUE_FULL is set)
+
+*/
+MessageType* ReserveMessage(void)
+{
+  MessageSlotType* psSlot = MessageSlotAllocate(U16_MAX_TX_MESSAGE_LENGTH);
+  
+  if(psSlot == NULL)
+  {
+    G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_FULL;
+    Msg_sStats.u32FullRejections++;
+    return(NULL);
+  }
+  
+  return(&psSlot->Message);
+  
+} /* end ReserveMessage() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void ReleaseMessage(MessageType* psMessage_)
+
+@brief Returns a loaned message to the pool without sending it.
+
+Requires:
+@param psMessage_ is a message returned by ReserveMessage() that has not been committed
+
+Promises:
+- The slot is free again; messages that are not on loan are ignored
+
+*/
+void ReleaseMessage(MessageType* psMessage_)
+{
+  MessageSlotType* psSlot = MessageSlotFind(psMessage_);
+  
+  /* A committed message has a token and belongs to a peripheral queue now */
+  if( (psSlot != NULL) && (psMessage_->u32Token == 0) )
+  {
+    MessageSlotFree(psSlot);
+  }
+  
+} /* end ReleaseMessage() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void MessagingGetPoolStats(MessagePoolStatsType* psStats_)
+
+@brief Reports how much payload storage is in use and how much of it is wasted.
+
+Without EIE_MSG_ARENA every occupied slot counts as U16_MAX_TX_MESSAGE_LENGTH bytes in use.  
+With it, the bytes in use are the ring bytes between the oldest and newest blocks.  In both cases 
+the fragmented bytes are the part of that which does not hold queued message data.
+
+Requires:
+@param psStats_ points to the structure to fill in
+
+Promises:
+- *psStats_ holds the current and peak figures since MessagingInitialize()
+
+*/
+void MessagingGetPoolStats(MessagePoolStatsType* psStats_)
+{
+  __disable_irq();
+  psStats_->u32BytesInUse = MessagePoolBytesInUse();
+  psStats_->u32PayloadBytes = Msg_u32PayloadBytes;
+  psStats_->u32PeakBytesInUse = Msg_u32PeakBytesInUse;
+  psStats_->u32PeakFragmentedBytes = Msg_u32PeakFragmentedBytes;
+  __enable_irq();
+
+#ifdef EIE_MSG_ARENA
+  psStats_->u32Size = U16_MSG_ARENA_SIZE;
+#else
+  psStats_->u32Size = (u32)U8_TX_QUEUE_SIZE * U16_MAX_TX_MESSAGE_LENGTH;
+#endif
+  psStats_->u32FragmentedBytes = psStats_->u32BytesInUse - psStats_->u32PayloadBytes;
+  
+} /* end MessagingGetPoolStats() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u8 MessagingGetFreeSlots(void)
+
+@brief Returns the number of message slots that are not in use.
+
+A task that can hold back or drop its own output (e.g. DebugPrintfFrom() with DEBUG_PRINT_LOW)
+checks this so it leaves slots for traffic that cannot wait.
+
+Requires:
+- NONE
+
+Promises:
+- Returns U8_TX_QUEUE_SIZE less the slots that are queued or on loan
+
+*/
+u8 MessagingGetFreeSlots(void)
+{
+  return( (u8)(U8_TX_QUEUE_SIZE - Msg_u8QueuedMessageCount) );
+  
+} /* end MessagingGetFreeSlots() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void MessagingGetPriorityStats(MessagePriorityType ePriority_, MessagePriorityStatsType* psStats_)
+
+@brief Reports the occupancy and latency counters of one priority level.
+
+Requires:
+@param ePriority_ is the priority level of interest
+@param psStats_ points to the structure to fill in
+
+Promises:
+- *psStats_ holds the counters since MessagingInitialize() (all 0 for an invalid ePriority_)
+
+*/
+void MessagingGetPriorityStats(MessagePriorityType ePriority_, MessagePriorityStatsType* psStats_)
+{
+  if((u8)ePriority_ >= U8_MSG_PRIORITY_LEVELS)
+  {
+    psStats_->u32Queued = 0;
+    psStats_->u32PeakQueued = 0;
+    psStats_->u32Sent = 0;
+    psStats_->u32TotalLatency = 0;
+    psStats_->u32MaxLatency = 0;
+    return;
+  }
+  
+  __disable_irq();
+  *psStats_ = Msg_asPriorityStats[ePriority_];
+  __enable_irq();
+  
+} /* end MessagingGetPriorityStats() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void MessagingGetStats(MessagingStatsType* psStats_)
+
+@brief Reports the messaging load counters.
+
+Requires:
+@param psStats_ points to the structure to fill in
+
+Promises:
+- *psStats_ holds the counters since MessagingInitialize()
+
+*/
+void MessagingGetStats(MessagingStatsType* psStats_)
+{
+  __disable_irq();
+  *psStats_ = Msg_sStats;
+  __enable_irq();
+  
+} /* end MessagingGetStats() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 MessagingDumpStats(u8* pu8Buffer_, u32 u32Size_)
+
+@brief Packs the messaging load counters into the binary record described at the top of this file.
+
+Only the peripherals that have queued data are included, so the record is 113 bytes plus 5 per
+peripheral and never more than U16_MSG_STATS_DUMP_SIZE.
+
+Requires:
+@param pu8Buffer_ points to the destination
+@param u32Size_ is the number of bytes available at pu8Buffer_
+
+Promises:
+- Returns the number of bytes written, or 0 (nothing written) if u32Size_ is too small
+
+*/
+u32 MessagingDumpStats(u8* pu8Buffer_, u32 u32Size_)
+{
+  MessagingStatsType sStats;
+  MessageLatencyStatsType* apsLatency[2];
+  u8* pu8Next;
+  u8 u8Peripherals = 0;
+  
+  MessagingGetStats(&sStats);
+  for(u8 i = 0; i < U8_MSG_STATS_PERIPHERALS; i++)
+  {
+    if(sStats.au32PeripheralBytes[i] != 0)
+    {
+      u8Peripherals++;
+    }
+  }
+  
+  if( u32Size_ < (113 + (5 * (u32)u8Peripherals)) )
+  {
+    return(0);
+  }
+
+  pu8Buffer_[0] = 'M';
+  pu8Buffer_[1] = 'S';
+  pu8Buffer_[2] = U8_MSG_STATS_DUMP_VERSION;
+  pu8Buffer_[3] = (u8)sStats.u32PeakQueuedMessages;
+  pu8Next = MessageDumpU32(&pu8Buffer_[4], sStats.u32Enqueues);
+  pu8Next = MessageDumpU32(pu8Next, sStats.u32Dequeues);
+  pu8Next = MessageDumpU32(pu8Next, sStats.u32FullRejections);
+  
+  apsLatency[0] = &sStats.sWaitingToSending;
+  apsLatency[1] = &sStats.sSendingToComplete;
+  for(u8 i = 0; i < 2; i++)
+  {
+    pu8Next = MessageDumpU32(pu8Next, apsLatency[i]->u32Count);
+    pu8Next = MessageDumpU32(pu8Next, apsLatency[i]->u32Total);
+    pu8Next = MessageDumpU32(pu8Next, apsLatency[i]->u32Min);
+    pu8Next = MessageDumpU32(pu8Next, apsLatency[i]->u32Max);
+    for(u8 j = 0; j < U8_MSG_LATENCY_BINS; j++)
+    {
+      pu8Next = MessageDumpU32(pu8Next, apsLatency[i]->au32Bins[j]);
+    }
+  }
+  
+  *pu8Next++ = u8Peripherals;
+  for(u8 i = 0; i < U8_MSG_STATS_PERIPHERALS; i++)
+  {
+    if(sStats.au32PeripheralBytes[i] != 0)
+    {
+      *pu8Next++ = i;
+      pu8Next = MessageDumpU32(pu8Next, sStats.au32PeripheralBytes[i]);
+    }
+  }
+  
+  return( (u32)(pu8Next - pu8Buffer_) );
+  
+} /* end MessagingDumpStats() */
+
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /*! @protectedsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -165,34 +552,91 @@ void MessagingInitialize(void)
   Msg_u32Token = 1;
 
   /* Ensure all message slots are deallocated and the message status queue is empty */
-  for(u8 i = 0; i < U8_TX_QUEUE_SIZE; i++)
+  Msg_psFreeSlots = NULL;
+  for(u8 i = U8_TX_QUEUE_SIZE; i-- > 0; )
   {
-    /* Clear the Slot value */
+    /* Clear the Slot value and push it on the free list so slot 0 is handed out first */
     Msg_asPool[i].bFree = TRUE;
+    Msg_asPool[i].psNextFreeSlot = Msg_psFreeSlots;
+    Msg_psFreeSlots = &Msg_asPool[i];
     
     /* Clear the slot's message values */
     Msg_asPool[i].Message.u32Token = 0;
     Msg_asPool[i].Message.u32Size = 0;
     Msg_asPool[i].Message.psNextMessage = NULL;
+    Msg_asPool[i].Message.psQueue = NULL;
+    Msg_asPool[i].Message.pfnCallback = NULL;
     
+#ifdef EIE_MSG_ARENA
+    Msg_asPool[i].Message.pu8Data = NULL;
+#else
+    Msg_asPool[i].Message.pu8Data = Msg_asPool[i].Message.pu8Message;
+
     /* Clear the slot's message's contents */
     for(u16 j = 0; j < U16_MAX_TX_MESSAGE_LENGTH; j++)
     {
       *(Msg_asPool[i].Message.pu8Message + j) = 0;
     }
+#endif
+  }
+
+#ifdef EIE_MSG_ARENA
+  /* Empty the payload ring */
+  Msg_u32ArenaHead = 0;
+  Msg_u32ArenaTail = 0;
+  Msg_u32ArenaUsed = 0;
+  for(u16 i = 0; i < (U16_MSG_ARENA_SIZE / 4); i++)
+  {
+    Msg_au32Arena[i] = 0;
   }
+#endif
+
+  Msg_u32PayloadBytes = 0;
+  Msg_u32PeakBytesInUse = 0;
+  Msg_u32PeakFragmentedBytes = 0;
 
   /* Clear the message status queue */
-  for(u8 i = 0; i < U8_STATUS_QUEUE_SIZE; i++)
+  for(u16 i = 0; i < U16_STATUS_QUEUE_SIZE; i++)
   {
     Msg_asStatusQueue[i].u32Token = 0;
     Msg_asStatusQueue[i].eState = EMPTY;
     Msg_asStatusQueue[i].u32Timestamp = 0;
+    Msg_asStatusQueue[i].pfnCallback = NULL;
   }
 
-  Msg_psNextStatus = &Msg_asStatusQueue[0];
-
   G_u32MessagingFlags = 0;
+  G_u32MessagingStatusEvictions = 0;
+  G_u32MessagingTimeouts = 0;
+  Msg_u16CleaningIndex = 0;
+  
+  for(u8 i = 0; i < U8_MSG_PRIORITY_LEVELS; i++)
+  {
+    Msg_asPriorityStats[i].u32Queued = 0;
+    Msg_asPriorityStats[i].u32PeakQueued = 0;
+    Msg_asPriorityStats[i].u32Sent = 0;
+    Msg_asPriorityStats[i].u32TotalLatency = 0;
+    Msg_asPriorityStats[i].u32MaxLatency = 0;
+  }
+  
+  Msg_sStats.u32Enqueues = 0;
+  Msg_sStats.u32Dequeues = 0;
+  Msg_sStats.u32FullRejections = 0;
+  Msg_sStats.u32PeakQueuedMessages = 0;
+  for(u8 i = 0; i < U8_MSG_LATENCY_BINS; i++)
+  {
+    Msg_sStats.sWaitingToSending.au32Bins[i] = 0;
+    Msg_sStats.sSendingToComplete.au32Bins[i] = 0;
+  }
+  Msg_sStats.sWaitingToSending.u32Count = 0;
+  Msg_sStats.sWaitingToSending.u32Total = 0;
+  Msg_sStats.sWaitingToSending.u32Min = 0;
+  Msg_sStats.sWaitingToSending.u32Max = 0;
+  Msg_sStats.sSendingToComplete = Msg_sStats.sWaitingToSending;
+  for(u8 i = 0; i < U8_MSG_STATS_PERIPHERALS; i++)
+  {
+    Msg_sStats.au32PeripheralBytes[i] = 0;
+  }
+  
   Messaging_pfnStateMachine = MessagingSM_Idle;
 
 } /* end MessagingInitialize() */
@@ -221,34 +665,47 @@ void MessagingRunActiveState(void)
 
 
 /*!--------------------------------------------------------------------------------------------------------------------
-@fn u32 QueueMessage(MessageType** ppsTargetTxBuffer_, u32 u32MessageSize_, u8* pu8MessageData_)
+@fn u32 QueueMessage(MessageQueueType* psTargetQueue_, u32 u32MessageSize_, u8* pu8MessageData_, MessagePriorityType ePriority_)
 
 @brief Allocates one of the positions in the message queue to the calling function's send queue.
 
+Free slots are taken from the front of a free list and linked at the tail of the target queue, 
+so the time spent with interrupts disabled does not depend on U8_TX_QUEUE_SIZE or on how many 
+messages are already queued.  Messages longer than one slot (or U16_MSG_ARENA_MAX_MESSAGE with 
+EIE_MSG_ARENA) are split, and all of the pieces are allocated before any is queued so a message 
+is never sent in part.
+
 Requires:
 - Msg_asPool should not be full 
 
-@param  ppsTargetTxBuffer_ is the peripheral transmit buffer where the message will be queued
+@param  psTargetQueue_ is the peripheral transmit queue where the message will be queued
 @param  u32MessageSize_ is the size of the message data array in bytes
 @param  pu8MessageData_ points to the message data array
+@param  ePriority_ is MSG_PRIORITY_HIGH to send the message ahead of normal messages that have not started
 
 Promises:
 - The message is inserted into the target list and assigned a token
 - If the message is created successfully, the message token is returned; otherwise, NULL is returned
 
 */
-u32 QueueMessage(MessageType** ppsTargetTxBuffer_, u32 u32MessageSize_, u8* pu8MessageData_)
+u32 QueueMessage(MessageQueueType* psTargetQueue_, u32 u32MessageSize_, u8* pu8MessageData_, MessagePriorityType ePriority_)
 {
-  MessageSlotType *psSlotParser = NULL;
-  MessageType *psNewMessage = NULL;
-  MessageType *psListParser = NULL;
+  MessageSlotType *psSlot = NULL;
+  MessageType *psPieces = NULL;
+  MessageType *psMessage;
+  MessageType *psNext;
   u8  u8SlotsRequired;
   u32 u32BytesRemaining = u32MessageSize_;
   u32 u32CurrentMessageSize = 0;
+#ifdef EIE_MSG_ARENA
+  u32 u32MaxTxMessageLength = (u32)U16_MSG_ARENA_MAX_MESSAGE;
+#else
   u32 u32MaxTxMessageLength = (u32)(U16_MAX_TX_MESSAGE_LENGTH) & 0x0000FFFF;
+#endif
+  u32 u32Token = 0;
   
   /* Check for empty message */
-  if(u32MessageSize_ == 0)
+  if( (u32MessageSize_ == 0) || ((u8)ePriority_ >= U8_MSG_PRIORITY_LEVELS) )
   {
     return(0);
   }
@@ -263,230 +720,1311 @@ u32 QueueMessage(MessageType** ppsTargetTxBuffer_, u32 u32MessageSize_, u8* pu8M
   if( (Msg_u8QueuedMessageCount + u8SlotsRequired) > U8_TX_QUEUE_SIZE)
   {
     G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_FULL;
+    Msg_sStats.u32FullRejections++;
     return(0);
   }
 
-  /* Space available, so proceed with allocation.  Though only one message is queued at a time, we
-  use a while loop to handle messages that are too big and must be split into different slots.  The slots
-  are always sequential and the message processor will send the bytes continuously across slots */
+  /* Slots available, so proceed with allocation.  Though only one message is queued at a time, we
+  use a while loop to handle messages that are too big and must be split into different slots.  The pieces
+  are held newest first in psPieces until they have all been allocated */
   while(u32BytesRemaining)
   {
-    /* Increment the message count.  Interrupts are disabled here since this global
-    can be accessed by an interrupt. */
-    __disable_irq();
-    Msg_u8QueuedMessageCount++;
-    __enable_irq();
-  
-    /* Flag if we're above the high watermark */
-    if(Msg_u8QueuedMessageCount >= U8_TX_QUEUE_WATERMARK)
-    {
-      G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_ALMOST_FULL;
-    }
-    else
-    {
-      G_u32MessagingFlags &= ~_MESSAGING_TX_QUEUE_ALMOST_FULL;
-    }
-
-    /* Find an empty slot: this is non-circular and there must be at least one free slot if we're here */
-    psSlotParser = &Msg_asPool[0];
-    while(!psSlotParser->bFree)
-    {
-      psSlotParser++;
-    }
-    
-    /* Allocate the slot and set the message pointer */
-    psSlotParser->bFree = FALSE;
-    psNewMessage = &(psSlotParser->Message);
-  
     /* Check the message size and split the message up if necessary */
     if(u32BytesRemaining > u32MaxTxMessageLength)
     {
       u32CurrentMessageSize = u32MaxTxMessageLength;
-      u32BytesRemaining -= u32MaxTxMessageLength;
     }
     else
     {
       u32CurrentMessageSize = u32BytesRemaining;
-      u32BytesRemaining = 0;
     }
     
-    /* Copy all the data to the allocated message structure */
-    psNewMessage->u32Token      = Msg_u32Token;
-    psNewMessage->u32Size       = u32CurrentMessageSize;
-    psNewMessage->psNextMessage = NULL;
-    
-    /* Add the data into the payload */
-    for(u32 i = 0; i < psNewMessage->u32Size; i++)
-    {
-      *(psNewMessage->pu8Message + i) = *pu8MessageData_;
-      pu8MessageData_++;
-    }
-  
-    /* Link the new message into the client's transmit buffer.  This must happen
-    with interrupts off since other functions can operate on the transmit buffer. */
-    __disable_irq();
-    
-    /* Handle an empty list */
-    if(*ppsTargetTxBuffer_ == NULL)
-    {
-      *ppsTargetTxBuffer_ = psNewMessage;
-    }
-
-    /* Add the message to the end of the list */
-    else
+    /* A slot is always available here, but the arena may not have room for the payload */
+    psSlot = MessageSlotAllocate(u32CurrentMessageSize);
+    if(psSlot == NULL)
     {
-      /* Find the last node */
-      psListParser = *ppsTargetTxBuffer_;
-      while(psListParser->psNextMessage != NULL)
+      /* Give back the pieces newest first so the arena can take the space straight back */
+      while(psPieces != NULL)
       {
-        psListParser = psListParser->psNextMessage;
+        psMessage = psPieces;
+        psPieces = psPieces->psNextMessage;
+        MessageSlotFree(MessageSlotFind(psMessage));
       }
-     
-      /* Found the end: add the new node */
-      psListParser->psNextMessage = psNewMessage;
+      
+      G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_FULL;
+      Msg_sStats.u32FullRejections++;
+      return(0);
     }
-
-    /* Safe to re-enable interrupts */
-    __enable_irq();
-
-    /* Update the Public status of the message in the status queue */
-    AddNewMessageStatus(Msg_u32Token);
-  
-    /* Increment message token and catch the rollover every 4 billion messages... Token 0 is not allowed. */
-    Msg_u32Token++;
-    if(Msg_u32Token == 0)
+    
+    /* Add the data into the payload */
+    psSlot->Message.u32Size = u32CurrentMessageSize;
+    for(u32 i = 0; i < u32CurrentMessageSize; i++)
     {
-      Msg_u32Token = 1;
+      *(psSlot->Message.pu8Data + i) = *pu8MessageData_;
+      pu8MessageData_++;
     }
+    u32BytesRemaining -= u32CurrentMessageSize;
+    
+    psSlot->Message.u8Priority = (u8)ePriority_;
+    psSlot->Message.u8Continuation = (psPieces != NULL) ? 1 : 0;
+    psSlot->Message.psNextMessage = psPieces;
+    psPieces = &psSlot->Message;
       
   } /* end while */
 
+  /* Reverse the pieces so they are linked in order and the message processor will send the 
+  bytes continuously across slots */
+  psMessage = NULL;
+  while(psPieces != NULL)
+  {
+    psNext = psPieces->psNextMessage;
+    psPieces->psNextMessage = psMessage;
+    psMessage = psPieces;
+    psPieces = psNext;
+  }
+  
+  while(psMessage != NULL)
+  {
+    psNext = psMessage->psNextMessage;
+    u32Token = MessageLink(psTargetQueue_, psMessage);
+    psMessage = psNext;
+  }
+
   /* Return only the current (and highest) message token, as it will be the last portion to be sent if the message was split up */
-  return(psNewMessage->u32Token);
+  return(u32Token);
   
 } /* end QueueMessage() */
 
 
 /*!--------------------------------------------------------------------------------------------------------------------
-@fn void DeQueueMessage(MessageType** pTargetQueue_)
+@fn u32 CommitMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Size_)
 
-@brief Removes a message from a message queue and adds it back to the pool.
+@brief Queues a message that was loaned with ReserveMessage() and filled in place.
 
 Requires:
-- The message to be removed has been completely sent and is no longer in use
-- New message cannot be added into the list during this function (via interrupts)
-
-@param  pTargetQueue_ is a FIFO linked-list where the message that needs to be killed is at the front of the list
+@param  psTargetQueue_ is the peripheral transmit queue where the message will be queued
+@param  psMessage_ is a message returned by ReserveMessage() that has not been committed or released
+@param  u32Size_ is the number of bytes written to psMessage_->pu8Data (1 to U16_MAX_TX_MESSAGE_LENGTH)
 
 Promises:
-- The first message in the list is deleted; the list is hooked back up
-- The message space is added back to the available message queue
+- The message is linked at the tail of the target queue and its token is returned
+- Returns 0 and leaves the loan with the caller if the message or size is not valid
 
 */
-void DeQueueMessage(MessageType** pTargetQueue_)
+u32 CommitMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Size_)
 {
-  MessageSlotType *psSlotParser;
-      
-  /* Make sure there is a message to kill */
-  if(*pTargetQueue_ == NULL)
-  {
-    G_u32MessagingFlags |= _DEQUEUE_GOT_NULL;
-    return;
-  }
+  MessageSlotType* psSlot = MessageSlotFind(psMessage_);
   
-  /* Find the message's slot: this message pool is non-circular and the message must be one of the slots */
-  psSlotParser = &Msg_asPool[0];
-  while( (&psSlotParser->Message != *pTargetQueue_) && 
-         (psSlotParser != &Msg_asPool[U8_TX_QUEUE_SIZE]) )
-  {
-    psSlotParser++;
-  }
-
-  /* Make sure the message has been found */
-  if(psSlotParser == &Msg_asPool[U8_TX_QUEUE_SIZE])
+  /* Only a reserved message (no token yet) with a valid size can be committed */
+  if( (psSlot == NULL) || (psMessage_->u32Token != 0) ||
+      (u32Size_ == 0) || (u32Size_ > (u32)U16_MAX_TX_MESSAGE_LENGTH) )
   {
-    G_u32MessagingFlags |= _DEQUEUE_MSG_NOT_FOUND;
-    return;
+    return(0);
   }
-
-  /* Unhook the message from the current owner's queue and put it back in the pool */
-  *pTargetQueue_ = (*pTargetQueue_)->psNextMessage;
-  psSlotParser->bFree = TRUE;
-  Msg_u8QueuedMessageCount--;
   
-} /* end DeQueueMessage() */
+  psMessage_->u32Size = u32Size_;
+#ifdef EIE_MSG_ARENA
+  MessageArenaTrim(psMessage_->pu8Data, u32Size_);
+#endif
+  return( MessageLink(psTargetQueue_, psMessage_) );
+  
+} /* end CommitMessage() */
 
 
 /*!--------------------------------------------------------------------------------------------------------------------
-@fn void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_)
+@fn u32 QueueMessageNoCopy(MessageQueueType* psTargetQueue_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
 
-@brief Changes the status of a message in the statue queue.
+@brief Queues a message that is sent directly from the caller's buffer.
+
+A pool slot is still used to track the message (but no arena space), but the payload is not copied and may be longer
+than U16_MAX_TX_MESSAGE_LENGTH.  The caller must not change or reuse the buffer until the callback
+runs (or until the message status is COMPLETE, TIMEOUT, ABANDONED or FAILED if no callback is given).
 
 Requires:
-@param u32Token_ is message that should be in the status queue
-@param eNewState_ is the desired status setting for the message
+@param  psTargetQueue_ is the peripheral transmit queue where the message will be queued
+@param  u32Size_ is the number of bytes to send (1 to U16_MAX_NO_COPY_MESSAGE_LENGTH)
+@param  pu8Data_ points to the data, which must stay valid until the message is finished
+@param  pfnCallback_ is called when the message is dequeued; it runs in the context that dequeues
+        the message (usually the peripheral ISR) so it must be short; may be NULL
 
 Promises:
-- if the token is found, the eState of the message is set to eNewState_
+- The message is linked at the tail of the target queue and its token is returned
+- Returns 0 if the pool is full (_MESSAGING_TX_QUEUE_FULL is set) or the size is not valid
 
 */
-void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_)
+u32 QueueMessageNoCopy(MessageQueueType* psTargetQueue_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
 {
-  MessageStatusType* pListParser = &Msg_asStatusQueue[0];
+  MessageSlotType* psSlot;
   
-  /* Search for the token */
-  while( (pListParser->u32Token != u32Token_) && (pListParser != &Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE]) )
+  if( (u32Size_ == 0) || (u32Size_ > (u32)U16_MAX_NO_COPY_MESSAGE_LENGTH) || (pu8Data_ == NULL) )
   {
-    pListParser++;
+    return(0);
   }
-
-  /* If the token was found, change the status */
-  if(pListParser != &Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE])
+  
+  psSlot = MessageSlotAllocate(0);
+  if(psSlot == NULL)
   {
-    pListParser->eState = eNewState_;
+    G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_FULL;
+    Msg_sStats.u32FullRejections++;
+    return(0);
   }
   
-} /* end UpdateMessageStatus() */
-
+  psSlot->Message.u32Size = u32Size_;
+  psSlot->Message.pu8Data = pu8Data_;
+  psSlot->Message.pfnCallback = pfnCallback_;
+  
+  return( MessageLink(psTargetQueue_, &psSlot->Message) );
+  
+} /* end QueueMessageNoCopy() */
 
-/*------------------------------------------------------------------------------------------------------------------*/
-/*! @privatesection */                                                                                            
-/*--------------------------------------------------------------------------------------------------------------------*/
 
 /*!--------------------------------------------------------------------------------------------------------------------
-@fn static void AddNewMessageStatus(u32 u32Token_)
+@fn void DeQueueMessage(MessageQueueType* psTargetQueue_)
 
-@brief Adds a new message into the message status queue.  
+@brief Removes a message from a message queue and adds it back to the pool.
 
-Due to the tendency of applications to forget that they wrote a message here, 
-this buffer is circular and will overwrite the oldest message if it needs space for a 
-new message.
+The slot is found from the message address, so this takes the same time regardless of the
+pool size.  If the message has a completion callback, it is called after the slot is freed.
+The time since the message was queued is added to the latency counters of its priority.
 
 Requires:
-- Msg_psNextStatus points to the next status location
+- The message to be removed has been completely sent and is no longer in use
+- New message cannot be added into the list during this function (via interrupts)
+
+@param  psTargetQueue_ is a FIFO queue where the message that needs to be killed is at the front of the list
+
+Promises:
+- The first message in the list is deleted; the list is hooked back up
+- The message space is added back to the free list
+- The message's callback (if any) is called with its token and current status
+
+*/
+void DeQueueMessage(MessageQueueType* psTargetQueue_)
+{
+  MessageSlotType *psSlot;
+  MessageType *psMessage = psTargetQueue_->psHead;
+  MessageCallbackType pfnCallback;
+  MessageStatusType* psStatus;
+  MessagePriorityStatsType* psPriorityStats;
+  u32 u32Token;
+  u32 u32Latency;
+      
+  /* Make sure there is a message to kill */
+  if(psMessage == NULL)
+  {
+    G_u32MessagingFlags |= _DEQUEUE_GOT_NULL;
+    return;
+  }
+  
+  /* The message must be the payload of one of the slots in the pool */
+  psSlot = MessageSlotFind(psMessage);
+  if(psSlot == NULL)
+  {
+    G_u32MessagingFlags |= _DEQUEUE_MSG_NOT_FOUND;
+    return;
+  }
+
+  /* Keep what the callback needs since the slot can be reused as soon as it is freed */
+  pfnCallback = psMessage->pfnCallback;
+  u32Token = psMessage->u32Token;
+
+  /* Unhook the message from the current owner's queue and put it back in the pool */
+  __disable_irq();
+  psTargetQueue_->psHead = psMessage->psNextMessage;
+  if(psTargetQueue_->psHead == NULL)
+  {
+    psTargetQueue_->psTail = NULL;
+  }
+  if(psTargetQueue_->psPriorityTail == psMessage)
+  {
+    psTargetQueue_->psPriorityTail = NULL;
+  }
+  
+  /* A message the peripheral loaded early is always the one right after the head */
+  psTargetQueue_->psNextStarted = NULL;
+  
+  u32Latency = G_u32SystemTime1ms - psMessage->u32QueuedTime;
+  psPriorityStats = &Msg_asPriorityStats[psMessage->u8Priority];
+  psPriorityStats->u32Sent++;
+  psPriorityStats->u32TotalLatency += u32Latency;
+  if(u32Latency > psPriorityStats->u32MaxLatency)
+  {
+    psPriorityStats->u32MaxLatency = u32Latency;
+  }
+  Msg_sStats.u32Dequeues++;
+  __enable_irq();
+  
+  MessageSlotFree(psSlot);
+  
+  if(pfnCallback != NULL)
+  {
+    psStatus = MessageStatusEntry(u32Token);
+    pfnCallback(u32Token, (psStatus->u32Token == u32Token) ? psStatus->eState : NOT_FOUND);
+  }
+  
+} /* end DeQueueMessage() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn MessageType* StartNextMessage(MessageQueueType* psTargetQueue_, bool bContinuationOnly_)
+
+@brief Hands the message after the one at the front of a queue to a peripheral that will send it
+as soon as the current one finishes (e.g. from the PDC next pointer and counter registers).
+
+Only one message can be started ahead.  It stays in the queue and becomes the head when the 
+current message is dequeued, at which point the peripheral may start the one after it.  
+Can be called from the peripheral ISR.
+
+Requires:
+@param psTargetQueue_ is the peripheral transmit queue whose head is being sent
+@param bContinuationOnly_ is TRUE if only a later piece of the message being sent may be started 
+       (for peripherals where each message is a separate transaction)
+
+Promises:
+- Returns the message after the head with its status set to SENDING and psTargetQueue_->psNextStarted
+  pointing at it, or NULL if there is no such message, one has already been started, or 
+  bContinuationOnly_ is TRUE and the next message is not a continuation
+
+*/
+MessageType* StartNextMessage(MessageQueueType* psTargetQueue_, bool bContinuationOnly_)
+{
+  MessageType* psNext = NULL;
+  
+  __disable_irq();
+  if( (psTargetQueue_->psHead != NULL) && (psTargetQueue_->psNextStarted == NULL) )
+  {
+    psNext = psTargetQueue_->psHead->psNextMessage;
+    if( (psNext != NULL) && bContinuationOnly_ && !psNext->u8Continuation )
+    {
+      psNext = NULL;
+    }
+    psTargetQueue_->psNextStarted = psNext;
+  }
+  __enable_irq();
+  
+  if(psNext != NULL)
+  {
+    UpdateMessageStatus(psNext->u32Token, SENDING);
+  }
+  
+  return(psNext);
+  
+} /* end StartNextMessage() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool ExtendMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Token_, u32 u32Size_)
+
+@brief Adds bytes to the end of a queued no-copy message that has not been started.
+
+The caller writes the new bytes right after the message's current last byte first, then calls this
+to make them part of the message.  Every write merged this way shares the message's token.
+
+Requires:
+@param psTargetQueue_ is the peripheral transmit queue the message was queued on
+@param psMessage_ is a message from QueueMessageNoCopy() on that queue (it may have been sent since)
+@param u32Token_ is the token returned when psMessage_ was queued
+@param u32Size_ is the number of bytes that were written after the end of the message
+
+Promises:
+- If psMessage_ still holds u32Token_, is the last message in psTargetQueue_, is WAITING and was not 
+  started with StartNextMessage(), its u32Size grows by u32Size_ (up to U16_MAX_NO_COPY_MESSAGE_LENGTH),
+  the bytes are counted for the peripheral and TRUE is returned
+- Otherwise nothing changes and FALSE is returned
+
+*/
+bool ExtendMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Token_, u32 u32Size_)
+{
+  MessageStatusType* psStatus = MessageStatusEntry(u32Token_);
+  bool bExtended = FALSE;
+  
+  /* The peripheral ISR can start the message or finish it, so check and grow it with interrupts off */
+  __disable_irq();
+  if( (u32Token_ != 0) && (psMessage_->u32Token == u32Token_) && (psTargetQueue_->psHead != NULL) &&
+      (psTargetQueue_->psTail == psMessage_) && (psTargetQueue_->psNextStarted != psMessage_) &&
+      (psStatus->u32Token == u32Token_) && (psStatus->eState == WAITING) &&
+      ((psMessage_->u32Size + u32Size_) <= (u32)U16_MAX_NO_COPY_MESSAGE_LENGTH) )
+  {
+    psMessage_->u32Size += u32Size_;
+    if(psTargetQueue_->u8PeripheralId < U8_MSG_STATS_PERIPHERALS)
+    {
+      Msg_sStats.au32PeripheralBytes[psTargetQueue_->u8PeripheralId] += u32Size_;
+    }
+    bExtended = TRUE;
+  }
+  __enable_irq();
+  
+  return(bExtended);
+  
+} /* end ExtendMessage() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_)
+
+@brief Changes the status of a message in the statue queue.
+
+Requires:
+@param u32Token_ is message that should be in the status queue
+@param eNewState_ is the desired status setting for the message
+
+Promises:
+- if the token is found, the eState of the message is set to eNewState_ and the status is time-stamped
+- a change from WAITING to SENDING or from SENDING to COMPLETE is added to the latency statistics
+- if eNewState_ is final and a callback was registered with MessageSetCallback(), the callback is 
+  removed and called; a COMPLETE, TIMEOUT or ABANDONED status is then cleared as if QueryMessageStatus() 
+  had collected it
+
+*/
+void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_)
+{
+  MessageStatusType* pListParser = MessageStatusEntry(u32Token_);
+  MessageCallbackType pfnCallback = NULL;
+  
+  /* If the token is still in its entry, change the status */
+  __disable_irq();
+  if( (u32Token_ != 0) && (pListParser->u32Token == u32Token_) )
+  {
+    if( (pListParser->eState == WAITING) && (eNewState_ == SENDING) )
+    {
+      MessageLatencyRecord(&Msg_sStats.sWaitingToSending, G_u32SystemTime1ms - pListParser->u32Timestamp);
+    }
+    else if( (pListParser->eState == SENDING) && (eNewState_ == COMPLETE) )
+    {
+      MessageLatencyRecord(&Msg_sStats.sSendingToComplete, G_u32SystemTime1ms - pListParser->u32Timestamp);
+    }
+    
+    pListParser->eState = eNewState_;
+    pListParser->u32Timestamp = G_u32SystemTime1ms;
+    
+    /* Hand a final state to the registered callback, which collects the status */
+    if( MessageStateIsFinal(eNewState_) && (pListParser->pfnCallback != NULL) )
+    {
+      pfnCallback = pListParser->pfnCallback;
+      pListParser->pfnCallback = NULL;
+      if(eNewState_ != FAILED)
+      {
+        pListParser->u32Token = 0;
+        pListParser->eState = EMPTY;
+      }
+    }
+  }
+  __enable_irq();
+  
+  /* The callback runs with interrupts enabled since it may queue another message */
+  if(pfnCallback != NULL)
+  {
+    pfnCallback(u32Token_, eNewState_);
+  }
+  
+} /* end UpdateMessageStatus() */
+
+
+/*------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */                                                                                            
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static MessageSlotType* MessageSlotAllocate(u32 u32PayloadSize_)
+
+@brief Takes a slot from the free list and prepares its message for a new payload.
+
+Interrupts are disabled while the free list is changed since DeQueueMessage() returns slots
+from interrupt context.
+
+Requires:
+@param u32PayloadSize_ is the number of payload bytes needed (0 for a no-copy message); 
+       without EIE_MSG_ARENA every slot has U16_MAX_TX_MESSAGE_LENGTH bytes and this is ignored
+
+Promises:
+- Returns a slot that is no longer free with a cleared message (u32Token is 0 until it is
+  linked and pu8Data points at the pooled payload, or is NULL for a no-copy message with 
+  EIE_MSG_ARENA), or NULL if there are no free slots or no room in the arena
+- The queue high watermark flag is updated
+
+*/
+static MessageSlotType* MessageSlotAllocate(u32 u32PayloadSize_)
+{
+  MessageSlotType* psSlot;
+  u32 u32BytesInUse;
+  
+  __disable_irq();
+  psSlot = Msg_psFreeSlots;
+  if(psSlot != NULL)
+  {
+    Msg_psFreeSlots = psSlot->psNextFreeSlot;
+    Msg_u8QueuedMessageCount++;
+    if(Msg_u8QueuedMessageCount > Msg_sStats.u32PeakQueuedMessages)
+    {
+      Msg_sStats.u32PeakQueuedMessages = Msg_u8QueuedMessageCount;
+    }
+  }
+  __enable_irq();
+
+  if(psSlot == NULL)
+  {
+    return(NULL);
+  }
+  
+  psSlot->bFree = FALSE;
+  psSlot->psNextFreeSlot = NULL;
+  psSlot->Message.u32Token = 0;
+  psSlot->Message.u32Size = 0;
+  psSlot->Message.pfnCallback = NULL;
+  psSlot->Message.u8Priority = (u8)MSG_PRIORITY_NORMAL;
+  psSlot->Message.u8Continuation = 0;
+  psSlot->Message.psNextMessage = NULL;
+
+#ifdef EIE_MSG_ARENA
+  psSlot->Message.pu8Data = NULL;
+  if(u32PayloadSize_ != 0)
+  {
+    psSlot->Message.pu8Data = MessageArenaAllocate(u32PayloadSize_);
+    if(psSlot->Message.pu8Data == NULL)
+    {
+      MessageSlotFree(psSlot);
+      return(NULL);
+    }
+  }
+#else
+  psSlot->Message.pu8Data = psSlot->Message.pu8Message;
+#endif
+  
+  /* Flag if we're above the high watermark */
+  u32BytesInUse = MessagePoolBytesInUse();
+#ifdef EIE_MSG_ARENA
+  if( (Msg_u8QueuedMessageCount >= U8_TX_QUEUE_WATERMARK) ||
+      ((U16_MSG_ARENA_SIZE - u32BytesInUse) < U16_MSG_ARENA_LOW_WATER) )
+#else
+  if(Msg_u8QueuedMessageCount >= U8_TX_QUEUE_WATERMARK)
+#endif
+  {
+    G_u32MessagingFlags |= _MESSAGING_TX_QUEUE_ALMOST_FULL;
+  }
+  else
+  {
+    G_u32MessagingFlags &= ~_MESSAGING_TX_QUEUE_ALMOST_FULL;
+  }
+
+  if(u32BytesInUse > Msg_u32PeakBytesInUse)
+  {
+    Msg_u32PeakBytesInUse = u32BytesInUse;
+  }
+  
+  return(psSlot);
+  
+} /* end MessageSlotAllocate() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageSlotFree(MessageSlotType* psSlot_)
+
+@brief Puts a slot back on the free list and releases its arena space.
+
+Requires:
+@param psSlot_ is an allocated slot that is not linked into any queue
+
+Promises:
+- The slot is free and at the front of the free list
+- A linked message is no longer counted in the pool and priority statistics
+
+*/
+static void MessageSlotFree(MessageSlotType* psSlot_)
+{
+  if(psSlot_->Message.u32Token != 0)
+  {
+    MessageTrackPayload(&psSlot_->Message, FALSE);
+  }
+  
+#ifdef EIE_MSG_ARENA
+  if(MessagePayloadIsPooled(&psSlot_->Message))
+  {
+    MessageArenaFree(psSlot_->Message.pu8Data);
+  }
+  psSlot_->Message.pu8Data = NULL;
+#endif
+  
+  __disable_irq();
+  if(psSlot_->Message.u32Token != 0)
+  {
+    Msg_asPriorityStats[psSlot_->Message.u8Priority].u32Queued--;
+  }
+  psSlot_->bFree = TRUE;
+  psSlot_->psNextFreeSlot = Msg_psFreeSlots;
+  Msg_psFreeSlots = psSlot_;
+  Msg_u8QueuedMessageCount--;
+  __enable_irq();
+  
+} /* end MessageSlotFree() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static MessageSlotType* MessageSlotFind(MessageType* psMessage_)
+
+@brief Returns the allocated slot that holds a message.
+
+Requires:
+@param psMessage_ is the message of interest
+
+Promises:
+- Returns the slot if psMessage_ is the message of an allocated slot in Msg_asPool; otherwise NULL
+
+*/
+static MessageSlotType* MessageSlotFind(MessageType* psMessage_)
+{
+  MessageSlotType *psSlot;
+  u32 u32Offset;
+  
+  if( (u8*)psMessage_ < (u8*)&Msg_asPool[0].Message )
+  {
+    return(NULL);
+  }
+  
+  u32Offset = (u32)((u8*)psMessage_ - (u8*)&Msg_asPool[0].Message);
+  if(u32Offset >= sizeof(Msg_asPool))
+  {
+    return(NULL);
+  }
+  
+  psSlot = &Msg_asPool[u32Offset / sizeof(MessageSlotType)];
+  if( (&psSlot->Message != psMessage_) || psSlot->bFree )
+  {
+    return(NULL);
+  }
+  
+  return(psSlot);
+  
+} /* end MessageSlotFind() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static bool MessagePayloadIsPooled(MessageType* psMessage_)
+
+@brief Checks whether a message's payload is stored in the pool (not a no-copy message).
+
+Requires:
+@param psMessage_ is an allocated message
+
+Promises:
+- Returns TRUE if pu8Data points at the slot's own array or into the arena
+
+*/
+static bool MessagePayloadIsPooled(MessageType* psMessage_)
+{
+#ifdef EIE_MSG_ARENA
+  u8* pu8Arena = (u8*)Msg_au32Arena;
+  
+  if( (psMessage_->pu8Data >= pu8Arena) && (psMessage_->pu8Data < (pu8Arena + U16_MSG_ARENA_SIZE)) )
+#else
+  if(psMessage_->pu8Data == psMessage_->pu8Message)
+#endif
+  {
+    return(TRUE);
+  }
+  
+  return(FALSE);
+  
+} /* end MessagePayloadIsPooled() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageTrackPayload(MessageType* psMessage_, bool bAdd_)
+
+@brief Adds or removes a queued message's bytes from the pool statistics.
+
+Requires:
+@param psMessage_ is a message with its final u32Size
+@param bAdd_ is TRUE when the message is linked and FALSE when it is freed
+
+Promises:
+- Msg_u32PayloadBytes includes the payload of every linked pooled message
+- Msg_u32PeakFragmentedBytes is updated when a message is added
+
+*/
+static void MessageTrackPayload(MessageType* psMessage_, bool bAdd_)
+{
+  u32 u32Fragmented;
+  
+  if(!MessagePayloadIsPooled(psMessage_))
+  {
+    return;
+  }
+  
+  __disable_irq();
+  if(bAdd_)
+  {
+    Msg_u32PayloadBytes += psMessage_->u32Size;
+    u32Fragmented = MessagePoolBytesInUse() - Msg_u32PayloadBytes;
+    if(u32Fragmented > Msg_u32PeakFragmentedBytes)
+    {
+      Msg_u32PeakFragmentedBytes = u32Fragmented;
+    }
+  }
+  else
+  {
+    Msg_u32PayloadBytes -= psMessage_->u32Size;
+  }
+  __enable_irq();
+  
+} /* end MessageTrackPayload() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u32 MessagePoolBytesInUse(void)
+
+@brief Returns the payload storage currently allocated.
+
+Requires:
+- NONE
+
+Promises:
+- Returns the arena bytes between the oldest and newest blocks with EIE_MSG_ARENA, 
+  otherwise the size of all occupied slot arrays
+
+*/
+static u32 MessagePoolBytesInUse(void)
+{
+#ifdef EIE_MSG_ARENA
+  return(Msg_u32ArenaUsed);
+#else
+  return((u32)Msg_u8QueuedMessageCount * U16_MAX_TX_MESSAGE_LENGTH);
+#endif
+  
+} /* end MessagePoolBytesInUse() */
+
+
+#ifdef EIE_MSG_ARENA
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u8* MessageArenaAllocate(u32 u32Size_)
+
+@brief Takes a block for a payload from the head of the arena ring.
+
+The block goes at the head if it fits before the end of the ring.  Otherwise the rest of the ring
+is filled with a skip block and the payload goes at the start, if it fits before the tail.
+This never searches, so the time with interrupts off is constant.
+
+Requires:
+@param u32Size_ is the number of payload bytes (1 to U16_MSG_ARENA_SIZE - 4)
+
+Promises:
+- Returns a 4-byte aligned pointer to u32Size_ bytes, or NULL if there is no room
+
+*/
+static u8* MessageArenaAllocate(u32 u32Size_)
+{
+  u8* pu8Arena = (u8*)Msg_au32Arena;
+  MessageArenaBlockType* psBlock;
+  u32 u32Length = ((u32Size_ + 3) & ~(u32)3) + sizeof(MessageArenaBlockType);
+  u32 u32Offset = U16_MSG_ARENA_SIZE;
+  
+  __disable_irq();
+  
+  if(Msg_u32ArenaUsed == 0)
+  {
+    /* Start over at the beginning so the whole ring is one piece */
+    Msg_u32ArenaHead = 0;
+    Msg_u32ArenaTail = 0;
+  }
+  
+  if( (Msg_u32ArenaUsed == 0) || (Msg_u32ArenaHead > Msg_u32ArenaTail) )
+  {
+    /* Free space is from the head to the end and from the start to the tail */
+    if(u32Length <= (U16_MSG_ARENA_SIZE - Msg_u32ArenaHead))
+    {
+      u32Offset = Msg_u32ArenaHead;
+    }
+    else if(u32Length <= Msg_u32ArenaTail)
+    {
+      psBlock = (MessageArenaBlockType*)(pu8Arena + Msg_u32ArenaHead);
+      psBlock->u16Length = (u16)(U16_MSG_ARENA_SIZE - Msg_u32ArenaHead);
+      psBlock->u16InUse = 0;
+      Msg_u32ArenaUsed += psBlock->u16Length;
+      u32Offset = 0;
+    }
+  }
+  else if(Msg_u32ArenaHead < Msg_u32ArenaTail)
+  {
+    /* The ring has wrapped: free space is between the head and the tail */
+    if(u32Length <= (Msg_u32ArenaTail - Msg_u32ArenaHead))
+    {
+      u32Offset = Msg_u32ArenaHead;
+    }
+  }
+  /* Otherwise the head has caught up with the tail and the ring is full */
+  
+  if(u32Offset == U16_MSG_ARENA_SIZE)
+  {
+    __enable_irq();
+    return(NULL);
+  }
+  
+  psBlock = (MessageArenaBlockType*)(pu8Arena + u32Offset);
+  psBlock->u16Length = (u16)u32Length;
+  psBlock->u16InUse = 1;
+  Msg_u32ArenaUsed += u32Length;
+  Msg_u32ArenaHead = u32Offset + u32Length;
+  if(Msg_u32ArenaHead == U16_MSG_ARENA_SIZE)
+  {
+    Msg_u32ArenaHead = 0;
+  }
+  
+  __enable_irq();
+  
+  return( (u8*)(psBlock + 1) );
+  
+} /* end MessageArenaAllocate() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageArenaFree(u8* pu8Payload_)
+
+@brief Frees an arena block and reclaims all free blocks at the tail of the ring.
+
+The newest block (e.g. a piece of a message that could not be queued) is given straight back to
+the head.  Any other block stays in the ring until every block in front of it is also free; the
+number of blocks reclaimed at once is limited by U8_TX_QUEUE_SIZE.
+
+Requires:
+@param pu8Payload_ was returned by MessageArenaAllocate() and has not been freed
+
+Promises:
+- The block is free and the tail has moved past every free block at the front of the ring
 
+*/
+static void MessageArenaFree(u8* pu8Payload_)
+{
+  u8* pu8Arena = (u8*)Msg_au32Arena;
+  MessageArenaBlockType* psBlock = (MessageArenaBlockType*)pu8Payload_ - 1;
+  u32 u32Offset = (u32)((u8*)psBlock - pu8Arena);
+  u32 u32End = u32Offset + psBlock->u16Length;
+  
+  if(u32End == U16_MSG_ARENA_SIZE)
+  {
+    u32End = 0;
+  }
+  
+  __disable_irq();
+  
+  psBlock->u16InUse = 0;
+  if(u32End == Msg_u32ArenaHead)
+  {
+    Msg_u32ArenaHead = u32Offset;
+    Msg_u32ArenaUsed -= psBlock->u16Length;
+  }
+  
+  while(Msg_u32ArenaUsed != 0)
+  {
+    psBlock = (MessageArenaBlockType*)(pu8Arena + Msg_u32ArenaTail);
+    if(psBlock->u16InUse)
+    {
+      break;
+    }
+    
+    Msg_u32ArenaUsed -= psBlock->u16Length;
+    Msg_u32ArenaTail += psBlock->u16Length;
+    if(Msg_u32ArenaTail == U16_MSG_ARENA_SIZE)
+    {
+      Msg_u32ArenaTail = 0;
+    }
+  }
+  
+  __enable_irq();
+  
+} /* end MessageArenaFree() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageArenaTrim(u8* pu8Payload_, u32 u32Size_)
+
+@brief Gives back the unused end of the newest arena block (a committed ReserveMessage() loan).
+
+Requires:
+@param pu8Payload_ was returned by MessageArenaAllocate() and has not been freed
+@param u32Size_ is the number of payload bytes that are actually used
+
+Promises:
+- If the block is still the newest one, it is shortened to fit u32Size_; otherwise nothing changes
+
+*/
+static void MessageArenaTrim(u8* pu8Payload_, u32 u32Size_)
+{
+  MessageArenaBlockType* psBlock = (MessageArenaBlockType*)pu8Payload_ - 1;
+  u32 u32Offset = (u32)((u8*)psBlock - (u8*)Msg_au32Arena);
+  u32 u32Length = ((u32Size_ + 3) & ~(u32)3) + sizeof(MessageArenaBlockType);
+  u32 u32End = u32Offset + psBlock->u16Length;
+  
+  if(u32End == U16_MSG_ARENA_SIZE)
+  {
+    u32End = 0;
+  }
+  
+  __disable_irq();
+  
+  if( (u32End == Msg_u32ArenaHead) && (u32Length < psBlock->u16Length) )
+  {
+    Msg_u32ArenaUsed -= psBlock->u16Length - u32Length;
+    psBlock->u16Length = (u16)u32Length;
+    Msg_u32ArenaHead = u32Offset + u32Length;
+  }
+  
+  __enable_irq();
+  
+} /* end MessageArenaTrim() */
+#endif /* EIE_MSG_ARENA */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u32 MessageLink(MessageQueueType* psTargetQueue_, MessageType* psMessage_)
+
+@brief Assigns the next token to a filled message and links it into a transmit queue.
+
+A normal message goes at the tail.  A high priority message goes after the last high priority
+message, or after the message at the front (or the one started with it) if there is none, but 
+never between two pieces of a message that QueueMessage() split.  The pieces to skip are only those of one message, so the
+time with interrupts off stays short.
+
+Requires:
+@param psTargetQueue_ is the peripheral transmit queue
+@param psMessage_ is an allocated message with its size, data and priority set
+
+Promises:
+- The message has a new token with a WAITING status and is linked into psTargetQueue_ according to its priority
+- The enqueue and the message size are counted in Msg_sStats
+- Returns the token
+
+*/
+static u32 MessageLink(MessageQueueType* psTargetQueue_, MessageType* psMessage_)
+{
+  MessageType* psPrevious;
+  MessagePriorityStatsType* psPriorityStats;
+  u32 u32Token;
+  
+  /* Take the next token and catch the rollover every 4 billion messages... Token 0 is not allowed.  
+  Interrupts are off since a completion callback may queue a message from an ISR. */
+  __disable_irq();
+  u32Token = Msg_u32Token;
+  Msg_u32Token++;
+  if(Msg_u32Token == 0)
+  {
+    Msg_u32Token = 1;
+  }
+  __enable_irq();
+  
+  psMessage_->u32Token = u32Token;
+  psMessage_->u32QueuedTime = G_u32SystemTime1ms;
+  psMessage_->psQueue = psTargetQueue_;
+  psMessage_->psNextMessage = NULL;
+  MessageTrackPayload(psMessage_, TRUE);
+  
+  /* Post the status first so the peripheral can update it as soon as the message is visible */
+  AddNewMessageStatus(u32Token);
+
+  /* Link the new message into the client's transmit queue.  This must happen
+  with interrupts off since other functions can operate on the transmit queue. */
+  __disable_irq();
+  
+  if(psTargetQueue_->psHead == NULL)
+  {
+    psTargetQueue_->psHead = psMessage_;
+    psTargetQueue_->psTail = psMessage_;
+    psTargetQueue_->psPriorityTail = NULL;
+    psTargetQueue_->psNextStarted = NULL;
+  }
+  else if(psMessage_->u8Priority == (u8)MSG_PRIORITY_HIGH)
+  {
+    psPrevious = psTargetQueue_->psPriorityTail;
+    if(psPrevious == NULL)
+    {
+      psPrevious = psTargetQueue_->psNextStarted;
+    }
+    if(psPrevious == NULL)
+    {
+      psPrevious = psTargetQueue_->psHead;
+    }
+    
+    /* Skip the rest of a split message */
+    while( (psPrevious->psNextMessage != NULL) && 
+           ((MessageType*)psPrevious->psNextMessage)->u8Continuation )
+    {
+      psPrevious = psPrevious->psNextMessage;
+    }
+    
+    psMessage_->psNextMessage = psPrevious->psNextMessage;
+    psPrevious->psNextMessage = psMessage_;
+    if(psTargetQueue_->psTail == psPrevious)
+    {
+      psTargetQueue_->psTail = psMessage_;
+    }
+    psTargetQueue_->psPriorityTail = psMessage_;
+  }
+  else
+  {
+    psTargetQueue_->psTail->psNextMessage = psMessage_;
+    psTargetQueue_->psTail = psMessage_;
+  }
+  
+  psPriorityStats = &Msg_asPriorityStats[psMessage_->u8Priority];
+  psPriorityStats->u32Queued++;
+  if(psPriorityStats->u32Queued > psPriorityStats->u32PeakQueued)
+  {
+    psPriorityStats->u32PeakQueued = psPriorityStats->u32Queued;
+  }
+  
+  Msg_sStats.u32Enqueues++;
+  if(psTargetQueue_->u8PeripheralId < U8_MSG_STATS_PERIPHERALS)
+  {
+    Msg_sStats.au32PeripheralBytes[psTargetQueue_->u8PeripheralId] += psMessage_->u32Size;
+  }
+
+  /* Safe to re-enable interrupts */
+  __enable_irq();
+  
+  return(u32Token);
+  
+} /* end MessageLink() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static MessageStatusType* MessageStatusEntry(u32 u32Token_)
+
+@brief Returns the status queue entry that a token maps to.
+
+Requires:
+@param u32Token_ is the token of the message of interest
+
+Promises:
+- Returns a pointer into Msg_asStatusQueue; the caller must check that the entry's u32Token
+  matches since a newer token may have replaced it
+
+*/
+static MessageStatusType* MessageStatusEntry(u32 u32Token_)
+{
+  return( &Msg_asStatusQueue[u32Token_ % U16_STATUS_QUEUE_SIZE] );
+  
+} /* end MessageStatusEntry() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void AddNewMessageStatus(u32 u32Token_)
+
+@brief Adds a new message into the message status queue.  
+
+Due to the tendency of applications to forget that they wrote a message here, 
+the entry a token maps to is simply overwritten.  Since tokens are sequential, the status
+that is replaced is the one from U16_STATUS_QUEUE_SIZE messages ago.
+
+Requires:
 @param u32Token_ is the token of the message of interest
 
 Promises:
-- A new status is created at Msg_psNextStatus indexed by u32Token_
+- A new status is created at the entry for u32Token_
+- G_u32MessagingStatusEvictions is incremented if the entry held a status that was never
+  cleared by QueryMessageStatus()
+- If the replaced status still had a callback registered, it is called with NOT_FOUND
 
 */
 static void AddNewMessageStatus(u32 u32Token_)
 {
+  MessageStatusType* psStatus = MessageStatusEntry(u32Token_);
+  MessageCallbackType pfnEvicted;
+  u32 u32EvictedToken;
+  
+  __disable_irq();
+  
+  /* Count statuses that the owner never picked up */
+  u32EvictedToken = psStatus->u32Token;
+  pfnEvicted = psStatus->pfnCallback;
+  if(u32EvictedToken != 0)
+  {
+    G_u32MessagingStatusEvictions++;
+  }
+  
   /* Install the new message */
-  Msg_psNextStatus->u32Token = u32Token_;
-  Msg_psNextStatus->eState = WAITING;
-  Msg_psNextStatus->u32Timestamp = G_u32SystemTime1ms;
+  psStatus->u32Token = u32Token_;
+  psStatus->eState = WAITING;
+  psStatus->u32Timestamp = G_u32SystemTime1ms;
+  psStatus->pfnCallback = NULL;
+  
+  __enable_irq();
   
-  /* Safely advance the pointer */
-  Msg_psNextStatus++;
-  if(Msg_psNextStatus == &Msg_asStatusQueue[U8_STATUS_QUEUE_SIZE])
+  /* The old owner will never get a final state now */
+  if( (u32EvictedToken != 0) && (pfnEvicted != NULL) )
   {
-    Msg_psNextStatus = &Msg_asStatusQueue[0];
+    pfnEvicted(u32EvictedToken, NOT_FOUND);
   }
   
 } /* end AddNewMessageStatus() */
 
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static bool MessageStateIsFinal(MessageStateType eState_)
+
+@brief Checks if a message state can no longer change.
+
+Requires:
+@param eState_ is the state to check
+
+Promises:
+- Returns TRUE for COMPLETE, TIMEOUT, ABANDONED or FAILED
+
+*/
+static bool MessageStateIsFinal(MessageStateType eState_)
+{
+  return( ((eState_ == COMPLETE) || (eState_ == TIMEOUT) || 
+           (eState_ == ABANDONED) || (eState_ == FAILED)) ? TRUE : FALSE );
+  
+} /* end MessageStateIsFinal() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageLatencyRecord(MessageLatencyStatsType* psLatency_, u32 u32Time_)
+
+@brief Adds one measured time to a latency histogram.
+
+Requires:
+- Interrupts are disabled (the statistics are updated from the peripheral ISRs)
+
+@param psLatency_ is the histogram to update
+@param u32Time_ is the time in ms
+
+Promises:
+- The count, total, min, max and the bin for u32Time_ are updated
+
+*/
+static void MessageLatencyRecord(MessageLatencyStatsType* psLatency_, u32 u32Time_)
+{
+  u8 u8Bin = 0;
+  
+  if( (psLatency_->u32Count == 0) || (u32Time_ < psLatency_->u32Min) )
+  {
+    psLatency_->u32Min = u32Time_;
+  }
+  if(u32Time_ > psLatency_->u32Max)
+  {
+    psLatency_->u32Max = u32Time_;
+  }
+  psLatency_->u32Count++;
+  psLatency_->u32Total += u32Time_;
+  
+  /* Bin n holds 2^(n-1) to 2^n - 1 ms */
+  while( (u32Time_ != 0) && (u8Bin < (U8_MSG_LATENCY_BINS - 1)) )
+  {
+    u32Time_ >>= 1;
+    u8Bin++;
+  }
+  psLatency_->au32Bins[u8Bin]++;
+  
+} /* end MessageLatencyRecord() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static u8* MessageDumpU32(u8* pu8Buffer_, u32 u32Value_)
+
+@brief Writes a value least significant byte first.
+
+Requires:
+@param pu8Buffer_ has room for 4 bytes
+@param u32Value_ is the value to write
+
+Promises:
+- Returns the address after the 4 bytes written
+
+*/
+static u8* MessageDumpU32(u8* pu8Buffer_, u32 u32Value_)
+{
+  for(u8 i = 0; i < 4; i++)
+  {
+    *pu8Buffer_++ = (u8)(u32Value_ >> (8 * i));
+  }
+  
+  return(pu8Buffer_);
+  
+} /* end MessageDumpU32() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageExpire(MessageSlotType* psSlot_)
+
+@brief Removes a message from its queue if it has been WAITING too long.
+
+The message before it is found by walking the queue from the front, which is only done once a 
+message has expired.  The peripheral ISR may dequeue messages at the front during the walk and a
+completion callback may queue a high priority message in front of it, so the message is only 
+unlinked (with interrupts off) if it is still queued, not at the front, and still follows the 
+message the walk found.  Otherwise it is left for the next sweep.
+
+A message split by QueueMessage() only expires as a whole, from its first piece, so a peripheral
+never sends a message with pieces missing.
+
+Requires:
+@param psSlot_ is a slot in Msg_asPool
+
+Promises:
+- If the slot holds the first piece of a queued message that is not at the front of its queue 
+  (or started with StartNextMessage()) and has been WAITING for U32_MSG_STATUS_WAITING_TIME, it 
+  and the rest of its pieces are unlinked; for each piece the status is set to TIMEOUT, the slot
+  is freed, the callback (if any) is called with TIMEOUT and G_u32MessagingTimeouts is incremented
+
+*/
+static void MessageExpire(MessageSlotType* psSlot_)
+{
+  MessageType* psMessage = &psSlot_->Message;
+  MessageQueueType* psQueue;
+  MessageType* psPrevious;
+  MessageType* psLast;
+  MessageType* psNext;
+  MessageStatusType* psStatus;
+  MessageCallbackType pfnCallback;
+  u32 u32Token;
+  bool bPriorityTail = FALSE;
+  
+  /* Only messages that have been queued (a loaned message has no token yet) and are old enough.
+  The later pieces of a split message go with the first one. */
+  u32Token = psMessage->u32Token;
+  if( psSlot_->bFree || (u32Token == 0) || psMessage->u8Continuation ||
+      ((G_u32SystemTime1ms - psMessage->u32QueuedTime) < U32_MSG_STATUS_WAITING_TIME) )
+  {
+    return;
+  }
+  
+  /* A message that has been started is always at the front, but check the status if it is still available */
+  psStatus = MessageStatusEntry(u32Token);
+  if( (psStatus->u32Token == u32Token) && (psStatus->eState != WAITING) )
+  {
+    return;
+  }
+  
+  psQueue = psMessage->psQueue;
+  psPrevious = psQueue->psHead;
+  while( (psPrevious != NULL) && (psPrevious->psNextMessage != psMessage) )
+  {
+    psPrevious = psPrevious->psNextMessage;
+  }
+  
+  /* Not found means the message is at the front */
+  if(psPrevious == NULL)
+  {
+    return;
+  }
+  
+  __disable_irq();
+  if( psSlot_->bFree || (psMessage->u32Token != u32Token) ||
+      (psQueue->psHead == psMessage) || (psQueue->psNextStarted == psMessage) ||
+      (MessageSlotFind(psPrevious) == NULL) || (psPrevious->psQueue != psQueue) || 
+      (psPrevious->psNextMessage != psMessage) )
+  {
+    __enable_irq();
+    return;
+  }
+  
+  /* Take the rest of the message with it */
+  psLast = psMessage;
+  while(TRUE)
+  {
+    if(psQueue->psPriorityTail == psLast)
+    {
+      bPriorityTail = TRUE;
+    }
+    
+    psNext = psLast->psNextMessage;
+    if( (psNext == NULL) || !psNext->u8Continuation )
+    {
+      break;
+    }
+    psLast = psNext;
+  }
+  
+  psPrevious->psNextMessage = psLast->psNextMessage;
+  if(psQueue->psTail == psLast)
+  {
+    psQueue->psTail = psPrevious;
+  }
+  if(bPriorityTail)
+  {
+    /* The priority tail is only ever a message behind the head and the one started after it */
+    if( (psPrevious == psQueue->psHead) || (psPrevious == psQueue->psNextStarted) )
+    {
+      psQueue->psPriorityTail = NULL;
+    }
+    else
+    {
+      psQueue->psPriorityTail = psPrevious;
+    }
+  }
+  __enable_irq();
+  
+  /* The pieces are no longer linked, so each slot can be freed while walking them */
+  while(psMessage != NULL)
+  {
+    psNext = (psMessage == psLast) ? NULL : psMessage->psNextMessage;
+    pfnCallback = psMessage->pfnCallback;
+    u32Token = psMessage->u32Token;
+    
+    UpdateMessageStatus(u32Token, TIMEOUT);
+    MessageSlotFree(MessageSlotFind(psMessage));
+    G_u32MessagingTimeouts++;
+    
+    if(pfnCallback != NULL)
+    {
+      pfnCallback(u32Token, TIMEOUT);
+    }
+    
+    psMessage = psNext;
+  }
+  
+} /* end MessageExpire() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void MessageStatusReap(MessageStatusType* psStatus_)
+
+@brief Clears a final status that its owner has not collected in time.
+
+Requires:
+@param psStatus_ is an entry in Msg_asStatusQueue
+
+Promises:
+- A COMPLETE status older than U32_MSG_STATUS_COMPLETE_TIME or a TIMEOUT, ABANDONED or FAILED 
+  status older than U32_MSG_STATUS_TIMEOUT_TIME is cleared as if QueryMessageStatus() had 
+  collected it (so it is not counted as an eviction)
+
+*/
+static void MessageStatusReap(MessageStatusType* psStatus_)
+{
+  u32 u32Age;
+  bool bStale = FALSE;
+  
+  /* A callback in an ISR can queue a message that takes this entry, so check and clear atomically */
+  __disable_irq();
+  u32Age = G_u32SystemTime1ms - psStatus_->u32Timestamp;
+  switch(psStatus_->eState)
+  {
+    case COMPLETE:
+      bStale = (u32Age >= U32_MSG_STATUS_COMPLETE_TIME) ? TRUE : FALSE;
+      break;
+      
+    case TIMEOUT:
+    case ABANDONED:
+    case FAILED:
+      bStale = (u32Age >= U32_MSG_STATUS_TIMEOUT_TIME) ? TRUE : FALSE;
+      break;
+      
+    default:
+      break;
+  }
+  
+  if(bStale && (psStatus_->u32Token != 0))
+  {
+    psStatus_->u32Token = 0;
+    psStatus_->eState = EMPTY;
+    psStatus_->u32Timestamp = G_u32SystemTime1ms;
+    psStatus_->pfnCallback = NULL;
+  }
+  __enable_irq();
+  
+} /* end MessageStatusReap() */
+
+
 /**********************************************************************************************************************
 State Machine Function Definitions
 **********************************************************************************************************************/
@@ -494,7 +2032,7 @@ State Machine Function Definitions
 /*!-------------------------------------------------------------------------------------------------------------------
 @fn static void MessagingSM_Idle(void)
 
-@brief Right now this doesn't do anything 
+@brief Waits until it is time to sweep the message pool and status queue.
 */
 static void MessagingSM_Idle(void)
 {
@@ -505,12 +2043,42 @@ static void MessagingSM_Idle(void)
   {
     u32CleaningTime = U32_MSG_STATUS_CLEANING_TIME;
     
-    /* ??? Probably should add clean of the main message queue to detect any messages that have become stuck */
+    Msg_u16CleaningIndex = 0;
+    Messaging_pfnStateMachine = MessagingSM_Clean;
   }
     
 } /* end MessagingSM_Idle() */
 
 
+/*!-------------------------------------------------------------------------------------------------------------------
+@fn static void MessagingSM_Clean(void)
+
+@brief Checks the next U8_MSG_CLEANING_STEPS pool slots and status entries for expired messages
+and stale statuses.  Returns to Idle when the whole status queue has been checked.
+*/
+static void MessagingSM_Clean(void)
+{
+  for(u8 i = 0; i < U8_MSG_CLEANING_STEPS; i++)
+  {
+    if(Msg_u16CleaningIndex < U8_TX_QUEUE_SIZE)
+    {
+      MessageExpire(&Msg_asPool[Msg_u16CleaningIndex]);
+    }
+    
+    /* The status queue is always at least as long as the pool */
+    MessageStatusReap(&Msg_asStatusQueue[Msg_u16CleaningIndex]);
+    
+    Msg_u16CleaningIndex++;
+    if(Msg_u16CleaningIndex == U16_STATUS_QUEUE_SIZE)
+    {
+      Messaging_pfnStateMachine = MessagingSM_Idle;
+      break;
+    }
+  }
+    
+} /* end MessagingSM_Clean() */
+
+
 #if 0
 /*-------------------------------------------------------------------------------------------------------------------*/
 /* Handle an error */
@@ -19,20 +19,45 @@ Constants / Definitions
 
 
 /* Tx buffer allocation: be aware of RAM usage when selecting the parameters below.
-Queue size in bytes is U8_TX_QUEUE_SIZE x U16_MAX_TX_MESSAGE_LENGTH */
-#define U16_MAX_TX_MESSAGE_LENGTH       (u16)128       /*!< @brief Max bytes in message payload */
-#define U8_TX_QUEUE_SIZE                (u8)32         /*!< @brief Number of messages allowed in the queue */
+By default every message has its own U16_MAX_TX_MESSAGE_LENGTH payload array, so the queue size in bytes 
+is U8_TX_QUEUE_SIZE x U16_MAX_TX_MESSAGE_LENGTH.  If EIE_MSG_ARENA is defined by the build, payloads are 
+instead packed into a U16_MSG_ARENA_SIZE byte ring and U8_TX_QUEUE_SIZE only sets the number of 
+message descriptors (about 36 bytes each). */
+#define U16_MAX_TX_MESSAGE_LENGTH       (u16)128       /*!< @brief Max bytes in a ReserveMessage() payload (and in a message payload without the arena) */
+#define U16_MAX_NO_COPY_MESSAGE_LENGTH  (u16)0xFFFF    /*!< @brief Max bytes in a QueueMessageNoCopy() message (PDC counter limit) */
+
+#ifdef EIE_MSG_ARENA
+#ifndef U16_MSG_ARENA_SIZE
+#define U16_MSG_ARENA_SIZE              (u16)2048      /*!< @brief Bytes in the payload ring (multiple of 4; may be set by the build) */
+#endif
+#define U16_MSG_ARENA_MAX_MESSAGE       (u16)(U16_MSG_ARENA_SIZE / 4) /*!< @brief QueueMessage() splits payloads larger than this */
+#define U16_MSG_ARENA_LOW_WATER         (u16)(U16_MSG_ARENA_SIZE / 8) /*!< @brief Free ring bytes that will trigger a warning flag */
+#ifndef U8_TX_QUEUE_SIZE
+#define U8_TX_QUEUE_SIZE                (u8)64         /*!< @brief Number of message descriptors (max 255; may be set by the build) */
+#endif
+#endif /* EIE_MSG_ARENA */
+
+#ifndef U8_TX_QUEUE_SIZE
+#define U8_TX_QUEUE_SIZE                (u8)32         /*!< @brief Number of messages allowed in the queue (max 255; may be set by the build) */
+#endif
 #define U8_TX_QUEUE_WATERMARK           (u8)(U8_TX_QUEUE_SIZE - 3) /*!< @brief Number of messages in the queue that will trigger a warning flag */
-#define U8_STATUS_QUEUE_SIZE            (u8)(2 * U8_TX_QUEUE_SIZE) /*!< @brief Number of message statuses to maintain */
+#define U16_STATUS_QUEUE_SIZE           (u16)(2 * U8_TX_QUEUE_SIZE) /*!< @brief Number of message statuses to maintain */
+
 
+/* Time-to-live limits enforced by MessagingSM_Idle() */
+#define U32_MSG_STATUS_COMPLETE_TIME    (u32)1000      /*!< @brief Max time in ms that a message status can sit in the status queue in a COMPLETE state */
+#define U32_MSG_STATUS_WAITING_TIME     (u32)3000      /*!< @brief Max time in ms that a message can sit in the queue in a WAITING state */
+#define U32_MSG_STATUS_TIMEOUT_TIME     (u32)5000      /*!< @brief Max time in ms that a TIMEOUT, ABANDONED or FAILED status can sit in the status queue */
+#define U32_MSG_STATUS_CLEANING_TIME    (u32)1000      /*!< @brief Time in ms between starting sweeps of the message pool and status queue */
+#define U8_MSG_CLEANING_STEPS           (u8)4          /*!< @brief Pool slots and status entries checked per 1ms pass during a sweep */
 
-/*! @cond DOXYGEN_EXCLUDE */
-/* Future: possible time-to-live constants for messages in the queue */
-#define U32_MSG_STATUS_COMPLETE_TIME    (u32)1000      /* Max time in ms that a message status can sit in the status queue in a COMPLETE state */
-#define U32_MSG_STATUS_WAITING_TIME     (u32)3000      /* Max time in ms that a message can sit in the queue in a WAITING state */
-#define U32_MSG_STATUS_TIMEOUT_TIME     (u32)5000      /* Max time in ms that a message status can sit in the status queue in a TIMEOUT state */
-#define U32_MSG_STATUS_CLEANING_TIME    (u32)10000     /* Time in ms between cleaning the message queue */
-/*! @endcond */
+#define U8_MSG_PRIORITY_LEVELS          (u8)2          /*!< @brief Number of MessagePriorityType levels */
+
+/* Statistics reported by MessagingGetStats() and MessagingDumpStats() */
+#define U8_MSG_STATS_PERIPHERALS        (u8)32         /*!< @brief Peripheral IDs with a bytes queued counter (every AT91C_ID_ value is below 32) */
+#define U8_MSG_LATENCY_BINS             (u8)8          /*!< @brief Latency histogram bins: 0 ms, 1 ms, 2-3 ms, 4-7 ms ... 64 ms and longer */
+#define U8_MSG_STATS_DUMP_VERSION       (u8)1          /*!< @brief Format version in byte 2 of a MessagingDumpStats() record */
+#define U16_MSG_STATS_DUMP_SIZE         (u16)(113 + (5 * U8_MSG_STATS_PERIPHERALS)) /*!< @brief Largest MessagingDumpStats() record in bytes */
 
 
 /**********************************************************************************************************************
@@ -44,6 +69,21 @@ Type Definitions
 */
 typedef enum {EMPTY = 0, WAITING, SENDING, COMPLETE, TIMEOUT, ABANDONED, FAILED, NOT_FOUND = 0xff} MessageStateType;
 
+/*! 
+@enum MessagePriorityType
+@brief Transmit priority of a message.  A MSG_PRIORITY_HIGH message is sent before any MSG_PRIORITY_NORMAL
+message that has not started yet.
+*/
+typedef enum {MSG_PRIORITY_NORMAL = 0, MSG_PRIORITY_HIGH} MessagePriorityType;
+
+/*! 
+@typedef MessageCallbackType
+@brief Completion callback called with a message's token and state, usually from the peripheral ISR: 
+for a QueueMessageNoCopy() message when it is dequeued, and for MessageSetCallback() when its status 
+reaches a final state
+*/
+typedef void(*MessageCallbackType)(u32 u32Token_, MessageStateType eState_);
+
 /*! 
 @enum MessageType
 @brief Message struct for data messages 
@@ -52,7 +92,15 @@ typedef struct
 {
   u32 u32Token;                             /*!< @brief Unique token for this message */
   u32 u32Size;                              /*!< @brief Size of the data payload in bytes */
+#ifndef EIE_MSG_ARENA
   u8 pu8Message[U16_MAX_TX_MESSAGE_LENGTH]; /*!< @brief Data payload array */
+#endif
+  u8* pu8Data;                              /*!< @brief Bytes to send: the pooled payload or the caller's buffer for a no-copy message */
+  MessageCallbackType pfnCallback;          /*!< @brief Called when the message is dequeued (NULL if none) */
+  u32 u32QueuedTime;                        /*!< @brief G_u32SystemTime1ms when the message was queued */
+  u8 u8Priority;                            /*!< @brief MessagePriorityType of the message */
+  u8 u8Continuation;                        /*!< @brief Non-zero if this message is a later piece of one split by QueueMessage() */
+  void* psQueue;                            /*!< @brief MessageQueueType the message is linked into */
   void* psNextMessage;                      /*!< @brief Pointer to next message */
 } MessageType;
 
@@ -63,9 +111,88 @@ typedef struct
 typedef struct
 {
   bool bFree;                               /*!< @brief TRUE if message slot is available */
+  void* psNextFreeSlot;                     /*!< @brief Next slot in the free list (only valid while bFree) */
   MessageType Message;                      /*!< @brief The slot's message */
 } MessageSlotType;
 
+/*! 
+@struct MessageQueueType
+@brief A peripheral's transmit queue: FIFO linked list of messages with both ends available in constant time
+*/
+typedef struct
+{
+  MessageType* psHead;                      /*!< @brief Message currently being sent / next to send (NULL if empty) */
+  MessageType* psTail;                      /*!< @brief Last message queued (only valid when psHead is not NULL) */
+  MessageType* psPriorityTail;              /*!< @brief Last MSG_PRIORITY_HIGH message after the head (NULL if none; only valid when psHead is not NULL) */
+  MessageType* psNextStarted;               /*!< @brief Message after the head already loaded by the peripheral (NULL if none; only valid when psHead is not NULL) */
+  u8 u8PeripheralId;                        /*!< @brief AT91C_ID_ of the peripheral that owns the queue (bytes queued statistics) */
+} MessageQueueType;
+
+/*! 
+@struct MessageArenaBlockType
+@brief Header in front of every block in the payload ring (EIE_MSG_ARENA builds)
+*/
+typedef struct
+{
+  u16 u16Length;                            /*!< @brief Bytes in the block including this header (multiple of 4) */
+  u16 u16InUse;                             /*!< @brief Non-zero while a message owns the block; 0 for a freed block or the skip block before a wrap */
+} MessageArenaBlockType;
+
+/*! 
+@struct MessagePoolStatsType
+@brief Payload memory use reported by MessagingGetPoolStats()
+*/
+typedef struct
+{
+  u32 u32Size;                              /*!< @brief Bytes of payload storage (slot arrays or arena ring) */
+  u32 u32BytesInUse;                        /*!< @brief Bytes currently allocated, including headers, padding and unreclaimed blocks */
+  u32 u32PeakBytesInUse;                    /*!< @brief Highest u32BytesInUse since MessagingInitialize() */
+  u32 u32PayloadBytes;                      /*!< @brief Bytes of queued message data held in the pool */
+  u32 u32FragmentedBytes;                   /*!< @brief u32BytesInUse that does not hold queued data */
+  u32 u32PeakFragmentedBytes;               /*!< @brief Highest u32FragmentedBytes seen when a message was queued */
+} MessagePoolStatsType;
+
+/*! 
+@struct MessagePriorityStatsType
+@brief Counters for one priority level reported by MessagingGetPriorityStats()
+*/
+typedef struct
+{
+  u32 u32Queued;                            /*!< @brief Messages of this priority in the transmit queues now */
+  u32 u32PeakQueued;                        /*!< @brief Highest u32Queued since MessagingInitialize() */
+  u32 u32Sent;                              /*!< @brief Messages dequeued by their peripheral */
+  u32 u32TotalLatency;                      /*!< @brief Sum of the ms from queued to dequeued for the u32Sent messages */
+  u32 u32MaxLatency;                        /*!< @brief Longest time in ms from queued to dequeued */
+} MessagePriorityStatsType;
+
+/*! 
+@struct MessageLatencyStatsType
+@brief Time between two message states, in ms, for the messages that made the change
+*/
+typedef struct
+{
+  u32 u32Count;                             /*!< @brief Messages measured */
+  u32 u32Total;                             /*!< @brief Sum of the times (average is u32Total / u32Count) */
+  u32 u32Min;                               /*!< @brief Shortest time (0 if u32Count is 0) */
+  u32 u32Max;                               /*!< @brief Longest time */
+  u32 au32Bins[U8_MSG_LATENCY_BINS];        /*!< @brief Messages per bin; bin n > 0 holds times from 2^(n-1) ms, the last bin holds everything longer */
+} MessageLatencyStatsType;
+
+/*! 
+@struct MessagingStatsType
+@brief Load counters reported by MessagingGetStats()
+*/
+typedef struct
+{
+  u32 u32Enqueues;                          /*!< @brief Messages linked into a transmit queue (each piece of a split message counts) */
+  u32 u32Dequeues;                          /*!< @brief Messages removed by DeQueueMessage() */
+  u32 u32FullRejections;                    /*!< @brief Requests refused because the pool (or arena) was full */
+  u32 u32PeakQueuedMessages;                /*!< @brief Most pool slots in use at once (out of U8_TX_QUEUE_SIZE) */
+  MessageLatencyStatsType sWaitingToSending;  /*!< @brief Time from queued (WAITING) until the peripheral started it (SENDING) */
+  MessageLatencyStatsType sSendingToComplete; /*!< @brief Time from SENDING until COMPLETE */
+  u32 au32PeripheralBytes[U8_MSG_STATS_PERIPHERALS]; /*!< @brief Bytes queued to each peripheral, indexed by AT91C_ID_ */
+} MessagingStatsType;
+
 /*! 
 @enum MessageStatusType
 @brief Message tracking information 
@@ -74,7 +201,8 @@ typedef struct
 {
   u32 u32Token;                             /*!< @brief Unique token for this message; a token is never 0 */
   MessageStateType eState;                  /*!< @brief State of the message */
-  u32 u32Timestamp;                         /*!< @brief Time the message status was posted */          
+  u32 u32Timestamp;                         /*!< @brief Time the message status was posted or last changed */          
+  MessageCallbackType pfnCallback;          /*!< @brief Called when the status reaches a final state (NULL if none) */
 } MessageStatusType;
 
 
@@ -86,6 +214,14 @@ typedef struct
 /*! @publicsection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
 MessageStateType QueryMessageStatus(u32 u32Token_);
+MessageStateType MessageSetCallback(u32 u32Token_, MessageCallbackType pfnCallback_);
+MessageType* ReserveMessage(void);
+void ReleaseMessage(MessageType* psMessage_);
+void MessagingGetPoolStats(MessagePoolStatsType* psStats_);
+u8 MessagingGetFreeSlots(void);
+void MessagingGetPriorityStats(MessagePriorityType ePriority_, MessagePriorityStatsType* psStats_);
+void MessagingGetStats(MessagingStatsType* psStats_);
+u32 MessagingDumpStats(u8* pu8Buffer_, u32 u32Size_);
 
 
 /*------------------------------------------------------------------------------------------------------------------*/
@@ -94,21 +230,44 @@ MessageStateType QueryMessageStatus(u32 u32Token_);
 void MessagingInitialize(void);
 void MessagingRunActiveState(void);
 
-u32 QueueMessage(MessageType** ppeTargetTxBuffer_, u32 u32MessageSize_, u8* pu8MessageData_);
-void DeQueueMessage(MessageType** pTargetQueue_);
+u32 QueueMessage(MessageQueueType* psTargetQueue_, u32 u32MessageSize_, u8* pu8MessageData_, MessagePriorityType ePriority_);
+u32 CommitMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Size_);
+u32 QueueMessageNoCopy(MessageQueueType* psTargetQueue_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_);
+void DeQueueMessage(MessageQueueType* psTargetQueue_);
+MessageType* StartNextMessage(MessageQueueType* psTargetQueue_, bool bContinuationOnly_);
+bool ExtendMessage(MessageQueueType* psTargetQueue_, MessageType* psMessage_, u32 u32Token_, u32 u32Size_);
 void UpdateMessageStatus(u32 u32Token_, MessageStateType eNewState_);
 
 
 /*------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
+static MessageSlotType* MessageSlotAllocate(u32 u32PayloadSize_);
+static void MessageSlotFree(MessageSlotType* psSlot_);
+static MessageSlotType* MessageSlotFind(MessageType* psMessage_);
+static bool MessagePayloadIsPooled(MessageType* psMessage_);
+static void MessageTrackPayload(MessageType* psMessage_, bool bAdd_);
+static u32 MessagePoolBytesInUse(void);
+#ifdef EIE_MSG_ARENA
+static u8* MessageArenaAllocate(u32 u32Size_);
+static void MessageArenaFree(u8* pu8Payload_);
+static void MessageArenaTrim(u8* pu8Payload_, u32 u32Size_);
+#endif
+static u32 MessageLink(MessageQueueType* psTargetQueue_, MessageType* psMessage_);
+static MessageStatusType* MessageStatusEntry(u32 u32Token_);
 static void AddNewMessageStatus(u32 u32Token_);
+static bool MessageStateIsFinal(MessageStateType eState_);
+static void MessageLatencyRecord(MessageLatencyStatsType* psLatency_, u32 u32Time_);
+static u8* MessageDumpU32(u8* pu8Buffer_, u32 u32Value_);
+static void MessageExpire(MessageSlotType* psSlot_);
+static void MessageStatusReap(MessageStatusType* psStatus_);
 
 
 /***********************************************************************************************************************
 State Machine Declarations
 ***********************************************************************************************************************/
 static void MessagingSM_Idle(void);             
+static void MessagingSM_Clean(void);             
 static void MessagingSM_Error(void);         
 
 
@@ -3,7 +3,7 @@
 @brief MASTER ONLY.  Provides a driver to use TWI0 (IIC/I2C) peripheral to send and receive data using 
 interrupts and PDC direct memory access.
 
-Currently Set at 200kHz Master Mode.
+Master Mode at 200kHz (TWI0_CWGR_INIT) unless a slave has its own bus speed (see BUS SPEEDS).
 
 Due to the nature of I2C use-cases, this driver does not require tasks to request and release it.
 Read / write messages information is queued locally with all required details.  The driver will
@@ -12,6 +12,22 @@ Read messages stand alone.  Write messages will have associated Message task mes
 
 Clock stretching is supported automatically by the peripheral in Master mode for both read and write.
 
+TRANSACTIONS:
+TwiQueueTransaction() queues a caller-owned TwiTransactionType for a write, a read or a write-then-read 
+(register address then repeated START).  Any number can be queued.  The ISR runs them back to back 
+without the U8_NEXT_TRANSFER_DELAY_MS gap and without the state machine in between, sets each 
+descriptor's eState and calls its pfnCallback as it finishes, so the caller knows exactly when read 
+data is valid.  Messages from the functions above take turns with transactions: the ISR stops 
+chaining when one is waiting and the state machine starts the queue again after it.
+
+BUS SPEEDS:
+TwiSetDeviceSpeed() gives a slave address its own SCL rate (100, 200 or 400 kHz).  The clock is 
+switched just before each message or transaction to that slave starts, so slow and Fast-mode 
+devices can share the bus.  Drivers set the speed of their device in their initialize function.
+en+c twibench times U16_TWI_BENCH_READS back-to-back U8_TWI_BENCH_READ_SIZE-byte reads from 
+U8_TWI_BENCH_ADDRESS at each speed and logs the throughput and the share of the bus that one 
+read every millisecond would take.
+
 ------------------------------------------------------------------------------------------------------------------------
 GLOBALS
 - G_u32Twi0ApplicationFlags
@@ -24,10 +40,21 @@ TYPES
 - TwiDirectionType
 - TwiPeripheralType
 - TwiMessageQueueType
+- TwiTransactionType
+- TwiTransactionCallbackType
+- TwiBusSpeedType
+- TwiDeviceSpeedType
+- TwiBusSpeedInfoType
 
 PUBLIC FUNCTIONS
 - bool TwiReadData(u8 u8SlaveAddress_, u8* pu8RxBuffer_, u32 u32Size_)
+- bool TwiWriteReadData(u8 u8SlaveAddress_, u8 u8InternalAddress_, u8* pu8RxBuffer_, u32 u32Size_)
 - u32 TwiWriteData(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType Send_)
+- u32 TwiCommitData(u8 u8SlaveAddress_, MessageType* psMessage_, u32 u32Size_, TwiStopType eStop_)
+- u32 TwiWriteDataNoCopy(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eStop_, MessageCallbackType pfnCallback_)
+- bool TwiQueueTransaction(TwiTransactionType* psTransaction_)
+- bool TwiSetDeviceSpeed(u8 u8SlaveAddress_, TwiBusSpeedType eSpeed_)
+- u8 TwiGetFreeMessages(void)
 
 PROTECTED FUNCTIONS
 - void TwiInitialize(void)
@@ -70,6 +97,32 @@ static TwiMessageQueueType* TWI_psMsgBufferNext;                        /*!< @br
 static TwiMessageQueueType* TWI_psMsgBufferCurrent;                     /*!< @brief Current message that is being processed */
 static u8 TWI_u8MsgQueueCount;                                          /*!< @brief Counter to track the number of messages in the queue */
 
+static TwiTransactionType* TWI_psTransactionHead;                       /*!< @brief Transaction on the bus or next to start (NULL if none) */
+static TwiTransactionType* TWI_psTransactionTail;                       /*!< @brief Last queued transaction */
+static u32 TWI_u32TransactionTimer;                                     /*!< @brief G_u32SystemTime1ms when the current transaction started */
+
+/*! @brief Clock settings in TwiBusSpeedType order */
+static const TwiBusSpeedInfoType TWI_asBusSpeeds[] =
+{ {U32_TWI_CWGR_100KHZ, 100},
+  {U32_TWI_CWGR_200KHZ, 200},
+  {U32_TWI_CWGR_400KHZ, 400}
+};
+
+#define U8_TWI_BUS_SPEEDS  (u8)(sizeof(TWI_asBusSpeeds) / sizeof(TwiBusSpeedInfoType))
+
+static TwiDeviceSpeedType TWI_asDeviceSpeeds[U8_TWI_MAX_DEVICE_SPEEDS]; /*!< @brief Slaves with their own bus speed */
+static u32 TWI_u32Cwgr;                                                 /*!< @brief TWI_CWGR value currently in the peripheral */
+
+static TwiTransactionType TWI_asBenchReads[U8_TWI_BENCH_IN_FLIGHT];     /*!< @brief Reads queued by en+c twibench */
+static u8 TWI_au8BenchData[U8_TWI_BENCH_IN_FLIGHT][U8_TWI_BENCH_READ_SIZE]; /*!< @brief Where the benchmark reads land */
+static u8 TWI_u8BenchSpeed;                                             /*!< @brief TwiBusSpeedType being timed */
+static u16 TWI_u16BenchQueued;                                          /*!< @brief Reads queued at this speed */
+static volatile u16 TWI_u16BenchDone;                                   /*!< @brief Reads completed at this speed (counted in the ISR) */
+static volatile u16 TWI_u16BenchFailed;                                 /*!< @brief Reads that did not complete */
+static volatile u32 TWI_u32BenchFirstDone;                              /*!< @brief G_u32SystemTime1ms when the first read completed */
+static volatile u32 TWI_u32BenchLastDone;                               /*!< @brief G_u32SystemTime1ms when the latest read completed */
+static u32 TWI_u32BenchTimer;                                           /*!< @brief Start of the current speed for its time-out */
+
 
 /***********************************************************************************************************************
 Function Definitions
@@ -84,7 +137,8 @@ Function Definitions
 
 @brief Queues a TWI Read Message into TWI_asMessageBuffer
 
-Read operations do not have an associated message in the Message task queue.
+Read operations do not have an associated message in the Message task queue, so there is no way to 
+tell when pu8RxBuffer_ is filled.  Use TwiQueueTransaction() when that matters.
 
 Requires:
 - Master mode
@@ -246,7 +300,7 @@ Requires:
           register address must first be specified, then the data is read after.
 
 Promises:
-- adds the data message at TWI_Peripheral0.pTransmitBuffer buffer that will be sent by the TWI application
+- adds the data message at TWI_Peripheral0.sTransmitQueue buffer that will be sent by the TWI application
   when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message cannot be queued in which case
   G_u32MessagingFlags can be checked for the reason
@@ -262,57 +316,259 @@ u32 TwiWriteData(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eSt
     return 0;
   }
 
-  /* Queue Message in message system */
-  u32Token = QueueMessage(&TWI_Peripheral0.pTransmitBuffer, u32Size_, pu8Data_);
+  /* Queue Message in message system.  TWI_asMessageBuffer must stay in the same order as the
+  transmit queue, so TWI messages cannot use MSG_PRIORITY_HIGH. */
+  u32Token = QueueMessage(&TWI_Peripheral0.sTransmitQueue, u32Size_, pu8Data_, MSG_PRIORITY_NORMAL);
   if(u32Token == 0)
   {
     /* TWI Message Task Queue Full or the Tx transmit isn't complete */
     return 0;
   }
 
-  /* Critical section: TWI buffer management must be done with interrutps off since 
-  an ISR can also manage the buffer values and pointers */
-  __disable_irq();
+  TwiQueueWriteTask(u32Token, u8SlaveAddress_, u32Size_, eStop_);
+  return(u32Token);
+  
+} /* end TwiWriteData() */
 
-  /* Queue Relevant data for TWI register setup */
-  TWI_psMsgBufferNext->u32MessageTaskToken = u32Token;
-  TWI_psMsgBufferNext->eDirection = TWI_WRITE;
-  TWI_psMsgBufferNext->u32Size    = u32Size_;
-  TWI_psMsgBufferNext->u8Address  = u8SlaveAddress_;
-  TWI_psMsgBufferNext->eStopType  = eStop_; 
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u32 TwiCommitData(u8 u8SlaveAddress_, MessageType* psMessage_, u32 u32Size_, TwiStopType eStop_)
+
+@brief Queues a message from ReserveMessage() that the caller has already filled in.  
+
+Requires:
+@param u8SlaveAddress_ holds the target's IC address
+@param psMessage_ was returned by ReserveMessage() and holds the data to send in pu8Data
+@param u32Size_ is the number of bytes written to psMessage_->pu8Data NOT including the address byte
+@param eStop_ is the type of operation (see TwiWriteData())
+
+Promises:
+- The message is queued without copying and its token is returned
+- Returns 0 if the message could not be committed, in which case the caller still owns it and
+  must commit it again or call ReleaseMessage()
+
+*/
+u32 TwiCommitData(u8 u8SlaveAddress_, MessageType* psMessage_, u32 u32Size_, TwiStopType eStop_)
+{
+  u32 u32Token;
+    
+  if(TWI_u8MsgQueueCount == U8_TWI_MSG_BUFFER_SIZE)
+  {
+    /* TWI Message Task Queue Full */
+    return 0;
+  }
+
+  u32Token = CommitMessage(&TWI_Peripheral0.sTransmitQueue, psMessage_, u32Size_);
+  if(u32Token == 0)
+  {
+    return 0;
+  }
+
+  TwiQueueWriteTask(u32Token, u8SlaveAddress_, u32Size_, eStop_);
+  return(u32Token);
   
-  /* Not used by Transmit */
-  TWI_psMsgBufferNext->pu8RxBuffer = NULL;
+} /* end TwiCommitData() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u32 TwiWriteDataNoCopy(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eStop_, MessageCallbackType pfnCallback_)
+
+@brief Queues a data array that is sent directly from the caller's buffer.  
+
+Requires:
+@param u8SlaveAddress_ holds the target's IC address
+@param u32Size_ is the number of bytes to send NOT including the address byte (up to U16_MAX_NO_COPY_MESSAGE_LENGTH)
+@param pu8Data_ points to the start of the data to send which must not change until the message is done
+@param eStop_ is the type of operation (see TwiWriteData())
+@param pfnCallback_ is called when the message is done (may be NULL)
+
+Promises:
+- Returns the message token assigned to the message; 0 is returned if the message cannot be queued in which case
+  G_u32MessagingFlags can be checked for the reason
+
+*/
+u32 TwiWriteDataNoCopy(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eStop_, MessageCallbackType pfnCallback_)
+{
+  u32 u32Token;
+    
+  if(TWI_u8MsgQueueCount == U8_TWI_MSG_BUFFER_SIZE)
+  {
+    /* TWI Message Task Queue Full */
+    return 0;
+  }
+
+  u32Token = QueueMessageNoCopy(&TWI_Peripheral0.sTransmitQueue, u32Size_, pu8Data_, pfnCallback_);
+  if(u32Token == 0)
+  {
+    return 0;
+  }
+
+  TwiQueueWriteTask(u32Token, u8SlaveAddress_, u32Size_, eStop_);
+  return(u32Token);
   
-  /* Update array pointers and size */
-  TWI_u8MsgQueueCount++;
-  TWI_psMsgBufferNext++;
-  if( TWI_psMsgBufferNext == &TWI_asMessageBuffer[U8_TWI_MSG_BUFFER_SIZE] )
+} /* end TwiWriteDataNoCopy() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool TwiQueueTransaction(TwiTransactionType* psTransaction_)
+
+@brief Queues a write, read or write-then-read that reports when it is finished.  
+
+The descriptor is used in place: nothing is copied, so it and its data must not change until eState 
+is final.  Queue several descriptors to keep the bus busy; the ISR starts each one as soon as the 
+one before it completes.  pfnCallback must not queue a transaction itself.
+
+Example: read 14 bytes starting at register 0x20
+  sRead.u8Address = 0x6B;
+  sRead.eDirection = TWI_READ;
+  sRead.u8RegisterSize = 1;
+  sRead.u32Register = 0x20;
+  sRead.pu8Data = au8Sample;
+  sRead.u32Size = 14;
+  sRead.pfnCallback = UserApp1SampleDone;
+  TwiQueueTransaction(&sRead);
+
+Requires:
+- Master mode
+
+@param psTransaction_ is filled in by the caller (see TwiTransactionType); psNext and eState 
+       are set here
+
+Promises:
+- Returns TRUE and sets eState to WAITING if the transaction was queued
+- Returns FALSE if the descriptor is still queued or on the bus, or does not describe a transfer
+  (no data, u8RegisterSize over U8_TWI_MAX_REGISTER_SIZE, or a register on a write)
+- Finished transactions have eState COMPLETE, FAILED (not acknowledged) or TIMEOUT
+
+*/
+bool TwiQueueTransaction(TwiTransactionType* psTransaction_)
+{
+  /* A descriptor can only be in the queue once */
+  if( (psTransaction_->eState == WAITING) || (psTransaction_->eState == SENDING) )
   {
-    TWI_psMsgBufferNext = &TWI_asMessageBuffer[0];
+    return FALSE;
   }
 
-  /* Clear the new location to avoid confusion */
-  TWI_psMsgBufferNext->eDirection  = TWI_EMPTY;
-  TWI_psMsgBufferNext->u32Size     = 0;
-  TWI_psMsgBufferNext->u8Address   = 0;
-  TWI_psMsgBufferNext->pu8RxBuffer = NULL;
-  TWI_psMsgBufferNext->eStopType   = TWI_NA; 
-  TWI_psMsgBufferNext->u8InternalAddress = 0;
-  TWI_psMsgBufferNext->u32MessageTaskToken = 0;
+  if( (psTransaction_->u32Size == 0) || (psTransaction_->pu8Data == NULL) ||
+      (psTransaction_->u8RegisterSize > U8_TWI_MAX_REGISTER_SIZE) ||
+      ((psTransaction_->eDirection != TWI_READ) && (psTransaction_->eDirection != TWI_WRITE)) ||
+      ((psTransaction_->eDirection == TWI_WRITE) && (psTransaction_->u8RegisterSize != 0)) )
+  {
+    return FALSE;
+  }
+
+  psTransaction_->eState = WAITING;
+  psTransaction_->psNext = NULL;
+
+  /* Critical section: the ISR takes transactions off the front of the list */
+  __disable_irq();
+
+  if(TWI_psTransactionHead == NULL)
+  {
+    TWI_psTransactionHead = psTransaction_;
+  }
+  else
+  {
+    TWI_psTransactionTail->psNext = psTransaction_;
+  }
+  TWI_psTransactionTail = psTransaction_;
 
-  /* End of critical section */
   __enable_irq();
 
-  /* If the system is initializing, manually cycle the TWI task through one iteration to send the message */
+  /* If the system is initializing, manually cycle the TWI task to run the transaction */
   if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
   {
     TwiManualMode();
   }
 
-  return(u32Token);
-  
-} /* end TwiWriteData() */
+  return TRUE;
+
+} /* end TwiQueueTransaction() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn bool TwiSetDeviceSpeed(u8 u8SlaveAddress_, TwiBusSpeedType eSpeed_)
+
+@brief Sets the SCL rate used for every message and transaction to a slave.
+
+Only ask for a rate that the slave and the bus pull-ups support.  Slaves without a speed use 
+TWI0_CWGR_INIT.
+
+e.g.
+TwiSetDeviceSpeed(U8_LSM6DSL_I2C_ADDRESS, TWI_SPEED_400KHZ);
+
+Requires:
+@param u8SlaveAddress_ is the 7-bit slave address (not 0)
+@param eSpeed_ is the bus speed to use
+
+Promises:
+- Returns TRUE if the speed is stored; the clock is switched before the next transfer to the 
+  slave starts
+- Returns FALSE if eSpeed_ is not valid or U8_TWI_MAX_DEVICE_SPEEDS slaves already have a speed
+
+*/
+bool TwiSetDeviceSpeed(u8 u8SlaveAddress_, TwiBusSpeedType eSpeed_)
+{
+  TwiDeviceSpeedType* psFree = NULL;
+
+  if( (u8SlaveAddress_ == 0) || ((u8)eSpeed_ >= U8_TWI_BUS_SPEEDS) )
+  {
+    return FALSE;
+  }
+
+  /* Critical section: the ISR looks up speeds when it chains transactions */
+  __disable_irq();
+
+  for(u8 i = 0; i < U8_TWI_MAX_DEVICE_SPEEDS; i++)
+  {
+    if(TWI_asDeviceSpeeds[i].u8Address == u8SlaveAddress_)
+    {
+      TWI_asDeviceSpeeds[i].eSpeed = eSpeed_;
+      __enable_irq();
+      return TRUE;
+    }
+
+    if( (psFree == NULL) && (TWI_asDeviceSpeeds[i].u8Address == 0) )
+    {
+      psFree = &TWI_asDeviceSpeeds[i];
+    }
+  }
+
+  if(psFree != NULL)
+  {
+    psFree->eSpeed = eSpeed_;
+    psFree->u8Address = u8SlaveAddress_;
+  }
+
+  __enable_irq();
+
+  return (psFree != NULL);
+
+} /* end TwiSetDeviceSpeed() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u8 TwiGetFreeMessages(void)
+
+@brief Returns how many more TwiReadData(), TwiWriteReadData() or TwiWriteData() calls the TWI 
+message buffer can take.
+
+A task that must queue several writes together (e.g. a register sequence that is only valid as a 
+whole) checks this before queueing the first one. Transactions from TwiQueueTransaction() do not
+use the buffer.
+
+Requires:
+- NONE
+
+Promises:
+- Returns U8_TWI_MSG_BUFFER_SIZE less the operations waiting in the buffer
+
+*/
+u8 TwiGetFreeMessages(void)
+{
+  return( (u8)(U8_TWI_MSG_BUFFER_SIZE - TWI_u8MsgQueueCount) );
+
+} /* end TwiGetFreeMessages() */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -342,6 +598,26 @@ void TwiInitialize(void)
   TWI_psMsgBufferNext = TWI_asMessageBuffer;
   TWI_psMsgBufferCurrent = TWI_asMessageBuffer;
   TWI_u8MsgQueueCount = 0;
+  TWI_psTransactionHead = NULL;
+  TWI_psTransactionTail = NULL;
+  
+  for(u8 i = 0; i < U8_TWI_MAX_DEVICE_SPEEDS; i++)
+  {
+    TWI_asDeviceSpeeds[i].u8Address = 0;
+    TWI_asDeviceSpeeds[i].eSpeed = TWI_SPEED_200KHZ;
+  }
+  
+  for(u8 i = 0; i < U8_TWI_BENCH_IN_FLIGHT; i++)
+  {
+    TWI_asBenchReads[i].u8Address = U8_TWI_BENCH_ADDRESS;
+    TWI_asBenchReads[i].eDirection = TWI_READ;
+    TWI_asBenchReads[i].u8RegisterSize = 1;
+    TWI_asBenchReads[i].u32Register = U8_TWI_BENCH_REGISTER;
+    TWI_asBenchReads[i].pu8Data = &TWI_au8BenchData[i][0];
+    TWI_asBenchReads[i].u32Size = U8_TWI_BENCH_READ_SIZE;
+    TWI_asBenchReads[i].pfnCallback = TwiBenchmarkReadDone;
+    TWI_asBenchReads[i].eState = EMPTY;
+  }
   
   /* Clear the local message buffer */
   for(u8 i = 0; i < U8_TWI_MSG_BUFFER_SIZE; i++)
@@ -357,7 +633,9 @@ void TwiInitialize(void)
    
   /* Initialize the TWI peripheral structures */
   TWI_Peripheral0.pBaseAddress    = AT91C_BASE_TWI0;
-  TWI_Peripheral0.pTransmitBuffer = NULL;
+  TWI_Peripheral0.sTransmitQueue.psHead = NULL;
+  TWI_Peripheral0.sTransmitQueue.psTail = NULL;
+  TWI_Peripheral0.sTransmitQueue.u8PeripheralId = AT91C_ID_TWI0;
   TWI_Peripheral0.u32PrivateFlags = 0;
 
   /* Software reset of peripheral */
@@ -366,7 +644,8 @@ void TwiInitialize(void)
   while( !IsTimeUp(&TWI_u32Timer, 1) );
   
   /* Configure Peripheral for Master mode */
-  TWI_Peripheral0.pBaseAddress->TWI_CWGR = TWI0_CWGR_INIT;
+  TWI_u32Cwgr = TWI0_CWGR_INIT;
+  TWI_Peripheral0.pBaseAddress->TWI_CWGR = TWI_u32Cwgr;
   TWI_Peripheral0.pBaseAddress->TWI_CR   = TWI0_CR_INIT;
   TWI_Peripheral0.pBaseAddress->TWI_MMR  = TWI0_MMR_INIT;
   TWI_Peripheral0.pBaseAddress->TWI_IER  = TWI0_IER_INIT;
@@ -376,6 +655,8 @@ void TwiInitialize(void)
   NVIC_ClearPendingIRQ( (IRQn_Type)AT91C_ID_TWI0 );
   NVIC_EnableIRQ( (IRQn_Type)AT91C_ID_TWI0 );
 
+  DebugCommandRegister("twibench", TwiCommandBenchmark, "Measure TWI throughput at each bus speed");
+
   /* Set application pointer */
   TWI_pfnStateMachine = TwiSM_Idle;
   DebugPrintf("TWI Peripheral Ready\n\r");
@@ -396,12 +677,18 @@ Requires:
 
 Promises:
 - Calls the function to pointed by the state machine function pointer
+- Keeps en+c twibench going while it runs
 
 */
 void TwiRunActiveState(void)
 {
   TWI_pfnStateMachine();
 
+  if(TWI_u32Flags & _TWI_BENCHMARK)
+  {
+    TwiBenchmarkService();
+  }
+
 } /* end TwiRunActiveState */
 
 
@@ -449,6 +736,7 @@ Requires:
 - NONE
 
 Promises:
+- Queued transactions are handled by TwiTransactionIsr()
 - NACK: flags error, disables ENDTX and sets Error state
 - ENDTX: disables interrupt & PDC, writes STOP (if applicable), and clears _TWI_TRANSMITTING
 - ENDRX: disables interrupt & PDC and writes STOP
@@ -462,6 +750,12 @@ void TWI0_IrqHandler(void)
   u32InterruptStatus = AT91C_BASE_TWI0->TWI_IMR;
   u32InterruptStatus &= AT91C_BASE_TWI0->TWI_SR;
   
+  if(TWI_Peripheral0.u32PrivateFlags & _TWI_TRANSACTIONS)
+  {
+    TwiTransactionIsr(u32InterruptStatus);
+    return;
+  }
+  
   /*** NACK Received (Master only) ***/
   if(u32InterruptStatus & AT91C_TWI_NACK_MASTER )
   {
@@ -480,7 +774,7 @@ void TWI0_IrqHandler(void)
     TWI_Peripheral0.pBaseAddress->TWI_PTCR = AT91C_PDC_TXTDIS;
 
     /* Set stop condition if multi-byte transfer */
-    if( (TWI_Peripheral0.pTransmitBuffer->u32Size != 1) &&
+    if( (TWI_Peripheral0.sTransmitQueue.psHead->u32Size != 1) &&
         (TWI_psMsgBufferCurrent->eStopType == TWI_STOP) )
     {
       TWI_Peripheral0.pBaseAddress->TWI_CR = AT91C_TWI_STOP;
@@ -511,6 +805,455 @@ void TWI0_IrqHandler(void)
 /*! @privatesection */                                                                                            
 /*----------------------------------------------------------------------------------------------------------------------*/
 
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiQueueWriteTask(u32 u32Token_, u8 u8SlaveAddress_, u32 u32Size_, TwiStopType eStop_)
+
+@brief Adds the TWI operation for a write message that is already in TWI_Peripheral0.sTransmitQueue.
+
+Requires:
+- TWI_asMessageBuffer is not full
+
+@param u32Token_ is the token of the queued message
+@param u8SlaveAddress_ holds the target's IC address
+@param u32Size_ is the number of bytes to send NOT including the address byte
+@param eStop_ is the type of operation
+
+Promises:
+- The write is added to the local TWI message buffer and will be started by the TWI state machine
+
+*/
+static void TwiQueueWriteTask(u32 u32Token_, u8 u8SlaveAddress_, u32 u32Size_, TwiStopType eStop_)
+{
+  /* Critical section: TWI buffer management must be done with interrutps off since 
+  an ISR can also manage the buffer values and pointers */
+  __disable_irq();
+
+  /* Queue Relevant data for TWI register setup */
+  TWI_psMsgBufferNext->u32MessageTaskToken = u32Token_;
+  TWI_psMsgBufferNext->eDirection = TWI_WRITE;
+  TWI_psMsgBufferNext->u32Size    = u32Size_;
+  TWI_psMsgBufferNext->u8Address  = u8SlaveAddress_;
+  TWI_psMsgBufferNext->eStopType  = eStop_; 
+  
+  /* Not used by Transmit */
+  TWI_psMsgBufferNext->pu8RxBuffer = NULL;
+  
+  /* Update array pointers and size */
+  TWI_u8MsgQueueCount++;
+  TWI_psMsgBufferNext++;
+  if( TWI_psMsgBufferNext == &TWI_asMessageBuffer[U8_TWI_MSG_BUFFER_SIZE] )
+  {
+    TWI_psMsgBufferNext = &TWI_asMessageBuffer[0];
+  }
+
+  /* Clear the new location to avoid confusion */
+  TWI_psMsgBufferNext->eDirection  = TWI_EMPTY;
+  TWI_psMsgBufferNext->u32Size     = 0;
+  TWI_psMsgBufferNext->u8Address   = 0;
+  TWI_psMsgBufferNext->pu8RxBuffer = NULL;
+  TWI_psMsgBufferNext->eStopType   = TWI_NA; 
+  TWI_psMsgBufferNext->u8InternalAddress = 0;
+  TWI_psMsgBufferNext->u32MessageTaskToken = 0;
+
+  /* End of critical section */
+  __enable_irq();
+
+  /* If the system is initializing, manually cycle the TWI task through one iteration to send the message */
+  if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
+  {
+    TwiManualMode();
+  }
+
+} /* end TwiQueueWriteTask() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiTransactionStart(void)
+
+@brief Puts the transaction at the front of the queue on the bus.
+
+Requires:
+- Interrupts are off or this is the TWI ISR
+- TWI_psTransactionHead is not NULL and the bus is free
+
+Promises:
+- The peripheral and PDC are set up and the first interrupt of the transfer is enabled
+- _TWI_TRANSACTIONS is set so the ISR handles the transfer
+
+*/
+static void TwiTransactionStart(void)
+{
+  TwiTransactionType* psTransaction = TWI_psTransactionHead;
+  AT91PS_TWI pTwi = TWI_Peripheral0.pBaseAddress;
+  u32 u32Mode;
+
+  psTransaction->eState = SENDING;
+  TWI_u32TransactionTimer = G_u32SystemTime1ms;
+  TwiSelectBusSpeed(psTransaction->u8Address);
+  TWI_Peripheral0.u32PrivateFlags |= _TWI_TRANSACTIONS;
+  TWI_Peripheral0.u32PrivateFlags &= ~_TWI_TRANSACTION_NACK;
+
+  u32Mode = (u32)psTransaction->u8Address << TWI_MMR_ADDRESS_SHIFT;
+  if(psTransaction->eDirection == TWI_WRITE)
+  {
+    /* The PDC feeds THR; ENDTX then asks for the STOP */
+    pTwi->TWI_MMR = u32Mode;
+    pTwi->TWI_TPR = (u32)psTransaction->pu8Data;
+    pTwi->TWI_TCR = psTransaction->u32Size;
+    pTwi->TWI_IER = AT91C_TWI_ENDTX;
+    pTwi->TWI_PTCR = AT91C_PDC_TXTEN;
+
+    /* Single byte transfers need STOP immediately */
+    if(psTransaction->u32Size == 1)
+    {
+      pTwi->TWI_CR = AT91C_TWI_STOP;
+    }
+    return;
+  }
+
+  /* Reads: the peripheral sends the register address (IADR) and the repeated START itself */
+  pTwi->TWI_MMR = u32Mode | AT91C_TWI_MREAD | ((u32)psTransaction->u8RegisterSize << TWI_MMR_IADRZ_SHIFT);
+  pTwi->TWI_IADR = psTransaction->u32Register;
+
+  if(psTransaction->u32Size == 1)
+  {
+    /* Single byte direct receive (no PDC required) */
+    pTwi->TWI_IER = AT91C_TWI_RXRDY;
+    pTwi->TWI_CR = (AT91C_TWI_START | AT91C_TWI_STOP);
+  }
+  else
+  {
+    /* The PDC takes all but the last byte, which is read after STOP is requested */
+    pTwi->TWI_RPR = (u32)psTransaction->pu8Data;
+    pTwi->TWI_RCR = psTransaction->u32Size - 1;
+    pTwi->TWI_IER = AT91C_TWI_ENDRX;
+    pTwi->TWI_PTCR = AT91C_PDC_RXTEN;
+    pTwi->TWI_CR = AT91C_TWI_START;
+  }
+
+} /* end TwiTransactionStart() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiTransactionFinish(MessageStateType eState_)
+
+@brief Ends the transaction at the front of the queue and starts the next one.
+
+Requires:
+- Interrupts are off or this is the TWI ISR
+- TWI_psTransactionHead is the transaction that was on the bus
+
+@param eState_ is the final state for the transaction (COMPLETE, FAILED or TIMEOUT)
+
+Promises:
+- The transaction leaves the queue with eState_ and its callback (if any) is called
+- The next transaction is started unless the queue is empty or a message from TwiWriteData() and 
+  friends is waiting, in which case _TWI_TRANSACTIONS is cleared to hand the bus back to the state 
+  machine
+
+*/
+static void TwiTransactionFinish(MessageStateType eState_)
+{
+  TwiTransactionType* psTransaction = TWI_psTransactionHead;
+
+  TWI_Peripheral0.pBaseAddress->TWI_IDR = AT91C_TWI_TXCOMP_MASTER | AT91C_TWI_RXRDY | 
+                                          AT91C_TWI_ENDRX | AT91C_TWI_ENDTX;
+  TWI_psTransactionHead = psTransaction->psNext;
+  psTransaction->psNext = NULL;
+  psTransaction->eState = eState_;
+
+  /* Start the next transfer before the callback so the bus is not kept waiting */
+  if( (TWI_psTransactionHead != NULL) && (TWI_u8MsgQueueCount == 0) )
+  {
+    TwiTransactionStart();
+  }
+  else
+  {
+    TWI_Peripheral0.u32PrivateFlags &= ~_TWI_TRANSACTIONS;
+  }
+
+  if(psTransaction->pfnCallback != NULL)
+  {
+    psTransaction->pfnCallback(psTransaction);
+  }
+
+} /* end TwiTransactionFinish() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiTransactionIsr(u32 u32InterruptStatus_)
+
+@brief Moves the current transaction through its phases; called from TWI0_IrqHandler() while 
+_TWI_TRANSACTIONS is set.
+
+Requires:
+@param u32InterruptStatus_ is SR masked with IMR
+
+Promises:
+- NACK: stops the PDC and waits for TXCOMP (the peripheral ends the transfer itself)
+- ENDTX: writes STOP and waits for TXCOMP
+- ENDRX: writes STOP and waits for the last byte (RXRDY)
+- RXRDY: stores the last byte and waits for TXCOMP
+- TXCOMP: finishes the transaction as COMPLETE, or FAILED after a NACK
+
+*/
+static void TwiTransactionIsr(u32 u32InterruptStatus_)
+{
+  AT91PS_TWI pTwi = TWI_Peripheral0.pBaseAddress;
+  TwiTransactionType* psTransaction = TWI_psTransactionHead;
+
+  if(u32InterruptStatus_ & AT91C_TWI_NACK_MASTER)
+  {
+    TWI_Peripheral0.u32PrivateFlags |= _TWI_TRANSACTION_NACK;
+    pTwi->TWI_IDR = AT91C_TWI_RXRDY | AT91C_TWI_ENDRX | AT91C_TWI_ENDTX;
+    pTwi->TWI_PTCR = AT91C_PDC_TXTDIS | AT91C_PDC_RXTDIS;
+    pTwi->TWI_IER = AT91C_TWI_TXCOMP_MASTER;
+    return;
+  }
+
+  if(u32InterruptStatus_ & AT91C_TWI_ENDTX)
+  {
+    pTwi->TWI_IDR = AT91C_TWI_ENDTX;
+    pTwi->TWI_PTCR = AT91C_PDC_TXTDIS;
+    pTwi->TWI_CR = AT91C_TWI_STOP;
+    pTwi->TWI_IER = AT91C_TWI_TXCOMP_MASTER;
+  }
+
+  if(u32InterruptStatus_ & AT91C_TWI_ENDRX)
+  {
+    pTwi->TWI_IDR = AT91C_TWI_ENDRX;
+    pTwi->TWI_PTCR = AT91C_PDC_RXTDIS;
+    pTwi->TWI_CR = AT91C_TWI_STOP;
+    pTwi->TWI_IER = AT91C_TWI_RXRDY;
+  }
+
+  if(u32InterruptStatus_ & AT91C_TWI_RXRDY)
+  {
+    psTransaction->pu8Data[psTransaction->u32Size - 1] = (u8)pTwi->TWI_RHR;
+    pTwi->TWI_IDR = AT91C_TWI_RXRDY;
+    pTwi->TWI_IER = AT91C_TWI_TXCOMP_MASTER;
+  }
+
+  if(u32InterruptStatus_ & AT91C_TWI_TXCOMP_MASTER)
+  {
+    TwiTransactionFinish( (TWI_Peripheral0.u32PrivateFlags & _TWI_TRANSACTION_NACK) ? FAILED : COMPLETE );
+  }
+
+} /* end TwiTransactionIsr() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiSelectBusSpeed(u8 u8SlaveAddress_)
+
+@brief Sets the TWI clock for the next transfer to a slave.
+
+Requires:
+- The bus is free (CWGR must not change during a transfer)
+- Interrupts are off, or this is the TWI ISR or the state machine with no transaction running
+
+@param u8SlaveAddress_ is the slave about to be addressed
+
+Promises:
+- TWI_CWGR holds the slave's speed from TWI_asDeviceSpeeds (the benchmark speed for 
+  U8_TWI_BENCH_ADDRESS while en+c twibench runs) or TWI0_CWGR_INIT; it is only written if it changes
+
+*/
+static void TwiSelectBusSpeed(u8 u8SlaveAddress_)
+{
+  u32 u32Cwgr = TWI0_CWGR_INIT;
+
+  if( (TWI_u32Flags & _TWI_BENCHMARK) && (u8SlaveAddress_ == U8_TWI_BENCH_ADDRESS) )
+  {
+    u32Cwgr = TWI_asBusSpeeds[TWI_u8BenchSpeed].u32Cwgr;
+  }
+  else
+  {
+    for(u8 i = 0; i < U8_TWI_MAX_DEVICE_SPEEDS; i++)
+    {
+      if(TWI_asDeviceSpeeds[i].u8Address == u8SlaveAddress_)
+      {
+        u32Cwgr = TWI_asBusSpeeds[TWI_asDeviceSpeeds[i].eSpeed].u32Cwgr;
+        break;
+      }
+    }
+  }
+
+  if(u32Cwgr != TWI_u32Cwgr)
+  {
+    TWI_u32Cwgr = u32Cwgr;
+    TWI_Peripheral0.pBaseAddress->TWI_CWGR = u32Cwgr;
+  }
+
+} /* end TwiSelectBusSpeed() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiCommandBenchmark(void)
+
+@brief Debug command (en+c twibench) that times back-to-back reads from U8_TWI_BENCH_ADDRESS at 
+each bus speed.
+
+The reads are queued transactions, U8_TWI_BENCH_IN_FLIGHT at a time, so the ISR chains them 
+without gaps (see TwiBenchmarkService()).  Other traffic keeps running and is included in the time.
+
+Requires:
+- NONE
+
+Promises:
+- The benchmark starts at the slowest speed unless it is already running
+
+*/
+static void TwiCommandBenchmark(void)
+{
+  if(TWI_u32Flags & _TWI_BENCHMARK)
+  {
+    DebugPrintf("\n\rTWI bench already running\n\r");
+    return;
+  }
+
+  DebugPrintf("\n\rTWI bench: ");
+  DebugPrintNumber(U16_TWI_BENCH_READS);
+  DebugPrintf(" reads of ");
+  DebugPrintNumber(U8_TWI_BENCH_READ_SIZE);
+  DebugPrintf(" bytes at each speed\n\r");
+
+  TWI_u8BenchSpeed = 0;
+  TwiBenchmarkStartSpeed();
+  TWI_u32Flags |= _TWI_BENCHMARK;
+
+} /* end TwiCommandBenchmark() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiBenchmarkStartSpeed(void)
+
+@brief Clears the benchmark counters for the speed in TWI_u8BenchSpeed.
+
+Requires:
+- No benchmark reads are queued
+
+Promises:
+- Counters and the time-out timer are reset; TwiBenchmarkService() queues the reads
+
+*/
+static void TwiBenchmarkStartSpeed(void)
+{
+  TWI_u16BenchQueued = 0;
+  TWI_u16BenchDone = 0;
+  TWI_u16BenchFailed = 0;
+  TWI_u32BenchFirstDone = 0;
+  TWI_u32BenchLastDone = 0;
+  TWI_u32BenchTimer = G_u32SystemTime1ms;
+
+} /* end TwiBenchmarkStartSpeed() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiBenchmarkReadDone(TwiTransactionType* psTransaction_)
+
+@brief Transaction callback (TWI ISR) that counts and time-stamps finished benchmark reads.
+
+Requires:
+@param psTransaction_ is one of TWI_asBenchReads
+
+Promises:
+- TWI_u16BenchDone or TWI_u16BenchFailed is incremented; completed reads update the time stamps
+
+*/
+static void TwiBenchmarkReadDone(TwiTransactionType* psTransaction_)
+{
+  if(psTransaction_->eState != COMPLETE)
+  {
+    TWI_u16BenchFailed++;
+    return;
+  }
+
+  if(TWI_u16BenchDone == 0)
+  {
+    TWI_u32BenchFirstDone = G_u32SystemTime1ms;
+  }
+  TWI_u32BenchLastDone = G_u32SystemTime1ms;
+  TWI_u16BenchDone++;
+
+} /* end TwiBenchmarkReadDone() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn static void TwiBenchmarkService(void)
+
+@brief Keeps the benchmark reads queued and logs the result of each speed.
+
+The rate is measured from the end of the first read to the end of the last one.  The bus share 
+is the time one read takes as a percentage of 1 ms, i.e. the load of sampling at 1 kHz.
+
+Requires:
+- _TWI_BENCHMARK is set
+
+Promises:
+- Finished reads are queued again until U16_TWI_BENCH_READS have been queued
+- When all reads at a speed are back, DEBUG_LOG_TWI_BENCH is logged and the next speed starts
+- The benchmark stops if a read fails or a speed takes longer than U32_TWI_BENCH_TIMEOUT_MS
+
+*/
+static void TwiBenchmarkService(void)
+{
+  TwiTransactionType* psRead;
+  u32 u32Time;
+  u32 u32Bytes;
+
+  for(u8 i = 0; (i < U8_TWI_BENCH_IN_FLIGHT) && (TWI_u16BenchQueued < U16_TWI_BENCH_READS); i++)
+  {
+    psRead = &TWI_asBenchReads[i];
+    if( (TWI_u16BenchFailed == 0) && TwiQueueTransaction(psRead) )
+    {
+      TWI_u16BenchQueued++;
+    }
+  }
+
+  /* Wait for every queued read so none are left on the bus when the speed changes */
+  if( (u16)(TWI_u16BenchDone + TWI_u16BenchFailed) == TWI_u16BenchQueued )
+  {
+    if(TWI_u16BenchFailed != 0)
+    {
+      DebugPrintf("TWI bench: the slave did not answer\n\r");
+      TWI_u32Flags &= ~_TWI_BENCHMARK;
+      return;
+    }
+
+    if(TWI_u16BenchQueued == U16_TWI_BENCH_READS)
+    {
+      /* The first read only starts the clock */
+      u32Time = TWI_u32BenchLastDone - TWI_u32BenchFirstDone;
+      u32Bytes = (u32)(U16_TWI_BENCH_READS - 1) * U8_TWI_BENCH_READ_SIZE;
+      DebugLog(DEBUG_LOG_TWI_BENCH, (u32)TWI_asBusSpeeds[TWI_u8BenchSpeed].u16Khz, 
+               (u32)(U16_TWI_BENCH_READS - 1), u32Time, 
+               (u32Time == 0) ? 0 : ((u32Bytes * 1000) / u32Time),
+               (u32Time * 100) / (U16_TWI_BENCH_READS - 1));
+
+      TWI_u8BenchSpeed++;
+      if(TWI_u8BenchSpeed == U8_TWI_BUS_SPEEDS)
+      {
+        TWI_u32Flags &= ~_TWI_BENCHMARK;
+      }
+      else
+      {
+        TwiBenchmarkStartSpeed();
+      }
+      return;
+    }
+  }
+
+  if( IsTimeUp(&TWI_u32BenchTimer, U32_TWI_BENCH_TIMEOUT_MS) )
+  {
+    DebugPrintf("TWI bench: stalled after ");
+    DebugPrintNumber(TWI_u16BenchDone);
+    DebugPrintf(" reads\n\r");
+    TWI_u32Flags &= ~_TWI_BENCHMARK;
+  }
+
+} /* end TwiBenchmarkService() */
+
+
 
 /***********************************************************************************************************************
 State Machine Function Definitions
@@ -529,9 +1272,18 @@ static void TwiSM_Idle(void)
   {
     if(TWI_psMsgBufferCurrent->eDirection == TWI_WRITE)
     {
+      /* Messaging removes messages that wait too long (but never the one at the front), 
+      so if the front message is newer than this task's message the task has timed out */
+      if( (TWI_Peripheral0.sTransmitQueue.psHead == NULL) ||
+          (TWI_Peripheral0.sTransmitQueue.psHead->u32Token > TWI_psMsgBufferCurrent->u32MessageTaskToken) )
+      {
+        TWI_u32Timer = 1;
+        TWI_pfnStateMachine = TwiSM_NextTransferDelay;
+      }
+      
       /* Check that the local buffer Message token matches the message queued
       and the transmit buffer */
-      if(TWI_psMsgBufferCurrent->u32MessageTaskToken != TWI_Peripheral0.pTransmitBuffer->u32Token)
+      else if(TWI_psMsgBufferCurrent->u32MessageTaskToken != TWI_Peripheral0.sTransmitQueue.psHead->u32Token)
       {
         DebugPrintf("TWI transmit message out of sync!\n\r");
         TWI_Peripheral0.u32PrivateFlags |= _TWI_ERROR_TX_MSG_SYNC;
@@ -539,23 +1291,24 @@ static void TwiSM_Idle(void)
       else
       {
         /* Update the message's status */
-        UpdateMessageStatus(TWI_Peripheral0.pTransmitBuffer->u32Token, SENDING);
+        UpdateMessageStatus(TWI_Peripheral0.sTransmitQueue.psHead->u32Token, SENDING);
 
         /* Set up to transmit the message */
+        TwiSelectBusSpeed(TWI_psMsgBufferCurrent->u8Address);
         TWI_Peripheral0.u32PrivateFlags |= _TWI_TRANSMITTING;
         u32Byte = (u32)(TWI_psMsgBufferCurrent->u8Address) << TWI_MMR_ADDRESS_SHIFT;
         TWI_Peripheral0.pBaseAddress->TWI_MMR = u32Byte; 
 
         /* Setup PDC and interrupts */
-        TWI_Peripheral0.pBaseAddress->TWI_TPR = (u32)TWI_Peripheral0.pTransmitBuffer->pu8Message; 
-        TWI_Peripheral0.pBaseAddress->TWI_TCR = TWI_Peripheral0.pTransmitBuffer->u32Size;
+        TWI_Peripheral0.pBaseAddress->TWI_TPR = (u32)TWI_Peripheral0.sTransmitQueue.psHead->pu8Data; 
+        TWI_Peripheral0.pBaseAddress->TWI_TCR = TWI_Peripheral0.sTransmitQueue.psHead->u32Size;
 
         /* Enable Tx interrupt and the transmitter (triggers THR load) */
         TWI_Peripheral0.pBaseAddress->TWI_IER = AT91C_TWI_ENDTX;
         TWI_Peripheral0.pBaseAddress->TWI_PTCR = AT91C_PDC_TXTEN;
              
         /* Single byte transfers need STOP immediately (if applicable) */
-        if(TWI_Peripheral0.pTransmitBuffer->u32Size == 1)
+        if(TWI_Peripheral0.sTransmitQueue.psHead->u32Size == 1)
         {
           /* Set up the stop condition immediately if applicable */
           if(TWI_psMsgBufferCurrent->eStopType == TWI_STOP)
@@ -572,6 +1325,7 @@ static void TwiSM_Idle(void)
     else if(TWI_psMsgBufferCurrent->eDirection == TWI_READ)
     {
       /* Set up for READ transaction */
+      TwiSelectBusSpeed(TWI_psMsgBufferCurrent->u8Address);
       u32Byte = AT91C_TWI_MREAD | (TWI_psMsgBufferCurrent->u8Address << TWI_MMR_ADDRESS_SHIFT);
       TWI_Peripheral0.pBaseAddress->TWI_MMR = u32Byte; 
       TWI_Peripheral0.u32PrivateFlags |= _TWI_RECEIVING;
@@ -612,6 +1366,16 @@ static void TwiSM_Idle(void)
     } /* end TWI_READ */ 
   } /* if(TWI_u8MsgQueueCount != 0) */  
   
+  /* Otherwise hand the bus to the ISR for any queued transactions */
+  else if(TWI_psTransactionHead != NULL)
+  {
+    __disable_irq();
+    TwiTransactionStart();
+    __enable_irq();
+    
+    TWI_pfnStateMachine = TwiSM_Transactions;
+  }
+  
 } /* end TwiSM_Idle() */
      
 
@@ -625,8 +1389,8 @@ static void TwiSM_Transmit(void)
   if( !(TWI_Peripheral0.u32PrivateFlags & _TWI_TRANSMITTING) )
   {
     /*  Clean up the Message task message */
-    UpdateMessageStatus(TWI_Peripheral0.pTransmitBuffer->u32Token, COMPLETE);
-    DeQueueMessage(&TWI_Peripheral0.pTransmitBuffer);
+    UpdateMessageStatus(TWI_Peripheral0.sTransmitQueue.psHead->u32Token, COMPLETE);
+    DeQueueMessage(&TWI_Peripheral0.sTransmitQueue);
 
     
     /* Advance states depending on whether TXCOMP is expected */
@@ -744,6 +1508,50 @@ static void TwiSM_NextTransferDelay(void)
 } /* TwiSM_NextTransferDelay */
 
 
+/*!-------------------------------------------------------------------------------------------------------------------
+@fn static void TwiSM_Transactions(void)
+@brief The ISR is running queued transactions; wait for it to give the bus back and time out a 
+transaction that never finishes.
+*/
+static void TwiSM_Transactions(void)
+{
+  bool bTimeout = FALSE;
+
+  if( !(TWI_Peripheral0.u32PrivateFlags & _TWI_TRANSACTIONS) )
+  {
+    /* Make sure _TWI_INIT_MODE flag is clear if there is nothing more to do */
+    if( (TWI_u8MsgQueueCount == 0) && (TWI_psTransactionHead == NULL) )
+    {
+      TWI_u32Flags &= ~_TWI_INIT_MODE;
+    }
+
+    TWI_pfnStateMachine = TwiSM_Idle;
+    return;
+  }
+
+  if( IsTimeUp(&TWI_u32TransactionTimer, U32_TWI_TRANSACTION_TIMEOUT_MS) )
+  {
+    /* Check again with interrupts off since the ISR may have just moved on to the next transaction */
+    __disable_irq();
+    if( (TWI_Peripheral0.u32PrivateFlags & _TWI_TRANSACTIONS) && 
+        IsTimeUp(&TWI_u32TransactionTimer, U32_TWI_TRANSACTION_TIMEOUT_MS) )
+    {
+      TWI_Peripheral0.pBaseAddress->TWI_PTCR = AT91C_PDC_TXTDIS | AT91C_PDC_RXTDIS;
+      TWI_Peripheral0.pBaseAddress->TWI_CR = AT91C_TWI_STOP;
+      TwiTransactionFinish(TIMEOUT);
+      bTimeout = TRUE;
+    }
+    __enable_irq();
+
+    if(bTimeout)
+    {
+      DebugPrintf("TWI transaction timeout\n\r");
+    }
+  }
+
+} /* end TwiSM_Transactions() */
+
+
 /*!-------------------------------------------------------------------------------------------------------------------
 @fn static void TwiSM_Error(void)
 @brief Handle an error 
@@ -755,12 +1563,12 @@ static void TwiSM_Error(void)
   {
     /* Announce the error and clear flag */
     TWI_u32Flags &= ~_TWI_ERROR_NACK;
-    DebugPrintNumber(TWI_Peripheral0.pTransmitBuffer->u32Token);
+    DebugPrintNumber(TWI_Peripheral0.sTransmitQueue.psHead->u32Token);
     DebugPrintf(" TWI NACK. Message deleted.\n\r");
     
     /* Clear flags and clean up the Message task message */
-    UpdateMessageStatus(TWI_Peripheral0.pTransmitBuffer->u32Token, FAILED);
-    DeQueueMessage(&TWI_Peripheral0.pTransmitBuffer);
+    UpdateMessageStatus(TWI_Peripheral0.sTransmitQueue.psHead->u32Token, FAILED);
+    DeQueueMessage(&TWI_Peripheral0.sTransmitQueue);
     TWI_Peripheral0.u32PrivateFlags &= ~_TWI_TRANSMITTING;
   }
   
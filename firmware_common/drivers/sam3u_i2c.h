@@ -26,6 +26,68 @@ typedef enum {TWI_STOP, TWI_NO_STOP, TWI_NA} TwiStopType;
 typedef enum {TWI_EMPTY, TWI_WRITE, TWI_READ} TwiDirectionType;
 
 
+/*! 
+@enum TwiBusSpeedType
+@brief SCL rates a slave can be run at (see TwiSetDeviceSpeed()).  Order matches TWI_asBusSpeeds[].
+*/
+typedef enum {TWI_SPEED_100KHZ, TWI_SPEED_200KHZ, TWI_SPEED_400KHZ} TwiBusSpeedType;
+
+
+/*! 
+@struct TwiDeviceSpeedType
+@brief Bus speed profile of one slave address 
+*/
+typedef struct
+{
+  u8 u8Address;                        /*!< @brief Slave address (0 = unused entry) */
+  TwiBusSpeedType eSpeed;              /*!< @brief SCL rate used for every transfer to the slave */
+} TwiDeviceSpeedType;
+
+
+/*! 
+@struct TwiBusSpeedInfoType
+@brief Clock waveform for one TwiBusSpeedType 
+*/
+typedef struct
+{
+  u32 u32Cwgr;                         /*!< @brief TWI_CWGR value */
+  u16 u16Khz;                          /*!< @brief Resulting SCL rate for reports */
+} TwiBusSpeedInfoType;
+
+
+/*! 
+@struct TwiTransactionType
+@brief A transfer queued with TwiQueueTransaction().  The caller owns the descriptor and its data, 
+which must stay valid until eState is final.
+
+- Write: eDirection = TWI_WRITE; pu8Data/u32Size are the bytes to write, then STOP
+- Read: eDirection = TWI_READ and u8RegisterSize = 0; u32Size bytes are read into pu8Data
+- Write-then-read: eDirection = TWI_READ with u8RegisterSize 1 to 3; u32Register is written first
+  and the read follows with a repeated START
+*/
+typedef struct TwiTransaction TwiTransactionType;
+
+/*! 
+@typedef TwiTransactionCallbackType
+@brief Called with the descriptor when a transaction finishes, usually from the TWI ISR
+*/
+typedef void(*TwiTransactionCallbackType)(TwiTransactionType* psTransaction_);
+
+struct TwiTransaction
+{
+  u8 u8Address;                        /*!< @brief Slave address */
+  TwiDirectionType eDirection;         /*!< @brief TWI_WRITE or TWI_READ */
+  u8 u8RegisterSize;                   /*!< @brief READ ONLY: bytes of u32Register to write before the read (0 = plain read) */
+  u32 u32Register;                     /*!< @brief READ ONLY: slave register to start reading from */
+  u8* pu8Data;                         /*!< @brief Bytes to write, or where read bytes go */
+  u32 u32Size;                         /*!< @brief Bytes to write or read (at least 1) */
+  TwiTransactionCallbackType pfnCallback; /*!< @brief Called when the transaction finishes (NULL if none) */
+  void* pvContext;                     /*!< @brief For the caller's use (e.g. in pfnCallback) */
+  volatile MessageStateType eState;    /*!< @brief Set by the driver: WAITING, SENDING, then COMPLETE, FAILED (NACK) or TIMEOUT */
+  TwiTransactionType* psNext;          /*!< @brief Driver use: next queued transaction */
+};
+
+
 /*! 
 @struct TwiPeripheralType
 @brief User-defined TWI configuration information 
@@ -33,13 +95,15 @@ typedef enum {TWI_EMPTY, TWI_WRITE, TWI_READ} TwiDirectionType;
 typedef struct 
 {
   AT91PS_TWI pBaseAddress;             /*!< @brief Base address of the associated peripheral */
-  MessageType* pTransmitBuffer;        /*!< @brief Pointer to the transmit message struct linked list */
+  MessageQueueType sTransmitQueue;    /*!< @brief Transmit message linked list */
   u32 u32PrivateFlags;                 /*!< @brief Private peripheral flags */
 } TwiPeripheralType;
 
 /* u32PrivateFlags definitions in TwiPeripheralType */
 #define _TWI_TRANSMITTING              (u32)0x00000001   /* Peripheral is Transmitting */
 #define _TWI_RECEIVING                 (u32)0x00000002   /* Peripheral is Receiving */
+#define _TWI_TRANSACTIONS              (u32)0x00000004   /* Peripheral is running queued transactions (TwiQueueTransaction()) */
+#define _TWI_TRANSACTION_NACK          (u32)0x00000008   /* The current transaction was not acknowledged */
  
 #define _TWI_ERROR_TX_MSG_SYNC         (u32)0x01000000  /*!< @brief Local Tx message token != queued token */
 /* end u32PrivateFlags */
@@ -67,6 +131,7 @@ Constants / Definitions
 **********************************************************************************************************************/
 /* TWI_u32Flags */
 #define _TWI_INIT_MODE                 (u32)0x00000001     /*!< @brief Set to push a transmit cycle during initialization mode */
+#define _TWI_BENCHMARK                 (u32)0x00000002     /*!< @brief Set while en+c twibench is running */
 
 #define _TWI_ERROR_NACK                (u32)0x01000000     /*!< @brief Set if a NACK is received */
 #define _TWI_ERROR_INTERRUPT           (u32)0x02000000     /*!< @brief Set if an unexpected interrupt occurs */
@@ -79,6 +144,23 @@ Constants / Definitions
 
 #define U8_NEXT_TRANSFER_DELAY_MS      (u8)1               /*!< @brief Time before next transfer will begin */
 #define U32_RX_TIMEOUT_MS              (u32)3000           /*!< @brief Max time allowed for Rx message */
+#define U32_TWI_TRANSACTION_TIMEOUT_MS (u32)100            /*!< @brief Max time allowed for one queued transaction (about 2 KB at 200 kHz) */
+#define U8_TWI_MAX_REGISTER_SIZE       (u8)3               /*!< @brief Largest u8RegisterSize the peripheral can send (IADRSZ) */
+#define U8_TWI_MAX_DEVICE_SPEEDS       (u8)8               /*!< @brief Number of slaves that can have their own bus speed */
+
+/* TWI_CWGR values (see the calculation with EIE_TWI_CWGR_INIT in configuration.h).  
+400 kHz is the fastest rate the SAM3U TWI supports. */
+#define U32_TWI_CWGR_100KHZ            (u32)0x00023B3B
+#define U32_TWI_CWGR_200KHZ            (u32)0x00021D1D
+#define U32_TWI_CWGR_400KHZ            (u32)0x00030707
+
+/* en+c twibench reads one LSM6DSL sample (OUT_TEMP_L to OUTZ_H_XL) over and over at each speed */
+#define U8_TWI_BENCH_ADDRESS           (u8)0x6B            /*!< @brief Slave read by the benchmark (LSM6DSL on the IMU blade) */
+#define U8_TWI_BENCH_REGISTER          (u8)0x20            /*!< @brief First register of each read */
+#define U8_TWI_BENCH_READ_SIZE         (u8)14              /*!< @brief Bytes per read */
+#define U16_TWI_BENCH_READS            (u16)250            /*!< @brief Reads timed at each speed */
+#define U8_TWI_BENCH_IN_FLIGHT         (u8)8               /*!< @brief Reads kept queued so the bus never waits for the task */
+#define U32_TWI_BENCH_TIMEOUT_MS       (u32)2000           /*!< @brief Max time for the reads at one speed */
 
 
 /*! @cond DOXYGEN_EXCLUDE */
@@ -99,6 +181,11 @@ Constants / Definitions
 bool TwiReadData(u8 u8SlaveAddress_, u8* pu8RxBuffer_, u32 u32Size_);
 bool TwiWriteReadData(u8 u8SlaveAddress_, u8 u8InternalAddress_, u8* pu8RxBuffer_, u32 u32Size_);
 u32 TwiWriteData(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eStop_);
+u32 TwiCommitData(u8 u8SlaveAddress_, MessageType* psMessage_, u32 u32Size_, TwiStopType eStop_);
+u32 TwiWriteDataNoCopy(u8 u8SlaveAddress_, u32 u32Size_, u8* pu8Data_, TwiStopType eStop_, MessageCallbackType pfnCallback_);
+bool TwiQueueTransaction(TwiTransactionType* psTransaction_);
+bool TwiSetDeviceSpeed(u8 u8SlaveAddress_, TwiBusSpeedType eSpeed_);
+u8 TwiGetFreeMessages(void);
 
 
 /*-------------------------------------------------------------------------------------------------------------------*/
@@ -114,6 +201,16 @@ void TWI0_IrqHandler(void);
 /*-------------------------------------------------------------------------------------------------------------------*/
 /*! @privatesection */                                                                                            
 /*-------------------------------------------------------------------------------------------------------------------*/
+static void TwiQueueWriteTask(u32 u32Token_, u8 u8SlaveAddress_, u32 u32Size_, TwiStopType eStop_);
+static void TwiTransactionStart(void);
+static void TwiTransactionFinish(MessageStateType eState_);
+static void TwiTransactionIsr(u32 u32InterruptStatus_);
+static void TwiSelectBusSpeed(u8 u8SlaveAddress_);
+
+static void TwiCommandBenchmark(void);
+static void TwiBenchmarkStartSpeed(void);
+static void TwiBenchmarkReadDone(TwiTransactionType* psTransaction_);
+static void TwiBenchmarkService(void);
 
 
 /***********************************************************************************************************************
@@ -130,6 +227,8 @@ static void TwiSM_ReceiveComplete(void);
 
 static void TwiSM_NextTransferDelay(void);       
 
+static void TwiSM_Transactions(void);
+
 static void TwiSM_Error(void);         
 
 
@@ -195,10 +195,10 @@ void SpiRelease(SpiPeripheralType* psSpiPeripheral_)
   psSpiPeripheral_->u32PrivateFlags = 0;
   
   /* Empty the transmit buffer if there were leftover messages */
-  while(psSpiPeripheral_->psTransmitBuffer != NULL)
+  while(psSpiPeripheral_->sTransmitQueue.psHead != NULL)
   {
-    UpdateMessageStatus(psSpiPeripheral_->psTransmitBuffer->u32Token, ABANDONED);
-    DeQueueMessage(&psSpiPeripheral_->psTransmitBuffer);
+    UpdateMessageStatus(psSpiPeripheral_->sTransmitQueue.psHead->u32Token, ABANDONED);
+    DeQueueMessage(&psSpiPeripheral_->sTransmitQueue);
   }
   
 } /* end SpiRelease() */
@@ -214,7 +214,7 @@ Requires:
 @param u8Byte_ is the byte to send
 
 Promises:
-- Creates a 1-byte message at psSpiPeripheral_->psTransmitBuffer that will be sent 
+- Creates a 1-byte message at psSpiPeripheral_->sTransmitQueue that will be sent 
   by the SPI application when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message 
   cannot be queued in which case G_u32MessagingFlags can be checked for the reason
@@ -226,7 +226,7 @@ u32 SpiWriteByte(SpiPeripheralType* psSpiPeripheral_, u8 u8Byte_)
   u8 u8Data = u8Byte_;
   
   /* Attempt to queue message and get a response token */
-  u32Token = QueueMessage(&psSpiPeripheral_->psTransmitBuffer, 1, &u8Data);
+  u32Token = QueueMessage(&psSpiPeripheral_->sTransmitQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
   if( u32Token != 0 )
   {
     /* If the system is initializing, we want to manually cycle the SPI task through one iteration
@@ -253,7 +253,7 @@ Requires:
 @param pu8Data_ points to the first byte of the data array
 
 Promises:
-- adds the data message at psSpiPeripheral_->psTransmitBuffer that will be sent by the SPI application
+- adds the data message at psSpiPeripheral_->sTransmitQueue that will be sent by the SPI application
   when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message 
   cannot be queued in which case G_u32MessagingFlags can be checked for the reason
@@ -270,7 +270,7 @@ u32 SpiWriteData(SpiPeripheralType* psSpiPeripheral_, u32 u32Size_, u8* pu8Data_
   }
 
   /* Attempt to queue message and get a response token */
-  u32Token = QueueMessage(&psSpiPeripheral_->psTransmitBuffer, u32Size_, pu8Data_);
+  u32Token = QueueMessage(&psSpiPeripheral_->sTransmitQueue, u32Size_, pu8Data_, MSG_PRIORITY_NORMAL);
   if( u32Token == 0 )
   {
     return(0);
@@ -299,7 +299,7 @@ Requires:
 @param psSpiPeripheral_ is the SPI peripheral to use and it has already been requested.
 
 Promises:
-- Creates a message with one SPI_DUMMY_BYTE at psSpiPeripheral_->psTransmitBuffer that will be sent by the SPI application
+- Creates a message with one SPI_DUMMY_BYTE at psSpiPeripheral_->sTransmitQueue that will be sent by the SPI application
   when it is available and thus clock in a received byte to the target receive buffer.
 - Returns TRUE and loads the target SPI u16RxBytes
 
@@ -313,7 +313,7 @@ bool SpiReadByte(SpiPeripheralType* psSpiPeripheral_)
   }
 
   /* Make sure no Tx or Rx function is already in progress */
-  if( (psSpiPeripheral_->u16RxBytes != 0) || (psSpiPeripheral_->psTransmitBuffer != NULL) )
+  if( (psSpiPeripheral_->u16RxBytes != 0) || (psSpiPeripheral_->sTransmitQueue.psHead != NULL) )
   {
     return FALSE;
   }
@@ -350,7 +350,7 @@ bool SpiReadData(SpiPeripheralType* psSpiPeripheral_, u16 u16Size_)
   }
 
   /* Make sure no Tx or Rx function is already in progress */
-  if( (psSpiPeripheral_->u16RxBytes != 0) || (psSpiPeripheral_->psTransmitBuffer != NULL) )
+  if( (psSpiPeripheral_->u16RxBytes != 0) || (psSpiPeripheral_->sTransmitQueue.psHead != NULL) )
   {
     return FALSE;
   }
@@ -445,7 +445,9 @@ void SpiInitialize(void)
   SPI_Peripheral0.pBaseAddress     = AT91C_BASE_SPI0;
   SPI_Peripheral0.u8PeripheralId   = AT91C_ID_SPI0;
   SPI_Peripheral0.pCsGpioAddress   = NULL;
-  SPI_Peripheral0.psTransmitBuffer = NULL;
+  SPI_Peripheral0.sTransmitQueue.psHead = NULL;
+  SPI_Peripheral0.sTransmitQueue.psTail = NULL;
+  SPI_Peripheral0.sTransmitQueue.u8PeripheralId = AT91C_ID_SPI0;
   SPI_Peripheral0.pu8RxBuffer      = NULL;
   SPI_Peripheral0.u16RxBufferSize  = 0;
   SPI_Peripheral0.ppu8RxNextByte   = NULL;
@@ -620,8 +622,8 @@ void SPI0_IrqHandler(void)
       {
         SPI_Peripheral0.u32PrivateFlags &= ~_SPI_PERIPHERAL_TX;  
         G_u32Spi0ApplicationFlags |= _SPI_TX_COMPLETE; 
-        UpdateMessageStatus(SPI_Peripheral0.psTransmitBuffer->u32Token, COMPLETE);
-        DeQueueMessage(&SPI_Peripheral0.psTransmitBuffer);
+        UpdateMessageStatus(SPI_Peripheral0.sTransmitQueue.psHead->u32Token, COMPLETE);
+        DeQueueMessage(&SPI_Peripheral0.sTransmitQueue);
       }
     }
   } /* end AT91C_SPI_TDRE */
@@ -654,7 +656,7 @@ static void SpiSM_Idle(void)
 {
   u32 u32Byte;
 
-  if( ( (SPI_Peripheral0.psTransmitBuffer != NULL) || (SPI_Peripheral0.u16RxBytes !=0) ) && 
+  if( ( (SPI_Peripheral0.sTransmitQueue.psHead != NULL) || (SPI_Peripheral0.u16RxBytes !=0) ) && 
      !(SPI_Peripheral0.u32PrivateFlags & (_SPI_PERIPHERAL_TX | _SPI_PERIPHERAL_RX) ) 
     )
   {
@@ -686,12 +688,12 @@ static void SpiSM_Idle(void)
     else
     {
       /* Transmitting: update the message's status and flag that the peripheral is now busy */
-      UpdateMessageStatus(SPI_Peripheral0.psTransmitBuffer->u32Token, SENDING);
+      UpdateMessageStatus(SPI_Peripheral0.sTransmitQueue.psHead->u32Token, SENDING);
       SPI_Peripheral0.u32PrivateFlags |= _SPI_PERIPHERAL_TX;    
       
       /* Load in the message parameters. */
-      SPI_Peripheral0.u32CurrentTxBytesRemaining = SPI_Peripheral0.psTransmitBuffer->u32Size;
-      SPI_Peripheral0.pu8CurrentTxData = SPI_Peripheral0.psTransmitBuffer->pu8Message;
+      SPI_Peripheral0.u32CurrentTxBytesRemaining = SPI_Peripheral0.sTransmitQueue.psHead->u32Size;
+      SPI_Peripheral0.pu8CurrentTxData = SPI_Peripheral0.sTransmitQueue.psHead->pu8Data;
        
       /* Load first byte.  If we need LSB first, use inline assembly to flip bits with a single instruction. */
       u32Byte = 0x000000FF &  *SPI_Peripheral0.pu8CurrentTxData;
@@ -66,7 +66,7 @@ typedef struct
   u8** ppu8RxNextByte;                /*!< @brief Pointer to buffer location where next received byte will be placed (SPI_SLAVE_FLOW_CONTROL only) */
   u16 u16RxBufferSize;                /*!< @brief Size of receive buffer in bytes */
   u16 u16RxBytes;                     /*!< @brief Number of bytes to receive */
-  MessageType* psTransmitBuffer;      /*!< @brief Pointer to the transmit message struct linked list */
+  MessageQueueType sTransmitQueue;    /*!< @brief Transmit message linked list */
   u32 u32CurrentTxBytesRemaining;     /*!< @brief Counter for bytes remaining in current transfer */
   u8* pu8CurrentTxData;               /*!< @brief Pointer to current location in the Tx buffer */
 } SpiPeripheralType;
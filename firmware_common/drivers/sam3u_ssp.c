@@ -39,6 +39,10 @@ SspWriteData() which both return a message token unique to the queued message.
 Once the data is queued, it is sent by the SSP as soon as possible.  Different 
 SSP resources may transmit and receive data simultaneously.  
 
+Large transfers can skip the copy into the message pool: SspCommitData() queues a
+message that was borrowed with ReserveMessage() and filled in place, and 
+SspWriteDataNoCopy() sends straight from the caller's buffer and calls back when done.
+
 The SPI protocol always receives a byte with every transmitted byte.  This may 
 be a defined dummy byte, or it may be 0xFF or 0x00 depending on the idle state 
 of the MISO line.  Your application must process the received bytes and determine 
@@ -114,6 +118,9 @@ PUBLIC FUNCTIONS
 - void SspDeAssertCS(SspPeripheralType* psSspPeripheral_)
 - u32 SspWriteByte(SspPeripheralType* psSspPeripheral_, u8 u8Byte_)
 - u32 SspWriteData(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_)
+- u32 SspWriteDataPriority(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
+- u32 SspCommitData(SspPeripheralType* psSspPeripheral_, MessageType* psMessage_, u32 u32Size_)
+- u32 SspWriteDataNoCopy(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
 
 Master mode only:
 - bool SspReadByte(SspPeripheralType* psSspPeripheral_)
@@ -371,10 +378,10 @@ void SspRelease(SspPeripheralType* psSspPeripheral_)
   psSspPeripheral_->fnSlaveRxFlowCallback = NULL;
 
   /* Empty the transmit buffer if there were leftover messages */
-  while(psSspPeripheral_->psTransmitBuffer != NULL)
+  while(psSspPeripheral_->sTransmitQueue.psHead != NULL)
   {
-    UpdateMessageStatus(psSspPeripheral_->psTransmitBuffer->u32Token, ABANDONED);
-    DeQueueMessage(&psSspPeripheral_->psTransmitBuffer);
+    UpdateMessageStatus(psSspPeripheral_->sTransmitQueue.psHead->u32Token, ABANDONED);
+    DeQueueMessage(&psSspPeripheral_->sTransmitQueue);
   }
   
   /* Ensure the SM is in the Idle state */
@@ -443,7 +450,7 @@ Requires:
 @param u8Byte_ is the byte to send
 
 Promises:
-- Creates a 1-byte message at psSspPeripheral_->psTransmitBuffer that will be sent 
+- Creates a 1-byte message at psSspPeripheral_->sTransmitQueue that will be sent 
   by the SSP application when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message 
   cannot be queued in which case G_u32MessagingFlags can be checked for the reason
@@ -460,7 +467,7 @@ u32 SspWriteByte(SspPeripheralType* psSspPeripheral_, u8 u8Byte_)
     return(0);
   }
 
-  u32Token = QueueMessage(&psSspPeripheral_->psTransmitBuffer, 1, &u8Data);
+  u32Token = QueueMessage(&psSspPeripheral_->sTransmitQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
   if( u32Token != 0 )
   {
     /* If the system is initializing, we want to manually cycle the SSP task through one iteration
@@ -489,13 +496,43 @@ Requires:
 @param pu8Data_ points to the first byte of the data array
 
 Promises:
-- adds the data message at psSspPeripheral_->psTransmitBuffer that will be sent by the SSP application
+- adds the data message at psSspPeripheral_->sTransmitQueue that will be sent by the SSP application
   when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message 
   cannot be queued in which case G_u32MessagingFlags can be checked for the reason
 
 */
 u32 SspWriteData(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_)
+{
+  return( SspWriteDataPriority(psSspPeripheral_, u32Size_, pu8Data_, MSG_PRIORITY_NORMAL) );
+
+} /* end SspWriteData() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u32 SspWriteDataPriority(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
+
+@brief Queues a data array for transfer on the target SSP peripheral at the given priority.  
+
+A MSG_PRIORITY_HIGH message is sent as soon as the message currently being sent is finished, ahead 
+of any normal messages already queued (see messaging.c).
+
+Requires:
+- A receive request cannot be in progress
+
+@param psSspPeripheral_ is the SSP peripheral to use and it has already been requested.
+@param u32Size_ is the number of bytes in the data array
+@param pu8Data_ points to the first byte of the data array
+@param ePriority_ is the transmit priority of the message
+
+Promises:
+- adds the data message at psSspPeripheral_->sTransmitQueue that will be sent by the SSP application
+  when it is available.
+- Returns the message token assigned to the message; 0 is returned if the message 
+  cannot be queued in which case G_u32MessagingFlags can be checked for the reason
+
+*/
+u32 SspWriteDataPriority(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
 {
   u32 u32Token;
 
@@ -505,7 +542,7 @@ u32 SspWriteData(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_
     return(0);
   }
 
-  u32Token = QueueMessage(&psSspPeripheral_->psTransmitBuffer, u32Size_, pu8Data_);
+  u32Token = QueueMessage(&psSspPeripheral_->sTransmitQueue, u32Size_, pu8Data_, ePriority_);
   if( u32Token == 0 )
   {
     return(0);
@@ -519,7 +556,97 @@ u32 SspWriteData(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_
 
   return(u32Token);
 
-} /* end SspWriteData() */
+} /* end SspWriteDataPriority() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u32 SspCommitData(SspPeripheralType* psSspPeripheral_, MessageType* psMessage_, u32 u32Size_)
+
+@brief Queues a message from ReserveMessage() that the caller has already filled in.  
+
+Requires:
+- A receive request cannot be in progress
+
+@param psSspPeripheral_ is the SSP peripheral to use and it has already been requested.
+@param psMessage_ was returned by ReserveMessage() and holds the data to send in pu8Data
+@param u32Size_ is the number of bytes written to psMessage_->pu8Data
+
+Promises:
+- The message is queued without copying and its token is returned
+- Returns 0 if the message could not be committed, in which case the caller still owns it and
+  must commit it again or call ReleaseMessage()
+
+*/
+u32 SspCommitData(SspPeripheralType* psSspPeripheral_, MessageType* psMessage_, u32 u32Size_)
+{
+  u32 u32Token;
+
+  /* Make sure no receive function is already in progress based on the bytes in the buffer */
+  if( psSspPeripheral_->u16RxBytes != 0)
+  {
+    return(0);
+  }
+
+  u32Token = CommitMessage(&psSspPeripheral_->sTransmitQueue, psMessage_, u32Size_);
+  if( u32Token == 0 )
+  {
+    return(0);
+  }
+  
+  /* If the system is initializing, manually cycle the SSP task through one iteration to send the message */
+  if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
+  {
+    SspManualMode();
+  }
+
+  return(u32Token);
+
+} /* end SspCommitData() */
+
+
+/*!--------------------------------------------------------------------------------------------------------------------
+@fn u32 SspWriteDataNoCopy(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+
+@brief Queues a data array that is sent directly from the caller's buffer.  
+
+Requires:
+- A receive request cannot be in progress
+
+@param psSspPeripheral_ is the SSP peripheral to use and it has already been requested.
+@param u32Size_ is the number of bytes in the data array (up to U16_MAX_NO_COPY_MESSAGE_LENGTH)
+@param pu8Data_ points to the first byte of the data array which must not change until the message is done
+@param pfnCallback_ is called from the SSP ISR when the message is done (may be NULL)
+
+Promises:
+- Returns the message token assigned to the message; 0 is returned if the message 
+  cannot be queued in which case G_u32MessagingFlags can be checked for the reason
+
+*/
+u32 SspWriteDataNoCopy(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+{
+  u32 u32Token;
+
+  /* Make sure no receive function is already in progress based on the bytes in the buffer */
+  if( psSspPeripheral_->u16RxBytes != 0)
+  {
+    return(0);
+  }
+
+  u32Token = QueueMessageNoCopy(&psSspPeripheral_->sTransmitQueue, u32Size_, pu8Data_, pfnCallback_);
+  if( u32Token == 0 )
+  {
+    return(0);
+  }
+  
+  /* If the system is initializing, manually cycle the SSP task through one iteration to send the message */
+  if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
+  {
+    SspManualMode();
+  }
+
+  return(u32Token);
+
+} /* end SspWriteDataNoCopy() */
 
 
 /*!--------------------------------------------------------------------------------------------------------------------
@@ -534,7 +661,7 @@ Requires:
 @param psSspPeripheral_ is the SSP peripheral to use and it has already been requested.
 
 Promises:
-- Creates a message with one SSP_DUMMY_BYTE at psSspPeripheral_->psTransmitBuffer that will be sent by the SSP application
+- Creates a message with one SSP_DUMMY_BYTE at psSspPeripheral_->sTransmitQueue that will be sent by the SSP application
   when it is available and thus clock in a received byte to the target receive buffer.
 - Returns TRUE and loads the target SSP u16RxBytes
 
@@ -549,7 +676,7 @@ bool SspReadByte(SspPeripheralType* psSspPeripheral_)
   }
 
   /* Make sure no Tx or Rx function is already in progress */
-  if( (psSspPeripheral_->u16RxBytes != 0) || (psSspPeripheral_->psTransmitBuffer != NULL) )
+  if( (psSspPeripheral_->u16RxBytes != 0) || (psSspPeripheral_->sTransmitQueue.psHead != NULL) )
   {
     return FALSE;
   }
@@ -587,7 +714,7 @@ bool SspReadData(SspPeripheralType* psSspPeripheral_, u16 u16Size_)
   }
 
   /* Make sure no Tx or Rx function is already in progress */
-  if( (psSspPeripheral_->u16RxBytes != 0) || (psSspPeripheral_->psTransmitBuffer != NULL) )
+  if( (psSspPeripheral_->u16RxBytes != 0) || (psSspPeripheral_->sTransmitQueue.psHead != NULL) )
   {
     return FALSE;
   }
@@ -683,7 +810,9 @@ void SspInitialize(void)
   SSP_Peripheral0.pBaseAddress     = AT91C_BASE_US0;
   SSP_Peripheral0.u8PeripheralId   = AT91C_ID_US0;
   SSP_Peripheral0.pCsGpioAddress   = NULL;
-  SSP_Peripheral0.psTransmitBuffer = NULL;
+  SSP_Peripheral0.sTransmitQueue.psHead = NULL;
+  SSP_Peripheral0.sTransmitQueue.psTail = NULL;
+  SSP_Peripheral0.sTransmitQueue.u8PeripheralId = AT91C_ID_US0;
   SSP_Peripheral0.pu8RxBuffer      = NULL;
   SSP_Peripheral0.u16RxBufferSize  = 0;
   SSP_Peripheral0.ppu8RxNextByte   = NULL;
@@ -692,7 +821,9 @@ void SspInitialize(void)
   SSP_Peripheral1.pBaseAddress     = AT91C_BASE_US1;
   SSP_Peripheral1.u8PeripheralId   = AT91C_ID_US1;
   SSP_Peripheral1.pCsGpioAddress   = NULL;
-  SSP_Peripheral1.psTransmitBuffer = NULL;
+  SSP_Peripheral1.sTransmitQueue.psHead = NULL;
+  SSP_Peripheral1.sTransmitQueue.psTail = NULL;
+  SSP_Peripheral1.sTransmitQueue.u8PeripheralId = AT91C_ID_US1;
   SSP_Peripheral1.pu8RxBuffer      = NULL;
   SSP_Peripheral1.u16RxBufferSize  = 0;
   SSP_Peripheral1.ppu8RxNextByte   = NULL;
@@ -701,7 +832,9 @@ void SspInitialize(void)
   SSP_Peripheral2.pBaseAddress     = AT91C_BASE_US2;
   SSP_Peripheral2.u8PeripheralId   = AT91C_ID_US2;
   SSP_Peripheral2.pCsGpioAddress   = NULL;
-  SSP_Peripheral2.psTransmitBuffer = NULL;
+  SSP_Peripheral2.sTransmitQueue.psHead = NULL;
+  SSP_Peripheral2.sTransmitQueue.psTail = NULL;
+  SSP_Peripheral2.sTransmitQueue.u8PeripheralId = AT91C_ID_US2;
   SSP_Peripheral2.pu8RxBuffer      = NULL;
   SSP_Peripheral2.u16RxBufferSize  = 0;
   SSP_Peripheral2.ppu8RxNextByte   = NULL;
@@ -874,7 +1007,12 @@ TXEMPTY: Transmit for Flow Control Slaves
 RXRDY: Receive for Flow Control Slaves
 
 ENDTX: An End Transmit interrupt will occur when the PDC has finished sending all 
-of the bytes for Master or Slave.
+of the bytes for Master or Slave.  For a Master sending a message that was split
+across several message slots, it occurs at the end of each piece while the PDC 
+continues with the next piece from TNPR/TNCR.
+
+TXBUFE: Used instead of ENDTX for the last piece of a Master message once there 
+is no further piece to load.
 
 ENDRX: An End Receive interrupt will occur when the PDC has finished receiving all 
 of the expected bytes for Master or a single byte for Slave.
@@ -915,7 +1053,7 @@ static void SspGenericHandler(void)
       /* If a no flow control Slave is receiving, then it should be ready to respond with dummy bytes */
       if(SSP_psCurrentISR->eSspMode == SSP_SLAVE)
       {
-        if(SSP_psCurrentISR->psTransmitBuffer == NULL)
+        if(SSP_psCurrentISR->sTransmitQueue.psHead == NULL)
         {
           SSP_psCurrentISR->pBaseAddress->US_THR = SSP_DUMMY_BYTE;
         }
@@ -940,8 +1078,8 @@ static void SspGenericHandler(void)
         SSP_psCurrentISR->pBaseAddress->US_IDR = AT91C_US_ENDTX;
         
         SSP_psCurrentISR->u32PrivateFlags &= ~_SSP_PERIPHERAL_TX;  
-        UpdateMessageStatus(SSP_psCurrentISR->psTransmitBuffer->u32Token, ABANDONED);
-        DeQueueMessage(&SSP_psCurrentISR->psTransmitBuffer);
+        UpdateMessageStatus(SSP_psCurrentISR->sTransmitQueue.psHead->u32Token, ABANDONED);
+        DeQueueMessage(&SSP_psCurrentISR->sTransmitQueue);
    
         *SSP_pu32SspApplicationFlagsISR |= _SSP_TX_COMPLETE; 
         
@@ -996,8 +1134,8 @@ static void SspGenericHandler(void)
       
       /* Clean up the message status and flags */
       *SSP_pu32SspApplicationFlagsISR |= _SSP_TX_COMPLETE; 
-      UpdateMessageStatus(SSP_psCurrentISR->psTransmitBuffer->u32Token, COMPLETE);
-      DeQueueMessage(&SSP_psCurrentISR->psTransmitBuffer);
+      UpdateMessageStatus(SSP_psCurrentISR->sTransmitQueue.psHead->u32Token, COMPLETE);
+      DeQueueMessage(&SSP_psCurrentISR->sTransmitQueue);
       SSP_psCurrentISR->u32PrivateFlags &= ~_SSP_PERIPHERAL_TX;  
  
       /* Re-enable Rx interrupt and make final call to callback */    
@@ -1085,16 +1223,48 @@ static void SspGenericHandler(void)
   } /* end ENDRX handling */
 
 
-  /* ENDTX Interrupt when all requested transmit bytes have been sent (if enabled) */
-  if( (SSP_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDTX) && 
-      (u32Current_CSR & AT91C_US_ENDTX) )
+  /* ENDTX Interrupt when all requested transmit bytes have been sent (if enabled), or TXBUFE
+  when the last piece of a Master message has been sent */
+  if( ( (SSP_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDTX) && 
+        (u32Current_CSR & AT91C_US_ENDTX) ) ||
+      ( (SSP_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_TXBUFE) && 
+        (u32Current_CSR & AT91C_US_TXBUFE) ) )
   {
     /* If this was a non-dummy transmit... */
     if(SSP_psCurrentISR->u32PrivateFlags & _SSP_PERIPHERAL_TX)
     {
       /* Update this message token status and then DeQueue it */
-      UpdateMessageStatus(SSP_psCurrentISR->psTransmitBuffer->u32Token, COMPLETE);
-      DeQueueMessage(&SSP_psCurrentISR->psTransmitBuffer);
+      UpdateMessageStatus(SSP_psCurrentISR->sTransmitQueue.psHead->u32Token, COMPLETE);
+      DeQueueMessage(&SSP_psCurrentISR->sTransmitQueue);
+      
+      /* The piece loaded next is the head now; it may have finished as well if this interrupt was late */
+      if(SSP_psCurrentISR->u32PrivateFlags & _SSP_PERIPHERAL_TX_NEXT)
+      {
+        SSP_psCurrentISR->u32PrivateFlags &= ~_SSP_PERIPHERAL_TX_NEXT;
+        if(SSP_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_TXBUFE)
+        {
+          UpdateMessageStatus(SSP_psCurrentISR->sTransmitQueue.psHead->u32Token, COMPLETE);
+          DeQueueMessage(&SSP_psCurrentISR->sTransmitQueue);
+          
+          /* The PDC is empty: a further piece of the same message restarts it with CS still asserted */
+          if( (SSP_psCurrentISR->sTransmitQueue.psHead != NULL) &&
+              (SSP_psCurrentISR->sTransmitQueue.psHead->u8Continuation) )
+          {
+            UpdateMessageStatus(SSP_psCurrentISR->sTransmitQueue.psHead->u32Token, SENDING);
+            SSP_psCurrentISR->pBaseAddress->US_TPR = (unsigned int)SSP_psCurrentISR->sTransmitQueue.psHead->pu8Data;
+            SSP_psCurrentISR->pBaseAddress->US_TCR = SSP_psCurrentISR->sTransmitQueue.psHead->u32Size;
+            SspLoadNextPiece(SSP_psCurrentISR);
+            return;
+          }
+        }
+        else
+        {
+          /* Keep CS asserted and line up the piece after it */
+          SspLoadNextPiece(SSP_psCurrentISR);
+          return;
+        }
+      }
+      
       SSP_psCurrentISR->u32PrivateFlags &= ~_SSP_PERIPHERAL_TX;
     }
  
@@ -1106,7 +1276,7 @@ static void SspGenericHandler(void)
         (SSP_psCurrentISR->eSspMode == SSP_MASTER_MANUAL_CS) )
     {
       SSP_psCurrentISR->pBaseAddress->US_PTCR = AT91C_PDC_TXTDIS;
-      SSP_psCurrentISR->pBaseAddress->US_IDR  = AT91C_US_ENDTX;
+      SSP_psCurrentISR->pBaseAddress->US_IDR  = AT91C_US_ENDTX | AT91C_US_TXBUFE;
     }
 
     /* Allow the peripheral to finish clocking out the Tx byte */
@@ -1129,6 +1299,47 @@ static void SspGenericHandler(void)
 } /* end SspGenericHandler() */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void SspLoadNextPiece(SspPeripheralType* psSsp_)
+
+@brief Loads the next piece of a split message into the PDC "next" registers so a Master sends
+the whole message without a gap or a CS change between pieces.
+
+Each queued message is a separate transaction for the Slave, so only pieces that QueueMessage() split
+from the message being sent are loaded ahead.
+
+Requires:
+@param psSsp_ is a Master transmitting the message at the head of its queue with nothing loaded in TNPR/TNCR
+
+Promises:
+- If the next queued message is a later piece of the current one, it is started with StartNextMessage()
+  and loaded in TNPR/TNCR, _SSP_PERIPHERAL_TX_NEXT is set and the ENDTX interrupt is enabled (TXBUFE disabled)
+- Otherwise the TXBUFE interrupt is enabled (ENDTX disabled)
+
+*/
+static void SspLoadNextPiece(SspPeripheralType* psSsp_)
+{
+  MessageType* psNextPiece = StartNextMessage(&psSsp_->sTransmitQueue, TRUE);
+  
+  if(psNextPiece != NULL)
+  {
+    /* Writing TNCR also clears ENDTX from the piece that just finished */
+    psSsp_->pBaseAddress->US_TNPR = (unsigned int)psNextPiece->pu8Data;
+    psSsp_->pBaseAddress->US_TNCR = psNextPiece->u32Size;
+    psSsp_->u32PrivateFlags |= _SSP_PERIPHERAL_TX_NEXT;
+    
+    psSsp_->pBaseAddress->US_IDR = AT91C_US_TXBUFE;
+    psSsp_->pBaseAddress->US_IER = AT91C_US_ENDTX;
+  }
+  else
+  {
+    psSsp_->pBaseAddress->US_IDR = AT91C_US_ENDTX;
+    psSsp_->pBaseAddress->US_IER = AT91C_US_TXBUFE;
+  }
+  
+} /* end SspLoadNextPiece() */
+
+
 /***********************************************************************************************************************
 State Machine Function Definitions
 
@@ -1152,11 +1363,11 @@ static void SspSM_Idle(void)
   /* Check all SPI/SSP peripherals for message activity or skip the current peripheral 
   if it is already busy.
   Slave devices receive outside of the state machine.
-  For Master devices sending a message, SSP_psCurrentSsp->psTransmitBuffer->pu8Message will 
+  For Master devices sending a message, SSP_psCurrentSsp->sTransmitQueue.psHead->pu8Data will 
   point to the application transmit buffer.
   For Master devices receiving a message, SSP_psCurrentSsp->u16RxBytes will != 0. Dummy bytes 
   are sent. */
-  if( ( (SSP_psCurrentSsp->psTransmitBuffer != NULL) || (SSP_psCurrentSsp->u16RxBytes !=0) ) && 
+  if( ( (SSP_psCurrentSsp->sTransmitQueue.psHead != NULL) || (SSP_psCurrentSsp->u16RxBytes !=0) ) && 
      !(SSP_psCurrentSsp->u32PrivateFlags & (_SSP_PERIPHERAL_TX | _SSP_PERIPHERAL_RX)       ) 
     )
   {
@@ -1193,7 +1404,7 @@ static void SspSM_Idle(void)
     else
     {
       /* Transmitting: update the message's status and flag that the peripheral is now busy */
-      UpdateMessageStatus(SSP_psCurrentSsp->psTransmitBuffer->u32Token, SENDING);
+      UpdateMessageStatus(SSP_psCurrentSsp->sTransmitQueue.psHead->u32Token, SENDING);
       SSP_psCurrentSsp->u32PrivateFlags |= _SSP_PERIPHERAL_TX;    
       
       /* TRANSMIT SPI_SSP_SLAVE_FLOW_CONTROL */ 
@@ -1203,8 +1414,8 @@ static void SspSM_Idle(void)
         CS must be asserted for the Slave to have queued data to get to here. */
 
         /* Load in the message parameters. */
-        SSP_psCurrentSsp->u32CurrentTxBytesRemaining = SSP_psCurrentSsp->psTransmitBuffer->u32Size;
-        SSP_psCurrentSsp->pu8CurrentTxData = SSP_psCurrentSsp->psTransmitBuffer->pu8Message;
+        SSP_psCurrentSsp->u32CurrentTxBytesRemaining = SSP_psCurrentSsp->sTransmitQueue.psHead->u32Size;
+        SSP_psCurrentSsp->pu8CurrentTxData = SSP_psCurrentSsp->sTransmitQueue.psHead->pu8Data;
 
         /* If we need LSB first, use inline assembly to flip bits with a single instruction. */
         u32Byte = 0x000000FF & *SSP_psCurrentSsp->pu8CurrentTxData;
@@ -1231,13 +1442,21 @@ static void SspSM_Idle(void)
       /* A Master or Slave device without flow control uses the PDC */
       else
       {
-        /* Load the PDC counter and pointer registers.  The "Next" pointers are never changed and will
-        always point to SSP_u8Dummies with length 1.  */
-        SSP_psCurrentSsp->pBaseAddress->US_TPR = (unsigned int)SSP_psCurrentSsp->psTransmitBuffer->pu8Message; 
-        SSP_psCurrentSsp->pBaseAddress->US_TCR = SSP_psCurrentSsp->psTransmitBuffer->u32Size;
+        /* Load the PDC counter and pointer registers.  For a Slave, the "Next" pointers are never changed 
+        and will always point to SSP_u8Dummies with length 1.  A Master uses them to chain the pieces of a
+        split message. */
+        SSP_psCurrentSsp->pBaseAddress->US_TPR = (unsigned int)SSP_psCurrentSsp->sTransmitQueue.psHead->pu8Data; 
+        SSP_psCurrentSsp->pBaseAddress->US_TCR = SSP_psCurrentSsp->sTransmitQueue.psHead->u32Size;
    
         /* When TCR is loaded, the ENDTX flag is cleared so it is safe to enable the interrupt */
-        SSP_psCurrentSsp->pBaseAddress->US_IER = AT91C_US_ENDTX;
+        if(SSP_psCurrentSsp->eSspMode == SSP_SLAVE)
+        {
+          SSP_psCurrentSsp->pBaseAddress->US_IER = AT91C_US_ENDTX;
+        }
+        else
+        {
+          SspLoadNextPiece(SSP_psCurrentSsp);
+        }
         
         /* Enable the transmitter to start the transfer */
         SSP_psCurrentSsp->pBaseAddress->US_PTCR = AT91C_PDC_TXTEN;
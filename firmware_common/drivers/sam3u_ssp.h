@@ -71,7 +71,7 @@ typedef struct
   u8 u8PeripheralId;                  /*!< @brief Simple peripheral ID number */
   u8 u8Pad;                           /*!< @brief Preserve 4-byte alignment */
   u16 u16Pad;                         /*!< @brief Preserve 4-byte alignment */
-  MessageType* psTransmitBuffer;      /*!< @brief Pointer to the transmit message struct linked list */
+  MessageQueueType sTransmitQueue;    /*!< @brief Transmit message linked list */
   u32 u32CurrentTxBytesRemaining;     /*!< @brief Counter for bytes remaining in current transfer */
   u8* pu8CurrentTxData;               /*!< @brief Pointer to current location in the Tx buffer */
 } SspPeripheralType;
@@ -81,6 +81,7 @@ typedef struct
 #define _SSP_PERIPHERAL_TX            (u32)0x00200000    /*!< @brief Set when the peripheral is transmitting */
 #define _SSP_PERIPHERAL_RX            (u32)0x00400000    /*!< @brief Set when the peripheral is receiving */
 #define _SSP_PERIPHERAL_RX_COMPLETE   (u32)0x00800000    /*!< @brief Set when the peripheral is finished receiving */
+#define _SSP_PERIPHERAL_TX_NEXT       (u32)0x01000000    /*!< @brief Set when the next piece of a message is loaded in TNPR/TNCR */
 /* end u32PrivateFlags */
 
 
@@ -121,6 +122,9 @@ void SspDeAssertCS(SspPeripheralType* psSspPeripheral_);
 
 u32 SspWriteByte(SspPeripheralType* psSspPeripheral_, u8 u8Byte_);
 u32 SspWriteData(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* u8Data_);
+u32 SspWriteDataPriority(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_);
+u32 SspCommitData(SspPeripheralType* psSspPeripheral_, MessageType* psMessage_, u32 u32Size_);
+u32 SspWriteDataNoCopy(SspPeripheralType* psSspPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_);
 
 bool SspReadData(SspPeripheralType* psSspPeripheral_, u16 u16Size_);
 bool SspReadByte(SspPeripheralType* psSspPeripheral_);
@@ -144,6 +148,7 @@ void SSP2_IRQHandler(void);
 /*! @privatesection */                                                                                            
 /*-------------------------------------------------------------------------------------------------------------------*/
 static void SspGenericHandler(void);
+static void SspLoadNextPiece(SspPeripheralType* psSsp_);
 
 
 /***********************************************************************************************************************
@@ -7,7 +7,8 @@ running in asynchronous (UART) mode).
 
 INITIALIZATION (should take place in application's initialization function):
 1. Create a variable of UartConfigurationType in your application and initialize it to the desired UART peripheral,
-the address of the receive buffer for the application, and the size in bytes of the receive buffer.
+the address of the receive buffer for the application, and the size in bytes of the receive buffer.  Optionally
+provide a transmit ring (or set pu8TxRingAddress to NULL).
 
 2. Call UartRequest() with pointer to the configuration variable created in step 1.  The returned pointer is the
 UartPeripheralType object created that will be used by your application and should be assigned to a variable
@@ -15,6 +16,37 @@ accessible to your application.
 
 3. If the application no longer needs the UART resource, call UartRelease().  
 
+BAUD RATE AND HANDSHAKING:
+u32BaudRate selects the baud rate of each peripheral when it is requested; 0 keeps the BRGR value from 
+configuration.h.  The divider is worked out from MCK with 16x oversampling and the fractional part of BRGR, 
+switching to 8x oversampling (OVER) above MCK / 16, so up to 6 Mbaud can be set.  UartRequest() returns NULL
+for a rate the divider cannot reach.  The rate BRGR really gives is kept in u32BaudRate of the peripheral object.
+
+bHandshake puts a USART in hardware handshaking mode: the transmitter only sends while CTS is low, and the 
+receiver raises RTS while the receive PDC has no buffer loaded, so the other end holds off instead of overrunning
+the receiver.  The board must assign the RTSx/CTSx pins to the USART; neither board in this tree routes them for
+the debug port, so the debug task leaves handshaking off.
+
+TRANSMIT RING:
+Without a ring, every UartWriteByte() and UartWriteData() call takes a message slot, a token and a PDC transfer 
+of its own.  With a ring, a write of up to U16_UART_TX_RING_MAX_WRITE bytes is copied into the ring instead and 
+added to the message queued from the ring before it (see ExtendMessage()) as long as that message is still the
+last one queued and the UART has not started it.  Everything written while the UART is busy therefore goes out 
+in one transfer, and the merged writes share that message's token.  The ISR frees the ring bytes once the 
+message is sent.  A write that does not fit, and every UartWriteDataPriority(), UartCommitData() and 
+UartWriteDataNoCopy() call, is queued on its own as before and gets a token of its own.
+
+BULK RECEIVE:
+By default the receive PDC is loaded one byte at a time, so every received byte costs an interrupt and a call to
+fnRxCallback, which must advance the task's next-byte pointer itself.  If u16RxIdleBits is not 0 (USARTs only; 
+the UART has no receiver time-out), the PDC instead fills the receive buffer in two halves, each one reloaded as 
+the other fills, and the receiver time-out (US_RTOR) is set to u16RxIdleBits bit periods.  The driver sets the 
+task's next-byte pointer (*pu8RxNextByte) and calls fnRxCallback (which may be NULL) when the line has been idle
+that long after a burst, or when a half of the buffer fills during a longer burst.  A pasted line therefore costs
+one or two interrupts instead of one per character.  The task must read the buffer faster than half of it fills.
+A task that wants to see bytes before the burst ends (e.g. to echo them as they arrive) calls UartRxPoll() when 
+it runs.
+
 ------------------------------------------------------------------------------------------------------------------------
 GLOBALS
 - NONE
@@ -31,6 +63,10 @@ PUBLIC FUNCTIONS
 - void UartRelease(UartPeripheralType* psUartPeripheral_)
 - u32 UartWriteByte(UartPeripheralType* psUartPeripheral_, u8 u8Byte_)
 - u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_)
+- u32 UartWriteDataPriority(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
+- u32 UartCommitData(UartPeripheralType* psUartPeripheral_, MessageType* psMessage_, u32 u32Size_)
+- u32 UartWriteDataNoCopy(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+- void UartRxPoll(UartPeripheralType* psUartPeripheral_)
 
 PROTECTED FUNCTIONS
 - void UartInitialize(void);
@@ -189,6 +225,27 @@ UartPeripheralType* UartRequest(UartConfigurationType* psUartConfig_)
     return(NULL);
   }
   
+  /* Bulk receive and handshaking need the receiver time-out and RTS/CTS, which only the USARTs have */
+  if( ( (psUartConfig_->u16RxIdleBits != 0) || psUartConfig_->bHandshake ) && 
+      (psUartConfig_->UartPeripheral == UART) )
+  {
+    return(NULL);
+  }
+  
+  if(psUartConfig_->bHandshake)
+  {
+    u32TargetMR = (u32TargetMR & ~AT91C_US_USMODE) | AT91C_US_USMODE_HWHSH;
+  }
+  
+  if(psUartConfig_->u32BaudRate != 0)
+  {
+    u32TargetBRGR = UartBaudRateDivisor(psUartConfig_->UartPeripheral, psUartConfig_->u32BaudRate, &u32TargetMR);
+    if(u32TargetBRGR == 0)
+    {
+      return(NULL);
+    }
+  }
+  
   /* Activate and configure the peripheral */
   AT91C_BASE_PMC->PMC_PCER |= (1 << psRequestedUart->u8PeripheralId);
 
@@ -196,7 +253,25 @@ UartPeripheralType* UartRequest(UartConfigurationType* psUartConfig_)
   psRequestedUart->u16RxBufferSize = psUartConfig_->u16RxBufferSize;
   psRequestedUart->pu8RxNextByte   = psUartConfig_->pu8RxNextByte;
   psRequestedUart->fnRxCallback    = psUartConfig_->fnRxCallback;
+  psRequestedUart->pu8TxRing       = psUartConfig_->pu8TxRingAddress;
+  psRequestedUart->u16TxRingSize   = psUartConfig_->u16TxRingSize;
+  psRequestedUart->u16TxRingHead   = 0;
+  psRequestedUart->u16TxRingTail   = 0;
+  psRequestedUart->psTxRingOpen    = NULL;
+  psRequestedUart->u32BaudRate     = (U32_UART_MCK_HZ * 8) / ( ((u32TargetMR & AT91C_US_OVER) ? 8 : 16) * 
+                                     ( ((u32TargetBRGR & 0xFFFF) * 8) + ((u32TargetBRGR >> 16) & 0x7) ) );
   psRequestedUart->u32PrivateFlags |= _UART_PERIPHERAL_ASSIGNED;
+
+  if(psUartConfig_->u16RxIdleBits != 0)
+  {
+    psRequestedUart->u32PrivateFlags |= _UART_PERIPHERAL_RX_BULK;
+    u32TargetIER |= AT91C_US_TIMEOUT;
+    u32TargetIDR &= ~AT91C_US_TIMEOUT;
+    
+    /* The time-out counter starts with the first character */
+    u32TargetCR |= AT91C_US_STTTO;
+    psRequestedUart->pBaseAddress->US_RTOR = psUartConfig_->u16RxIdleBits;
+  }
   
   psRequestedUart->pBaseAddress->US_CR   = u32TargetCR;
   psRequestedUart->pBaseAddress->US_MR   = u32TargetMR;
@@ -205,10 +280,22 @@ UartPeripheralType* UartRequest(UartConfigurationType* psUartConfig_)
   psRequestedUart->pBaseAddress->US_BRGR = u32TargetBRGR;
 
   /* Preset the receive PDC pointers and counters; the receive buffer must be starting from [0] and be at least 2 bytes long)*/
-  psRequestedUart->pBaseAddress->US_RPR  = (unsigned int)psUartConfig_->pu8RxBufferAddress;
-  psRequestedUart->pBaseAddress->US_RNPR = (unsigned int)((psUartConfig_->pu8RxBufferAddress) + 1);
-  psRequestedUart->pBaseAddress->US_RCR  = 1;
-  psRequestedUart->pBaseAddress->US_RNCR = 1;
+  if(psRequestedUart->u32PrivateFlags & _UART_PERIPHERAL_RX_BULK)
+  {
+    /* Each half of the buffer in turn */
+    psRequestedUart->pBaseAddress->US_RPR  = (unsigned int)psUartConfig_->pu8RxBufferAddress;
+    psRequestedUart->pBaseAddress->US_RCR  = psUartConfig_->u16RxBufferSize / 2;
+    psRequestedUart->pBaseAddress->US_RNPR = (unsigned int)(psUartConfig_->pu8RxBufferAddress + (psUartConfig_->u16RxBufferSize / 2));
+    psRequestedUart->pBaseAddress->US_RNCR = psUartConfig_->u16RxBufferSize - (psUartConfig_->u16RxBufferSize / 2);
+    *psRequestedUart->pu8RxNextByte = psUartConfig_->pu8RxBufferAddress;
+  }
+  else
+  {
+    psRequestedUart->pBaseAddress->US_RPR  = (unsigned int)psUartConfig_->pu8RxBufferAddress;
+    psRequestedUart->pBaseAddress->US_RNPR = (unsigned int)((psUartConfig_->pu8RxBufferAddress) + 1);
+    psRequestedUart->pBaseAddress->US_RCR  = 1;
+    psRequestedUart->pBaseAddress->US_RNCR = 1;
+  }
   
   /* Enable the receiver and transmitter requests */
   psRequestedUart->pBaseAddress->US_PTCR = AT91C_PDC_RXTEN | AT91C_PDC_TXTEN;
@@ -249,6 +336,13 @@ void UartRelease(UartPeripheralType* psUartPeripheral_)
   NVIC_DisableIRQ( (IRQn_Type)(psUartPeripheral_->u8PeripheralId) );
   NVIC_ClearPendingIRQ( (IRQn_Type)(psUartPeripheral_->u8PeripheralId) );
  
+  /* Stop the receiver time-out so it does not run into the next user of the peripheral */
+  if(psUartPeripheral_->u32PrivateFlags & _UART_PERIPHERAL_RX_BULK)
+  {
+    psUartPeripheral_->pBaseAddress->US_IDR  = AT91C_US_TIMEOUT;
+    psUartPeripheral_->pBaseAddress->US_RTOR = 0;
+  }
+  
   /* Now it's safe to release all of the resources in the target peripheral */
   psUartPeripheral_->pu8RxBuffer   = NULL;
   psUartPeripheral_->pu8RxNextByte = NULL;
@@ -256,11 +350,13 @@ void UartRelease(UartPeripheralType* psUartPeripheral_)
   psUartPeripheral_->u32PrivateFlags = 0;
 
   /* Empty the transmit buffer if there were leftover messages */
-  while(psUartPeripheral_->psTransmitBuffer != NULL)
+  while(psUartPeripheral_->sTransmitQueue.psHead != NULL)
   {
-    UpdateMessageStatus(psUartPeripheral_->psTransmitBuffer->u32Token, ABANDONED);
-    DeQueueMessage(&psUartPeripheral_->psTransmitBuffer);
+    UpdateMessageStatus(psUartPeripheral_->sTransmitQueue.psHead->u32Token, ABANDONED);
+    DeQueueMessage(&psUartPeripheral_->sTransmitQueue);
   }
+  psUartPeripheral_->pu8TxRing = NULL;
+  psUartPeripheral_->psTxRingOpen = NULL;
   
   /* Ensure the SM is in the Idle state */
   Uart_pfnStateMachine = UartSM_Idle;
@@ -278,9 +374,10 @@ Requires:
 @param u8Byte_ is the byte to send
 
 Promises:
-- Creates a 1-byte message at psUartPeripheral_->pTransmitBuffer that will be sent by the UART application
-  when it is available.
-- Returns the message token assigned to the message
+- The byte is added to the transmit ring if there is one and it has room; otherwise a 1-byte message
+  is created at psUartPeripheral_->sTransmitQueue that will be sent by the UART application when it 
+  is available.
+- Returns the token of the message that will carry the byte
 
 */
 u32 UartWriteByte(UartPeripheralType* psUartPeripheral_, u8 u8Byte_)
@@ -288,8 +385,14 @@ u32 UartWriteByte(UartPeripheralType* psUartPeripheral_, u8 u8Byte_)
   u32 u32Token;
   u8 u8Data = u8Byte_;
   
-  /* Attempt to queue message and get a response token */
-  u32Token = QueueMessage(&psUartPeripheral_->psTransmitBuffer, 1, &u8Data);
+  /* Merge with other small writes if possible, otherwise queue a message and get a response token */
+  u32Token = UartWriteRing(psUartPeripheral_, 1, &u8Data);
+  if(u32Token != 0)
+  {
+    return(u32Token);
+  }
+  
+  u32Token = QueueMessage(&psUartPeripheral_->sTransmitQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
   
   if( u32Token != 0 )
   {
@@ -318,13 +421,51 @@ Requires:
 @param pu8Data_ points to the first byte of the data array
 
 Promises:
-- adds the data message at psUartPeripheral_->pTransmitBuffer that will be sent by the UART application
+- Up to U16_UART_TX_RING_MAX_WRITE bytes are added to the transmit ring if there is one and it has room 
+  (the token may be shared with other writes); otherwise adds the data message at 
+  psUartPeripheral_->sTransmitQueue that will be sent by the UART application when it is available.
+- Returns the token of the message that will carry the data; 0 is returned if the message cannot be 
+  queued in which case G_u32MessagingFlags can be checked for the reason
+
+*/
+u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_)
+{
+  u32 u32Token;
+  
+  u32Token = UartWriteRing(psUartPeripheral_, u32Size_, pu8Data_);
+  if(u32Token != 0)
+  {
+    return(u32Token);
+  }
+  
+  return( UartWriteDataPriority(psUartPeripheral_, u32Size_, pu8Data_, MSG_PRIORITY_NORMAL) );
+  
+} /* end UartWriteData() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 UartWriteDataPriority(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
+
+@brief Queues an array of bytes for transfer on the target UART peripheral at the given priority.  
+
+A MSG_PRIORITY_HIGH message is sent as soon as the message currently being sent is finished, ahead 
+of any normal messages already queued (see messaging.c).  The data is never merged through the transmit
+ring, so the token belongs to this message alone.
+
+Requires:
+@param psUartPeripheral_ has been requested
+@param u32Size_ is the number of bytes in the data array; should not be 0
+@param pu8Data_ points to the first byte of the data array
+@param ePriority_ is the transmit priority of the message
+
+Promises:
+- adds the data message at psUartPeripheral_->sTransmitQueue that will be sent by the UART application
   when it is available.
 - Returns the message token assigned to the message; 0 is returned if the message cannot be queued in which case
   G_u32MessagingFlags can be checked for the reason
 
 */
-u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_)
+u32 UartWriteDataPriority(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_)
 {
   u32 u32Token;
   
@@ -335,7 +476,7 @@ u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Da
   }
 
   /* Attempt to queue message and get a response token */
-  u32Token = QueueMessage(&psUartPeripheral_->psTransmitBuffer, u32Size_, pu8Data_);
+  u32Token = QueueMessage(&psUartPeripheral_->sTransmitQueue, u32Size_, pu8Data_, ePriority_);
   if(u32Token)
   {
     /* If the system is initializing, manually cycle the UART task through one iteration to send the message */
@@ -347,7 +488,105 @@ u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Da
   
   return(u32Token);
   
-} /* end UartWriteData() */
+} /* end UartWriteDataPriority() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 UartCommitData(UartPeripheralType* psUartPeripheral_, MessageType* psMessage_, u32 u32Size_)
+
+@brief Queues a message from ReserveMessage() that the caller has already filled in.  
+
+Requires:
+@param psUartPeripheral_ has been requested
+@param psMessage_ was returned by ReserveMessage() and holds the data to send in pu8Data
+@param u32Size_ is the number of bytes written to psMessage_->pu8Data
+
+Promises:
+- The message is queued without copying and its token is returned
+- Returns 0 if the message could not be committed, in which case the caller still owns it and
+  must commit it again or call ReleaseMessage()
+
+*/
+u32 UartCommitData(UartPeripheralType* psUartPeripheral_, MessageType* psMessage_, u32 u32Size_)
+{
+  u32 u32Token;
+  
+  u32Token = CommitMessage(&psUartPeripheral_->sTransmitQueue, psMessage_, u32Size_);
+  if(u32Token)
+  {
+    /* If the system is initializing, manually cycle the UART task through one iteration to send the message */
+    if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
+    {
+      UartManualMode();
+    }
+  }
+  
+  return(u32Token);
+  
+} /* end UartCommitData() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 UartWriteDataNoCopy(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+
+@brief Queues an array of bytes that is sent directly from the caller's buffer.  
+
+Requires:
+@param psUartPeripheral_ has been requested
+@param u32Size_ is the number of bytes in the data array (up to U16_MAX_NO_COPY_MESSAGE_LENGTH)
+@param pu8Data_ points to the first byte of the data array which must not change until the message is done
+@param pfnCallback_ is called from the UART ISR when the message is done (may be NULL)
+
+Promises:
+- Returns the message token assigned to the message; 0 is returned if the message cannot be queued in which case
+  G_u32MessagingFlags can be checked for the reason
+
+*/
+u32 UartWriteDataNoCopy(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_)
+{
+  u32 u32Token;
+  
+  u32Token = QueueMessageNoCopy(&psUartPeripheral_->sTransmitQueue, u32Size_, pu8Data_, pfnCallback_);
+  if(u32Token)
+  {
+    /* If the system is initializing, manually cycle the UART task through one iteration to send the message */
+    if(G_u32SystemFlags & _SYSTEM_INITIALIZING)
+    {
+      UartManualMode();
+    }
+  }
+  
+  return(u32Token);
+  
+} /* end UartWriteDataNoCopy() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void UartRxPoll(UartPeripheralType* psUartPeripheral_)
+
+@brief Moves the task's next-byte pointer up to the last byte the bulk receive PDC has written.
+
+The pointer is otherwise only updated when a burst ends or a half of the buffer fills.  fnRxCallback is not called.
+Does nothing if the peripheral is not in bulk receive mode.
+
+Requires:
+@param psUartPeripheral_ has been requested
+
+Promises:
+- *pu8RxNextByte is set to where the PDC writes the next byte
+
+*/
+void UartRxPoll(UartPeripheralType* psUartPeripheral_)
+{
+  if(psUartPeripheral_->u32PrivateFlags & _UART_PERIPHERAL_RX_BULK)
+  {
+    /* Keep the ISR from moving the pointer between reading RPR and writing it */
+    NVIC_DisableIRQ( (IRQn_Type)(psUartPeripheral_->u8PeripheralId) );
+    *psUartPeripheral_->pu8RxNextByte = UartRxBulkPosition(psUartPeripheral_);
+    NVIC_EnableIRQ( (IRQn_Type)(psUartPeripheral_->u8PeripheralId) );
+  }
+  
+} /* end UartRxPoll() */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -371,34 +610,50 @@ void UartInitialize(void)
 {
   /* Initialize all the UART peripheral structures */
   Uart_sPeripheral.pBaseAddress      = (AT91S_USART*)AT91C_BASE_DBGU;
-  Uart_sPeripheral.psTransmitBuffer  = NULL;
+  Uart_sPeripheral.sTransmitQueue.psHead = NULL;
+  Uart_sPeripheral.sTransmitQueue.psTail = NULL;
+  Uart_sPeripheral.sTransmitQueue.u8PeripheralId = AT91C_ID_DBGU;
   Uart_sPeripheral.pu8RxBuffer       = NULL;
   Uart_sPeripheral.u16RxBufferSize   = 0;
   Uart_sPeripheral.pu8RxNextByte     = NULL;
+  Uart_sPeripheral.pu8TxRing         = NULL;
+  Uart_sPeripheral.psTxRingOpen      = NULL;
   Uart_sPeripheral.u32PrivateFlags   = 0;
   Uart_sPeripheral.u8PeripheralId    = AT91C_ID_DBGU;
 
   Uart_sPeripheral0.pBaseAddress     = AT91C_BASE_US0;
-  Uart_sPeripheral0.psTransmitBuffer = NULL;
+  Uart_sPeripheral0.sTransmitQueue.psHead = NULL;
+  Uart_sPeripheral0.sTransmitQueue.psTail = NULL;
+  Uart_sPeripheral0.sTransmitQueue.u8PeripheralId = AT91C_ID_US0;
   Uart_sPeripheral0.pu8RxBuffer      = NULL;
   Uart_sPeripheral0.u16RxBufferSize  = 0;
   Uart_sPeripheral0.pu8RxNextByte    = NULL;
+  Uart_sPeripheral0.pu8TxRing        = NULL;
+  Uart_sPeripheral0.psTxRingOpen     = NULL;
   Uart_sPeripheral0.u32PrivateFlags  = 0;
   Uart_sPeripheral0.u8PeripheralId   = AT91C_ID_US0;
 
   Uart_sPeripheral1.pBaseAddress     = AT91C_BASE_US1;
-  Uart_sPeripheral1.psTransmitBuffer = NULL;
+  Uart_sPeripheral1.sTransmitQueue.psHead = NULL;
+  Uart_sPeripheral1.sTransmitQueue.psTail = NULL;
+  Uart_sPeripheral1.sTransmitQueue.u8PeripheralId = AT91C_ID_US1;
   Uart_sPeripheral1.pu8RxBuffer      = NULL;
   Uart_sPeripheral1.u16RxBufferSize  = 0;
   Uart_sPeripheral1.pu8RxNextByte    = NULL;
+  Uart_sPeripheral1.pu8TxRing        = NULL;
+  Uart_sPeripheral1.psTxRingOpen     = NULL;
   Uart_sPeripheral1.u32PrivateFlags  = 0;
   Uart_sPeripheral1.u8PeripheralId   = AT91C_ID_US1;
 
   Uart_sPeripheral2.pBaseAddress     = AT91C_BASE_US2;
-  Uart_sPeripheral2.psTransmitBuffer = NULL;
+  Uart_sPeripheral2.sTransmitQueue.psHead = NULL;
+  Uart_sPeripheral2.sTransmitQueue.psTail = NULL;
+  Uart_sPeripheral2.sTransmitQueue.u8PeripheralId = AT91C_ID_US2;
   Uart_sPeripheral2.pu8RxBuffer      = NULL;
   Uart_sPeripheral2.u16RxBufferSize  = 0;
   Uart_sPeripheral2.pu8RxNextByte    = NULL;
+  Uart_sPeripheral2.pu8TxRing        = NULL;
+  Uart_sPeripheral2.psTxRingOpen     = NULL;
   Uart_sPeripheral2.u32PrivateFlags  = 0;
   Uart_sPeripheral2.u8PeripheralId   = AT91C_ID_US2;
   
@@ -576,17 +831,53 @@ Receive: A requested UART peripheral is always enabled and ready to receive data
 new byte has been read by the peripheral. All incoming data is dumped into the circular receive data buffer configured.
 No processing is done on the data - it is up to the processing application to parse incoming data to find useful information
 and to manage dummy bytes.  All data reception is done with DMA, but only 1 byte at a time.  Receiving is done by using
-the two reception pointers to ensure no data is missed.
+the two reception pointers to ensure no data is missed.  In bulk receive mode the two pointers cover the two halves of
+the buffer instead, and the task is told about new data on TIMEOUT or when a half fills (see UartRxBulkUpdate()).
 
 Transmit: All data bytes in the transmit buffer are sent using DMA and interrupts. Once the full message has been sent,
-the message status is updated.
+the message status is updated.  The message after it is normally already loaded in the PDC "next" registers, so the
+transmitter does not stop between queued messages; otherwise a message queued in the meantime is started from here.
 
 */
 static void UartGenericHandler(void)
 {
+  u16 u16RxHalf;
+  
+  /* Bulk receive: ENDRX when a half of the buffer is full and the PDC moved on to the other half */
+  if(Uart_psCurrentISR->u32PrivateFlags & _UART_PERIPHERAL_RX_BULK)
+  {
+    if( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDRX) && 
+        (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_ENDRX) )
+    {
+      /* Queue the half just filled to follow the one now in use (writing RNCR clears ENDRX) */
+      u16RxHalf = Uart_psCurrentISR->u16RxBufferSize / 2;
+      if(Uart_psCurrentISR->pBaseAddress->US_RNPR == (u32)Uart_psCurrentISR->pu8RxBuffer)
+      {
+        Uart_psCurrentISR->pBaseAddress->US_RNPR = (u32)(Uart_psCurrentISR->pu8RxBuffer + u16RxHalf);
+        Uart_psCurrentISR->pBaseAddress->US_RNCR = Uart_psCurrentISR->u16RxBufferSize - u16RxHalf;
+      }
+      else
+      {
+        Uart_psCurrentISR->pBaseAddress->US_RNPR = (u32)Uart_psCurrentISR->pu8RxBuffer;
+        Uart_psCurrentISR->pBaseAddress->US_RNCR = u16RxHalf;
+      }
+      
+      UartRxBulkUpdate(Uart_psCurrentISR);
+    }
+    
+    /* TIMEOUT when the line has been idle for u16RxIdleBits after a character */
+    if( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_TIMEOUT) && 
+        (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_TIMEOUT) )
+    {
+      /* Clear TIMEOUT; the counter starts again with the next character */
+      Uart_psCurrentISR->pBaseAddress->US_CR = AT91C_US_STTTO;
+      UartRxBulkUpdate(Uart_psCurrentISR);
+    }
+  }
+  
   /* ENDRX Interrupt when a byte has been received (RNCR is moved to RCR; RNPR is copied to RPR) */
-  if( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDRX) && 
-      (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_ENDRX) )
+  else if( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDRX) && 
+           (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_ENDRX) )
   {
     /* Update the "next" DMA pointer to the next valid Rx location with wrap-around check */
     Uart_psCurrentISR->pBaseAddress->US_RNPR++;
@@ -604,38 +895,366 @@ static void UartGenericHandler(void)
   } /* end of ENDRX interrupt processing */
 
   
-  /* ENDTX Interrupt when all requested transmit bytes have been sent (if enabled) */
-  if( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDTX) && 
-      (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_ENDTX) )
+  /* ENDTX Interrupt when the current message has been sent and the PDC moved on to the next one, or TXBUFE
+  when the last loaded message has been sent (whichever is enabled) */
+  if( ( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_ENDTX) && 
+        (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_ENDTX) ) ||
+      ( (Uart_psCurrentISR->pBaseAddress->US_IMR & AT91C_US_TXBUFE) && 
+        (Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_TXBUFE) ) )
   {
     /* Update this message's token status and then DeQueue it */
-    UpdateMessageStatus(Uart_psCurrentISR->psTransmitBuffer->u32Token, COMPLETE);
-    DeQueueMessage( &Uart_psCurrentISR->psTransmitBuffer );
-    Uart_psCurrentISR->u32PrivateFlags &= ~_UART_PERIPHERAL_TX;
-        
-    /* Disable the transmitter and interrupt sources that were enabled in UART Idle to 
-    start the transmission sequence */
-    Uart_psCurrentISR->pBaseAddress->US_PTCR = AT91C_PDC_TXTDIS;
-    Uart_psCurrentISR->pBaseAddress->US_IDR  = AT91C_US_ENDTX;
+    UartCompleteMessage(Uart_psCurrentISR);
     
-    /* Decrement # of UARTs that are currently sending (incremented in UART Idle when the
-    transmission started) */
-    if(Uart_u8ActiveUarts != 0)
+    /* The message loaded next is the head now; it may have finished as well if this interrupt was late */
+    if(Uart_psCurrentISR->u32PrivateFlags & _UART_PERIPHERAL_TX_NEXT)
+    {
+      Uart_psCurrentISR->u32PrivateFlags &= ~_UART_PERIPHERAL_TX_NEXT;
+      if(Uart_psCurrentISR->pBaseAddress->US_CSR & AT91C_US_TXBUFE)
+      {
+        UartCompleteMessage(Uart_psCurrentISR);
+      }
+    }
+    
+    /* Still sending: load the message after the current one */
+    if(Uart_psCurrentISR->pBaseAddress->US_TCR != 0)
+    {
+      UartLoadNextMessage(Uart_psCurrentISR);
+    }
+    /* Idle but a message was queued in the meantime: start it now */
+    else if(Uart_psCurrentISR->sTransmitQueue.psHead != NULL)
     {
-      Uart_u8ActiveUarts--;
+      UpdateMessageStatus(Uart_psCurrentISR->sTransmitQueue.psHead->u32Token, SENDING);
+      Uart_psCurrentISR->pBaseAddress->US_TPR = (unsigned int)Uart_psCurrentISR->sTransmitQueue.psHead->pu8Data;
+      Uart_psCurrentISR->pBaseAddress->US_TCR = Uart_psCurrentISR->sTransmitQueue.psHead->u32Size;
+      UartLoadNextMessage(Uart_psCurrentISR);
     }
+    /* All done */
     else
     {
-      /* If Uart_u8ActiveUarts is already 0, then we are not properly synchronized */
-      DebugPrintf("\n\rUART counter out of sync\n\r");
-      Uart_u32Flags |= _UART_NO_ACTIVE_UARTS;
+      Uart_psCurrentISR->u32PrivateFlags &= ~_UART_PERIPHERAL_TX;
+        
+      /* Disable the transmitter and interrupt sources that were enabled in UART Idle to 
+      start the transmission sequence */
+      Uart_psCurrentISR->pBaseAddress->US_PTCR = AT91C_PDC_TXTDIS;
+      Uart_psCurrentISR->pBaseAddress->US_IDR  = AT91C_US_ENDTX | AT91C_US_TXBUFE;
+    
+      /* Decrement # of UARTs that are currently sending (incremented in UART Idle when the
+      transmission started) */
+      if(Uart_u8ActiveUarts != 0)
+      {
+        Uart_u8ActiveUarts--;
+      }
+      else
+      {
+        /* If Uart_u8ActiveUarts is already 0, then we are not properly synchronized */
+        DebugPrintf("\n\rUART counter out of sync\n\r");
+        Uart_u32Flags |= _UART_NO_ACTIVE_UARTS;
+      }
     }
     
-  } /* end of ENDTX interrupt processing */
+  } /* end of ENDTX / TXBUFE interrupt processing */
   
 } /* end UartGenericHandler() */
 
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void UartLoadNextMessage(UartPeripheralType* psUart_)
+
+@brief Loads the message after the one being sent into the PDC "next" registers so the two go out back to back.
+
+The PDC moves TNPR/TNCR into TPR/TCR as soon as TCR reaches 0 and sets ENDTX, so the only gap between the messages 
+is the time to move one byte.  If there is nothing to load yet, TXBUFE is used instead to signal the end of the 
+current message.
+
+Requires:
+@param psUart_ is transmitting the message at the head of its queue and nothing is loaded in TNPR/TNCR
+
+Promises:
+- If another message is queued, it is started with StartNextMessage() and loaded in TNPR/TNCR, _UART_PERIPHERAL_TX_NEXT
+  is set and the ENDTX interrupt is enabled (TXBUFE disabled)
+- Otherwise the TXBUFE interrupt is enabled (ENDTX disabled)
+
+*/
+static void UartLoadNextMessage(UartPeripheralType* psUart_)
+{
+  MessageType* psNextMessage = StartNextMessage(&psUart_->sTransmitQueue, FALSE);
+  
+  if(psNextMessage != NULL)
+  {
+    /* Writing TNCR also clears ENDTX from the message that just finished */
+    psUart_->pBaseAddress->US_TNPR = (unsigned int)psNextMessage->pu8Data;
+    psUart_->pBaseAddress->US_TNCR = psNextMessage->u32Size;
+    psUart_->u32PrivateFlags |= _UART_PERIPHERAL_TX_NEXT;
+    
+    psUart_->pBaseAddress->US_IDR = AT91C_US_TXBUFE;
+    psUart_->pBaseAddress->US_IER = AT91C_US_ENDTX;
+  }
+  else
+  {
+    psUart_->pBaseAddress->US_IDR = AT91C_US_ENDTX;
+    psUart_->pBaseAddress->US_IER = AT91C_US_TXBUFE;
+  }
+  
+} /* end UartLoadNextMessage() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void UartCompleteMessage(UartPeripheralType* psUart_)
+
+@brief Finishes the message at the head of a UART's transmit queue once it has been sent.
+
+Requires:
+@param psUart_ has sent all of the message at the head of its queue
+
+Promises:
+- If the message came from the transmit ring, the ring bytes up to its end are free again
+- The message status is COMPLETE and the message is dequeued
+
+*/
+static void UartCompleteMessage(UartPeripheralType* psUart_)
+{
+  MessageType* psMessage = psUart_->sTransmitQueue.psHead;
+  u32 u32End;
+  
+  /* Ring messages are sent in the order they were written, so everything before the end of this one is free */
+  if( (psUart_->pu8TxRing != NULL) && (psMessage->pu8Data >= psUart_->pu8TxRing) &&
+      (psMessage->pu8Data < (psUart_->pu8TxRing + psUart_->u16TxRingSize)) )
+  {
+    u32End = (u32)(psMessage->pu8Data - psUart_->pu8TxRing) + psMessage->u32Size;
+    if(u32End >= psUart_->u16TxRingSize)
+    {
+      u32End = 0;
+    }
+    psUart_->u16TxRingTail = (u16)u32End;
+  }
+  
+  UpdateMessageStatus(psMessage->u32Token, COMPLETE);
+  DeQueueMessage(&psUart_->sTransmitQueue);
+  
+} /* end UartCompleteMessage() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u32 UartWriteRing(UartPeripheralType* psUart_, u32 u32Size_, u8* pu8Data_)
+
+@brief Copies a small write into a UART's transmit ring and merges it with the ring message queued before it.
+
+A message's bytes must be contiguous, so a write that does not fit before the end of the ring starts a new
+message at the front (the unused end is skipped).  One byte is always left free so a full ring can be told
+from an empty one.
+
+The ring is only written from task context, so its messages are queued in the order of their bytes.  A write
+from an interrupt handler (e.g. a DebugPrintf() in an ISR or a completion callback) is refused so the caller
+queues a copy instead; that message can land between two ring messages without harm.
+
+Requires:
+- The UART ISR only moves u16TxRingTail
+
+@param psUart_ has been requested
+@param u32Size_ is the number of bytes to write
+@param pu8Data_ points to the bytes
+
+Promises:
+- If the UART has a ring with room for the data, u32Size_ is 1 to U16_UART_TX_RING_MAX_WRITE, the system
+  is not initializing and no interrupt handler is active, the data is copied into the ring and either added to psUart_->psTxRingOpen with 
+  ExtendMessage() or queued as a new no-copy message that becomes psUart_->psTxRingOpen
+- Returns the token of the message carrying the data, or 0 if the data was not taken
+
+*/
+static u32 UartWriteRing(UartPeripheralType* psUart_, u32 u32Size_, u8* pu8Data_)
+{
+  u32 u32Head = psUart_->u16TxRingHead;
+  u32 u32Tail = psUart_->u16TxRingTail;
+  u32 u32Start;
+  u32 u32Token;
+  MessageType* psQueued;
+  
+  if( (psUart_->pu8TxRing == NULL) || (u32Size_ == 0) || (u32Size_ > U16_UART_TX_RING_MAX_WRITE) ||
+      (G_u32SystemFlags & _SYSTEM_INITIALIZING) || (AT91C_BASE_NVIC->NVIC_ICSR & AT91C_NVIC_VECTACTIVE) )
+  {
+    return(0);
+  }
+  
+  /* Find contiguous room at the head, or at the front of the ring if the head is past the tail */
+  if(u32Head >= u32Tail)
+  {
+    if( (u32Size_ < (u32)(psUart_->u16TxRingSize - u32Head)) || 
+        ((u32Size_ == (u32)(psUart_->u16TxRingSize - u32Head)) && (u32Tail != 0)) )
+    {
+      u32Start = u32Head;
+    }
+    else if(u32Size_ < u32Tail)
+    {
+      u32Start = 0;
+    }
+    else
+    {
+      return(0);
+    }
+  }
+  else if(u32Size_ < (u32Tail - u32Head))
+  {
+    u32Start = u32Head;
+  }
+  else
+  {
+    return(0);
+  }
+  
+  for(u32 i = 0; i < u32Size_; i++)
+  {
+    psUart_->pu8TxRing[u32Start + i] = *pu8Data_++;
+  }
+  
+  /* Add to the open message if the bytes follow it, otherwise queue a new message from the ring */
+  if( (psUart_->psTxRingOpen != NULL) && (u32Start == u32Head) &&
+      ((psUart_->psTxRingOpen->pu8Data + psUart_->psTxRingOpen->u32Size) == &psUart_->pu8TxRing[u32Start]) &&
+      ExtendMessage(&psUart_->sTransmitQueue, psUart_->psTxRingOpen, psUart_->u32TxRingOpenToken, u32Size_) )
+  {
+    u32Token = psUart_->u32TxRingOpenToken;
+  }
+  else
+  {
+    u32Token = QueueMessageNoCopy(&psUart_->sTransmitQueue, u32Size_, &psUart_->pu8TxRing[u32Start], NULL);
+    if(u32Token == 0)
+    {
+      return(0);
+    }
+    
+    /* An ISR may have queued a message behind it already; then there is nothing to add to */
+    __disable_irq();
+    psQueued = psUart_->sTransmitQueue.psTail;
+    __enable_irq();
+    if( (psQueued != NULL) && (psQueued->u32Token == u32Token) )
+    {
+      psUart_->psTxRingOpen = psQueued;
+    }
+    else
+    {
+      psUart_->psTxRingOpen = NULL;
+    }
+    psUart_->u32TxRingOpenToken = u32Token;
+  }
+  
+  u32Start += u32Size_;
+  if(u32Start == psUart_->u16TxRingSize)
+  {
+    u32Start = 0;
+  }
+  psUart_->u16TxRingHead = (u16)u32Start;
+  
+  return(u32Token);
+  
+} /* end UartWriteRing() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u32 UartBaudRateDivisor(PeripheralType ePeripheral_, u32 u32BaudRate_, u32* pu32TargetMR_)
+
+@brief Works out the BRGR value for a baud rate.
+
+BAUD = MCK / (8(2-OVER)(CD + FP / 8)), so 8 x (CD + FP / 8) = MCK / ((2-OVER) x BAUD), rounded to the
+nearest step.  16x oversampling is used while CD is at least 1, then 8x (OVER).  The UART has neither FP 
+nor OVER, so its divider is rounded to a whole CD.
+
+Requires:
+@param ePeripheral_ is the peripheral being requested
+@param u32BaudRate_ is the rate wanted in bits/s (not 0)
+@param pu32TargetMR_ points to the MR value that will be written
+
+Promises:
+- Returns the BRGR value, or 0 if the rate is out of reach
+- AT91C_US_OVER in *pu32TargetMR_ is set or cleared to match
+
+*/
+static u32 UartBaudRateDivisor(PeripheralType ePeripheral_, u32 u32BaudRate_, u32* pu32TargetMR_)
+{
+  u32 u32Eighths;
+  
+  if(ePeripheral_ == UART)
+  {
+    /* Whole CD only */
+    u32Eighths = 8 * ( (U32_UART_MCK_HZ + (8 * u32BaudRate_)) / (16 * u32BaudRate_) );
+  }
+  else
+  {
+    /* 16x oversampling */
+    u32Eighths = (U32_UART_MCK_HZ + u32BaudRate_) / (2 * u32BaudRate_);
+    *pu32TargetMR_ &= ~AT91C_US_OVER;
+    
+    /* 8x oversampling when the divider would be below 1 */
+    if(u32Eighths < 8)
+    {
+      u32Eighths = (U32_UART_MCK_HZ + (u32BaudRate_ / 2)) / u32BaudRate_;
+      *pu32TargetMR_ |= AT91C_US_OVER;
+    }
+  }
+  
+  if( (u32Eighths < 8) || ((u32Eighths >> 3) > U32_UART_MAX_CD) )
+  {
+    return(0);
+  }
+  
+  /* CD in bits 0-15, FP in bits 16-18 */
+  return( (u32Eighths >> 3) | ((u32Eighths & 0x7) << 16) );
+  
+} /* end UartBaudRateDivisor() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static u8* UartRxBulkPosition(UartPeripheralType* psUart_)
+
+@brief Returns where the bulk receive PDC writes the next byte.
+
+Requires:
+@param psUart_ is in bulk receive mode
+
+Promises:
+- Returns a pointer into the receive buffer
+
+*/
+static u8* UartRxBulkPosition(UartPeripheralType* psUart_)
+{
+  u8* pu8Next = (u8*)psUart_->pBaseAddress->US_RPR;
+  
+  /* RPR sits at the end of the buffer if both halves are full and the next one is not loaded yet */
+  if(pu8Next == (psUart_->pu8RxBuffer + psUart_->u16RxBufferSize))
+  {
+    pu8Next = psUart_->pu8RxBuffer;
+  }
+  
+  return(pu8Next);
+  
+} /* end UartRxBulkPosition() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void UartRxBulkUpdate(UartPeripheralType* psUart_)
+
+@brief Tells the task how far the bulk receive PDC has written into its buffer.
+
+Called from the ISR on TIMEOUT and when a half of the buffer fills.
+
+Requires:
+@param psUart_ is in bulk receive mode
+
+Promises:
+- *pu8RxNextByte is set to where the PDC writes the next byte
+- fnRxCallback is called if there is one
+
+*/
+static void UartRxBulkUpdate(UartPeripheralType* psUart_)
+{
+  *psUart_->pu8RxNextByte = UartRxBulkPosition(psUart_);
+  
+  if(psUart_->fnRxCallback != NULL)
+  {
+    psUart_->fnRxCallback();
+  }
+  
+} /* end UartRxBulkUpdate() */
+
+
 /***********************************************************************************************************************
 State Machine Function Definitions
 
@@ -665,20 +1284,30 @@ static void UartSM_Idle(void)
 {
   /* Check all UART peripherals for message activity or skip the current peripheral if it is already busy sending.
   All receive functions take place outside of the state machine.
-  Devices sending a message will have Uart_psCurrentSsp->psTransmitBuffer->pu8Message pointing to the message to send. */
-  if( (Uart_psCurrentUart->psTransmitBuffer != NULL) && 
+  Devices sending a message will have Uart_psCurrentSsp->sTransmitQueue.psHead->pu8Data pointing to the message to send. */
+  if( (Uart_psCurrentUart->sTransmitQueue.psHead == NULL) && 
      !(Uart_psCurrentUart->u32PrivateFlags & _UART_PERIPHERAL_TX ) )
+  {
+    /* Nothing queued means nothing in the ring is waiting either (including messages that timed out), 
+    so start writing at the front again */
+    Uart_psCurrentUart->u16TxRingHead = 0;
+    Uart_psCurrentUart->u16TxRingTail = 0;
+    Uart_psCurrentUart->psTxRingOpen = NULL;
+  }
+  else if( (Uart_psCurrentUart->sTransmitQueue.psHead != NULL) && 
+          !(Uart_psCurrentUart->u32PrivateFlags & _UART_PERIPHERAL_TX ) )
   {
     /* Transmitting: update the message's status and flag that the peripheral is now busy */
-    UpdateMessageStatus(Uart_psCurrentUart->psTransmitBuffer->u32Token, SENDING);
+    UpdateMessageStatus(Uart_psCurrentUart->sTransmitQueue.psHead->u32Token, SENDING);
     Uart_psCurrentUart->u32PrivateFlags |= _UART_PERIPHERAL_TX;    
       
     /* Load the PDC counter and pointer registers */
-    Uart_psCurrentUart->pBaseAddress->US_TPR = (unsigned int)Uart_psCurrentUart->psTransmitBuffer->pu8Message;
-    Uart_psCurrentUart->pBaseAddress->US_TCR = Uart_psCurrentUart->psTransmitBuffer->u32Size;
+    Uart_psCurrentUart->pBaseAddress->US_TPR = (unsigned int)Uart_psCurrentUart->sTransmitQueue.psHead->pu8Data;
+    Uart_psCurrentUart->pBaseAddress->US_TCR = Uart_psCurrentUart->sTransmitQueue.psHead->u32Size;
 
-    /* When TCR is loaded, the ENDTX flag is cleared so it is safe to enable the interrupt */
-    Uart_psCurrentUart->pBaseAddress->US_IER = AT91C_US_ENDTX;
+    /* When TCR is loaded, the ENDTX flag is cleared so it is safe to enable the interrupt.  If a second
+    message is waiting, it is loaded into the "next" registers now. */
+    UartLoadNextMessage(Uart_psCurrentUart);
     
     /* Update active UART count and enable the transmitter to start the transfer */
     Uart_u8ActiveUarts++;
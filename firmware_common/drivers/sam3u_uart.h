@@ -22,6 +22,11 @@ typedef struct
   u8* pu8RxBufferAddress;             /*!< @brief Address to circular receive buffer */
   u8** pu8RxNextByte;                 /*!< @brief Pointer to buffer location where next received byte will be placed */
   fnCode_type fnRxCallback;           /*!< @brief Callback function for receiving data */
+  u8* pu8TxRingAddress;               /*!< @brief Transmit ring used to merge small writes (NULL for none) */
+  u16 u16TxRingSize;                  /*!< @brief Size of the transmit ring in bytes */
+  u16 u16RxIdleBits;                  /*!< @brief Bulk receive: idle bit periods that end a burst (0 = callback per byte) */
+  bool bHandshake;                    /*!< @brief TRUE for RTS/CTS hardware handshaking (USARTs only) */
+  u32 u32BaudRate;                    /*!< @brief Baud rate in bits/s (0 = the board default in configuration.h) */
 } UartConfigurationType;
 
 /*! 
@@ -32,12 +37,19 @@ typedef struct
 {
   AT91PS_USART pBaseAddress;          /*!< @brief Base address of the associated peripheral */
   u32 u32PrivateFlags;                /*!< @brief Flags for peripheral */
-  MessageType* psTransmitBuffer;      /*!< @brief Pointer to the transmit message linked list */
+  MessageQueueType sTransmitQueue;    /*!< @brief Transmit message linked list */
   u32 u32CurrentTxBytesRemaining;     /*!< @brief Counter for bytes remaining in current transfer */
   u8* pu8CurrentTxData;               /*!< @brief Pointer to current location in the Tx buffer */
   u8* pu8RxBuffer;                    /*!< @brief Pointer to circular receive buffer in user application */
   u8** pu8RxNextByte;                 /*!< @brief Pointer to buffer location where next received byte will be placed */
   fnCode_type fnRxCallback;           /*!< @brief Callback function for receiving data */
+  u8* pu8TxRing;                      /*!< @brief Transmit ring for merged small writes (NULL if not used) */
+  MessageType* psTxRingOpen;          /*!< @brief Last message queued from the ring; later writes are added to it until it starts */
+  u32 u32TxRingOpenToken;             /*!< @brief Token of psTxRingOpen */
+  u16 u16TxRingSize;                  /*!< @brief Size of the transmit ring in bytes */
+  u16 u16TxRingHead;                  /*!< @brief Ring index where the next write goes */
+  volatile u16 u16TxRingTail;         /*!< @brief Ring index of the oldest byte not sent yet (moved by the ISR) */
+  u32 u32BaudRate;                    /*!< @brief Baud rate the BRGR setting actually gives (bits/s) */
   u16 u16RxBufferSize;                /*!< @brief Size of receive buffer in bytes */
   u8 u8PeripheralId;                  /*!< @brief Simple peripheral ID number */
   u8 u8Pad;
@@ -45,7 +57,9 @@ typedef struct
 
 /* u32PrivateFlags in UartPeripheralType */
 #define   _UART_PERIPHERAL_ASSIGNED     (u32)0x00000001   /*!< @brief Set when the peripheral is in use */
+#define   _UART_PERIPHERAL_RX_BULK      (u32)0x00000002   /*!< @brief Set when receiving over the whole buffer with the receiver time-out */
 #define   _UART_PERIPHERAL_TX           (u32)0x00200000   /*!< @brief Set when the peripheral is transmitting */
+#define   _UART_PERIPHERAL_TX_NEXT      (u32)0x00400000   /*!< @brief Set when the next message is loaded in TNPR/TNCR */
 /* end u32PrivateFlags */
 
 
@@ -61,6 +75,10 @@ void UartRelease(UartPeripheralType* psUartPeripheral_);
 
 u32 UartWriteByte(UartPeripheralType* psUartPeripheral_, u8 u8Byte_);
 u32 UartWriteData(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_);
+u32 UartWriteDataPriority(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessagePriorityType ePriority_);
+u32 UartCommitData(UartPeripheralType* psUartPeripheral_, MessageType* psMessage_, u32 u32Size_);
+u32 UartWriteDataNoCopy(UartPeripheralType* psUartPeripheral_, u32 u32Size_, u8* pu8Data_, MessageCallbackType pfnCallback_);
+void UartRxPoll(UartPeripheralType* psUartPeripheral_);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -81,6 +99,12 @@ void UART2_IRQHandler(void);
 /*! @privatesection */                                                                                            
 /*--------------------------------------------------------------------------------------------------------------------*/
 static void UartGenericHandler(void);
+static void UartLoadNextMessage(UartPeripheralType* psUart_);
+static void UartCompleteMessage(UartPeripheralType* psUart_);
+static u32 UartWriteRing(UartPeripheralType* psUart_, u32 u32Size_, u8* pu8Data_);
+static u8* UartRxBulkPosition(UartPeripheralType* psUart_);
+static void UartRxBulkUpdate(UartPeripheralType* psUart_);
+static u32 UartBaudRateDivisor(PeripheralType ePeripheral_, u32 u32BaudRate_, u32* pu32TargetMR_);
 
 
 /***********************************************************************************************************************
@@ -103,6 +127,9 @@ Constants / Definitions
 /* end of Uart_u32Flags */
 
 #define U8_MAX_NUM_UARTS                (u8)5             /*!< @brief Total number of UARTs possible on SAM3U */
+#define U16_UART_TX_RING_MAX_WRITE      (u16)64           /*!< @brief Largest UartWriteData() that is merged through the transmit ring */
+#define U32_UART_MCK_HZ                 (u32)(MCK)        /*!< @brief Clock the baud rate generator divides */
+#define U32_UART_MAX_CD                 (u32)0xFFFF       /*!< @brief Largest BRGR clock divider */
 
 
 
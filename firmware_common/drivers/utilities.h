@@ -23,6 +23,10 @@ Constants / Definitions
 #define ASCII_CARRIAGE_RETURN   (u8)0x0D      /*!< @brief ASCII CR char \r */
 #define ASCII_LINEFEED          (u8)0x0A      /*!< @brief ASCII LF char \n */
 #define ASCII_BACKSPACE         (u8)0x08      /*!< @brief ASCII Backspace char */
+#define ASCII_BELL              (u8)0x07      /*!< @brief ASCII Bell char (terminal beeps) */
+#define ASCII_TAB               (u8)0x09      /*!< @brief ASCII Horizontal tab char \t */
+#define ASCII_ESCAPE            (u8)0x1B      /*!< @brief ASCII Escape char (starts a terminal escape sequence) */
+#define ASCII_DELETE            (u8)0x7F      /*!< @brief ASCII Delete char (sent by many terminals for Backspace) */
 
 /* Terminal escape sequences 
 ("\033" converts to the single control character Esc (0x1B) 
@@ -75,6 +79,8 @@ Constants / Definitions
 #define MESSAGE_TASK_INIT       " task initializing... "            /*!< @brief Standard message */
 #define MESSAGE_TASK_INIT_SIZE  (u8)(sizeof(MESSAGE_TASK_INIT) - 1) /*!< @brief Message size in bytes less NULL */
 
+#define U16_CRC16_CCITT_INIT    (u16)0xFFFF                         /*!< @brief Starting value for Crc16Ccitt() */
+
 
 /***********************************************************************************************************************
 * Function Declarations
@@ -91,6 +97,7 @@ u8 HexToASCIICharUpper(u8 u8Char_);
 u8 HexToASCIICharLower(u8 u8Char_);
 u8 NumberToAscii(u32 u32Number_, u8* pu8AsciiString_);
 bool SearchString(u8* pu8TargetString_, u8* pu8MatchString_);
+u16 Crc16Ccitt(u16 u16Crc_, u8* pu8Data_, u32 u32Size_);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -60,6 +60,9 @@ extern qt_touch_lib_measure_data_t qt_measure_data;    /*!< @brief From touch_ap
 
 extern u32 G_u32DebugFlags;                            /*!< @brief From debug.c */
 
+extern u8 G_au8UtilMessageON[];                        /*!< @brief From utilities.c */
+extern u8 G_au8UtilMessageOFF[];                       /*!< @brief From utilities.c */
+
 
 /***********************************************************************************************************************
 Global variable definitions with scope limited to this local application.
@@ -217,6 +220,8 @@ ErrorStatusType CapTouchInitialize(void)
   CapTouch_u8CurrentHSliderValue = 0;
   CapTouch_u8CurrentVSliderValue = 0;
   
+  DebugCommandRegister("captouch", CapTouchDebugValuesToggle, "Toggle Captouch value display");
+  
   CapTouch_pfnStateMachine = CapTouchSM_Idle;
   G_u32ApplicationFlags |= _APPLICATION_FLAGS_CAPTOUCH;
   return (SUCCESS);
@@ -417,6 +422,41 @@ static void CapTouchSetParameters(void)
     
 } /* end CapTouchSetParameters() */
 
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void CapTouchDebugValuesToggle(void)
+
+@brief Debug command (en+c captouch) that toggles printing the current Captouch horizontal and 
+vertical values.
+
+Requires:
+- NONE
+
+Promises:
+@param G_u32DebugFlags flag _DEBUG_CAPTOUCH_VALUES_ENABLE is toggled
+
+*/
+static void CapTouchDebugValuesToggle(void)
+{
+  u8 au8CaptouchDisplayMessage[] = "\n\rDisplay Captouch values ";
+  u8 au8CaptouchOnMessage[] = "No values displayed if Captouch is OFF\n\r";
+  
+  /* Print message and toggle the flag */
+  DebugPrintf(au8CaptouchDisplayMessage);
+  if(G_u32DebugFlags & _DEBUG_CAPTOUCH_VALUES_ENABLE)
+  {
+    G_u32DebugFlags &= ~_DEBUG_CAPTOUCH_VALUES_ENABLE;
+    DebugPrintf(G_au8UtilMessageOFF);
+  }
+  else
+  {
+    G_u32DebugFlags |= _DEBUG_CAPTOUCH_VALUES_ENABLE;
+    DebugPrintf(G_au8UtilMessageON);
+    DebugPrintf(au8CaptouchOnMessage);
+  }
+  
+} /* end CapTouchDebugValuesToggle() */
+
 #if 0
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn static void CapTouchGetDebugValues(u8 u8Channel_, u16* pu16Measure_, u16* pu16Reference_)
@@ -467,6 +507,7 @@ void CapTouchSM_Idle(void)
 void CapTouchSM_Measure(void)
 {
   static u32 u32DebugPrintTimer = 0;
+  u8 au8Sliders[2];
   
   if( IsTimeUp(&CapTouch_u32Timer, QTOUCH_MEASUREMENT_TIME_MS) )
   {
@@ -478,6 +519,11 @@ void CapTouchSM_Measure(void)
     
     /* Read the vertical slider */
     CapTouch_u8CurrentVSliderValue = u8CapTouchGetSliderValue(SLIDER1);
+
+    /* Stream every sweep if telemetry is on */
+    au8Sliders[0] = CapTouch_u8CurrentHSliderValue;
+    au8Sliders[1] = CapTouch_u8CurrentVSliderValue;
+    DebugTelemetrySend(DEBUG_TELEMETRY_CAPTOUCH, au8Sliders, sizeof(au8Sliders));
   }
   
   /* Print the current values if Debug function is enabled */
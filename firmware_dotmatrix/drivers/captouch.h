@@ -47,6 +47,7 @@ u8 u8CapTouchGetSliderValue(SliderNumberType eSliderNumber_);
 /*-------------------------------------------------------------------------------------------------------------------*/
 static ErrorStatusType CapTouchVerify(void);
 static void CapTouchSetParameters(void);
+static void CapTouchDebugValuesToggle(void);
 static void CapTouchGetDebugValues(u8 u8Channel_, u16* pu16Measure_, u16* pu16Reference_);
 
 
@@ -201,13 +201,14 @@ static u32 Lcd_u32RefreshTimer;                                   /*!< @brief LC
 
 static fnCode_type Lcd_ReturnState;                               /*!< @brief Saved return state */
 static u32 Lcd_u32CurrentMsgToken;                                /*!< @brief Token of message currently being sent to LCD */
+static volatile MessageStateType Lcd_eTransferState;              /*!< @brief State of Lcd_u32CurrentMsgToken: WAITING until LcdTransferCallback() reports the result */
 
 static SspConfigurationType Lcd_sSspConfig;                       /*!< @brief Configuration information for SSP peripheral */
 static SspPeripheralType* Lcd_Ssp;                                /*!< @brief Pointer to LCD's SSP peripheral object */
 static u8 Lcd_u8PagesToUpdate;                                    /*!< @brief Counter for number of pages in current LCD refresh */
 static u8 Lcd_u8CurrentPage;                                      /*!< @brief Current page being updated */
 
-static u8 Lcd_au8TxBuffer[U16_LCD_TX_BUFFER_SIZE];                /*!< @brief Buffer for outgoing data to LCD during the current refresh cycle */
+static u8 Lcd_au8TxBuffer[U16_LCD_TX_BUFFER_SIZE];                /*!< @brief Buffer for outgoing commands to the LCD */
 static u8 Lcd_au8RxDummyBuffer[U16_LCD_RX_BUFFER_SIZE];           /*!< @brief Dummy location for LCD receive buffer (LCD does not send data) */
 static u8* Lcd_pu8RxDummyBuffer;                                  /*!< @brief Dummy buffer pointer */
 
@@ -583,6 +584,7 @@ bool LcdCommand(u8 u8Command_)
     /* Set hardware for command mode and queue the message */
     LCD_COMMAND_MODE();
     Lcd_u32CurrentMsgToken = SspWriteData(Lcd_Ssp, 1, &Lcd_au8TxBuffer[0]);
+    LcdWatchTransfer();
     
     /* Zero the timer so the command sends immediately and push the command out if initializing */
     Lcd_u32RefreshTimer = 0;
@@ -768,6 +770,10 @@ void LcdInitialize(void)
 
   LcdManualMode();
 
+  /* Let a host take screenshots in debug transfer mode (read-only since a write would not be
+  refreshed onto the screen) */
+  DebugXferRegister("lcd", (u8*)G_aau8LcdRamImage, sizeof(G_aau8LcdRamImage), FALSE);
+
   /* Announce on the debug port that LCD setup is ready */
   G_u32ApplicationFlags |= _APPLICATION_FLAGS_LCD;
   DebugPrintf(Lcd_au8MessageInit);
@@ -870,6 +876,7 @@ static bool LcdSetStartAddressForDataTransfer(u8 u8LocalRamPage_)
     LCD_COMMAND_MODE(); 
     Lcd_u32Flags |= _LCD_FLAGS_COMMAND_IN_QUEUE;
     Lcd_u32CurrentMsgToken = SspWriteData(Lcd_Ssp, 3, &Lcd_au8TxBuffer[0]);
+    LcdWatchTransfer();
 
     return TRUE;
   }
@@ -882,7 +889,10 @@ static bool LcdSetStartAddressForDataTransfer(u8 u8LocalRamPage_)
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn static void LcdLoadPageToBuffer(u8 u8LocalRamPage_) 
 
-@brief Loads Lcd_au8TxBuffer with one page of the current LCD data to refresh the screen.
+@brief Builds one page of the current LCD data to refresh the screen and queues it to the SSP.
+
+The page is built directly in a message slot borrowed with ReserveMessage() so the bytes are
+not copied a second time when they are queued.
 
 This function translates the logical addressing of the bits in G_aau8LcdRamImage to the
 addressing used by the ST7565 LCD controller.  Column bits must always be loaded
@@ -901,7 +911,9 @@ Requires:
            
 Promises:
 - Data from G_aau8LcdRamImage is parsed out by row & column for the current page that requires
-  updating.  A maximum of 128 bytes are posted to Lcd_au8TxBuffer (updates a full page).
+  updating.  A maximum of 128 bytes are sent (updates a full page).
+- Lcd_u32CurrentMsgToken holds the token of the page message (0 if it could not be queued) and
+  LcdWatchTransfer() has been called for it
    
 */
 static void LcdLoadPageToBuffer(u8 u8LocalRamPage_) 
@@ -912,8 +924,18 @@ static void LcdLoadPageToBuffer(u8 u8LocalRamPage_)
   u8 u8CurrentBitInLcdPageMask;
   u8 u8CurrentPixelBitInLocalRamMask;
   u8 u8CurrentColumnByte;
+  MessageType* psPageMessage;
 
-  pu8TxBufferParser = &Lcd_au8TxBuffer[0];
+  /* Borrow a message slot to build the page in */
+  psPageMessage = ReserveMessage();
+  if(psPageMessage == NULL)
+  {
+    Lcd_u32CurrentMsgToken = 0;
+    LcdWatchTransfer();
+    return;
+  }
+  
+  pu8TxBufferParser = psPageMessage->pu8Data;
   
   /* Initialize the variables for the first column of pixel data */
   u8LocalRamBitGroup = (Lcd_sCurrentUpdateArea.u16ColumnStart + Lcd_sCurrentUpdateArea.u16ColumnSize - 1) / 8; 
@@ -937,7 +959,7 @@ static void LcdLoadPageToBuffer(u8 u8LocalRamPage_)
       }
     }
     
-    /* The byte has been built: add to Lcd_au8TxBuffer */
+    /* The byte has been built: add to the page message */
     *pu8TxBufferParser = u8CurrentColumnByte;
     pu8TxBufferParser++;
     
@@ -950,13 +972,73 @@ static void LcdLoadPageToBuffer(u8 u8LocalRamPage_)
     }
   }
   
-  /* Lcd_au8TxBuffer now has all of the bytes for the current transfer */
+  /* The message now has all of the bytes for the current transfer */
   LCD_DATA_MODE();
-  Lcd_u32CurrentMsgToken = SspWriteData(Lcd_Ssp, Lcd_sCurrentUpdateArea.u16ColumnSize, &Lcd_au8TxBuffer[0]);
+  Lcd_u32CurrentMsgToken = SspCommitData(Lcd_Ssp, psPageMessage, Lcd_sCurrentUpdateArea.u16ColumnSize);
+  if(Lcd_u32CurrentMsgToken == 0)
+  {
+    ReleaseMessage(psPageMessage);
+  }
+  LcdWatchTransfer();
  
 } /* end LcdLoadPageToBuffer () */
     
 
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void LcdWatchTransfer(void)
+
+@brief Arranges for the result of the message in Lcd_u32CurrentMsgToken to be reported in Lcd_eTransferState.
+
+LcdTransferCallback() is registered for the token so LcdSM_WaitTransfer() only has to check a
+variable instead of looking up the message status every pass.
+
+Requires:
+- Lcd_u32CurrentMsgToken is the token of the message just queued (0 if queueing failed)
+
+Promises:
+- Lcd_eTransferState is WAITING until the message reaches a final state, or already holds the
+  final state (NOT_FOUND if the message was not queued)
+   
+*/
+static void LcdWatchTransfer(void)
+{
+  MessageStateType eState;
+  
+  Lcd_eTransferState = WAITING;
+  eState = MessageSetCallback(Lcd_u32CurrentMsgToken, LcdTransferCallback);
+  
+  /* The callback is only registered while the message is WAITING or SENDING */
+  if( (eState != WAITING) && (eState != SENDING) )
+  {
+    Lcd_eTransferState = eState;
+  }
+  
+} /* end LcdWatchTransfer() */
+
+
+/*!----------------------------------------------------------------------------------------------------------------------
+@fn static void LcdTransferCallback(u32 u32Token_, MessageStateType eState_)
+
+@brief Message completion callback for LCD transfers.  Called from the SSP ISR.
+
+Requires:
+@param u32Token_ is the token of the message that finished
+@param eState_ is its final state
+
+Promises:
+- Lcd_eTransferState is set to eState_ if u32Token_ is the current LCD message
+   
+*/
+static void LcdTransferCallback(u32 u32Token_, MessageStateType eState_)
+{
+  if(u32Token_ == Lcd_u32CurrentMsgToken)
+  {
+    Lcd_eTransferState = eState_;
+  }
+  
+} /* end LcdTransferCallback() */
+
+
 /*!----------------------------------------------------------------------------------------------------------------------
 @fn static void LcdUpdateScreenRefreshArea(PixelBlockType* psPixelsToUpdate_)
 
@@ -1083,14 +1165,15 @@ static void LcdSM_Idle(void)
 
 @brief Sends the current queued LCD command or data to the SPI peripheral through the SSP API.
 
-This waits until the message token is complete or a timeout occurs.  We can determine the next step based
-on Lcd_u8PagesToUpdate that will be 0 if the last transfer was a comand or non-zero if we are waiting
-on the screen refresh process.
+This waits until LcdTransferCallback() reports that the message is complete or has failed.  We can 
+determine the next step based on Lcd_u8PagesToUpdate that will be 0 if the last transfer was a comand 
+or non-zero if we are waiting on the screen refresh process.  If a transfer fails, the rest of the
+refresh is dropped and its area is added back so the next refresh sends it again.
 */
 static void LcdSM_WaitTransfer(void)
 {
   /* Wait for message to be sent */
-  if(QueryMessageStatus(Lcd_u32CurrentMsgToken) == COMPLETE)
+  if(Lcd_eTransferState == COMPLETE)
   {
     /* The next step depends on what we did last */
     if(Lcd_u8PagesToUpdate != 0)
@@ -1121,7 +1204,18 @@ static void LcdSM_WaitTransfer(void)
     Lcd_pfnStateMachine = Lcd_ReturnState;
   }
   
-  /* Check for timeout */
+  /* A message that timed out, was abandoned or could not be queued ends the transfer */
+  else if(Lcd_eTransferState != WAITING)
+  {
+    if(Lcd_u8PagesToUpdate != 0)
+    {
+      Lcd_u8PagesToUpdate = 0;
+      LcdUpdateScreenRefreshArea(&Lcd_sCurrentUpdateArea);
+    }
+    
+    Lcd_u32Flags &= ~(_LCD_MANUAL_MODE | _LCD_FLAGS_COMMAND_IN_QUEUE);
+    Lcd_pfnStateMachine = LcdSM_Idle;
+  }
   
 } /* end LcdSM_WaitTransfer() */
 
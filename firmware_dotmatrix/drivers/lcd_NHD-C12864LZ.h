@@ -100,7 +100,7 @@ typedef struct
 #define U16_LCD_IMAGE_ROWS               U16_LCD_ROWS
 #define U16_LCD_IMAGE_COLUMNS            (u16)(U16_LCD_COLUMNS * (u16)U8_LCD_PIXEL_BITS / 8)
 
-#define U16_LCD_TX_BUFFER_SIZE           (u16)128   /* Enough for a complete page refresh */
+#define U16_LCD_TX_BUFFER_SIZE           (u16)3     /* Longest command sequence (page and column address); page data is built in a message slot */
 #define U16_LCD_RX_BUFFER_SIZE           (u16)1     /* Enough for a complete page refresh */
 
 #define U32_LCD_STARTUP_DELAY_200        (u32)205
@@ -242,6 +242,8 @@ void LcdManualMode(void);
 static bool LcdSetStartAddressForDataTransfer(u8 u8Page_);         
 static void LcdLoadPageToBuffer(u8 u8LocalRamPage_); 
 static void LcdUpdateScreenRefreshArea(PixelBlockType* sPixelsToClear_);
+static void LcdWatchTransfer(void);
+static void LcdTransferCallback(u32 u32Token_, MessageStateType eState_);
 
 
 /**********************************************************************************************************************
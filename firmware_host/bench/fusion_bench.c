@@ -0,0 +1,914 @@
+/*!*********************************************************************************************************************
+@file fusion_bench.c
+@brief Host replay harness for the blade_imu_fusion.c orientation filter.
+
+blade_imu_fusion.c is compiled on its own (fusion-bench) and IMU traces are replayed through it the
+way the LSM6DSL task feeds it: a gyro calibration while still, then U8_BENCH_PASS_SAMPLES samples per
+loop pass.  The same traces go through a double precision model of the same filter, so each run
+checks:
+- Accuracy: the tilt (the gravity direction, which the filter can observe) against the true
+  orientation when the trace has one, and every output against the model, which isolates the
+  error added by the fixed-point arithmetic.  BladeImuFusionToEuler() is checked against atan2().
+- Cost: TSC ticks (nanoseconds without a TSC) per sample and for the slowest pass.  Only the
+  relative numbers matter.  The times depend on the host and its load (or valgrind and the
+  sanitizers), so they are only reported unless --timing is given.  Then the mean must stay below
+  U32_BENCH_MAX_TICKS_PER_SAMPLE so an accidental slow path (64-bit division, floating point)
+  shows up.
+
+With no arguments the traces are synthetic, with a known orientation: still and tilted with gyro
+bias and noise, turning on all three axes, and still with strong vibration on the accelerometer,
+each at 104Hz, 416Hz and 1.66kHz.
+
+  $ ./build/fusion-bench
+  $ ./build/fusion-bench --timing
+  $ ./build/fusion-bench capture/lsm6dsl.csv 12.5
+
+A recorded trace is a CSV file with a header naming at least gyro_x, gyro_y, gyro_z, accel_x,
+accel_y and accel_z in LSB (the lsm6dsl.csv written by telemetry_record.py works as it is) and the
+sample rate in Hz.  If it also has qw, qx, qy and qz columns they are taken as the true orientation.
+The program returns 1 if any accuracy check (or with --timing, the cost check) fails.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- NONE
+
+CONSTANTS
+- U8_BENCH_PASS_SAMPLES
+- U32_BENCH_MAX_TICKS_PER_SAMPLE
+- Bench_asRates
+
+TYPES
+- BenchSampleType
+- BenchModelType
+- BenchResultType
+- BenchRateType
+
+PUBLIC FUNCTIONS
+- int main(int argc, char** argv)
+
+PROTECTED FUNCTIONS
+- NONE
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "configuration.h"
+#include "blade_imu_fusion.h"
+
+/***********************************************************************************************************************
+Constants / Definitions
+***********************************************************************************************************************/
+#define U8_BENCH_PASS_SAMPLES            (u8)8          /*!< @brief Samples per loop pass, as U8_LSM6DSL_FUSION_SAMPLES_PER_PASS */
+#define U32_BENCH_MAX_TICKS_PER_SAMPLE   (u32)3000      /*!< @brief With --timing, fail if a sample costs more than this on average */
+#define U16_BENCH_TAU_MS                 (u16)1000      /*!< @brief Correction time constant (as en+c imufusion) */
+#define U32_BENCH_OUTPUT_HZ              (u32)26        /*!< @brief Output rate the decimation aims for */
+#define U32_BENCH_STILL_US               (u32)1000000   /*!< @brief Synthetic traces start still for this long */
+#define U32_BENCH_SETTLE_US              (u32)3000000   /*!< @brief Tilt errors are counted from this time on */
+#define U32_BENCH_TRACE_US               (u32)20000000  /*!< @brief Length of each synthetic trace */
+#define U32_BENCH_MAX_LINE               (u32)1024      /*!< @brief Longest CSV line */
+
+#define D_BENCH_GYRO_RAD_PER_LSB         (0.035 * M_PI / 180.0)  /*!< @brief 35mdps/LSB at 1000dps */
+#define D_BENCH_MAX_TILT_DEG             2.0            /*!< @brief Largest tilt error allowed against the true orientation */
+#define D_BENCH_MAX_TILT_RMS_DEG         0.75           /*!< @brief Largest RMS tilt error allowed against the true orientation */
+#define D_BENCH_MAX_MODEL_DEG            0.25           /*!< @brief Largest difference allowed between the fixed-point filter and the model */
+#define D_BENCH_MAX_EULER_DEG            0.15           /*!< @brief Largest BladeImuFusionToEuler() error allowed */
+
+
+/***********************************************************************************************************************
+Type Definitions
+***********************************************************************************************************************/
+/*!
+@struct BenchSampleType
+@brief One sample of a trace
+*/
+typedef struct
+{
+  BladeImuFusionSampleType sRaw;   /*!< @brief What the LSM6DSL reports */
+  double adTruth[4];               /*!< @brief True orientation W/X/Y/Z (W is NAN if unknown) */
+} BenchSampleType;
+
+
+/*!
+@struct BenchModelType
+@brief State of the double precision model of blade_imu_fusion.c
+*/
+typedef struct
+{
+  BladeImuFusionConfigType sConfig; /*!< @brief Settings */
+  double adQ[4];                   /*!< @brief Orientation W/X/Y/Z */
+  double adFiltered[3];            /*!< @brief Low-pass accelerometer in LSB */
+  bool bPrimed;                    /*!< @brief adFiltered holds a sample */
+  double dGyroGain;                /*!< @brief Half angle per LSB per sample */
+  double dGain;                    /*!< @brief dt / (2 x tau), at most 0.5 */
+  double dAlignGain;               /*!< @brief dt / (2 x U16_BLADE_FUSION_ALIGN_TAU_MS), at most 0.5 */
+  u32 u32AlignSamples;             /*!< @brief Samples in U32_BLADE_FUSION_ALIGN_US */
+  u32 u32AlignLeft;                /*!< @brief Samples left with the align gain */
+  s16 as16GyroOffset[3];           /*!< @brief Gyro offsets */
+  s32 as32GyroSum[3];              /*!< @brief Raw gyro summed while calibrating */
+  u16 u16CalibrationSamples;       /*!< @brief Samples to average */
+  u16 u16CalibrationLeft;          /*!< @brief Samples still to average */
+  u16 u16DecimationCount;          /*!< @brief Samples since the last output */
+} BenchModelType;
+
+
+/*!
+@struct BenchResultType
+@brief What one run measured
+*/
+typedef struct
+{
+  u32 u32Outputs;                  /*!< @brief Outputs compared */
+  u32 u32TiltCount;                /*!< @brief Outputs compared with the true tilt */
+  double dTiltSquares;             /*!< @brief Sum of squared tilt errors (deg^2) */
+  double dTiltMax;                 /*!< @brief Largest tilt error (deg) */
+  double dModelMax;                /*!< @brief Largest difference to the model (deg) */
+  double dEulerMax;                /*!< @brief Largest BladeImuFusionToEuler() error (deg) */
+  u64 u64Ticks;                    /*!< @brief Ticks spent in BladeImuFusionUpdate() */
+  u64 u64PassMax;                  /*!< @brief Slowest pass of U8_BENCH_PASS_SAMPLES samples */
+  u32 u32Samples;                  /*!< @brief Samples fused (after the calibration) */
+} BenchResultType;
+
+
+/*!
+@struct BenchRateType
+@brief A sample rate the synthetic traces are made at
+*/
+typedef struct
+{
+  u32 u32PeriodUs;                 /*!< @brief Sample period (as Bladelsm6dsl_au32RatePeriodUs[]) */
+  u8 u8LowPassShift;               /*!< @brief Accelerometer IIR shift for about 8Hz */
+} BenchRateType;
+
+
+/*! @brief Rates of the synthetic runs: 104Hz, 416Hz and 1.66kHz */
+static const BenchRateType Bench_asRates[] = {{9615, 1}, {2404, 3}, {602, 5}};
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Bench_<type>" and be declared as static.
+***********************************************************************************************************************/
+static u32 Bench_u32Random = 0x2545F491;  /*!< @brief xorshift32 state (fixed so every run is the same) */
+static bool Bench_bCheckTiming = FALSE;   /*!< @brief TRUE with --timing: the cost is checked as well as reported */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u64 BenchTicks(void)
+
+@brief Returns a free-running tick count (TSC where available).
+*/
+static u64 BenchTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  struct timespec sNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &sNow);
+  return((u64)sNow.tv_sec * 1000000000ull + (u64)sNow.tv_nsec);
+#endif
+
+} /* end BenchTicks() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchNoise(double dSigma_)
+
+@brief Returns normally distributed noise (Box-Muller on a fixed xorshift32 sequence).
+*/
+static double BenchNoise(double dSigma_)
+{
+  double dU1;
+  double dU2;
+
+  Bench_u32Random ^= Bench_u32Random << 13;
+  Bench_u32Random ^= Bench_u32Random >> 17;
+  Bench_u32Random ^= Bench_u32Random << 5;
+  dU1 = ((double)Bench_u32Random + 1.0) / 4294967297.0;
+  Bench_u32Random ^= Bench_u32Random << 13;
+  Bench_u32Random ^= Bench_u32Random >> 17;
+  Bench_u32Random ^= Bench_u32Random << 5;
+  dU2 = (double)Bench_u32Random / 4294967296.0;
+
+  return(dSigma_ * sqrt(-2.0 * log(dU1)) * cos(2.0 * M_PI * dU2));
+
+} /* end BenchNoise() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static s16 BenchQuantize(double dValue_)
+
+@brief Rounds a reading to LSB and clips it to the s16 range like the sensor.
+*/
+static s16 BenchQuantize(double dValue_)
+{
+  dValue_ = round(dValue_);
+  if(dValue_ > 32767.0)
+  {
+    return(32767);
+  }
+  if(dValue_ < -32768.0)
+  {
+    return(-32768);
+  }
+  return((s16)dValue_);
+
+} /* end BenchQuantize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchGravity(double* pdQ_, double* pdGravity_)
+
+@brief The world Z axis seen from the sensor for orientation pdQ_ (what the accelerometer reads at rest, in g).
+*/
+static void BenchGravity(double* pdQ_, double* pdGravity_)
+{
+  pdGravity_[0] = 2.0 * (pdQ_[1] * pdQ_[3] - pdQ_[0] * pdQ_[2]);
+  pdGravity_[1] = 2.0 * (pdQ_[0] * pdQ_[1] + pdQ_[2] * pdQ_[3]);
+  pdGravity_[2] = pdQ_[0] * pdQ_[0] - pdQ_[1] * pdQ_[1] - pdQ_[2] * pdQ_[2] + pdQ_[3] * pdQ_[3];
+
+} /* end BenchGravity() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchAngle(double* pdA_, double* pdB_)
+
+@brief Rotation angle in degrees between two quaternions.  They are normalized first: a Q14 output
+is only unit length to about 1e-4, which would read as most of a degree this close to acos(1).
+*/
+static double BenchAngle(double* pdA_, double* pdB_)
+{
+  double dDot = fabs(pdA_[0] * pdB_[0] + pdA_[1] * pdB_[1] + pdA_[2] * pdB_[2] + pdA_[3] * pdB_[3]);
+
+  dDot /= sqrt(pdA_[0] * pdA_[0] + pdA_[1] * pdA_[1] + pdA_[2] * pdA_[2] + pdA_[3] * pdA_[3]) *
+          sqrt(pdB_[0] * pdB_[0] + pdB_[1] * pdB_[1] + pdB_[2] * pdB_[2] + pdB_[3] * pdB_[3]);
+
+  return(2.0 * acos(dDot > 1.0 ? 1.0 : dDot) * 180.0 / M_PI);
+
+} /* end BenchAngle() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchTiltError(double* pdEstimate_, double* pdTruth_)
+
+@brief Angle in degrees between the gravity directions of two orientations (yaw does not count).
+*/
+static double BenchTiltError(double* pdEstimate_, double* pdTruth_)
+{
+  double adA[3];
+  double adB[3];
+  double dDot;
+
+  BenchGravity(pdEstimate_, adA);
+  BenchGravity(pdTruth_, adB);
+  dDot = adA[0] * adB[0] + adA[1] * adB[1] + adA[2] * adB[2];
+  dDot /= sqrt(adA[0] * adA[0] + adA[1] * adA[1] + adA[2] * adA[2]) *
+          sqrt(adB[0] * adB[0] + adB[1] * adB[1] + adB[2] * adB[2]);
+
+  return(acos(dDot > 1.0 ? 1.0 : dDot) * 180.0 / M_PI);
+
+} /* end BenchTiltError() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchAngleError(double dFixed_, double dExact_)
+
+@brief Difference in degrees between two angles, allowing for the +/-180 wrap.
+*/
+static double BenchAngleError(double dFixed_, double dExact_)
+{
+  double dError = fmod(fabs(dFixed_ - dExact_), 360.0);
+
+  return(dError > 180.0 ? 360.0 - dError : dError);
+
+} /* end BenchAngleError() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchModelGain(u32 u32PeriodUs_, u16 u16TauMs_)
+
+@brief dt / (2 x tau), at most 0.5 (as BladeImuFusionGain()).
+*/
+static double BenchModelGain(u32 u32PeriodUs_, u16 u16TauMs_)
+{
+  double dGain = (double)u32PeriodUs_ / (2000.0 * u16TauMs_);
+
+  return(dGain > 0.5 ? 0.5 : dGain);
+
+} /* end BenchModelGain() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchModelStart(BenchModelType* psModel_, BladeImuFusionConfigType* psConfig_, u16 u16Calibration_)
+
+@brief Starts the model as BladeImuFusionStart() and BladeImuFusionCalibrateGyro().
+*/
+static void BenchModelStart(BenchModelType* psModel_, BladeImuFusionConfigType* psConfig_, u16 u16Calibration_)
+{
+  memset(psModel_, 0, sizeof(*psModel_));
+  psModel_->sConfig = *psConfig_;
+  psModel_->adQ[0] = 1.0;
+  psModel_->dGyroGain = D_BENCH_GYRO_RAD_PER_LSB * psConfig_->u32PeriodUs * 1e-6 / 2.0;
+  if(psConfig_->u16TauMs != 0)
+  {
+    psModel_->dGain = BenchModelGain(psConfig_->u32PeriodUs, psConfig_->u16TauMs);
+    psModel_->dAlignGain = BenchModelGain(psConfig_->u32PeriodUs, U16_BLADE_FUSION_ALIGN_TAU_MS);
+  }
+  psModel_->u32AlignSamples = U32_BLADE_FUSION_ALIGN_US / psConfig_->u32PeriodUs;
+  psModel_->u32AlignLeft = psModel_->u32AlignSamples;
+  psModel_->u16CalibrationSamples = u16Calibration_;
+  psModel_->u16CalibrationLeft = u16Calibration_;
+
+} /* end BenchModelStart() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchModelUpdate(BenchModelType* psModel_, BladeImuFusionSampleType* psSample_)
+
+@brief One sample through the model: the steps of BladeImuFusionUpdate() in double precision, with
+an exact normalization.  Returns TRUE when an output is due.
+*/
+static bool BenchModelUpdate(BenchModelType* psModel_, BladeImuFusionSampleType* psSample_)
+{
+  double* pdQ = psModel_->adQ;
+  double adHalf[3];
+  double adUnit[3];
+  double adGravity[3];
+  double adNext[4];
+  double dNorm;
+  double dGain;
+  double dLow = (double)(((u32)U16_BLADE_FUSION_ACCEL_1G * (100 - U8_BLADE_FUSION_ACCEL_GATE_PERCENT)) / 100);
+  double dHigh = (double)(((u32)U16_BLADE_FUSION_ACCEL_1G * (100 + U8_BLADE_FUSION_ACCEL_GATE_PERCENT)) / 100);
+  double dAccel;
+
+  if(psModel_->u16CalibrationLeft != 0)
+  {
+    for(u8 i = 0; i < 3; i++)
+    {
+      psModel_->as32GyroSum[i] += psSample_->as16Gyro[i];
+    }
+    if(--psModel_->u16CalibrationLeft == 0)
+    {
+      for(u8 i = 0; i < 3; i++)
+      {
+        psModel_->as16GyroOffset[i] = (s16)(psModel_->as32GyroSum[i] / (s32)psModel_->u16CalibrationSamples);
+      }
+      pdQ[0] = 1.0;
+      pdQ[1] = pdQ[2] = pdQ[3] = 0.0;
+      psModel_->bPrimed = FALSE;
+      psModel_->u32AlignLeft = psModel_->u32AlignSamples;
+    }
+    return(FALSE);
+  }
+
+  for(u8 i = 0; i < 3; i++)
+  {
+    dAccel = psSample_->as16Accel[i];
+    if( (psModel_->sConfig.u8AccelLowPassShift == 0) || !psModel_->bPrimed )
+    {
+      psModel_->adFiltered[i] = dAccel;
+    }
+    else
+    {
+      psModel_->adFiltered[i] += (dAccel - psModel_->adFiltered[i]) / (double)(1 << psModel_->sConfig.u8AccelLowPassShift);
+    }
+    adHalf[i] = (double)(psSample_->as16Gyro[i] - psModel_->as16GyroOffset[i]) * psModel_->dGyroGain;
+  }
+  psModel_->bPrimed = TRUE;
+
+  dGain = psModel_->dGain;
+  if(psModel_->u32AlignLeft != 0)
+  {
+    psModel_->u32AlignLeft--;
+    dGain = psModel_->dAlignGain;
+  }
+
+  dNorm = sqrt(psModel_->adFiltered[0] * psModel_->adFiltered[0] + psModel_->adFiltered[1] * psModel_->adFiltered[1] +
+               psModel_->adFiltered[2] * psModel_->adFiltered[2]);
+  if( (dGain != 0.0) && (dNorm >= dLow) && (dNorm < dHigh + 1.0) )
+  {
+    for(u8 i = 0; i < 3; i++)
+    {
+      adUnit[i] = psModel_->adFiltered[i] / dNorm;
+    }
+    BenchGravity(pdQ, adGravity);
+    adHalf[0] += dGain * (adUnit[1] * adGravity[2] - adUnit[2] * adGravity[1]);
+    adHalf[1] += dGain * (adUnit[2] * adGravity[0] - adUnit[0] * adGravity[2]);
+    adHalf[2] += dGain * (adUnit[0] * adGravity[1] - adUnit[1] * adGravity[0]);
+  }
+
+  for(u8 i = 0; i < 3; i++)
+  {
+    adHalf[i] = fmax(-0.5, fmin(0.5, adHalf[i]));
+  }
+
+  adNext[0] = pdQ[0] - pdQ[1] * adHalf[0] - pdQ[2] * adHalf[1] - pdQ[3] * adHalf[2];
+  adNext[1] = pdQ[1] + pdQ[0] * adHalf[0] + pdQ[2] * adHalf[2] - pdQ[3] * adHalf[1];
+  adNext[2] = pdQ[2] + pdQ[0] * adHalf[1] - pdQ[1] * adHalf[2] + pdQ[3] * adHalf[0];
+  adNext[3] = pdQ[3] + pdQ[0] * adHalf[2] + pdQ[1] * adHalf[1] - pdQ[2] * adHalf[0];
+  dNorm = sqrt(adNext[0] * adNext[0] + adNext[1] * adNext[1] + adNext[2] * adNext[2] + adNext[3] * adNext[3]);
+  for(u8 i = 0; i < 4; i++)
+  {
+    pdQ[i] = adNext[i] / dNorm;
+  }
+
+  if(++psModel_->u16DecimationCount < psModel_->sConfig.u16Decimation)
+  {
+    return(FALSE);
+  }
+  psModel_->u16DecimationCount = 0;
+  return(TRUE);
+
+} /* end BenchModelUpdate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static double BenchCheckEuler(s16* ps16Quaternion_)
+
+@brief Returns the largest error in degrees of BladeImuFusionToEuler() for one output.
+*/
+static double BenchCheckEuler(s16* ps16Quaternion_)
+{
+  BladeImuFusionEulerType sAngles;
+  double adQ[4];
+  double dSinPitch;
+  double dError;
+
+  for(u8 i = 0; i < 4; i++)
+  {
+    adQ[i] = ps16Quaternion_[i] / 16384.0;
+  }
+
+  BladeImuFusionToEuler(ps16Quaternion_, &sAngles);
+  dSinPitch = fmax(-1.0, fmin(1.0, 2.0 * (adQ[0] * adQ[2] - adQ[3] * adQ[1])));
+
+  /* Roll and yaw mean nothing close to +/-90 degrees pitch */
+  dError = BenchAngleError(sAngles.s16Pitch / 100.0, asin(dSinPitch) * 180.0 / M_PI);
+  if(fabs(dSinPitch) < 0.99)
+  {
+    dError = fmax(dError, BenchAngleError(sAngles.s16Roll / 100.0,
+                          atan2(2.0 * (adQ[0] * adQ[1] + adQ[2] * adQ[3]),
+                                1.0 - 2.0 * (adQ[1] * adQ[1] + adQ[2] * adQ[2])) * 180.0 / M_PI));
+    dError = fmax(dError, BenchAngleError(sAngles.s16Yaw / 100.0,
+                          atan2(2.0 * (adQ[0] * adQ[3] + adQ[1] * adQ[2]),
+                                1.0 - 2.0 * (adQ[2] * adQ[2] + adQ[3] * adQ[3])) * 180.0 / M_PI));
+  }
+
+  return(dError);
+
+} /* end BenchCheckEuler() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchRun(BenchSampleType* psTrace_, u32 u32Count_, BladeImuFusionConfigType* psConfig_,
+                         u16 u16Calibration_, BenchResultType* psResult_)
+
+@brief Replays a trace through blade_imu_fusion.c and the model and compares every output.
+*/
+static void BenchRun(BenchSampleType* psTrace_, u32 u32Count_, BladeImuFusionConfigType* psConfig_,
+                     u16 u16Calibration_, BenchResultType* psResult_)
+{
+  BenchModelType sModel;
+  BladeImuFusionOutputType asOutputs[U8_BENCH_PASS_SAMPLES];
+  bool abOutput[U8_BENCH_PASS_SAMPLES];
+  double adFixed[4];
+  double dError;
+  u32 u32Settle = U32_BENCH_SETTLE_US / psConfig_->u32PeriodUs;
+  u64 u64Start;
+  u64 u64Pass;
+  u32 u32Pass;
+
+  memset(psResult_, 0, sizeof(*psResult_));
+  BladeImuFusionStart(psConfig_);
+  BladeImuFusionCalibrateGyro(u16Calibration_);
+  BenchModelStart(&sModel, psConfig_, u16Calibration_);
+
+  for(u32 i = 0; i < u32Count_; i += u32Pass)
+  {
+    u32Pass = u32Count_ - i;
+    if(u32Pass > U8_BENCH_PASS_SAMPLES)
+    {
+      u32Pass = U8_BENCH_PASS_SAMPLES;
+    }
+
+    /* One loop pass worth of samples, timed together, taking each output as Bladelsm6dslFusionRun() does */
+    u64Start = BenchTicks();
+    for(u32 j = 0; j < u32Pass; j++)
+    {
+      abOutput[j] = BladeImuFusionUpdate(&psTrace_[i + j].sRaw);
+      if(abOutput[j])
+      {
+        BladeImuFusionGetOutput(&asOutputs[j]);
+      }
+    }
+    u64Pass = BenchTicks() - u64Start;
+    if(i >= u16Calibration_)
+    {
+      psResult_->u64Ticks += u64Pass;
+      psResult_->u32Samples += u32Pass;
+      if(u64Pass > psResult_->u64PassMax)
+      {
+        psResult_->u64PassMax = u64Pass;
+      }
+    }
+
+    for(u32 j = 0; j < u32Pass; j++)
+    {
+      if(BenchModelUpdate(&sModel, &psTrace_[i + j].sRaw) != abOutput[j])
+      {
+        fprintf(stderr, "fusion_bench: output %u is not due in both filters\n", i + j);
+        psResult_->dModelMax = INFINITY;
+        return;
+      }
+      if(!abOutput[j])
+      {
+        continue;
+      }
+
+      for(u8 k = 0; k < 4; k++)
+      {
+        adFixed[k] = asOutputs[j].as16Quaternion[k] / 16384.0;
+      }
+
+      psResult_->u32Outputs++;
+      psResult_->dModelMax = fmax(psResult_->dModelMax, BenchAngle(adFixed, sModel.adQ));
+      psResult_->dEulerMax = fmax(psResult_->dEulerMax, BenchCheckEuler(asOutputs[j].as16Quaternion));
+
+      if( !isnan(psTrace_[i + j].adTruth[0]) && ((i + j) >= u32Settle) )
+      {
+        dError = BenchTiltError(adFixed, psTrace_[i + j].adTruth);
+        psResult_->u32TiltCount++;
+        psResult_->dTiltSquares += dError * dError;
+        psResult_->dTiltMax = fmax(psResult_->dTiltMax, dError);
+      }
+    }
+  }
+
+} /* end BenchRun() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchReport(const char* pcName_, u32 u32PeriodUs_, BenchResultType* psResult_)
+
+@brief Prints one result line and returns FALSE if a check failed (the cost only with --timing).
+*/
+static bool BenchReport(const char* pcName_, u32 u32PeriodUs_, BenchResultType* psResult_)
+{
+  double dTiltRms = 0.0;
+  double dTicks = 0.0;
+  bool bPass = TRUE;
+
+  if(psResult_->u32TiltCount != 0)
+  {
+    dTiltRms = sqrt(psResult_->dTiltSquares / psResult_->u32TiltCount);
+  }
+  if(psResult_->u32Samples != 0)
+  {
+    dTicks = (double)psResult_->u64Ticks / psResult_->u32Samples;
+  }
+
+  printf("%-10s %6.1f Hz: ", pcName_, 1e6 / u32PeriodUs_);
+  if(psResult_->u32TiltCount != 0)
+  {
+    printf("tilt error rms %.2f max %.2f deg, ", dTiltRms, psResult_->dTiltMax);
+  }
+  printf("vs model %.3f deg, euler %.3f deg, %u outputs, %.1f ticks/sample (slowest pass %llu)\n",
+         psResult_->dModelMax, psResult_->dEulerMax, psResult_->u32Outputs, dTicks, psResult_->u64PassMax);
+
+  if( (psResult_->u32Outputs == 0) || (psResult_->dModelMax > D_BENCH_MAX_MODEL_DEG) ||
+      (psResult_->dEulerMax > D_BENCH_MAX_EULER_DEG) )
+  {
+    bPass = FALSE;
+  }
+  if( Bench_bCheckTiming && (dTicks > U32_BENCH_MAX_TICKS_PER_SAMPLE) )
+  {
+    bPass = FALSE;
+  }
+  if( (psResult_->u32TiltCount != 0) &&
+      ((dTiltRms > D_BENCH_MAX_TILT_RMS_DEG) || (psResult_->dTiltMax > D_BENCH_MAX_TILT_DEG)) )
+  {
+    bPass = FALSE;
+  }
+  if(!bPass)
+  {
+    fprintf(stderr, "fusion_bench: %s at %.1f Hz failed\n", pcName_, 1e6 / u32PeriodUs_);
+  }
+
+  return(bPass);
+
+} /* end BenchReport() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchSyntheticRate(u8 u8Scenario_, double dTime_, double* pdRate_)
+
+@brief True angular rate in rad/s of a synthetic trace at dTime_ seconds.
+*/
+static void BenchSyntheticRate(u8 u8Scenario_, double dTime_, double* pdRate_)
+{
+  pdRate_[0] = 0.0;
+  pdRate_[1] = 0.0;
+  pdRate_[2] = 0.0;
+
+  if( (u8Scenario_ == 1) && (dTime_ >= U32_BENCH_STILL_US * 1e-6) )
+  {
+    pdRate_[0] = 40.0 * M_PI / 180.0 * sin(2.0 * M_PI * 0.20 * dTime_);
+    pdRate_[1] = 30.0 * M_PI / 180.0 * sin(2.0 * M_PI * 0.13 * dTime_ + 1.0);
+    pdRate_[2] = 60.0 * M_PI / 180.0 * sin(2.0 * M_PI * 0.07 * dTime_ + 2.0);
+  }
+
+} /* end BenchSyntheticRate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchRotate(double* pdQ_, double* pdRate_, double dSeconds_)
+
+@brief Turns orientation pdQ_ at a constant body rate for dSeconds_ (exactly, with the quaternion exponential).
+*/
+static void BenchRotate(double* pdQ_, double* pdRate_, double dSeconds_)
+{
+  double dRate = sqrt(pdRate_[0] * pdRate_[0] + pdRate_[1] * pdRate_[1] + pdRate_[2] * pdRate_[2]);
+  double adStep[4];
+  double adQ[4];
+  double dSin;
+
+  if(dRate == 0.0)
+  {
+    return;
+  }
+
+  dSin = sin(dRate * dSeconds_ / 2.0) / dRate;
+  adStep[0] = cos(dRate * dSeconds_ / 2.0);
+  adStep[1] = dSin * pdRate_[0];
+  adStep[2] = dSin * pdRate_[1];
+  adStep[3] = dSin * pdRate_[2];
+  memcpy(adQ, pdQ_, sizeof(adQ));
+
+  pdQ_[0] = adQ[0] * adStep[0] - adQ[1] * adStep[1] - adQ[2] * adStep[2] - adQ[3] * adStep[3];
+  pdQ_[1] = adQ[0] * adStep[1] + adQ[1] * adStep[0] + adQ[2] * adStep[3] - adQ[3] * adStep[2];
+  pdQ_[2] = adQ[0] * adStep[2] - adQ[1] * adStep[3] + adQ[2] * adStep[0] + adQ[3] * adStep[1];
+  pdQ_[3] = adQ[0] * adStep[3] + adQ[1] * adStep[2] - adQ[2] * adStep[1] + adQ[3] * adStep[0];
+
+} /* end BenchRotate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u32 BenchSynthesize(u8 u8Scenario_, u32 u32PeriodUs_, BenchSampleType** ppsTrace_)
+
+@brief Makes a synthetic trace with a known orientation and returns its length.
+
+0 "still": tilted 20 degrees in roll and -10 in pitch with gyro bias and noise.
+1 "turning": as still for U32_BENCH_STILL_US, then slow sine rates on all three axes (up to 60dps).
+2 "vibration": as still with 0.4g at 60Hz on every accelerometer axis.
+
+The true orientation is integrated in ten exact steps per sample; the gyro reports the rate at 
+each sample time.
+*/
+static u32 BenchSynthesize(u8 u8Scenario_, u32 u32PeriodUs_, BenchSampleType** ppsTrace_)
+{
+  const double adBias[3] = {30.0, -20.0, 12.0};
+  const double dRoll = 20.0 * M_PI / 180.0;
+  const double dPitch = -10.0 * M_PI / 180.0;
+  u32 u32Count = U32_BENCH_TRACE_US / u32PeriodUs_;
+  BenchSampleType* psTrace = calloc(u32Count, sizeof(BenchSampleType));
+  double dPeriod = u32PeriodUs_ * 1e-6;
+  double adQ[4];
+  double adRate[3];
+  double adGravity[3];
+  double dTime;
+  double dAccel;
+
+  /* Roll then pitch (Z-Y-X with no yaw) */
+  adQ[0] = cos(dRoll / 2) * cos(dPitch / 2);
+  adQ[1] = sin(dRoll / 2) * cos(dPitch / 2);
+  adQ[2] = cos(dRoll / 2) * sin(dPitch / 2);
+  adQ[3] = -sin(dRoll / 2) * sin(dPitch / 2);
+
+  for(u32 i = 0; i < u32Count; i++)
+  {
+    dTime = i * dPeriod;
+    memcpy(psTrace[i].adTruth, adQ, sizeof(adQ));
+    BenchSyntheticRate(u8Scenario_, dTime, adRate);
+    BenchGravity(adQ, adGravity);
+    for(u8 k = 0; k < 3; k++)
+    {
+      psTrace[i].sRaw.as16Gyro[k] = BenchQuantize(adRate[k] / D_BENCH_GYRO_RAD_PER_LSB + adBias[k] + BenchNoise(3.0));
+      dAccel = adGravity[k];
+      if(u8Scenario_ == 2)
+      {
+        dAccel += 0.4 * sin(2.0 * M_PI * 60.0 * dTime + k);
+      }
+      psTrace[i].sRaw.as16Accel[k] = BenchQuantize(dAccel * U16_BLADE_FUSION_ACCEL_1G + BenchNoise(8.0));
+    }
+
+    for(u8 n = 0; n < 10; n++)
+    {
+      BenchSyntheticRate(u8Scenario_, dTime + (n + 0.5) * dPeriod / 10.0, adRate);
+      BenchRotate(adQ, adRate, dPeriod / 10.0);
+    }
+  }
+
+  *ppsTrace_ = psTrace;
+  return(u32Count);
+
+} /* end BenchSynthesize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u32 BenchLoadTrace(const char* pcPath_, BenchSampleType** ppsTrace_)
+
+@brief Reads a recorded trace (see the top of this file) and returns its length (0 on error).
+*/
+static u32 BenchLoadTrace(const char* pcPath_, BenchSampleType** ppsTrace_)
+{
+  static const char* apcNames[] = {"gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z", "qw", "qx", "qy", "qz"};
+  int aiColumns[10];
+  char acLine[U32_BENCH_MAX_LINE];
+  FILE* pFile = fopen(pcPath_, "r");
+  BenchSampleType* psTrace = NULL;
+  u32 u32Count = 0;
+  u32 u32Size = 0;
+  char* pcField;
+  char* pcSave;
+  double dValue;
+  int iColumn;
+
+  if(pFile == NULL)
+  {
+    fprintf(stderr, "fusion_bench: cannot open %s\n", pcPath_);
+    return(0);
+  }
+
+  for(u8 i = 0; i < 10; i++)
+  {
+    aiColumns[i] = -1;
+  }
+  if(fgets(acLine, sizeof(acLine), pFile) != NULL)
+  {
+    iColumn = 0;
+    for(pcField = strtok_r(acLine, ",\r\n", &pcSave); pcField != NULL; pcField = strtok_r(NULL, ",\r\n", &pcSave))
+    {
+      for(u8 i = 0; i < 10; i++)
+      {
+        if(strcmp(pcField, apcNames[i]) == 0)
+        {
+          aiColumns[i] = iColumn;
+        }
+      }
+      iColumn++;
+    }
+  }
+  for(u8 i = 0; i < 6; i++)
+  {
+    if(aiColumns[i] < 0)
+    {
+      fprintf(stderr, "fusion_bench: %s has no %s column\n", pcPath_, apcNames[i]);
+      fclose(pFile);
+      return(0);
+    }
+  }
+
+  while(fgets(acLine, sizeof(acLine), pFile) != NULL)
+  {
+    if(u32Count == u32Size)
+    {
+      u32Size = (u32Size == 0) ? 4096 : (u32Size * 2);
+      psTrace = realloc(psTrace, u32Size * sizeof(BenchSampleType));
+    }
+
+    psTrace[u32Count].adTruth[0] = NAN;
+    iColumn = 0;
+    for(pcField = strtok_r(acLine, ",\r\n", &pcSave); pcField != NULL; pcField = strtok_r(NULL, ",\r\n", &pcSave))
+    {
+      dValue = strtod(pcField, NULL);
+      for(u8 i = 0; i < 10; i++)
+      {
+        if(aiColumns[i] != iColumn)
+        {
+          continue;
+        }
+        if(i < 3)
+        {
+          psTrace[u32Count].sRaw.as16Gyro[i] = BenchQuantize(dValue);
+        }
+        else if(i < 6)
+        {
+          psTrace[u32Count].sRaw.as16Accel[i - 3] = BenchQuantize(dValue);
+        }
+        else if(aiColumns[6] >= 0)
+        {
+          psTrace[u32Count].adTruth[i - 6] = dValue;
+        }
+      }
+      iColumn++;
+    }
+    u32Count++;
+  }
+
+  fclose(pFile);
+  *ppsTrace_ = psTrace;
+  return(u32Count);
+
+} /* end BenchLoadTrace() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn int main(int argc, char** argv)
+
+@brief Runs the synthetic traces, or a recorded trace given as a file name and a rate in Hz.
+Either can be preceded by --timing.
+*/
+int main(int argc, char** argv)
+{
+  static const char* apcScenarios[] = {"still", "turning", "vibration"};
+  BladeImuFusionConfigType sConfig;
+  BenchResultType sResult;
+  BenchSampleType* psTrace;
+  u32 u32Count;
+  bool bPass = TRUE;
+  double dRate;
+
+  if( (argc > 1) && (strcmp(argv[1], "--timing") == 0) )
+  {
+    Bench_bCheckTiming = TRUE;
+    argc--;
+    argv++;
+  }
+
+  /* A recorded trace: no gyro calibration (the device may not start still) */
+  if(argc > 2)
+  {
+    dRate = strtod(argv[2], NULL);
+    if(dRate <= 0.0)
+    {
+      fprintf(stderr, "usage: fusion-bench [--timing] [trace.csv rate_hz]\n");
+      return(1);
+    }
+    u32Count = BenchLoadTrace(argv[1], &psTrace);
+    if(u32Count == 0)
+    {
+      return(1);
+    }
+
+    sConfig.u32PeriodUs = (u32)(1e6 / dRate + 0.5);
+    sConfig.u16TauMs = U16_BENCH_TAU_MS;
+    sConfig.u16Decimation = (u16)fmax(1.0, round(dRate / U32_BENCH_OUTPUT_HZ));
+    sConfig.u8AccelLowPassShift = 0;
+    if(!BladeImuFusionStart(&sConfig))
+    {
+      fprintf(stderr, "fusion_bench: %.1f Hz is too slow\n", dRate);
+      return(1);
+    }
+
+    BenchRun(psTrace, u32Count, &sConfig, 0, &sResult);
+    bPass = BenchReport(argv[1], sConfig.u32PeriodUs, &sResult);
+    free(psTrace);
+    return(bPass ? 0 : 1);
+  }
+
+  for(u8 i = 0; i < sizeof(apcScenarios) / sizeof(apcScenarios[0]); i++)
+  {
+    for(u8 j = 0; j < sizeof(Bench_asRates) / sizeof(Bench_asRates[0]); j++)
+    {
+      sConfig.u32PeriodUs = Bench_asRates[j].u32PeriodUs;
+      sConfig.u16TauMs = U16_BENCH_TAU_MS;
+      sConfig.u16Decimation = (u16)((1000000 / sConfig.u32PeriodUs) / U32_BENCH_OUTPUT_HZ);
+      sConfig.u8AccelLowPassShift = Bench_asRates[j].u8LowPassShift;
+
+      u32Count = BenchSynthesize(i, sConfig.u32PeriodUs, &psTrace);
+      BenchRun(psTrace, u32Count, &sConfig, (u16)(U32_BENCH_STILL_US / 2 / sConfig.u32PeriodUs), &sResult);
+      bPass &= BenchReport(apcScenarios[i], sConfig.u32PeriodUs, &sResult);
+      free(psTrace);
+    }
+  }
+
+  return(bPass ? 0 : 1);
+
+} /* end main() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,1046 @@
+/*!*********************************************************************************************************************
+@file msg_bench.c
+@brief Host microbenchmark for the messaging.c transmit pool.
+
+messaging.c is compiled on its own with U8_TX_QUEUE_SIZE set by the build (msg-bench-8, msg-bench-32
+and msg-bench-128), and once more with the EIE_MSG_ARENA payload ring at its default sizes 
+(msg-bench-arena).  Each round fills the pool to that depth with 1-byte messages on one transmit
+queue and then dequeues them all, which is what a peripheral sees when a burst of DebugPrintf()
+calls is drained.  The cost of each QueueMessage() and DeQueueMessage() call is timed, as are the
+UpdateMessageStatus() call the peripheral ISR makes before dequeuing and the QueryMessageStatus()
+call the owner makes afterwards.  The interrupts-off windows are measured through
+__disable_irq()/__enable_irq(), which this file provides in place of the simulator.
+
+Before timing, the ReserveMessage()/CommitMessage() loan path and QueueMessageNoCopy() with its
+completion callback are checked once, as are the time-to-live sweeps run by 
+MessagingRunActiveState() (also on a message split across slots), the order in which MSG_PRIORITY_HIGH messages are sent, loading a message
+ahead with StartNextMessage(), a chain of transfers driven by MessageSetCallback() and the counters
+reported by MessagingGetStats() and MessagingDumpStats().  After timing, a burst of DebugPrintf()-sized lines is queued
+on two transmit queues until the pool is full, one queue is drained and the pool is filled again.
+The number of lines that fit and the pool statistics show how well each backend uses its RAM.
+
+Times are in TSC ticks on x86 and in nanoseconds elsewhere.  Only the relative numbers matter: the
+per-call cost and the interrupts-off window should stay flat as the depth increases.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- G_u32SystemTime1ms, G_u32SystemTime1s, G_u32SystemFlags, G_u32ApplicationFlags (stand-ins for main.c)
+
+CONSTANTS
+- U32_BENCH_ROUNDS
+- Bench_au8BurstLengths
+
+TYPES
+- NONE
+
+PUBLIC FUNCTIONS
+- int main(int argc, char** argv)
+
+PROTECTED FUNCTIONS
+- void __disable_irq(void)
+- void __enable_irq(void)
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Constants / Definitions
+***********************************************************************************************************************/
+#define U32_BENCH_ROUNDS        (u32)20000      /*!< @brief Default number of fill/drain rounds */
+
+/*! @brief Line lengths cycled through by the burst test (typical debug output) */
+static const u8 Bench_au8BurstLengths[] = {24, 48, 9, 70, 33, 2, 17, 96};
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+***********************************************************************************************************************/
+/* Stand-ins for main.c */
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32ApplicationFlags;
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern u32 G_u32MessagingFlags;                  /*!< @brief From messaging.c */
+extern u32 G_u32MessagingStatusEvictions;        /*!< @brief From messaging.c */
+extern u32 G_u32MessagingTimeouts;               /*!< @brief From messaging.c */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Bench_<type>" and be declared as static.
+***********************************************************************************************************************/
+static u64 Bench_u64IrqOffStart;                 /*!< @brief Tick count at the last __disable_irq() */
+static u64 Bench_u64IrqOffMax;                   /*!< @brief Longest interrupts-off window seen */
+static u64 Bench_u64IrqOffTotal;                 /*!< @brief Sum of all interrupts-off windows */
+static u64 Bench_u64IrqOffCount;                 /*!< @brief Number of interrupts-off windows */
+static bool Bench_bIrqOff;                       /*!< @brief TRUE between __disable_irq() and __enable_irq() */
+
+static u32 Bench_u32CallbackToken;               /*!< @brief Token passed to the last completion callback */
+static MessageStateType Bench_eCallbackState;    /*!< @brief State passed to the last completion callback */
+
+static MessageQueueType Bench_sChainQueue;       /*!< @brief Queue used by the chained transfer check */
+static u32 Bench_u32ChainCount;                  /*!< @brief Messages completed in the chained transfer check */
+static u32 Bench_u32ChainToken;                  /*!< @brief Token of the last message queued by BenchChainCallback() */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u64 BenchTicks(void)
+
+@brief Returns a free-running tick count (TSC where available).
+*/
+static u64 BenchTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return(__rdtsc());
+#else
+  struct timespec sNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &sNow);
+  return((u64)sNow.tv_sec * 1000000000ull + (u64)sNow.tv_nsec);
+#endif
+
+} /* end BenchTicks() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchCallback(u32 u32Token_, MessageStateType eState_)
+
+@brief Completion callback for the no-copy check.
+*/
+static void BenchCallback(u32 u32Token_, MessageStateType eState_)
+{
+  Bench_u32CallbackToken = u32Token_;
+  Bench_eCallbackState = eState_;
+
+} /* end BenchCallback() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchChainCallback(u32 u32Token_, MessageStateType eState_)
+
+@brief Status callback for the chained transfer check: queues the next message as soon as one completes.
+*/
+static void BenchChainCallback(u32 u32Token_, MessageStateType eState_)
+{
+  u8 u8Data = 0x3C;
+
+  if( (u32Token_ != Bench_u32ChainToken) || (eState_ != COMPLETE) )
+  {
+    return;
+  }
+
+  Bench_u32ChainCount++;
+  if(Bench_u32ChainCount < 4)
+  {
+    Bench_u32ChainToken = QueueMessage(&Bench_sChainQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+    MessageSetCallback(Bench_u32ChainToken, BenchChainCallback);
+  }
+
+} /* end BenchChainCallback() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckNoCopy(void)
+
+@brief Sends one loaned message and one no-copy message through a queue and checks the results.
+
+Promises:
+- Returns TRUE if the data pointers, tokens, callback and pool accounting are all correct
+*/
+static bool BenchCheckNoCopy(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  MessageType* psLoan;
+  u8 au8External[300];
+  u32 u32LoanToken;
+  u32 u32NoCopyToken;
+
+  /* A released loan goes straight back to the pool and cannot be committed afterwards */
+  psLoan = ReserveMessage();
+  if(psLoan == NULL)
+  {
+    return(FALSE);
+  }
+  ReleaseMessage(psLoan);
+  if(CommitMessage(&sQueue, psLoan, 1) != 0)
+  {
+    return(FALSE);
+  }
+
+  /* Loan: filled in place and sent from the slot */
+  psLoan = ReserveMessage();
+  psLoan->pu8Data[0] = 0x5A;
+  u32LoanToken = CommitMessage(&sQueue, psLoan, 1);
+  if( (u32LoanToken == 0) || (CommitMessage(&sQueue, psLoan, 1) != 0) ||
+      (sQueue.psHead != psLoan) || (psLoan->pu8Data[0] != 0x5A) )
+  {
+    return(FALSE);
+  }
+
+  /* No-copy: longer than a slot and sent from the caller's buffer */
+  u32NoCopyToken = QueueMessageNoCopy(&sQueue, sizeof(au8External), au8External, BenchCallback);
+  if( (u32NoCopyToken == 0) || (sQueue.psTail->pu8Data != au8External) || 
+      (sQueue.psTail->u32Size != sizeof(au8External)) )
+  {
+    return(FALSE);
+  }
+
+  /* Drain the way a peripheral does */
+  UpdateMessageStatus(u32LoanToken, COMPLETE);
+  DeQueueMessage(&sQueue);
+  UpdateMessageStatus(u32NoCopyToken, COMPLETE);
+  DeQueueMessage(&sQueue);
+
+  if( (Bench_u32CallbackToken != u32NoCopyToken) || (Bench_eCallbackState != COMPLETE) ||
+      (QueryMessageStatus(u32LoanToken) != COMPLETE) || (QueryMessageStatus(u32NoCopyToken) != COMPLETE) ||
+      (sQueue.psHead != NULL) )
+  {
+    return(FALSE);
+  }
+
+  return(TRUE);
+
+} /* end BenchCheckNoCopy() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckExtend(void)
+
+@brief Grows a queued no-copy message with ExtendMessage() and checks when growing is refused.
+
+Promises:
+- Returns TRUE if only the unstarted tail message with a matching token can be extended
+*/
+static bool BenchCheckExtend(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  u8 au8External[64];
+  MessageType* psOpen;
+  u32 u32Token;
+  u32 u32NextToken;
+
+  /* The open message is the tail and not started, so it can grow */
+  u32Token = QueueMessageNoCopy(&sQueue, 8, au8External, NULL);
+  psOpen = sQueue.psTail;
+  if( (u32Token == 0) || !ExtendMessage(&sQueue, psOpen, u32Token, 8) || (psOpen->u32Size != 16) ||
+      ExtendMessage(&sQueue, psOpen, u32Token + 1, 8) )
+  {
+    return(FALSE);
+  }
+
+  /* Once another message follows it the open message is closed */
+  u32NextToken = QueueMessageNoCopy(&sQueue, 8, &au8External[16], NULL);
+  if( (u32NextToken == 0) || ExtendMessage(&sQueue, psOpen, u32Token, 8) || (psOpen->u32Size != 16) )
+  {
+    return(FALSE);
+  }
+
+  /* A message already handed to the PDC next registers cannot grow either */
+  psOpen = sQueue.psTail;
+  if( (StartNextMessage(&sQueue, FALSE) == NULL) || ExtendMessage(&sQueue, psOpen, u32NextToken, 8) )
+  {
+    return(FALSE);
+  }
+
+  UpdateMessageStatus(u32Token, COMPLETE);
+  DeQueueMessage(&sQueue);
+  UpdateMessageStatus(u32NextToken, COMPLETE);
+  DeQueueMessage(&sQueue);
+
+  return( (sQueue.psHead == NULL) && (QueryMessageStatus(u32Token) == COMPLETE) );
+
+} /* end BenchCheckExtend() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchRunMessaging(u32 u32Milliseconds_)
+
+@brief Runs the messaging state machine once per simulated millisecond.
+*/
+static void BenchRunMessaging(u32 u32Milliseconds_)
+{
+  for(u32 i = 0; i < u32Milliseconds_; i++)
+  {
+    G_u32SystemTime1ms++;
+    MessagingRunActiveState();
+  }
+
+} /* end BenchRunMessaging() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckTimeToLive(void)
+
+@brief Leaves three messages on a queue that is not being sent and checks what the sweeps do.
+
+Promises:
+- Returns TRUE if the two messages behind the front one time out (with the callback), the front one
+  stays queued, and its COMPLETE status is cleared later without counting as an eviction
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckTimeToLive(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  u8 au8Data[4] = {1, 2, 3, 4};
+  u32 au32Tokens[3];
+  MessagePoolStatsType sStats;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  Bench_u32CallbackToken = 0;
+
+  au32Tokens[0] = QueueMessage(&sQueue, sizeof(au8Data), au8Data, MSG_PRIORITY_NORMAL);
+  au32Tokens[1] = QueueMessage(&sQueue, sizeof(au8Data), au8Data, MSG_PRIORITY_NORMAL);
+  au32Tokens[2] = QueueMessageNoCopy(&sQueue, sizeof(au8Data), au8Data, BenchCallback);
+
+  /* Nothing is old enough before the deadline */
+  BenchRunMessaging(U32_MSG_STATUS_WAITING_TIME - 1);
+  if( (G_u32MessagingTimeouts != 0) || (sQueue.psTail->u32Token != au32Tokens[2]) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* One full sweep after the deadline */
+  BenchRunMessaging(U32_MSG_STATUS_CLEANING_TIME + (U16_STATUS_QUEUE_SIZE / U8_MSG_CLEANING_STEPS) + 1);
+  if( (G_u32MessagingTimeouts != 2) || (sQueue.psHead->u32Token != au32Tokens[0]) || 
+      (sQueue.psTail != sQueue.psHead) || (sQueue.psHead->psNextMessage != NULL) ||
+      (Bench_u32CallbackToken != au32Tokens[2]) || (Bench_eCallbackState != TIMEOUT) ||
+      (QueryMessageStatus(au32Tokens[1]) != TIMEOUT) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* The front message is sent; nobody collects its status */
+  UpdateMessageStatus(au32Tokens[0], COMPLETE);
+  DeQueueMessage(&sQueue);
+  BenchRunMessaging(U32_MSG_STATUS_TIMEOUT_TIME + U32_MSG_STATUS_CLEANING_TIME + 
+                    (U16_STATUS_QUEUE_SIZE / U8_MSG_CLEANING_STEPS) + 1);
+  MessagingGetPoolStats(&sStats);
+  if( (QueryMessageStatus(au32Tokens[0]) != NOT_FOUND) || (QueryMessageStatus(au32Tokens[2]) != NOT_FOUND) ||
+      (sStats.u32BytesInUse != 0) || (sQueue.psHead != NULL) || (sQueue.psTail != NULL) )
+  {
+    bPassed = FALSE;
+  }
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckTimeToLive() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckSplitTimeToLive(void)
+
+@brief Leaves a message split across several slots on a queue that is not being sent, first behind 
+another message and then at the front, and checks what the sweeps do.
+
+Promises:
+- Returns TRUE if every piece times out when the message is behind the front one, and no piece
+  times out once its first piece is being sent
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckSplitTimeToLive(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  static u8 au8Long[600];
+  u8 u8Data = 0x42;
+  u32 u32FrontToken, u32LongToken;
+  u32 u32Queued = 0;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+
+  /* Behind the front message the whole split message goes */
+  u32FrontToken = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  u32LongToken  = QueueMessage(&sQueue, sizeof(au8Long), au8Long, MSG_PRIORITY_NORMAL);
+  BenchRunMessaging(U32_MSG_STATUS_WAITING_TIME + U32_MSG_STATUS_CLEANING_TIME + 
+                    (U16_STATUS_QUEUE_SIZE / U8_MSG_CLEANING_STEPS) + 1);
+  if( (G_u32MessagingTimeouts != u32LongToken - u32FrontToken) || (sQueue.psHead->u32Token != u32FrontToken) ||
+      (sQueue.psTail != sQueue.psHead) || (sQueue.psHead->psNextMessage != NULL) ||
+      (QueryMessageStatus(u32LongToken) != TIMEOUT) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* At the front, the pieces behind the one being sent are never cut off */
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  sQueue.psHead = NULL;
+  sQueue.psTail = NULL;
+  u32LongToken = QueueMessage(&sQueue, sizeof(au8Long), au8Long, MSG_PRIORITY_NORMAL);
+  UpdateMessageStatus(sQueue.psHead->u32Token, SENDING);
+  BenchRunMessaging(U32_MSG_STATUS_WAITING_TIME + U32_MSG_STATUS_CLEANING_TIME + 
+                    (U16_STATUS_QUEUE_SIZE / U8_MSG_CLEANING_STEPS) + 1);
+  for(MessageType* psMessage = sQueue.psHead; psMessage != NULL; psMessage = psMessage->psNextMessage)
+  {
+    u32Queued++;
+  }
+  if( (G_u32MessagingTimeouts != 0) || (u32Queued != u32LongToken) || (sQueue.psTail->u32Token != u32LongToken) )
+  {
+    bPassed = FALSE;
+  }
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckSplitTimeToLive() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckPriority(void)
+
+@brief Queues a split normal message, a short normal message and two high priority messages, then 
+checks the order they come off the queue and the priority counters.
+
+Promises:
+- Returns TRUE if the high priority messages go out in order after the pieces of the message at the 
+  front and before the short normal message, and the counters match
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckPriority(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  static u8 au8Long[600];
+  u8 u8Data = 0x42;
+  u32 u32LongToken, u32ShortToken, u32HighToken1, u32HighToken2;
+  u32 au32Order[16];
+  u32 u32Sent = 0;
+  u32 u32Pieces;
+  MessagePriorityStatsType sHigh;
+  MessagePriorityStatsType sNormal;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+
+  u32LongToken  = QueueMessage(&sQueue, sizeof(au8Long), au8Long, MSG_PRIORITY_NORMAL);
+  u32ShortToken = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  u32HighToken1 = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_HIGH);
+  u32HighToken2 = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_HIGH);
+
+  /* Send one message per millisecond */
+  while( (sQueue.psHead != NULL) && (u32Sent < (sizeof(au32Order) / sizeof(u32))) )
+  {
+    au32Order[u32Sent++] = sQueue.psHead->u32Token;
+    UpdateMessageStatus(sQueue.psHead->u32Token, COMPLETE);
+    G_u32SystemTime1ms++;
+    DeQueueMessage(&sQueue);
+  }
+
+  /* Tokens start at 1, so the long message's pieces are 1 to u32LongToken */
+  u32Pieces = u32LongToken;
+  if( (u32Sent != u32Pieces + 3) || (au32Order[u32Pieces] != u32HighToken1) ||
+      (au32Order[u32Pieces + 1] != u32HighToken2) || (au32Order[u32Pieces + 2] != u32ShortToken) )
+  {
+    bPassed = FALSE;
+  }
+  
+  for(u32 i = 0; i < u32Pieces; i++)
+  {
+    if(au32Order[i] != i + 1)
+    {
+      bPassed = FALSE;
+    }
+  }
+
+  MessagingGetPriorityStats(MSG_PRIORITY_HIGH, &sHigh);
+  MessagingGetPriorityStats(MSG_PRIORITY_NORMAL, &sNormal);
+  if( (sHigh.u32Sent != 2) || (sHigh.u32PeakQueued != 2) || (sHigh.u32Queued != 0) ||
+      (sHigh.u32MaxLatency != u32Pieces + 2) || (sNormal.u32Sent != u32Pieces + 1) ||
+      (sNormal.u32MaxLatency != u32Pieces + 3) || (sNormal.u32Queued != 0) )
+  {
+    bPassed = FALSE;
+  }
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckPriority() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckStartNext(void)
+
+@brief Starts the second message of a queue the way a PDC driver loads its "next" registers and checks 
+that it is protected like the head.
+
+Promises:
+- Returns TRUE if only a continuation is started when asked for one, the started message is SENDING,
+  a high priority message is linked after it, nothing else can be started until the head is dequeued
+  and the message is not expired while it waits
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckStartNext(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+#ifdef EIE_MSG_ARENA
+  static u8 au8Long[U16_MSG_ARENA_MAX_MESSAGE + 1];
+#else
+  static u8 au8Long[U16_MAX_TX_MESSAGE_LENGTH + 1];
+#endif
+  u8 u8Data = 0x24;
+  u32 u32FirstToken, u32SecondToken, u32HighToken;
+  MessageType* psStarted;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+
+  /* Two pieces: the second may be started as a continuation */
+  QueueMessage(&sQueue, sizeof(au8Long), au8Long, MSG_PRIORITY_NORMAL);
+  psStarted = StartNextMessage(&sQueue, TRUE);
+  if( (psStarted == NULL) || (psStarted != sQueue.psHead->psNextMessage) || 
+      (QueryMessageStatus(psStarted->u32Token) != SENDING) || (StartNextMessage(&sQueue, FALSE) != NULL) )
+  {
+    bPassed = FALSE;
+  }
+  DeQueueMessage(&sQueue);
+  DeQueueMessage(&sQueue);
+
+  /* Two messages: the second is not a continuation */
+  u32FirstToken  = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  u32SecondToken = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  if( (StartNextMessage(&sQueue, TRUE) != NULL) || (StartNextMessage(&sQueue, FALSE) == NULL) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* A high priority message cannot jump ahead of the started one, which does not expire */
+  u32HighToken = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_HIGH);
+  if( (sQueue.psHead->u32Token != u32FirstToken) || (sQueue.psHead->psNextMessage == NULL) ||
+      (((MessageType*)sQueue.psHead->psNextMessage)->u32Token != u32SecondToken) ||
+      (sQueue.psTail->u32Token != u32HighToken) )
+  {
+    bPassed = FALSE;
+  }
+  UpdateMessageStatus(u32SecondToken, WAITING);
+  BenchRunMessaging(U32_MSG_STATUS_WAITING_TIME + 2 * U32_MSG_STATUS_CLEANING_TIME);
+  if( (G_u32MessagingTimeouts != 1) || (QueryMessageStatus(u32HighToken) != TIMEOUT) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* Once the head is gone the started message is the head and the next one can be started */
+  DeQueueMessage(&sQueue);
+  if( (sQueue.psHead == NULL) || (sQueue.psHead->u32Token != u32SecondToken) || (sQueue.psNextStarted != NULL) )
+  {
+    bPassed = FALSE;
+  }
+  DeQueueMessage(&sQueue);
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckStartNext() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckStats(void)
+
+@brief Sends one message with known state times, fills the pool until a request is refused and 
+checks the statistics and their binary record.
+
+Promises:
+- Returns TRUE if the enqueue, dequeue, rejection, peak and bytes queued counters, both latency 
+  measurements and the matching fields of the MessagingDumpStats() record are right
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckStats(void)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, AT91C_ID_US1};
+  static u8 au8Data[10];
+  u8 au8Record[U16_MSG_STATS_DUMP_SIZE];
+  MessagingStatsType sStats;
+  u32 u32Token;
+  u32 u32Enqueues = 1;
+  u32 u32RecordSize;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  if(MessagingGetFreeSlots() != U8_TX_QUEUE_SIZE)
+  {
+    bPassed = FALSE;
+  }
+
+  /* WAITING for 5 ms (bin 3) and SENDING for 1 ms (bin 1) */
+  u32Token = QueueMessage(&sQueue, sizeof(au8Data), au8Data, MSG_PRIORITY_NORMAL);
+  G_u32SystemTime1ms = 5;
+  UpdateMessageStatus(u32Token, SENDING);
+  G_u32SystemTime1ms = 6;
+  UpdateMessageStatus(u32Token, COMPLETE);
+  DeQueueMessage(&sQueue);
+
+  /* No-copy messages use no arena space, so only the slots run out */
+  while(QueueMessageNoCopy(&sQueue, sizeof(au8Data), au8Data, NULL) != 0)
+  {
+    u32Enqueues++;
+  }
+
+  if(MessagingGetFreeSlots() != 0)
+  {
+    bPassed = FALSE;
+  }
+
+  MessagingGetStats(&sStats);
+  if( (sStats.u32Enqueues != u32Enqueues) || (sStats.u32Dequeues != 1) || (sStats.u32FullRejections != 1) ||
+      (sStats.u32PeakQueuedMessages != U8_TX_QUEUE_SIZE) || (u32Enqueues != (u32)U8_TX_QUEUE_SIZE + 1) ||
+      (sStats.au32PeripheralBytes[AT91C_ID_US1] != u32Enqueues * sizeof(au8Data)) ||
+      (sStats.sWaitingToSending.u32Count != 1) || (sStats.sWaitingToSending.u32Min != 5) ||
+      (sStats.sWaitingToSending.u32Max != 5) || (sStats.sWaitingToSending.au32Bins[3] != 1) ||
+      (sStats.sSendingToComplete.u32Count != 1) || (sStats.sSendingToComplete.u32Total != 1) ||
+      (sStats.sSendingToComplete.au32Bins[1] != 1) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* One peripheral: 113 bytes of counters and one 5-byte entry */
+  u32RecordSize = MessagingDumpStats(au8Record, sizeof(au8Record));
+  if( (u32RecordSize != 118) || (au8Record[0] != 'M') || (au8Record[1] != 'S') ||
+      (au8Record[2] != U8_MSG_STATS_DUMP_VERSION) || (au8Record[3] != U8_TX_QUEUE_SIZE) ||
+      (au8Record[4] != (u8)u32Enqueues) || (au8Record[16] != 1) || (au8Record[64] != 1) ||
+      (au8Record[112] != 1) || (au8Record[113] != AT91C_ID_US1) ||
+      (au8Record[114] != (u8)(u32Enqueues * sizeof(au8Data))) || 
+      (MessagingDumpStats(au8Record, 117) != 0) )
+  {
+    bPassed = FALSE;
+  }
+
+  while(sQueue.psHead != NULL)
+  {
+    DeQueueMessage(&sQueue);
+  }
+  
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckStats() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchCheckCallback(void)
+
+@brief Checks MessageSetCallback(): a chain of four messages where each completion queues the next 
+before the peripheral dequeues the one that finished, registration after the final state and the
+NOT_FOUND callback when a waiting status is overwritten.
+
+Promises:
+- Returns TRUE if each message is followed by the next one in the same "ISR", every callback
+  collects its status and the other cases report as documented
+- The pool is re-initialized afterwards
+*/
+static bool BenchCheckCallback(void)
+{
+  MessageQueueType sOther = {NULL, NULL, NULL, NULL, 0};
+  u8 u8Data = 0x3C;
+  u32 u32Passes = 0;
+  u32 u32Token;
+  bool bPassed = TRUE;
+
+  MessagingInitialize();
+  Bench_sChainQueue.psHead = NULL;
+  Bench_sChainQueue.psTail = NULL;
+  Bench_sChainQueue.psPriorityTail = NULL;
+  Bench_sChainQueue.psNextStarted = NULL;
+  Bench_sChainQueue.u8PeripheralId = 0;
+  Bench_u32ChainCount = 0;
+
+  Bench_u32ChainToken = QueueMessage(&Bench_sChainQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  if(MessageSetCallback(Bench_u32ChainToken, BenchChainCallback) != WAITING)
+  {
+    bPassed = FALSE;
+  }
+
+  /* One "ISR" per pass: the next message must already be queued when the finished one is dequeued */
+  while( (Bench_sChainQueue.psHead != NULL) && (u32Passes < 8) )
+  {
+    u32Token = Bench_sChainQueue.psHead->u32Token;
+    UpdateMessageStatus(u32Token, SENDING);
+    UpdateMessageStatus(u32Token, COMPLETE);
+    if( (QueryMessageStatus(u32Token) != NOT_FOUND) ||
+        ((Bench_u32ChainCount < 4) && (Bench_sChainQueue.psHead->psNextMessage == NULL)) )
+    {
+      bPassed = FALSE;
+    }
+    DeQueueMessage(&Bench_sChainQueue);
+    u32Passes++;
+  }
+
+  if( (Bench_u32ChainCount != 4) || (u32Passes != 4) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* A final status cannot take a callback; the client gets the state instead */
+  u32Token = QueueMessage(&Bench_sChainQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  UpdateMessageStatus(u32Token, COMPLETE);
+  DeQueueMessage(&Bench_sChainQueue);
+  if( (MessageSetCallback(u32Token, BenchCallback) != COMPLETE) || (MessageSetCallback(0, BenchCallback) != NOT_FOUND) )
+  {
+    bPassed = FALSE;
+  }
+
+  /* A status overwritten while still waiting reports NOT_FOUND */
+  Bench_u32CallbackToken = 0;
+  u32Token = QueueMessage(&Bench_sChainQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+  MessageSetCallback(u32Token, BenchCallback);
+  for(u32 i = 0; i < U16_STATUS_QUEUE_SIZE; i++)
+  {
+    QueueMessage(&sOther, 1, &u8Data, MSG_PRIORITY_NORMAL);
+    UpdateMessageStatus(sOther.psHead->u32Token, COMPLETE);
+    DeQueueMessage(&sOther);
+  }
+  if( (Bench_u32CallbackToken != u32Token) || (Bench_eCallbackState != NOT_FOUND) )
+  {
+    bPassed = FALSE;
+  }
+
+  MessagingInitialize();
+  G_u32SystemTime1ms = 0;
+  return(bPassed);
+
+} /* end BenchCheckCallback() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u32 BenchBurstFill(MessageQueueType* asQueues_, u32* pu32Line_, u32* pu32Bytes_)
+
+@brief Queues burst lines alternately on two queues until the pool is full.
+
+Requires:
+@param asQueues_ points to the two transmit queues
+@param pu32Line_ is the running line number (selects the length and queue)
+@param pu32Bytes_ has the number of bytes queued added to it
+
+Promises:
+- Returns the number of lines queued
+*/
+static u32 BenchBurstFill(MessageQueueType* asQueues_, u32* pu32Line_, u32* pu32Bytes_)
+{
+  u8 au8Line[128];
+  u32 u32Length;
+  u32 u32Lines = 0;
+
+  for(u32 i = 0; i < sizeof(au8Line); i++)
+  {
+    au8Line[i] = (u8)('0' + (i % 10));
+  }
+
+  while(TRUE)
+  {
+    u32Length = Bench_au8BurstLengths[*pu32Line_ % sizeof(Bench_au8BurstLengths)];
+    if(QueueMessage(&asQueues_[*pu32Line_ & 1], u32Length, au8Line, MSG_PRIORITY_NORMAL) == 0)
+    {
+      return(u32Lines);
+    }
+    
+    (*pu32Line_)++;
+    *pu32Bytes_ += u32Length;
+    u32Lines++;
+  }
+
+} /* end BenchBurstFill() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void BenchBurstDrain(MessageQueueType* psQueue_)
+
+@brief Sends everything on a queue the way a peripheral ISR does.
+*/
+static void BenchBurstDrain(MessageQueueType* psQueue_)
+{
+  while(psQueue_->psHead != NULL)
+  {
+    UpdateMessageStatus(psQueue_->psHead->u32Token, COMPLETE);
+    DeQueueMessage(psQueue_);
+  }
+
+} /* end BenchBurstDrain() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool BenchBurst(void)
+
+@brief Runs the burst test and prints one line of results.
+
+Promises:
+- The pool is re-initialized first
+- Prints the lines and bytes that fit, the lines that fit again after one queue is drained, and 
+  the peak bytes in use and peak fragmented bytes from MessagingGetPoolStats()
+- Returns FALSE if the pool does not account for every byte once both queues are drained
+*/
+static bool BenchBurst(void)
+{
+  MessageQueueType asQueues[2] = {{NULL, NULL, NULL, NULL, 0}, {NULL, NULL, NULL, NULL, 0}};
+  MessagePoolStatsType sStats;
+  u32 u32Line = 0;
+  u32 u32Bytes = 0;
+  u32 u32FirstLines;
+  u32 u32FirstBytes;
+  u32 u32RefillLines;
+
+  /* Start from an empty pool so the peaks only cover the burst */
+  MessagingInitialize();
+  u32FirstLines = BenchBurstFill(asQueues, &u32Line, &u32Bytes);
+  u32FirstBytes = u32Bytes;
+  BenchBurstDrain(&asQueues[0]);
+  u32RefillLines = BenchBurstFill(asQueues, &u32Line, &u32Bytes);
+  
+  BenchBurstDrain(&asQueues[0]);
+  BenchBurstDrain(&asQueues[1]);
+  MessagingGetPoolStats(&sStats);
+
+  printf("burst %s: %u lines (%u bytes) before full, %u more after draining one queue; "
+         "peak %u of %u bytes in use, peak fragmented %u\n",
+#ifdef EIE_MSG_ARENA
+         "arena",
+#else
+         "slots",
+#endif
+         u32FirstLines, u32FirstBytes, u32RefillLines, sStats.u32PeakBytesInUse, sStats.u32Size, 
+         sStats.u32PeakFragmentedBytes);
+
+  G_u32MessagingFlags &= ~_MESSAGING_TX_QUEUE_FULL;
+  return( (sStats.u32BytesInUse == 0) && (sStats.u32PayloadBytes == 0) );
+
+} /* end BenchBurst() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __disable_irq(void)
+
+@brief Starts timing an interrupts-off window.
+*/
+void __disable_irq(void)
+{
+  Bench_bIrqOff = TRUE;
+  Bench_u64IrqOffStart = BenchTicks();
+
+} /* end __disable_irq() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __enable_irq(void)
+
+@brief Ends the interrupts-off window and adds it to the statistics.
+*/
+void __enable_irq(void)
+{
+  u64 u64Window;
+
+  if(Bench_bIrqOff)
+  {
+    u64Window = BenchTicks() - Bench_u64IrqOffStart;
+    Bench_u64IrqOffTotal += u64Window;
+    Bench_u64IrqOffCount++;
+    if(u64Window > Bench_u64IrqOffMax)
+    {
+      Bench_u64IrqOffMax = u64Window;
+    }
+    Bench_bIrqOff = FALSE;
+  }
+
+} /* end __enable_irq() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn int main(int argc, char** argv)
+
+@brief Runs the fill/drain rounds and prints one line of results.
+
+Requires:
+@param argv[1] optionally sets the number of rounds
+
+Promises:
+- Prints the depth, mean ticks per enqueue, dequeue, status update and status query, and the mean
+  and longest interrupts-off windows (the longest also catches the host scheduler, so expect it
+  to be noisy)
+- Runs the burst test
+- Returns non-zero if the pool misbehaved (full early, lost a message or status, flagged an error 
+  or did not give back all of its memory)
+*/
+int main(int argc, char** argv)
+{
+  MessageQueueType sQueue = {NULL, NULL, NULL, NULL, 0};
+  u32 au32Tokens[U8_TX_QUEUE_SIZE];
+  u8 u8Data = 0xA5;
+  u32 u32Rounds = U32_BENCH_ROUNDS;
+  u64 u64Start;
+  u64 u64EnqueueTicks = 0;
+  u64 u64DequeueTicks = 0;
+  u64 u64UpdateTicks = 0;
+  u64 u64QueryTicks = 0;
+  u64 u64Operations;
+  MessageStateType eState;
+
+  if(argc > 1)
+  {
+    u32Rounds = (u32)strtoul(argv[1], NULL, 0);
+  }
+
+  MessagingInitialize();
+
+  if(!BenchCheckNoCopy())
+  {
+    fprintf(stderr, "msg_bench: loan / no-copy check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckExtend())
+  {
+    fprintf(stderr, "msg_bench: extend check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckTimeToLive())
+  {
+    fprintf(stderr, "msg_bench: time-to-live check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckSplitTimeToLive())
+  {
+    fprintf(stderr, "msg_bench: split message time-to-live check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckPriority())
+  {
+    fprintf(stderr, "msg_bench: priority check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckStartNext())
+  {
+    fprintf(stderr, "msg_bench: start next check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckCallback())
+  {
+    fprintf(stderr, "msg_bench: completion callback check failed\n");
+    return(1);
+  }
+
+  if(!BenchCheckStats())
+  {
+    fprintf(stderr, "msg_bench: statistics check failed\n");
+    return(1);
+  }
+
+  for(u32 i = 0; i < u32Rounds; i++)
+  {
+    /* Fill */
+    for(u32 j = 0; j < U8_TX_QUEUE_SIZE; j++)
+    {
+      u64Start = BenchTicks();
+      au32Tokens[j] = QueueMessage(&sQueue, 1, &u8Data, MSG_PRIORITY_NORMAL);
+      if(au32Tokens[j] == 0)
+      {
+        fprintf(stderr, "msg_bench: pool full after %u of %u messages\n", j, (u32)U8_TX_QUEUE_SIZE);
+        return(1);
+      }
+      u64EnqueueTicks += BenchTicks() - u64Start;
+    }
+
+    /* Drain the way a peripheral ISR does */
+    for(u32 j = 0; j < U8_TX_QUEUE_SIZE; j++)
+    {
+      u64Start = BenchTicks();
+      UpdateMessageStatus(sQueue.psHead->u32Token, COMPLETE);
+      u64UpdateTicks += BenchTicks() - u64Start;
+
+      u64Start = BenchTicks();
+      DeQueueMessage(&sQueue);
+      u64DequeueTicks += BenchTicks() - u64Start;
+    }
+
+    /* The owner collects every status */
+    for(u32 j = 0; j < U8_TX_QUEUE_SIZE; j++)
+    {
+      u64Start = BenchTicks();
+      eState = QueryMessageStatus(au32Tokens[j]);
+      u64QueryTicks += BenchTicks() - u64Start;
+
+      if(eState != COMPLETE)
+      {
+        fprintf(stderr, "msg_bench: token %u has state %u\n", au32Tokens[j], eState);
+        return(1);
+      }
+    }
+
+    if( (sQueue.psHead != NULL) || (sQueue.psTail != NULL) )
+    {
+      fprintf(stderr, "msg_bench: queue not empty after draining\n");
+      return(1);
+    }
+  }
+
+  /* The ALMOST_FULL warning is expected; anything else means the pool went wrong */
+  if( (G_u32MessagingFlags & ~_MESSAGING_TX_QUEUE_ALMOST_FULL) || (G_u32MessagingStatusEvictions != 0) )
+  {
+    fprintf(stderr, "msg_bench: G_u32MessagingFlags = 0x%08x, %u statuses evicted\n", 
+            G_u32MessagingFlags, G_u32MessagingStatusEvictions);
+    return(1);
+  }
+
+  u64Operations = (u64)u32Rounds * U8_TX_QUEUE_SIZE;
+  printf("depth %3u: enqueue %6.1f, dequeue %6.1f, update %5.1f, query %5.1f ticks/msg, "
+         "irq-off mean %5.1f max %llu ticks (%u rounds)\n",
+         (u32)U8_TX_QUEUE_SIZE,
+         (double)u64EnqueueTicks / (double)u64Operations,
+         (double)u64DequeueTicks / (double)u64Operations,
+         (double)u64UpdateTicks / (double)u64Operations,
+         (double)u64QueryTicks / (double)u64Operations,
+         (double)Bench_u64IrqOffTotal / (double)Bench_u64IrqOffCount,
+         (unsigned long long)Bench_u64IrqOffMax, u32Rounds);
+
+  if(!BenchBurst())
+  {
+    fprintf(stderr, "msg_bench: pool still holds memory after the burst test\n");
+    return(1);
+  }
+
+  return(0);
+
+} /* end main() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,157 @@
+/*!*********************************************************************************************************************
+@file sim.h
+@brief Header file for the host-native SAM3U simulator (sim_core.c, sim_usart.c, sim_twi.c, sim_pio.c).
+
+The host build compiles the real drivers, applications and board BSP with the host gcc.  The
+AT91C_BASE_* register blocks from AT91SAM3U4.h are backed by memory mapped at the same fixed
+addresses, and an event-driven model of SysTick, the PDC, USART/DBGU, TWI and PIO watches those
+registers and raises the same interrupts the firmware would see on the board.
+
+Simulation model notes:
+- Simulated time only advances when the firmware "spends" it: IsTimeUp() and kill_x_cycles() charge
+  core cycles, and __WFI() (SystemSleep) fast-forwards straight to the next scheduled event.
+- Write-only set/clear registers (IER/IDR, SODR/CODR, CR, PTCR, NVIC ISER/ICER...) are sampled at
+  every simulator step.  Two writes to the same register with no step between them coalesce.
+- Read-to-clear status bits (PIO_ISR, TWI NACK, USART RXRDY) are cleared after the ISR that reads
+  them has run.
+- Interrupts do not nest.  SysTick is serviced first, then peripherals in peripheral ID order.
+
+Runtime options are taken from environment variables since main() has no arguments:
+- EIE_SIM_TIME_MS: stop after this many simulated milliseconds and print statistics (0 = run forever)
+- EIE_SIM_REALTIME: set to 1 to pace simulated time against the wall clock (interactive use)
+- EIE_SIM_STATS: set to 1 to print statistics on exit even without a time limit
+- EIE_SIM_PTY: set to 1 to connect the debug UART to a pseudo-terminal instead of stdin/stdout, or
+  to a path to also make a symlink to the pty there (e.g. EIE_SIM_PTY=/tmp/eie-debug)
+
+The debug UART is connected to stdout/stdin.  Line feeds from stdin are sent as carriage returns
+so the en+c## console works from a normal terminal.  With EIE_SIM_PTY the simulator prints
+"sim: debug UART on /dev/pts/N" to stderr and passes bytes both ways unchanged (send CR for Enter),
+so terminal programs, expect scripts and firmware_host/tools/console_bench.py can drive the real
+console.  The pty runs in real time unless EIE_SIM_REALTIME=0, which lets the simulated 115200 link
+run as fast as the host can simulate it.
+
+***********************************************************************************************************************/
+
+#ifndef __SIM_H
+#define __SIM_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+typedef u64 SimTimeType;              /*!< @brief Simulated time stamps are kept in nanoseconds */
+
+typedef void(*SimByteSinkType)(u8 u8Byte_);     /*!< @brief Called for every byte a simulated transmitter puts on the wire */
+typedef u8(*SimByteSourceType)(u8 u8Byte_);     /*!< @brief SPI master: called with each MOSI byte and returns the MISO byte */
+
+
+/*!
+@struct SimTwiSlaveType
+@brief A simulated device on the TWI bus.
+
+Register-file devices only need au8Registers: the first byte of a write sets the register pointer,
+following bytes are written with auto-increment and reads return registers from the pointer.
+Stream devices (e.g. the ASCII LCD) provide pfnWrite to see every byte instead.
+*/
+typedef struct SimTwiSlave
+{
+  u8 u8Address;                                          /*!< @brief 7-bit bus address */
+  u8 u8Pointer;                                          /*!< @brief Register pointer for register-file devices */
+  bool bPointerSet;                                      /*!< @brief TRUE once the first byte of a write has set u8Pointer */
+  const char* pcName;                                    /*!< @brief Name for statistics */
+  void (*pfnWrite)(struct SimTwiSlave* psSlave_, u8 u8Byte_);  /*!< @brief Optional: handles each written byte */
+  u8 (*pfnRead)(struct SimTwiSlave* psSlave_);           /*!< @brief Optional: provides each read byte */
+  u32 u32BytesWritten;                                   /*!< @brief Statistics */
+  u32 u32BytesRead;                                      /*!< @brief Statistics */
+  u8 au8Registers[256];                                  /*!< @brief Register file */
+} SimTwiSlaveType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define U32_SIM_MCK_HZ                (u32)48000000      /*!< @brief Master clock used for all peripheral timing */
+#define U32_SIM_IS_TIME_UP_CYCLES     (u32)48            /*!< @brief Core cycles charged for one IsTimeUp() call (1 us) */
+
+#define U64_SIM_NEVER                 (SimTimeType)0xFFFFFFFFFFFFFFFFULL  /*!< @brief No event scheduled */
+#define U32_SIM_THR_EMPTY             (u32)0xFFFFFFFF    /*!< @brief Value parked in THR registers so firmware writes can be seen */
+
+#define U8_SIM_MAX_IRQ_PASSES         (u8)32             /*!< @brief Max ISRs serviced in one step before declaring an interrupt storm */
+#define U32_SIM_SYSTICK_VECTOR        (u32)15            /*!< @brief NVIC_ICSR VECTACTIVE while SysTick_Handler() runs */
+#define U32_SIM_FIRST_IRQ_VECTOR      (u32)16            /*!< @brief NVIC_ICSR VECTACTIVE of peripheral ID 0 (the ID is added) */
+#define U8_SIM_MAX_TWI_SLAVES         (u8)8              /*!< @brief Size of the TWI device table */
+#define U16_SIM_RX_FIFO_SIZE          (u16)4096          /*!< @brief Bytes that can be injected into a USART ahead of the receiver */
+
+#define U32_SIM_CONSOLE_POLL_NS       (u32)1000000       /*!< @brief How often stdin is checked for console input */
+#define U32_SIM_PTY_TX_SIZE           (u32)65536         /*!< @brief Debug UART output held for the pty while nobody reads it */
+#define U32_SIM_FIRMWARE_STACK_SIZE   (u32)0x00100000    /*!< @brief Stack for the firmware context (kept below 4 GB for the PDC) */
+
+/* Fixed memory regions that back the AT91C_BASE_* register blocks */
+#define U32_SIM_PERIPHERAL_BASE       (u32)0x40000000    /*!< @brief All SAM3U peripherals */
+#define U32_SIM_PERIPHERAL_SIZE       (u32)0x00100000
+#define U32_SIM_PPB_BASE              (u32)0xE0000000    /*!< @brief Cortex-M3 private peripheral bus (NVIC, SysTick, SCB) */
+#define U32_SIM_PPB_SIZE              (u32)0x00100000
+
+/* SysTick control bits */
+#define _SIM_SYSTICK_ENABLE           (u32)0x00000001
+#define _SIM_SYSTICK_TICKINT          (u32)0x00000002
+#define _SIM_SYSTICK_CLKSOURCE        (u32)0x00000004
+#define _SIM_SYSTICK_COUNTFLAG        (u32)0x00010000
+
+
+/**********************************************************************************************************************
+* Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void SimCpuCycles(u32 u32Cycles_);
+SimTimeType SimGetTimeNs(void);
+
+void SimUsartInjectRx(u8 u8PeripheralId_, const u8* pu8Data_, u32 u32Size_);
+u32 SimUsartRxRoom(u8 u8PeripheralId_);
+void SimUsartSetTxSink(u8 u8PeripheralId_, SimByteSinkType pfnSink_);
+void SimUsartSetSpiSource(u8 u8PeripheralId_, SimByteSourceType pfnSource_);
+void SimUsartSetCts(u8 u8PeripheralId_, bool bHigh_);
+
+bool SimTwiAttachSlave(SimTwiSlaveType* psSlave_);
+SimTwiSlaveType* SimTwiFindSlave(u8 u8Address_);
+
+void SimPioSetInput(AT91PS_PIO psPio_, u32 u32Pins_, bool bHigh_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void SimStep(void);
+
+void SimUsartInitialize(void);
+void SimUsartSync(void);
+void SimUsartUpdate(SimTimeType u64Now_);
+SimTimeType SimUsartNextEvent(void);
+u32 SimUsartPendingIrqs(void);
+void SimUsartIrqServiced(u8 u8PeripheralId_);
+void SimUsartReport(void);
+
+void SimTwiInitialize(void);
+void SimTwiSync(void);
+void SimTwiUpdate(SimTimeType u64Now_);
+SimTimeType SimTwiNextEvent(void);
+u32 SimTwiPendingIrqs(void);
+void SimTwiIrqServiced(u8 u8PeripheralId_);
+void SimTwiReport(void);
+
+void SimPioInitialize(void);
+void SimPioSync(void);
+u32 SimPioPendingIrqs(void);
+void SimPioIrqServiced(u8 u8PeripheralId_);
+
+void kill_x_cycles(u32 u32Cycles_);
+
+
+#endif /* __SIM_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,1136 @@
+/*!*********************************************************************************************************************
+@file sim_core.c
+@brief Core of the host-native SAM3U simulator: memory map, simulated time, SysTick, NVIC and the
+Cortex-M3 intrinsics used by the firmware.
+
+The firmware's main() is wrapped (-Wl,--wrap=main) so the simulator can map the register blocks
+at their real addresses and move the firmware onto a stack below 4 GB before anything runs.
+PDC pointer registers are 32 bits wide, so everything the firmware hands to a PDC (static data,
+heap and stack) must live in the low 4 GB of the host address space; the build links with -no-pie
+and malloc is restricted to the brk heap for the same reason.
+
+Simulated time is kept in nanoseconds.  SimStep() samples all write-only registers, advances the
+peripheral models to the current time and services any pending interrupt unless PRIMASK is set
+or an ISR is already running.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- SimTimeType G_u64SimTimeNs
+
+CONSTANTS
+- NONE
+
+TYPES
+- NONE
+
+PUBLIC FUNCTIONS
+- void SimCpuCycles(u32 u32Cycles_)
+- SimTimeType SimGetTimeNs(void)
+
+PROTECTED FUNCTIONS
+- void SimStep(void)
+- Cortex-M3 intrinsics declared in core_cm3.h for EIE_HOST
+- void kill_x_cycles(u32 u32Cycles_)
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <malloc.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_<type>Sim"
+***********************************************************************************************************************/
+/* New variables */
+SimTimeType G_u64SimTimeNs;                            /*!< @brief Current simulated time in ns */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemTime1ms;                /*!< @brief From main.c */
+extern volatile u32 G_u32SystemFlags;                  /*!< @brief From main.c */
+
+extern int __real_main(void);                          /*!< @brief The firmware's main() (see -Wl,--wrap=main) */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Sim_<type>" and be declared as static.
+***********************************************************************************************************************/
+/* Peripheral interrupt vectors in peripheral ID order (same as board_cstartup_gcc.c) */
+static const fnCode_type Sim_apfnVectors[] =
+{
+  SUPC_IrqHandler,  RSTC_IrqHandler,  RTC_IrqHandler,   RTT_IrqHandler,
+  WDT_IrqHandler,   PMC_IrqHandler,   EFC0_IrqHandler,  EFC1_IrqHandler,
+  DBGU_IrqHandler,  HSMC4_IrqHandler, PIOA_IrqHandler,  PIOB_IrqHandler,
+  PIOC_IrqHandler,  USART0_IrqHandler, USART1_IrqHandler, USART2_IrqHandler,
+  USART3_IrqHandler, MCI0_IrqHandler, TWI0_IrqHandler,  TWI1_IrqHandler,
+  SPI0_IrqHandler,  SSC0_IrqHandler,  TC0_IrqHandler,   TC1_IrqHandler,
+  TC2_IrqHandler,   PWM_IrqHandler,   ADCC0_IrqHandler, ADCC1_IrqHandler,
+  HDMA_IrqHandler,  UDPD_IrqHandler
+};
+
+#define U8_SIM_VECTORS  (u8)(sizeof(Sim_apfnVectors) / sizeof(fnCode_type))
+
+static const char* const Sim_apcVectorNames[] =
+{
+  "SUPC", "RSTC", "RTC", "RTT", "WDT", "PMC", "EFC0", "EFC1", "DBGU", "HSMC4",
+  "PIOA", "PIOB", "PIOC", "US0", "US1", "US2", "US3", "MCI0", "TWI0", "TWI1",
+  "SPI0", "SSC0", "TC0", "TC1", "TC2", "PWM", "ADCC0", "ADCC1", "HDMA", "UDPHS"
+};
+
+static bool Sim_bPrimask;                              /*!< @brief Emulated PRIMASK (TRUE = interrupts masked) */
+static bool Sim_bInIsr;                                /*!< @brief Set while an ISR is being serviced */
+static u32 Sim_u32NvicEnabled;                         /*!< @brief NVIC enable bits accumulated from ISER/ICER */
+static u32 Sim_u32NvicSoftPending;                     /*!< @brief Pending bits set through ISPR */
+
+static bool Sim_bSysTickPending;                       /*!< @brief SysTick counted to zero and has not been serviced */
+static SimTimeType Sim_u64NextTickNs;                  /*!< @brief Time of the next SysTick wrap */
+static SimTimeType Sim_u64TickPeriodNs;                /*!< @brief SysTick period from STICKRVR */
+static u32 Sim_u32LastStickCvr;                        /*!< @brief Last value written to STICKCVR by the simulator */
+
+static SimTimeType Sim_u64StopNs;                      /*!< @brief EIE_SIM_TIME_MS converted to ns (U64_SIM_NEVER = run forever) */
+static SimTimeType Sim_u64NextConsolePollNs;           /*!< @brief Next time stdin is checked */
+static SimTimeType Sim_u64WallStartNs;                 /*!< @brief Host monotonic time at start */
+static bool Sim_bRealTime;                             /*!< @brief Pace simulated time against the wall clock */
+static bool Sim_bPrintStats;                           /*!< @brief Print statistics on exit */
+static bool Sim_bConsoleInput;                         /*!< @brief stdin is still open */
+static bool Sim_bConsoleRaw;                           /*!< @brief stdin is a raw terminal (e.g. a pty from debug_xfer.py): pass bytes as they are */
+static bool Sim_bConsoleDirty;                         /*!< @brief stdout has unflushed console output */
+static int Sim_iConsoleFd;                             /*!< @brief Where debug UART input comes from: stdin or the pty master */
+
+static int Sim_iPtyMaster;                             /*!< @brief Pty master for EIE_SIM_PTY (-1 if not used) */
+static int Sim_iPtySlave;                              /*!< @brief Pty slave kept open so the master never sees a hang-up between clients */
+static const char* Sim_pcPtyLink;                      /*!< @brief Symlink made to the pty slave (NULL if none) */
+static u8 Sim_au8PtyTx[U32_SIM_PTY_TX_SIZE];           /*!< @brief Debug UART output the pty has not taken yet */
+static u32 Sim_u32PtyTxHead;                           /*!< @brief Oldest byte in Sim_au8PtyTx */
+static u32 Sim_u32PtyTxCount;                          /*!< @brief Bytes in Sim_au8PtyTx */
+static u32 Sim_u32PtyTxDropped;                        /*!< @brief Output lost because nobody read the pty */
+
+static u32 Sim_au32IrqCounts[32];                      /*!< @brief Serviced interrupts per peripheral ID */
+static u32 Sim_u32SysTickCount;                        /*!< @brief Serviced SysTick interrupts */
+static u32 Sim_u32SysTickLost;                         /*!< @brief SysTick wraps that happened while one was still pending */
+static u32 Sim_u32ServicedCount;                       /*!< @brief All exceptions serviced (SysTick and peripherals) */
+static u32 Sim_u32WfiCount;                            /*!< @brief Calls to __WFI() */
+static u32 Sim_u32IrqStorms;                           /*!< @brief Steps that hit U8_SIM_MAX_IRQ_PASSES */
+
+static ucontext_t Sim_sHostContext;                    /*!< @brief Context of the real host main() */
+static ucontext_t Sim_sFirmwareContext;                /*!< @brief Context running the firmware */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimWallClockNs(void)
+
+@brief Returns the host monotonic clock in ns.
+*/
+static SimTimeType SimWallClockNs(void)
+{
+  struct timespec sTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return( (SimTimeType)sTime.tv_sec * 1000000000ULL + (SimTimeType)sTime.tv_nsec );
+
+} /* end SimWallClockNs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimPtyFlush(void)
+
+@brief Writes as much buffered debug UART output to the pty as it will take without blocking.
+
+The firmware never waits for the host: output stays in Sim_au8PtyTx while the pty is full (e.g. no 
+client has opened it yet) and is only dropped once that is full too.
+*/
+static void SimPtyFlush(void)
+{
+  ssize_t iWritten;
+  u32 u32Chunk;
+
+  while(Sim_u32PtyTxCount != 0)
+  {
+    u32Chunk = U32_SIM_PTY_TX_SIZE - Sim_u32PtyTxHead;
+    if(u32Chunk > Sim_u32PtyTxCount)
+    {
+      u32Chunk = Sim_u32PtyTxCount;
+    }
+
+    iWritten = write(Sim_iPtyMaster, &Sim_au8PtyTx[Sim_u32PtyTxHead], u32Chunk);
+    if(iWritten <= 0)
+    {
+      break;
+    }
+
+    Sim_u32PtyTxHead = (Sim_u32PtyTxHead + (u32)iWritten) % U32_SIM_PTY_TX_SIZE;
+    Sim_u32PtyTxCount -= (u32)iWritten;
+  }
+
+} /* end SimPtyFlush() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimReport(void)
+
+@brief Prints simulator statistics to stderr.
+*/
+static void SimReport(void)
+{
+  SimTimeType u64WallNs = SimWallClockNs() - Sim_u64WallStartNs;
+  double dSimMs  = (double)G_u64SimTimeNs / 1e6;
+  double dWallMs = (double)u64WallNs / 1e6;
+
+  fflush(stdout);
+  fprintf(stderr, "\nsim: %.3f ms simulated in %.3f ms wall (%.0fx real time)\n",
+          dSimMs, dWallMs, (dWallMs > 0.0) ? (dSimMs / dWallMs) : 0.0);
+  fprintf(stderr, "sim: SysTick %u serviced, %u lost, G_u32SystemTime1ms %u, WFI %u, IRQ storms %u\n",
+          Sim_u32SysTickCount, Sim_u32SysTickLost, G_u32SystemTime1ms, Sim_u32WfiCount, Sim_u32IrqStorms);
+
+  for(u8 i = 0; i < U8_SIM_VECTORS; i++)
+  {
+    if(Sim_au32IrqCounts[i] != 0)
+    {
+      fprintf(stderr, "sim: IRQ %2u %-5s %u\n", i, Sim_apcVectorNames[i], Sim_au32IrqCounts[i]);
+    }
+  }
+
+  SimUsartReport();
+  SimTwiReport();
+
+  if(Sim_u32PtyTxDropped != 0)
+  {
+    fprintf(stderr, "sim: pty output dropped %u bytes (nobody was reading)\n", Sim_u32PtyTxDropped);
+  }
+
+} /* end SimReport() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimExit(int iStatus_)
+
+@brief Ends the simulation.
+*/
+static void SimExit(int iStatus_)
+{
+  if(Sim_bPrintStats)
+  {
+    SimReport();
+  }
+
+  if(Sim_iPtyMaster >= 0)
+  {
+    SimPtyFlush();
+  }
+  if(Sim_pcPtyLink != NULL)
+  {
+    unlink(Sim_pcPtyLink);
+  }
+
+  fflush(stdout);
+  exit(iStatus_);
+
+} /* end SimExit() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimSignalHandler(int iSignal_)
+
+@brief Ctrl-C ends the simulation cleanly so the statistics are still printed.
+*/
+static void SimSignalHandler(int iSignal_)
+{
+  (void)iSignal_;
+  SimExit(0);
+
+} /* end SimSignalHandler() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimConsoleWrite(u8 u8Byte_)
+
+@brief TX sink for the debug UART: stdout, or the pty buffer with EIE_SIM_PTY.
+*/
+static void SimConsoleWrite(u8 u8Byte_)
+{
+  if(Sim_iPtyMaster < 0)
+  {
+    putchar(u8Byte_);
+  }
+  else if(Sim_u32PtyTxCount == U32_SIM_PTY_TX_SIZE)
+  {
+    Sim_u32PtyTxDropped++;
+  }
+  else
+  {
+    Sim_au8PtyTx[(Sim_u32PtyTxHead + Sim_u32PtyTxCount) % U32_SIM_PTY_TX_SIZE] = u8Byte_;
+    Sim_u32PtyTxCount++;
+  }
+  
+  Sim_bConsoleDirty = TRUE;
+
+} /* end SimConsoleWrite() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimPtyOpen(const char* pcLink_)
+
+@brief Creates the pseudo-terminal for EIE_SIM_PTY and makes it the debug UART console.
+
+Requires:
+@param pcLink_ is a path for a symlink to the pty slave, or NULL for none
+
+Promises:
+- The pty slave is raw and its name is printed to stderr; the simulator exits if there is no pty
+*/
+static void SimPtyOpen(const char* pcLink_)
+{
+  struct termios sTerminal;
+  char* pcSlave = NULL;
+
+  Sim_iPtyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+  if(Sim_iPtyMaster >= 0)
+  {
+    if( (grantpt(Sim_iPtyMaster) == 0) && (unlockpt(Sim_iPtyMaster) == 0) )
+    {
+      pcSlave = ptsname(Sim_iPtyMaster);
+    }
+  }
+
+  if(pcSlave == NULL)
+  {
+    fprintf(stderr, "sim: unable to open a pty for the debug UART\n");
+    exit(1);
+  }
+
+  /* Raw so scripts see exactly the bytes the firmware sends and the firmware gets exactly theirs */
+  Sim_iPtySlave = open(pcSlave, O_RDWR | O_NOCTTY);
+  if( (Sim_iPtySlave >= 0) && (tcgetattr(Sim_iPtySlave, &sTerminal) == 0) )
+  {
+    cfmakeraw(&sTerminal);
+    tcsetattr(Sim_iPtySlave, TCSANOW, &sTerminal);
+  }
+  fcntl(Sim_iPtyMaster, F_SETFL, fcntl(Sim_iPtyMaster, F_GETFL) | O_NONBLOCK);
+
+  if(pcLink_ != NULL)
+  {
+    unlink(pcLink_);
+    if(symlink(pcSlave, pcLink_) == 0)
+    {
+      Sim_pcPtyLink = pcLink_;
+    }
+    else
+    {
+      fprintf(stderr, "sim: unable to link %s to the pty\n", pcLink_);
+    }
+  }
+
+  fprintf(stderr, "sim: debug UART on %s\n", pcSlave);
+  Sim_iConsoleFd = Sim_iPtyMaster;
+  Sim_bConsoleRaw = TRUE;
+
+} /* end SimPtyOpen() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimConsolePoll(int iTimeoutMs_)
+
+@brief Flushes console output and moves any waiting stdin (or pty) bytes into the debug UART receiver.
+
+LF from a pipe or a cooked terminal becomes CR; bytes from a raw terminal or the pty are passed 
+unchanged.  Only as many bytes are read as the receiver FIFO can take, so a fast writer waits 
+instead of losing input.
+
+Requires:
+@param iTimeoutMs_ is how long to block waiting for input (0 = just check)
+*/
+static void SimConsolePoll(int iTimeoutMs_)
+{
+  struct pollfd sPoll;
+  u8 au8Buffer[256];
+  ssize_t iBytes;
+  u32 u32Room;
+
+  if(Sim_bConsoleDirty)
+  {
+    if(Sim_iPtyMaster < 0)
+    {
+      fflush(stdout);
+    }
+    else
+    {
+      SimPtyFlush();
+    }
+    Sim_bConsoleDirty = (Sim_u32PtyTxCount != 0);
+  }
+
+  u32Room = SimUsartRxRoom(DEBUG_UART_PERIPHERAL);
+  if(u32Room > sizeof(au8Buffer))
+  {
+    u32Room = sizeof(au8Buffer);
+  }
+
+  if(!Sim_bConsoleInput || (u32Room == 0) )
+  {
+    if(iTimeoutMs_ > 0)
+    {
+      poll(NULL, 0, iTimeoutMs_);
+    }
+    return;
+  }
+
+  sPoll.fd = Sim_iConsoleFd;
+  sPoll.events = POLLIN;
+  if(poll(&sPoll, 1, iTimeoutMs_) <= 0)
+  {
+    return;
+  }
+
+  /* End of file only ends stdin; the pty stays open for the next client */
+  iBytes = read(Sim_iConsoleFd, au8Buffer, u32Room);
+  if(iBytes <= 0)
+  {
+    if(Sim_iPtyMaster < 0)
+    {
+      Sim_bConsoleInput = FALSE;
+    }
+    return;
+  }
+
+  /* The console expects a terminal's CR for Enter; a raw terminal already sends CR and may 
+  carry binary transfer frames, which must not be changed */
+  for(ssize_t i = 0; (i < iBytes) && !Sim_bConsoleRaw; i++)
+  {
+    if(au8Buffer[i] == ASCII_LINEFEED)
+    {
+      au8Buffer[i] = ASCII_CARRIAGE_RETURN;
+    }
+  }
+
+  SimUsartInjectRx(DEBUG_UART_PERIPHERAL, au8Buffer, (u32)iBytes);
+
+} /* end SimConsolePoll() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimHousekeeping(void)
+
+@brief Host-side work done as simulated time passes: console, real-time pacing and the time limit.
+*/
+static void SimHousekeeping(void)
+{
+  SimTimeType u64WallNs;
+  int iSleepMs = 0;
+
+  if(G_u64SimTimeNs >= Sim_u64StopNs)
+  {
+    SimExit(0);
+  }
+
+  if(G_u64SimTimeNs < Sim_u64NextConsolePollNs)
+  {
+    return;
+  }
+  Sim_u64NextConsolePollNs = G_u64SimTimeNs + U32_SIM_CONSOLE_POLL_NS;
+
+  /* In real-time mode, wait for the wall clock to catch up (while still listening to stdin).  
+  Input can end the wait early, so keep waiting until the wall clock has really caught up. */
+  do
+  {
+    iSleepMs = 0;
+    if(Sim_bRealTime)
+    {
+      u64WallNs = SimWallClockNs() - Sim_u64WallStartNs;
+      if(G_u64SimTimeNs > u64WallNs)
+      {
+        iSleepMs = (int)((G_u64SimTimeNs - u64WallNs) / 1000000ULL);
+      }
+    }
+  
+    SimConsolePoll(iSleepMs);
+  } while(iSleepMs > 0);
+
+} /* end SimHousekeeping() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimSysTickSync(void)
+
+@brief Picks up SysTick configuration changes and samples the NVIC set/clear registers.
+*/
+static void SimSysTickSync(void)
+{
+  u32 u32Csr = AT91C_BASE_NVIC->NVIC_STICKCSR;
+  u32 u32Divider;
+  SimTimeType u64Period;
+
+  /* NVIC set/clear registers are write-only: consume and clear them */
+  if(AT91C_BASE_NVIC->NVIC_ICER[0])
+  {
+    Sim_u32NvicEnabled &= ~AT91C_BASE_NVIC->NVIC_ICER[0];
+    AT91C_BASE_NVIC->NVIC_ICER[0] = 0;
+  }
+  if(AT91C_BASE_NVIC->NVIC_ISER[0])
+  {
+    Sim_u32NvicEnabled |= AT91C_BASE_NVIC->NVIC_ISER[0];
+    AT91C_BASE_NVIC->NVIC_ISER[0] = 0;
+  }
+  if(AT91C_BASE_NVIC->NVIC_ICPR[0])
+  {
+    Sim_u32NvicSoftPending &= ~AT91C_BASE_NVIC->NVIC_ICPR[0];
+    AT91C_BASE_NVIC->NVIC_ICPR[0] = 0;
+  }
+  if(AT91C_BASE_NVIC->NVIC_ISPR[0])
+  {
+    Sim_u32NvicSoftPending |= AT91C_BASE_NVIC->NVIC_ISPR[0];
+    AT91C_BASE_NVIC->NVIC_ISPR[0] = 0;
+  }
+
+  if( !(u32Csr & _SIM_SYSTICK_ENABLE) )
+  {
+    Sim_u64NextTickNs = U64_SIM_NEVER;
+    return;
+  }
+
+  u32Divider = (u32Csr & _SIM_SYSTICK_CLKSOURCE) ? 1 : 8;
+  u64Period = ((SimTimeType)(AT91C_BASE_NVIC->NVIC_STICKRVR & 0x00FFFFFF) + 1) * u32Divider * 1000000000ULL / U32_SIM_MCK_HZ;
+
+  /* (Re)start the counter if it was just enabled, reloaded or written */
+  if( (Sim_u64NextTickNs == U64_SIM_NEVER) || (u64Period != Sim_u64TickPeriodNs) ||
+      (AT91C_BASE_NVIC->NVIC_STICKCVR != Sim_u32LastStickCvr) )
+  {
+    Sim_u64TickPeriodNs = u64Period;
+    Sim_u64NextTickNs = G_u64SimTimeNs + u64Period;
+  }
+
+} /* end SimSysTickSync() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimSysTickUpdate(void)
+
+@brief Counts SysTick down to the current simulated time.
+*/
+static void SimSysTickUpdate(void)
+{
+  u32 u32Divider;
+
+  if(Sim_u64NextTickNs == U64_SIM_NEVER)
+  {
+    return;
+  }
+
+  while(G_u64SimTimeNs >= Sim_u64NextTickNs)
+  {
+    if(Sim_bSysTickPending)
+    {
+      Sim_u32SysTickLost++;
+    }
+    Sim_bSysTickPending = TRUE;
+    AT91C_BASE_NVIC->NVIC_STICKCSR |= _SIM_SYSTICK_COUNTFLAG;
+    Sim_u64NextTickNs += Sim_u64TickPeriodNs;
+  }
+
+  /* Keep the current value register readable */
+  u32Divider = (AT91C_BASE_NVIC->NVIC_STICKCSR & _SIM_SYSTICK_CLKSOURCE) ? 1 : 8;
+  Sim_u32LastStickCvr = (u32)((Sim_u64NextTickNs - G_u64SimTimeNs) * (U32_SIM_MCK_HZ / u32Divider) / 1000000000ULL);
+  AT91C_BASE_NVIC->NVIC_STICKCVR = Sim_u32LastStickCvr;
+
+} /* end SimSysTickUpdate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u32 SimPendingIrqs(void)
+
+@brief Returns the enabled and pending peripheral interrupts as a bit mask of peripheral IDs.
+*/
+static u32 SimPendingIrqs(void)
+{
+  u32 u32Pending;
+
+  u32Pending  = Sim_u32NvicSoftPending;
+  u32Pending |= SimUsartPendingIrqs();
+  u32Pending |= SimTwiPendingIrqs();
+  u32Pending |= SimPioPendingIrqs();
+
+  return(u32Pending & Sim_u32NvicEnabled);
+
+} /* end SimPendingIrqs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimIrqPending(void)
+
+@brief Returns TRUE if any exception would be taken if PRIMASK were clear.
+*/
+static bool SimIrqPending(void)
+{
+  if(Sim_bSysTickPending && (AT91C_BASE_NVIC->NVIC_STICKCSR & _SIM_SYSTICK_TICKINT))
+  {
+    return(TRUE);
+  }
+
+  return(SimPendingIrqs() != 0);
+
+} /* end SimIrqPending() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimSync(void)
+
+@brief Samples every model's write-only registers.
+*/
+static void SimSync(void)
+{
+  SimSysTickSync();
+  SimUsartSync();
+  SimTwiSync();
+  SimPioSync();
+
+} /* end SimSync() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimSetActiveVector(u32 u32Vector_)
+
+@brief Shows the exception being serviced in NVIC_ICSR VECTACTIVE (0 = thread mode) so the firmware
+can tell it is in a handler.
+*/
+static void SimSetActiveVector(u32 u32Vector_)
+{
+  AT91C_BASE_NVIC->NVIC_ICSR = (AT91C_BASE_NVIC->NVIC_ICSR & ~AT91C_NVIC_VECTACTIVE) | u32Vector_;
+
+} /* end SimSetActiveVector() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimDispatch(void)
+
+@brief Services pending interrupts until none are left (SysTick first, then by peripheral ID).
+*/
+static void SimDispatch(void)
+{
+  u32 u32Pending;
+  u8 u8Id;
+  u8 u8Passes;
+
+  Sim_bInIsr = TRUE;
+
+  for(u8Passes = 0; u8Passes < U8_SIM_MAX_IRQ_PASSES; u8Passes++)
+  {
+    if(Sim_bSysTickPending && (AT91C_BASE_NVIC->NVIC_STICKCSR & _SIM_SYSTICK_TICKINT))
+    {
+      Sim_bSysTickPending = FALSE;
+      Sim_u32SysTickCount++;
+      Sim_u32ServicedCount++;
+      SimSetActiveVector(U32_SIM_SYSTICK_VECTOR);
+      SysTick_Handler();
+      SimSetActiveVector(0);
+      SimSync();
+      continue;
+    }
+
+    u32Pending = SimPendingIrqs();
+    if(u32Pending == 0)
+    {
+      break;
+    }
+
+    u8Id = (u8)__builtin_ctz(u32Pending);
+    Sim_u32NvicSoftPending &= ~(1u << u8Id);
+    Sim_au32IrqCounts[u8Id]++;
+    Sim_u32ServicedCount++;
+
+    if(u8Id < U8_SIM_VECTORS)
+    {
+      SimSetActiveVector(U32_SIM_FIRST_IRQ_VECTOR + u8Id);
+      Sim_apfnVectors[u8Id]();
+      SimSetActiveVector(0);
+    }
+
+    /* Emulate the status reads the ISR just made */
+    SimUsartIrqServiced(u8Id);
+    SimTwiIrqServiced(u8Id);
+    SimPioIrqServiced(u8Id);
+    SimSync();
+  }
+
+  if(u8Passes == U8_SIM_MAX_IRQ_PASSES)
+  {
+    Sim_u32IrqStorms++;
+  }
+
+  Sim_bInIsr = FALSE;
+
+} /* end SimDispatch() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimNextEvent(void)
+
+@brief Returns the time of the next scheduled event in any model.
+*/
+static SimTimeType SimNextEvent(void)
+{
+  SimTimeType u64Next = Sim_u64NextTickNs;
+  SimTimeType u64Model;
+
+  u64Model = SimUsartNextEvent();
+  if(u64Model < u64Next)
+  {
+    u64Next = u64Model;
+  }
+
+  u64Model = SimTwiNextEvent();
+  if(u64Model < u64Next)
+  {
+    u64Next = u64Model;
+  }
+
+  if(Sim_u64NextConsolePollNs < u64Next)
+  {
+    u64Next = Sim_u64NextConsolePollNs;
+  }
+
+  if(Sim_u64StopNs < u64Next)
+  {
+    u64Next = Sim_u64StopNs;
+  }
+
+  return(u64Next);
+
+} /* end SimNextEvent() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimAdvanceTo(SimTimeType u64Target_)
+
+@brief Moves simulated time forward, stopping at every event on the way.
+*/
+static void SimAdvanceTo(SimTimeType u64Target_)
+{
+  SimTimeType u64Next;
+
+  while(G_u64SimTimeNs < u64Target_)
+  {
+    u64Next = SimNextEvent();
+    if(u64Next > u64Target_)
+    {
+      u64Next = u64Target_;
+    }
+    if(u64Next <= G_u64SimTimeNs)
+    {
+      u64Next = G_u64SimTimeNs + 1;
+    }
+
+    G_u64SimTimeNs = u64Next;
+    SimHousekeeping();
+    SimStep();
+  }
+
+} /* end SimAdvanceTo() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimMapRegion(u32 u32Base_, u32 u32Size_)
+
+@brief Maps zeroed memory at a fixed register block address.
+*/
+static void SimMapRegion(u32 u32Base_, u32 u32Size_)
+{
+  void* pvRegion;
+
+#ifdef MAP_FIXED_NOREPLACE
+  pvRegion = mmap((void*)(uintptr_t)u32Base_, u32Size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+#else
+  pvRegion = mmap((void*)(uintptr_t)u32Base_, u32Size_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+#endif
+
+  if(pvRegion != (void*)(uintptr_t)u32Base_)
+  {
+    fprintf(stderr, "sim: unable to map registers at 0x%08X\n", u32Base_);
+    exit(1);
+  }
+
+} /* end SimMapRegion() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimInitialize(void)
+
+@brief Maps the register blocks, loads reset values and reads the runtime options.
+*/
+static void SimInitialize(void)
+{
+  const char* pcOption;
+  struct termios sTerminal;
+
+  SimMapRegion(U32_SIM_PERIPHERAL_BASE, U32_SIM_PERIPHERAL_SIZE);
+  SimMapRegion(U32_SIM_PPB_BASE, U32_SIM_PPB_SIZE);
+
+  /* Keep every heap allocation on the brk heap below 4 GB */
+  mallopt(M_MMAP_MAX, 0);
+
+  /* Clocks are ready as soon as they are asked for */
+  AT91C_BASE_PMC->PMC_SR = AT91C_PMC_MOSCXTS | AT91C_PMC_LOCKA | AT91C_PMC_MCKRDY | AT91C_PMC_LOCKU |
+                           AT91C_PMC_MOSCSELS | AT91C_PMC_PCKRDY0 | AT91C_PMC_PCKRDY1 | AT91C_PMC_PCKRDY2;
+  AT91C_BASE_NVIC->NVIC_STICKCALVR = U32_SIM_MCK_HZ / 8 / 100;
+
+  Sim_u64NextTickNs = U64_SIM_NEVER;
+  SimPioInitialize();   /* First, as devices in the other models drive pins */
+  SimUsartInitialize();
+  SimTwiInitialize();
+  SimUsartSetTxSink(DEBUG_UART_PERIPHERAL, SimConsoleWrite);
+
+  /* Runtime options */
+  Sim_u64StopNs = U64_SIM_NEVER;
+  pcOption = getenv("EIE_SIM_TIME_MS");
+  if( (pcOption != NULL) && (atol(pcOption) > 0) )
+  {
+    Sim_u64StopNs = (SimTimeType)atol(pcOption) * 1000000ULL;
+    Sim_bPrintStats = TRUE;
+  }
+
+  pcOption = getenv("EIE_SIM_STATS");
+  if( (pcOption != NULL) && (atoi(pcOption) != 0) )
+  {
+    Sim_bPrintStats = TRUE;
+  }
+
+  Sim_bConsoleInput = TRUE;
+  Sim_bConsoleRaw = FALSE;
+  Sim_iConsoleFd = STDIN_FILENO;
+  if( isatty(STDIN_FILENO) && (tcgetattr(STDIN_FILENO, &sTerminal) == 0) )
+  {
+    Sim_bConsoleRaw = (sTerminal.c_iflag & ICRNL) ? FALSE : TRUE;
+  }
+
+  Sim_iPtyMaster = -1;
+  Sim_iPtySlave = -1;
+  pcOption = getenv("EIE_SIM_PTY");
+  if( (pcOption != NULL) && (strcmp(pcOption, "0") != 0) && (pcOption[0] != '\0') )
+  {
+    SimPtyOpen( (strcmp(pcOption, "1") == 0) ? NULL : pcOption );
+  }
+
+  /* Interactive sessions run in real time unless told otherwise */
+  Sim_bRealTime = ( isatty(STDIN_FILENO) || (Sim_iPtyMaster >= 0) ) ? TRUE : FALSE;
+  pcOption = getenv("EIE_SIM_REALTIME");
+  if(pcOption != NULL)
+  {
+    Sim_bRealTime = (atoi(pcOption) != 0) ? TRUE : FALSE;
+  }
+
+  Sim_u64WallStartNs = SimWallClockNs();
+  signal(SIGINT, SimSignalHandler);
+  signal(SIGTERM, SimSignalHandler);
+
+} /* end SimInitialize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimFirmwareEntry(void)
+
+@brief Runs the firmware's main() on the low stack.
+*/
+static void SimFirmwareEntry(void)
+{
+  __real_main();
+
+} /* end SimFirmwareEntry() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn int __wrap_main(void)
+
+@brief Host entry point: sets up the simulated chip and starts the firmware.
+
+Requires:
+- Linked with -Wl,--wrap=main and -no-pie
+
+Promises:
+- Never returns unless the firmware's main() does
+*/
+int __wrap_main(void)
+{
+  void* pvStack;
+
+  SimInitialize();
+
+  /* The firmware passes stack buffers to the PDC too, so its stack must be below 4 GB */
+  pvStack = mmap(NULL, U32_SIM_FIRMWARE_STACK_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+  if( (pvStack == MAP_FAILED) || ((uintptr_t)pvStack > 0xFFFFFFFFu - U32_SIM_FIRMWARE_STACK_SIZE) )
+  {
+    fprintf(stderr, "sim: unable to allocate a stack below 4 GB\n");
+    return(1);
+  }
+
+  getcontext(&Sim_sFirmwareContext);
+  Sim_sFirmwareContext.uc_stack.ss_sp = pvStack;
+  Sim_sFirmwareContext.uc_stack.ss_size = U32_SIM_FIRMWARE_STACK_SIZE;
+  Sim_sFirmwareContext.uc_link = &Sim_sHostContext;
+  makecontext(&Sim_sFirmwareContext, SimFirmwareEntry, 0);
+  swapcontext(&Sim_sHostContext, &Sim_sFirmwareContext);
+
+  SimExit(0);
+  return(0);
+
+} /* end __wrap_main() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimCpuCycles(u32 u32Cycles_)
+
+@brief Charges the simulated core for some work, letting time and the peripherals advance.
+
+Requires:
+@param u32Cycles_ is the number of MCK cycles spent
+
+Promises:
+- Simulated time advances and any interrupt that becomes due is serviced (unless masked)
+*/
+void SimCpuCycles(u32 u32Cycles_)
+{
+  SimAdvanceTo(G_u64SimTimeNs + (SimTimeType)u32Cycles_ * 1000000000ULL / U32_SIM_MCK_HZ);
+
+} /* end SimCpuCycles() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn SimTimeType SimGetTimeNs(void)
+
+@brief Returns the current simulated time in ns.
+*/
+SimTimeType SimGetTimeNs(void)
+{
+  return(G_u64SimTimeNs);
+
+} /* end SimGetTimeNs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimStep(void)
+
+@brief Brings every model up to the current simulated time and services interrupts.
+
+Requires:
+- Called whenever the firmware gives the simulator control
+
+Promises:
+- Write-only registers are consumed, status registers are current
+- Pending interrupts are serviced unless PRIMASK is set or an ISR is already running
+*/
+void SimStep(void)
+{
+  SimSync();
+  SimSysTickUpdate();
+  SimUsartUpdate(G_u64SimTimeNs);
+  SimTwiUpdate(G_u64SimTimeNs);
+
+  if(!Sim_bPrimask && !Sim_bInIsr)
+  {
+    SimDispatch();
+  }
+
+} /* end SimStep() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __WFI(void)
+
+@brief Sleeps until an interrupt is taken, fast-forwarding simulated time between events.
+*/
+void __WFI(void)
+{
+  u32 u32Serviced = Sim_u32ServicedCount;
+  SimTimeType u64Next;
+
+  Sim_u32WfiCount++;
+
+  /* Anything already pending wakes the core immediately */
+  SimStep();
+  if( (Sim_u32ServicedCount != u32Serviced) || SimIrqPending() )
+  {
+    return;
+  }
+
+  u64Next = SimNextEvent();
+  if(u64Next == U64_SIM_NEVER)
+  {
+    fprintf(stderr, "sim: WFI with nothing left to wake the core\n");
+    SimExit(1);
+  }
+
+  SimAdvanceTo(u64Next);
+
+} /* end __WFI() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __enable_irq(void)
+
+@brief Clears PRIMASK and services anything that became pending while masked.
+*/
+void __enable_irq(void)
+{
+  Sim_bPrimask = FALSE;
+  SimStep();
+
+} /* end __enable_irq() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __disable_irq(void)
+
+@brief Sets PRIMASK.
+*/
+void __disable_irq(void)
+{
+  Sim_bPrimask = TRUE;
+
+} /* end __disable_irq() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn uint32_t __get_PRIMASK(void)
+
+@brief Returns the emulated PRIMASK.
+*/
+uint32_t __get_PRIMASK(void)
+{
+  return(Sim_bPrimask ? 1 : 0);
+
+} /* end __get_PRIMASK() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void __set_PRIMASK(uint32_t priMask)
+
+@brief Writes the emulated PRIMASK.
+*/
+void __set_PRIMASK(uint32_t priMask)
+{
+  if(priMask & 1)
+  {
+    __disable_irq();
+  }
+  else
+  {
+    __enable_irq();
+  }
+
+} /* end __set_PRIMASK() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn uint32_t __RBIT(uint32_t value)
+
+@brief Reverses the bit order of a word.
+*/
+uint32_t __RBIT(uint32_t value)
+{
+  uint32_t u32Result = 0;
+
+  for(u8 i = 0; i < 32; i++)
+  {
+    u32Result = (u32Result << 1) | (value & 1);
+    value >>= 1;
+  }
+
+  return(u32Result);
+
+} /* end __RBIT() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn uint32_t __REV(uint32_t value)
+
+@brief Reverses the byte order of a word.
+*/
+uint32_t __REV(uint32_t value)
+{
+  return(__builtin_bswap32(value));
+
+} /* end __REV() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn uint32_t __REV16(uint16_t value)
+
+@brief Reverses the byte order of a halfword.
+*/
+uint32_t __REV16(uint16_t value)
+{
+  return( (uint32_t)__builtin_bswap16(value) );
+
+} /* end __REV16() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn int32_t __REVSH(int16_t value)
+
+@brief Reverses the byte order of a signed halfword and sign extends it.
+*/
+int32_t __REVSH(int16_t value)
+{
+  return( (int32_t)(int16_t)__builtin_bswap16((uint16_t)value) );
+
+} /* end __REVSH() */
+
+
+/* Core instructions with nothing to simulate */
+void __NOP(void)               {}
+void __enable_fault_irq(void)  {}
+void __disable_fault_irq(void) {}
+void __WFE(void)               { __WFI(); }
+void __SEV(void)               {}
+void __ISB(void)               {}
+void __DSB(void)               {}
+void __DMB(void)               {}
+void __CLREX(void)             {}
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void kill_x_cycles(u32 u32Cycles_)
+
+@brief Host version of kill_x_cycles.s: burns the requested core cycles of simulated time.
+*/
+void kill_x_cycles(u32 u32Cycles_)
+{
+  SimCpuCycles(u32Cycles_);
+
+} /* end kill_x_cycles() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,252 @@
+/*!*********************************************************************************************************************
+@file sim_pio.c
+@brief Simulated PIOA/PIOB/PIOC.
+
+The set/clear register pairs are folded into their status registers, PDSR shows driven outputs
+and the simulated external levels of inputs, and input changes set ISR bits (both edges, or the
+edge/level selected through the additional interrupt mode registers).  External levels default
+high, which matches the pulled-up, active-low buttons on both boards.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- NONE
+
+CONSTANTS
+- NONE
+
+TYPES
+- SimPioType
+
+PUBLIC FUNCTIONS
+- void SimPioSetInput(AT91PS_PIO psPio_, u32 u32Pins_, bool bHigh_)
+
+PROTECTED FUNCTIONS
+- void SimPioInitialize(void)
+- void SimPioSync(void)
+- u32 SimPioPendingIrqs(void)
+- void SimPioIrqServiced(u8 u8PeripheralId_)
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Type Definitions
+***********************************************************************************************************************/
+
+/*!
+@struct SimPioType
+@brief State of one simulated PIO controller.
+*/
+typedef struct
+{
+  AT91PS_PIO pRegisters;                       /*!< @brief Register block */
+  u8 u8PeripheralId;                           /*!< @brief AT91C_ID_PIOx */
+  u32 u32Inputs;                               /*!< @brief Level applied to each pin from outside */
+  u32 u32LastPdsr;                             /*!< @brief PDSR at the last sync, for edge detection */
+  u32 u32Isr;                                  /*!< @brief Interrupt status latched since the last ISR */
+} SimPioType;
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Sim_<type>" and be declared as static.
+***********************************************************************************************************************/
+static SimPioType Sim_asPios[] =
+{
+  {.pRegisters = AT91C_BASE_PIOA, .u8PeripheralId = AT91C_ID_PIOA},
+  {.pRegisters = AT91C_BASE_PIOB, .u8PeripheralId = AT91C_ID_PIOB},
+  {.pRegisters = AT91C_BASE_PIOC, .u8PeripheralId = AT91C_ID_PIOC}
+};
+
+#define U8_SIM_PIOS  (u8)(sizeof(Sim_asPios) / sizeof(SimPioType))
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimPioApply(volatile u32* pu32Set_, volatile u32* pu32Clear_, volatile u32* pu32Status_)
+
+@brief Folds one write-only set/clear register pair into its status register.
+*/
+static void SimPioApply(volatile u32* pu32Set_, volatile u32* pu32Clear_, volatile u32* pu32Status_)
+{
+  if(*pu32Clear_)
+  {
+    *pu32Status_ &= ~*pu32Clear_;
+    *pu32Clear_ = 0;
+  }
+  if(*pu32Set_)
+  {
+    *pu32Status_ |= *pu32Set_;
+    *pu32Set_ = 0;
+  }
+
+} /* end SimPioApply() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimPioSyncOne(SimPioType* psPio_)
+
+@brief Consumes the write-only registers of one PIO and updates PDSR/ISR.
+*/
+static void SimPioSyncOne(SimPioType* psPio_)
+{
+  AT91PS_PIO pRegs = psPio_->pRegisters;
+  u32 u32Pdsr;
+  u32 u32Changed;
+  u32 u32Level;
+
+  SimPioApply(&pRegs->PIO_PER,   &pRegs->PIO_PDR,   &pRegs->PIO_PSR);
+  SimPioApply(&pRegs->PIO_OER,   &pRegs->PIO_ODR,   &pRegs->PIO_OSR);
+  SimPioApply(&pRegs->PIO_IFER,  &pRegs->PIO_IFDR,  &pRegs->PIO_IFSR);
+  SimPioApply(&pRegs->PIO_IER,   &pRegs->PIO_IDR,   &pRegs->PIO_IMR);
+  SimPioApply(&pRegs->PIO_MDER,  &pRegs->PIO_MDDR,  &pRegs->PIO_MDSR);
+  SimPioApply(&pRegs->PIO_PPUDR, &pRegs->PIO_PPUER, &pRegs->PIO_PPUSR);  /* PPUSR set = pull-up disabled */
+  SimPioApply(&pRegs->PIO_OWER,  &pRegs->PIO_OWDR,  &pRegs->PIO_OWSR);
+  SimPioApply(&pRegs->PIO_AIMER, &pRegs->PIO_AIMDR, &pRegs->PIO_AIMMR);
+  SimPioApply(&pRegs->PIO_LSR,   &pRegs->PIO_ESR,   &pRegs->PIO_ELSR);
+  SimPioApply(&pRegs->PIO_REHLSR, &pRegs->PIO_FELLSR, &pRegs->PIO_FRLHSR);
+  SimPioApply(&pRegs->PIO_SODR,  &pRegs->PIO_CODR,  &pRegs->PIO_ODSR);
+
+  u32Pdsr = (pRegs->PIO_ODSR & pRegs->PIO_OSR) | (psPio_->u32Inputs & ~pRegs->PIO_OSR);
+  pRegs->PIO_PDSR = u32Pdsr;
+
+  /* Input change interrupts, optionally restricted to one edge or level */
+  u32Changed = u32Pdsr ^ psPio_->u32LastPdsr;
+  u32Level   = ~(u32Pdsr ^ pRegs->PIO_FRLHSR);   /* Pin is at the selected level (high/rising or low/falling) */
+  psPio_->u32Isr |= (u32Changed & ~pRegs->PIO_AIMMR) |
+                    (u32Changed & u32Level & pRegs->PIO_AIMMR & ~pRegs->PIO_ELSR) |
+                    (u32Level & pRegs->PIO_AIMMR & pRegs->PIO_ELSR);
+  psPio_->u32LastPdsr = u32Pdsr;
+  pRegs->PIO_ISR = psPio_->u32Isr;
+
+} /* end SimPioSyncOne() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimPioSetInput(AT91PS_PIO psPio_, u32 u32Pins_, bool bHigh_)
+
+@brief Drives pins from outside the chip (buttons, interrupt lines from simulated devices).
+
+Requires:
+@param psPio_ is AT91C_BASE_PIOA, AT91C_BASE_PIOB or AT91C_BASE_PIOC
+@param u32Pins_ is the bit mask of pins
+@param bHigh_ is the level to apply
+
+Promises:
+- The new level (and any resulting interrupt) is seen at the next simulator step
+*/
+void SimPioSetInput(AT91PS_PIO psPio_, u32 u32Pins_, bool bHigh_)
+{
+  for(u8 i = 0; i < U8_SIM_PIOS; i++)
+  {
+    if(Sim_asPios[i].pRegisters == psPio_)
+    {
+      if(bHigh_)
+      {
+        Sim_asPios[i].u32Inputs |= u32Pins_;
+      }
+      else
+      {
+        Sim_asPios[i].u32Inputs &= ~u32Pins_;
+      }
+    }
+  }
+
+} /* end SimPioSetInput() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimPioInitialize(void)
+
+@brief Loads reset values: every pin is an input under PIO control with the pull-up enabled.
+*/
+void SimPioInitialize(void)
+{
+  for(u8 i = 0; i < U8_SIM_PIOS; i++)
+  {
+    Sim_asPios[i].pRegisters->PIO_PSR = 0xFFFFFFFF;
+    Sim_asPios[i].u32Inputs = 0xFFFFFFFF;
+    Sim_asPios[i].u32LastPdsr = 0xFFFFFFFF;
+    Sim_asPios[i].pRegisters->PIO_PDSR = 0xFFFFFFFF;
+  }
+
+} /* end SimPioInitialize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimPioSync(void)
+
+@brief Picks up register writes and pin changes.
+*/
+void SimPioSync(void)
+{
+  for(u8 i = 0; i < U8_SIM_PIOS; i++)
+  {
+    SimPioSyncOne(&Sim_asPios[i]);
+  }
+
+} /* end SimPioSync() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 SimPioPendingIrqs(void)
+
+@brief Returns a peripheral ID bit for every PIO with an enabled change latched.
+*/
+u32 SimPioPendingIrqs(void)
+{
+  u32 u32Pending = 0;
+
+  for(u8 i = 0; i < U8_SIM_PIOS; i++)
+  {
+    if(Sim_asPios[i].u32Isr & Sim_asPios[i].pRegisters->PIO_IMR)
+    {
+      u32Pending |= (1u << Sim_asPios[i].u8PeripheralId);
+    }
+  }
+
+  return(u32Pending);
+
+} /* end SimPioPendingIrqs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimPioIrqServiced(u8 u8PeripheralId_)
+
+@brief The ISR read PIO_ISR, which clears it.
+*/
+void SimPioIrqServiced(u8 u8PeripheralId_)
+{
+  for(u8 i = 0; i < U8_SIM_PIOS; i++)
+  {
+    if(Sim_asPios[i].u8PeripheralId == u8PeripheralId_)
+    {
+      Sim_asPios[i].u32Isr = 0;
+      Sim_asPios[i].pRegisters->PIO_ISR = 0;
+    }
+  }
+
+} /* end SimPioIrqServiced() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,1230 @@
+/*!*********************************************************************************************************************
+@file sim_twi.c
+@brief Simulated TWI0/TWI1 master with PDC and a table of simulated slave devices.
+
+Master writes start as soon as data is available in THR or the PDC; an address phase is added
+unless the bus was left held by a previous transfer without a STOP.  When the data runs out the
+transfer either finishes (STOP requested, TXCOMP set) or holds the bus waiting for more data.
+Master reads start on a START command with MREAD set; IADR is sent first when IADRSZ is non-zero.
+Received bytes go to the PDC while RCR > 0 and otherwise to RHR; the byte that completes after a
+STOP request ends the transfer.
+
+Each byte (plus ACK) takes 9 SCL periods from CWGR.  A missing slave answers the address with a
+NACK, which ends the transfer with NACK and TXCOMP set.
+
+Default devices: the ASCII LCD at 0x3C (byte stream) and an LSM6DSL register file at 0x6B.
+
+The LSM6DSL also models its FIFO: once FIFO_CTRL5 selects continuous or FIFO mode, samples of 
+gyro X/Y/Z and accelerometer X/Y/Z arrive at ODR_FIFO.  FIFO_STATUS1-4 report the unread words, 
+the watermark (FIFO_CTRL1/2), overruns and the pattern, and reads of FIFO_DATA_OUT_L/H take words 
+with the register pointer rolling back from _H to _L.  Sample n holds gyro (n, 3n, -n) and 
+accelerometer (100, -100, 4096), so a reader can check that none were lost.
+
+INT1 drives Blade IO2 (PA_11_BLADE_UPIMO) as INT1_CTRL selects: INT1_DRDY_XL is high from each 
+accelerometer sample (at ODR_XL from CTRL1_XL) until an accelerometer output register is read, and 
+INT1_FTH is high while the FIFO holds at least the watermark.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- NONE
+
+CONSTANTS
+- NONE
+
+TYPES
+- SimTwiStateType
+- SimTwiType
+- SimLsm6dslFifoType
+- SimLsm6dslInt1Type
+
+PUBLIC FUNCTIONS
+- bool SimTwiAttachSlave(SimTwiSlaveType* psSlave_)
+- SimTwiSlaveType* SimTwiFindSlave(u8 u8Address_)
+
+PROTECTED FUNCTIONS
+- void SimTwiInitialize(void)
+- void SimTwiSync(void)
+- void SimTwiUpdate(SimTimeType u64Now_)
+- SimTimeType SimTwiNextEvent(void)
+- u32 SimTwiPendingIrqs(void)
+- void SimTwiIrqServiced(u8 u8PeripheralId_)
+- void SimTwiReport(void)
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Constants / Definitions
+***********************************************************************************************************************/
+#define U8_SIM_LCD_ADDRESS            (u8)0x3C           /*!< @brief ASCII LCD on the main board */
+#define U8_SIM_LSM6DSL_ADDRESS        (u8)0x6B           /*!< @brief LSM6DSL on the IMU blade */
+#define U8_SIM_LSM6DSL_WHO_AM_I       (u8)0x0F           /*!< @brief WHO_AM_I register */
+#define U8_SIM_LSM6DSL_ID             (u8)0x6A           /*!< @brief WHO_AM_I value */
+#define U8_SIM_LSM6DSL_FIFO_CTRL1     (u8)0x06           /*!< @brief Watermark FTH[7:0] */
+#define U8_SIM_LSM6DSL_FIFO_CTRL2     (u8)0x07           /*!< @brief Watermark FTH[10:8] in bits 2:0 */
+#define U8_SIM_LSM6DSL_FIFO_CTRL5     (u8)0x0A           /*!< @brief ODR_FIFO in bits 6:3, FIFO_MODE in bits 2:0 */
+#define U8_SIM_LSM6DSL_INT1_CTRL      (u8)0x0D           /*!< @brief Signals routed to INT1 */
+#define U8_SIM_LSM6DSL_CTRL1_XL       (u8)0x10           /*!< @brief ODR_XL in bits 7:4 */
+#define U8_SIM_LSM6DSL_OUTX_L_XL      (u8)0x28           /*!< @brief First accelerometer output register */
+#define U8_SIM_LSM6DSL_OUTZ_H_XL      (u8)0x2D           /*!< @brief Last accelerometer output register */
+#define U8_SIM_LSM6DSL_FIFO_STATUS1   (u8)0x3A           /*!< @brief First FIFO status register */
+#define U8_SIM_LSM6DSL_FIFO_STATUS4   (u8)0x3D           /*!< @brief Last FIFO status register */
+#define U8_SIM_LSM6DSL_FIFO_DATA_L    (u8)0x3E           /*!< @brief FIFO_DATA_OUT_L */
+#define U8_SIM_LSM6DSL_FIFO_DATA_H    (u8)0x3F           /*!< @brief FIFO_DATA_OUT_H */
+#define U16_SIM_LSM6DSL_FIFO_WORDS    (u16)2048          /*!< @brief FIFO size in 16-bit words (4 KB) */
+#define U8_SIM_LSM6DSL_SAMPLE_WORDS   (u8)6              /*!< @brief Gyro and accelerometer words per sample */
+#define U8_SIM_LSM6DSL_INT1_DRDY_XL   (u8)0x01           /*!< @brief INT1_CTRL: accelerometer data ready */
+#define U8_SIM_LSM6DSL_INT1_FTH       (u8)0x08           /*!< @brief INT1_CTRL: FIFO watermark */
+#define U32_SIM_LSM6DSL_INT1_PIN      PA_11_BLADE_UPIMO  /*!< @brief INT1 is wired to Blade IO2 on PIOA */
+
+
+/***********************************************************************************************************************
+Type Definitions
+***********************************************************************************************************************/
+
+/*!
+@enum SimTwiStateType
+@brief Bus state of a simulated TWI master.
+*/
+typedef enum {SIM_TWI_IDLE, SIM_TWI_ADDRESS, SIM_TWI_WRITING, SIM_TWI_READING, SIM_TWI_HOLD} SimTwiStateType;
+
+
+/*!
+@struct SimTwiType
+@brief State of one simulated TWI master and its PDC channel.
+*/
+typedef struct
+{
+  AT91PS_TWI pRegisters;                       /*!< @brief Register block */
+  u8 u8PeripheralId;                           /*!< @brief AT91C_ID_TWIx */
+  const char* pcName;                          /*!< @brief Name for statistics */
+  SimTwiStateType eState;                      /*!< @brief Bus state */
+  bool bMasterEnabled;                         /*!< @brief MSEN/MSDIS state */
+  bool bReading;                               /*!< @brief Current transfer direction */
+  bool bStartPending;                          /*!< @brief START requested and not yet acted on */
+  bool bStopPending;                           /*!< @brief STOP requested and not yet sent */
+  bool bTxComp;                                /*!< @brief TXCOMP */
+  bool bRxReady;                               /*!< @brief RXRDY */
+  bool bNack;                                  /*!< @brief NACK latch */
+  bool bEndTx;                                 /*!< @brief ENDTX latch */
+  bool bEndRx;                                 /*!< @brief ENDRX latch */
+  u8 u8TxShift;                                /*!< @brief Byte being written */
+  SimTwiSlaveType* psSlave;                    /*!< @brief Addressed device (NULL = nobody answered) */
+  SimTimeType u64PhaseDoneNs;                  /*!< @brief When the current address/data phase finishes */
+  u32 u32Tcr;                                  /*!< @brief TCR as last left by the model */
+  u32 u32Tncr;                                 /*!< @brief TNCR as last left by the model */
+  u32 u32Rcr;                                  /*!< @brief RCR as last left by the model */
+  u32 u32Rncr;                                 /*!< @brief RNCR as last left by the model */
+  u32 u32Transactions;                         /*!< @brief Statistics */
+  u32 u32Nacks;                                /*!< @brief Statistics */
+  u32 u32BytesWritten;                         /*!< @brief Statistics */
+  u32 u32BytesRead;                            /*!< @brief Statistics */
+} SimTwiType;
+
+
+/*!
+@struct SimLsm6dslFifoType
+@brief State of the simulated LSM6DSL FIFO.
+*/
+typedef struct
+{
+  bool bRunning;                               /*!< @brief FIFO_MODE is FIFO or continuous with a rate set */
+  SimTimeType u64StartNs;                      /*!< @brief When the FIFO was started */
+  u32 u32RateMilliHz;                          /*!< @brief ODR_FIFO */
+  u64 u64WordsRead;                            /*!< @brief Words taken (or overwritten) since the start */
+  u64 u64Words;                                /*!< @brief Words stored since the start */
+  u8 au8Status[4];                             /*!< @brief FIFO_STATUS1-4 latched when FIFO_STATUS1 is read */
+  bool bOverrun;                               /*!< @brief Words were overwritten since the last status read */
+  u32 u32Overruns;                             /*!< @brief Statistics */
+} SimLsm6dslFifoType;
+
+
+/*!
+@struct SimLsm6dslInt1Type
+@brief State of the simulated LSM6DSL accelerometer data ready and INT1 pin.
+*/
+typedef struct
+{
+  SimTimeType u64XlStartNs;                    /*!< @brief When CTRL1_XL last set the accelerometer rate */
+  u32 u32XlRateMilliHz;                        /*!< @brief ODR_XL (0 = powered down) */
+  u64 u64XlSamplesRead;                        /*!< @brief Accelerometer samples due when the outputs were last read */
+  bool bLevel;                                 /*!< @brief INT1 level */
+  u32 u32RisingEdges;                          /*!< @brief Statistics */
+} SimLsm6dslInt1Type;
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+***********************************************************************************************************************/
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern SimTimeType G_u64SimTimeNs;                     /*!< @brief From sim_core.c */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Sim_<type>" and be declared as static.
+***********************************************************************************************************************/
+static SimTwiType Sim_asTwis[] =
+{
+  {.pRegisters = AT91C_BASE_TWI0, .u8PeripheralId = AT91C_ID_TWI0, .pcName = "TWI0"},
+  {.pRegisters = AT91C_BASE_TWI1, .u8PeripheralId = AT91C_ID_TWI1, .pcName = "TWI1"}
+};
+
+#define U8_SIM_TWIS  (u8)(sizeof(Sim_asTwis) / sizeof(SimTwiType))
+
+static SimTwiSlaveType* Sim_apsTwiSlaves[U8_SIM_MAX_TWI_SLAVES];   /*!< @brief Devices on the bus */
+
+static SimTwiSlaveType Sim_sLcd =
+{
+  .u8Address = U8_SIM_LCD_ADDRESS, .pcName = "LCD"
+};
+
+static SimTwiSlaveType Sim_sLsm6dsl =
+{
+  .u8Address = U8_SIM_LSM6DSL_ADDRESS, .pcName = "LSM6DSL",
+  .au8Registers = { [U8_SIM_LSM6DSL_WHO_AM_I] = U8_SIM_LSM6DSL_ID }
+};
+
+static SimLsm6dslFifoType Sim_sLsm6dslFifo;                        /*!< @brief FIFO of Sim_sLsm6dsl */
+static SimLsm6dslInt1Type Sim_sLsm6dslInt1;                        /*!< @brief Data ready and INT1 of Sim_sLsm6dsl */
+
+/*! @brief ODR_FIFO codes in mHz */
+static const u32 Sim_au32Lsm6dslRatesMilliHz[16] = 
+{ 0, 12500, 26000, 52000, 104000, 208000, 416000, 833000, 1660000, 3330000, 6660000 };
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimTwiByteTimeNs(SimTwiType* psTwi_)
+
+@brief Returns the time for 9 SCL periods with the current CWGR settings.
+*/
+static SimTimeType SimTwiByteTimeNs(SimTwiType* psTwi_)
+{
+  u32 u32Cwgr = psTwi_->pRegisters->TWI_CWGR;
+  u32 u32CkDiv = (u32Cwgr & AT91C_TWI_CKDIV) >> 16;
+  u32 u32Low  = ((u32Cwgr & AT91C_TWI_CLDIV) << u32CkDiv) + 4;
+  u32 u32High = (((u32Cwgr & AT91C_TWI_CHDIV) >> 8) << u32CkDiv) + 4;
+
+  return( (SimTimeType)9 * (u32Low + u32High) * 1000000000ULL / U32_SIM_MCK_HZ );
+
+} /* end SimTwiByteTimeNs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiSlaveWrite(SimTwiSlaveType* psSlave_, u8 u8Byte_)
+
+@brief Delivers a written byte to a device.
+*/
+static void SimTwiSlaveWrite(SimTwiSlaveType* psSlave_, u8 u8Byte_)
+{
+  psSlave_->u32BytesWritten++;
+
+  if(psSlave_->pfnWrite != NULL)
+  {
+    psSlave_->pfnWrite(psSlave_, u8Byte_);
+    return;
+  }
+
+  /* Register file: first byte is the register pointer */
+  if(!psSlave_->bPointerSet)
+  {
+    psSlave_->u8Pointer = u8Byte_;
+    psSlave_->bPointerSet = TRUE;
+    return;
+  }
+
+  psSlave_->au8Registers[psSlave_->u8Pointer++] = u8Byte_;
+
+} /* end SimTwiSlaveWrite() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u8 SimTwiSlaveRead(SimTwiSlaveType* psSlave_)
+
+@brief Returns the next byte a device sends.
+*/
+static u8 SimTwiSlaveRead(SimTwiSlaveType* psSlave_)
+{
+  psSlave_->u32BytesRead++;
+
+  if(psSlave_->pfnRead != NULL)
+  {
+    return(psSlave_->pfnRead(psSlave_));
+  }
+
+  return(psSlave_->au8Registers[psSlave_->u8Pointer++]);
+
+} /* end SimTwiSlaveRead() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimLsm6dslFifoFill(void)
+
+@brief Adds the samples that are due by now to the LSM6DSL FIFO, overwriting the oldest words when
+it is full (continuous mode).
+*/
+static void SimLsm6dslFifoFill(void)
+{
+  SimLsm6dslFifoType* psFifo = &Sim_sLsm6dslFifo;
+
+  if(!psFifo->bRunning)
+  {
+    return;
+  }
+
+  psFifo->u64Words = ((G_u64SimTimeNs - psFifo->u64StartNs) * psFifo->u32RateMilliHz / 1000000000000ULL) *
+                     U8_SIM_LSM6DSL_SAMPLE_WORDS;
+  if( (psFifo->u64Words - psFifo->u64WordsRead) > U16_SIM_LSM6DSL_FIFO_WORDS )
+  {
+    psFifo->u64WordsRead = psFifo->u64Words - U16_SIM_LSM6DSL_FIFO_WORDS;
+    if(!psFifo->bOverrun)
+    {
+      psFifo->u32Overruns++;
+    }
+    psFifo->bOverrun = TRUE;
+  }
+
+} /* end SimLsm6dslFifoFill() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u64 SimLsm6dslXlSamples(SimTimeType u64Now_)
+
+@brief Returns how many accelerometer samples have been taken since CTRL1_XL was written.
+*/
+static u64 SimLsm6dslXlSamples(SimTimeType u64Now_)
+{
+  return( (u64Now_ - Sim_sLsm6dslInt1.u64XlStartNs) * Sim_sLsm6dslInt1.u32XlRateMilliHz / 1000000000000ULL );
+
+} /* end SimLsm6dslXlSamples() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimLsm6dslSampleTimeNs(SimTimeType u64StartNs_, u32 u32RateMilliHz_, u64 u64Sample_)
+
+@brief Returns when sample u64Sample_ (counting from 1) of a stream started at u64StartNs_ is taken.
+*/
+static SimTimeType SimLsm6dslSampleTimeNs(SimTimeType u64StartNs_, u32 u32RateMilliHz_, u64 u64Sample_)
+{
+  return( u64StartNs_ + (u64Sample_ * 1000000000000ULL + u32RateMilliHz_ - 1) / u32RateMilliHz_ );
+
+} /* end SimLsm6dslSampleTimeNs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimLsm6dslInt1Update(void)
+
+@brief Drives the INT1 pin from the signals INT1_CTRL routes to it.
+*/
+static void SimLsm6dslInt1Update(void)
+{
+  SimLsm6dslFifoType* psFifo = &Sim_sLsm6dslFifo;
+  u8 u8Int1Ctrl = Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_INT1_CTRL];
+  u32 u32Watermark;
+  bool bLevel = FALSE;
+
+  if( (u8Int1Ctrl & U8_SIM_LSM6DSL_INT1_DRDY_XL) && (Sim_sLsm6dslInt1.u32XlRateMilliHz != 0) &&
+      (SimLsm6dslXlSamples(G_u64SimTimeNs) > Sim_sLsm6dslInt1.u64XlSamplesRead) )
+  {
+    bLevel = TRUE;
+  }
+
+  if( (u8Int1Ctrl & U8_SIM_LSM6DSL_INT1_FTH) && psFifo->bRunning )
+  {
+    SimLsm6dslFifoFill();
+    u32Watermark = Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL1] | 
+                   ((u32)(Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL2] & 0x07) << 8);
+    if( (u32Watermark != 0) && ((psFifo->u64Words - psFifo->u64WordsRead) >= u32Watermark) )
+    {
+      bLevel = TRUE;
+    }
+  }
+
+  if(bLevel != Sim_sLsm6dslInt1.bLevel)
+  {
+    if(bLevel)
+    {
+      Sim_sLsm6dslInt1.u32RisingEdges++;
+    }
+    Sim_sLsm6dslInt1.bLevel = bLevel;
+    SimPioSetInput(AT91C_BASE_PIOA, U32_SIM_LSM6DSL_INT1_PIN, bLevel);
+  }
+
+} /* end SimLsm6dslInt1Update() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimLsm6dslInt1NextEvent(void)
+
+@brief Returns when INT1 will next rise, or U64_SIM_NEVER if it is high or nothing is routed to it.
+*/
+static SimTimeType SimLsm6dslInt1NextEvent(void)
+{
+  SimLsm6dslFifoType* psFifo = &Sim_sLsm6dslFifo;
+  u8 u8Int1Ctrl = Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_INT1_CTRL];
+  SimTimeType u64Next = U64_SIM_NEVER;
+  SimTimeType u64Event;
+  u32 u32Watermark;
+  u64 u64Unread;
+
+  if(Sim_sLsm6dslInt1.bLevel)
+  {
+    return(U64_SIM_NEVER);
+  }
+
+  if( (u8Int1Ctrl & U8_SIM_LSM6DSL_INT1_DRDY_XL) && (Sim_sLsm6dslInt1.u32XlRateMilliHz != 0) )
+  {
+    u64Next = SimLsm6dslSampleTimeNs(Sim_sLsm6dslInt1.u64XlStartNs, Sim_sLsm6dslInt1.u32XlRateMilliHz,
+                                     SimLsm6dslXlSamples(G_u64SimTimeNs) + 1);
+  }
+
+  if( (u8Int1Ctrl & U8_SIM_LSM6DSL_INT1_FTH) && psFifo->bRunning )
+  {
+    u32Watermark = Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL1] | 
+                   ((u32)(Sim_sLsm6dsl.au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL2] & 0x07) << 8);
+    u64Unread = psFifo->u64Words - psFifo->u64WordsRead;
+    if( (u32Watermark != 0) && (u64Unread < u32Watermark) )
+    {
+      u64Event = SimLsm6dslSampleTimeNs(psFifo->u64StartNs, psFifo->u32RateMilliHz,
+                                        (psFifo->u64Words + (u32Watermark - u64Unread) + U8_SIM_LSM6DSL_SAMPLE_WORDS - 1) /
+                                        U8_SIM_LSM6DSL_SAMPLE_WORDS);
+      if(u64Event < u64Next)
+      {
+        u64Next = u64Event;
+      }
+    }
+  }
+
+  return(u64Next);
+
+} /* end SimLsm6dslInt1NextEvent() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimLsm6dslWrite(SimTwiSlaveType* psSlave_, u8 u8Byte_)
+
+@brief Register-file write for the LSM6DSL that (re)starts the FIFO when FIFO_CTRL5 is written.
+*/
+static void SimLsm6dslWrite(SimTwiSlaveType* psSlave_, u8 u8Byte_)
+{
+  SimLsm6dslFifoType* psFifo = &Sim_sLsm6dslFifo;
+  u8 u8Register;
+
+  if(!psSlave_->bPointerSet)
+  {
+    psSlave_->u8Pointer = u8Byte_;
+    psSlave_->bPointerSet = TRUE;
+    return;
+  }
+
+  u8Register = psSlave_->u8Pointer++;
+  psSlave_->au8Registers[u8Register] = u8Byte_;
+
+  /* A new accelerometer rate restarts its samples (and data ready) */
+  if(u8Register == U8_SIM_LSM6DSL_CTRL1_XL)
+  {
+    Sim_sLsm6dslInt1.u32XlRateMilliHz = Sim_au32Lsm6dslRatesMilliHz[(u8Byte_ >> 4) & 0x0F];
+    Sim_sLsm6dslInt1.u64XlStartNs = G_u64SimTimeNs;
+    Sim_sLsm6dslInt1.u64XlSamplesRead = 0;
+  }
+
+  /* Any FIFO_CTRL5 write empties the FIFO; modes other than bypass start it again */
+  if(u8Register == U8_SIM_LSM6DSL_FIFO_CTRL5)
+  {
+    psFifo->u32RateMilliHz = Sim_au32Lsm6dslRatesMilliHz[(u8Byte_ >> 3) & 0x0F];
+    psFifo->bRunning = ((u8Byte_ & 0x07) != 0) && (psFifo->u32RateMilliHz != 0);
+    psFifo->u64StartNs = G_u64SimTimeNs;
+    psFifo->u64Words = 0;
+    psFifo->u64WordsRead = 0;
+    psFifo->bOverrun = FALSE;
+  }
+
+} /* end SimLsm6dslWrite() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u8 SimLsm6dslRead(SimTwiSlaveType* psSlave_)
+
+@brief Register-file read for the LSM6DSL with the FIFO status and data registers.
+*/
+static u8 SimLsm6dslRead(SimTwiSlaveType* psSlave_)
+{
+  SimLsm6dslFifoType* psFifo = &Sim_sLsm6dslFifo;
+  u8 u8Register = psSlave_->u8Pointer++;
+  u32 u32Unread;
+  u32 u32Watermark;
+  u64 u64Sample;
+  s16 s16Word;
+
+  /* Reading the accelerometer outputs clears data ready */
+  if( (u8Register >= U8_SIM_LSM6DSL_OUTX_L_XL) && (u8Register <= U8_SIM_LSM6DSL_OUTZ_H_XL) &&
+      (Sim_sLsm6dslInt1.u32XlRateMilliHz != 0) )
+  {
+    Sim_sLsm6dslInt1.u64XlSamplesRead = SimLsm6dslXlSamples(G_u64SimTimeNs);
+  }
+
+  if( (u8Register < U8_SIM_LSM6DSL_FIFO_STATUS1) || (u8Register > U8_SIM_LSM6DSL_FIFO_DATA_H) )
+  {
+    return(psSlave_->au8Registers[u8Register]);
+  }
+
+  SimLsm6dslFifoFill();
+  u32Unread = (u32)(psFifo->u64Words - psFifo->u64WordsRead);
+
+  /* The status registers are latched together when FIFO_STATUS1 is read */
+  if(u8Register == U8_SIM_LSM6DSL_FIFO_STATUS1)
+  {
+    u32Watermark = psSlave_->au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL1] | 
+                   ((u32)(psSlave_->au8Registers[U8_SIM_LSM6DSL_FIFO_CTRL2] & 0x07) << 8);
+    psFifo->au8Status[0] = (u8)(u32Unread & 0xFF);
+    psFifo->au8Status[1] = (u8)((u32Unread >> 8) & 0x07);
+    if( (u32Watermark != 0) && (u32Unread >= u32Watermark) )
+    {
+      psFifo->au8Status[1] |= 0x80;
+    }
+    if(psFifo->bOverrun)
+    {
+      psFifo->au8Status[1] |= 0x40;
+      psFifo->bOverrun = FALSE;
+    }
+    if(u32Unread == 0)
+    {
+      psFifo->au8Status[1] |= 0x10;
+    }
+    psFifo->au8Status[2] = (u8)((psFifo->u64WordsRead % U8_SIM_LSM6DSL_SAMPLE_WORDS) & 0xFF);
+    psFifo->au8Status[3] = 0;
+  }
+
+  if(u8Register <= U8_SIM_LSM6DSL_FIFO_STATUS4)
+  {
+    return(psFifo->au8Status[u8Register - U8_SIM_LSM6DSL_FIFO_STATUS1]);
+  }
+
+  /* FIFO_DATA_OUT: an empty FIFO reads as 0 */
+  if(u32Unread == 0)
+  {
+    psSlave_->u8Pointer = (u8Register == U8_SIM_LSM6DSL_FIFO_DATA_H) ? U8_SIM_LSM6DSL_FIFO_DATA_L : psSlave_->u8Pointer;
+    return(0);
+  }
+
+  u64Sample = psFifo->u64WordsRead / U8_SIM_LSM6DSL_SAMPLE_WORDS;
+  switch(psFifo->u64WordsRead % U8_SIM_LSM6DSL_SAMPLE_WORDS)
+  {
+    case 0:  s16Word = (s16)u64Sample;        break;
+    case 1:  s16Word = (s16)(u64Sample * 3);  break;
+    case 2:  s16Word = (s16)(0 - u64Sample);  break;
+    case 3:  s16Word = 100;                   break;
+    case 4:  s16Word = -100;                  break;
+    default: s16Word = 4096;                  break;
+  }
+
+  if(u8Register == U8_SIM_LSM6DSL_FIFO_DATA_L)
+  {
+    return((u8)((u16)s16Word & 0xFF));
+  }
+
+  psFifo->u64WordsRead++;
+  psSlave_->u8Pointer = U8_SIM_LSM6DSL_FIFO_DATA_L;
+  return((u8)((u16)s16Word >> 8));
+
+} /* end SimLsm6dslRead() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiSnapshot(SimTwiType* psTwi_)
+
+@brief Remembers the PDC counters so the next firmware write can be detected.
+*/
+static void SimTwiSnapshot(SimTwiType* psTwi_)
+{
+  psTwi_->u32Tcr  = psTwi_->pRegisters->TWI_TCR;
+  psTwi_->u32Tncr = psTwi_->pRegisters->TWI_TNCR;
+  psTwi_->u32Rcr  = psTwi_->pRegisters->TWI_RCR;
+  psTwi_->u32Rncr = psTwi_->pRegisters->TWI_RNCR;
+
+} /* end SimTwiSnapshot() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiUpdateStatus(SimTwiType* psTwi_)
+
+@brief Rebuilds SR from the model state.
+*/
+static void SimTwiUpdateStatus(SimTwiType* psTwi_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+  u32 u32Sr = 0;
+
+  if(psTwi_->bTxComp)
+  {
+    u32Sr |= AT91C_TWI_TXCOMP_MASTER;
+  }
+  if(psTwi_->bRxReady)
+  {
+    u32Sr |= AT91C_TWI_RXRDY;
+  }
+  if(pRegs->TWI_THR == U32_SIM_THR_EMPTY)
+  {
+    u32Sr |= AT91C_TWI_TXRDY_MASTER;
+  }
+  if(psTwi_->bNack)
+  {
+    u32Sr |= AT91C_TWI_NACK_MASTER;
+  }
+  if(psTwi_->bEndRx)
+  {
+    u32Sr |= AT91C_TWI_ENDRX;
+  }
+  if(psTwi_->bEndTx)
+  {
+    u32Sr |= AT91C_TWI_ENDTX;
+  }
+  if( (pRegs->TWI_RCR == 0) && (pRegs->TWI_RNCR == 0) )
+  {
+    u32Sr |= AT91C_TWI_RXBUFF;
+  }
+  if( (pRegs->TWI_TCR == 0) && (pRegs->TWI_TNCR == 0) )
+  {
+    u32Sr |= AT91C_TWI_TXBUFE;
+  }
+
+  pRegs->TWI_SR = u32Sr;
+
+} /* end SimTwiUpdateStatus() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimTwiFetchTx(SimTwiType* psTwi_)
+
+@brief Takes the next byte to write from THR or the PDC.  Returns FALSE if there is none.
+*/
+static bool SimTwiFetchTx(SimTwiType* psTwi_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+
+  if(pRegs->TWI_THR != U32_SIM_THR_EMPTY)
+  {
+    psTwi_->u8TxShift = (u8)pRegs->TWI_THR;
+    pRegs->TWI_THR = U32_SIM_THR_EMPTY;
+    return(TRUE);
+  }
+
+  if( (pRegs->TWI_PTSR & AT91C_PDC_TXTEN) && (pRegs->TWI_TCR != 0) )
+  {
+    psTwi_->u8TxShift = *(u8*)(uintptr_t)pRegs->TWI_TPR;
+    pRegs->TWI_TPR++;
+    pRegs->TWI_TCR--;
+    if(pRegs->TWI_TCR == 0)
+    {
+      psTwi_->bEndTx = TRUE;
+      if(pRegs->TWI_TNCR != 0)
+      {
+        pRegs->TWI_TPR  = pRegs->TWI_TNPR;
+        pRegs->TWI_TCR  = pRegs->TWI_TNCR;
+        pRegs->TWI_TNCR = 0;
+        psTwi_->bEndTx = FALSE;
+      }
+    }
+    return(TRUE);
+  }
+
+  return(FALSE);
+
+} /* end SimTwiFetchTx() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimTwiTxAvailable(SimTwiType* psTwi_)
+
+@brief TRUE if THR or the PDC has data to write.
+*/
+static bool SimTwiTxAvailable(SimTwiType* psTwi_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+
+  return( (pRegs->TWI_THR != U32_SIM_THR_EMPTY) ||
+          ((pRegs->TWI_PTSR & AT91C_PDC_TXTEN) && (pRegs->TWI_TCR != 0)) );
+
+} /* end SimTwiTxAvailable() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiStoreRx(SimTwiType* psTwi_, u8 u8Byte_)
+
+@brief A read byte goes to the PDC buffer if one is armed, otherwise to RHR.
+*/
+static void SimTwiStoreRx(SimTwiType* psTwi_, u8 u8Byte_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+
+  psTwi_->u32BytesRead++;
+  if( (pRegs->TWI_PTSR & AT91C_PDC_RXTEN) && (pRegs->TWI_RCR != 0) )
+  {
+    *(u8*)(uintptr_t)pRegs->TWI_RPR = u8Byte_;
+    pRegs->TWI_RPR++;
+    pRegs->TWI_RCR--;
+    if(pRegs->TWI_RCR == 0)
+    {
+      psTwi_->bEndRx = TRUE;
+      if(pRegs->TWI_RNCR != 0)
+      {
+        pRegs->TWI_RPR  = pRegs->TWI_RNPR;
+        pRegs->TWI_RCR  = pRegs->TWI_RNCR;
+        pRegs->TWI_RNCR = 0;
+        psTwi_->bEndRx = FALSE;
+      }
+    }
+    return;
+  }
+
+  pRegs->TWI_RHR = u8Byte_;
+  psTwi_->bRxReady = TRUE;
+
+} /* end SimTwiStoreRx() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiFinish(SimTwiType* psTwi_)
+
+@brief Sends STOP and completes the transfer.
+*/
+static void SimTwiFinish(SimTwiType* psTwi_)
+{
+  psTwi_->eState = SIM_TWI_IDLE;
+  psTwi_->bStopPending = FALSE;
+  psTwi_->bTxComp = TRUE;
+  psTwi_->u32Transactions++;
+
+} /* end SimTwiFinish() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiStart(SimTwiType* psTwi_, SimTimeType u64StartNs_)
+
+@brief Starts a new transfer (or continues a held write) if the firmware has asked for one.
+*/
+static void SimTwiStart(SimTwiType* psTwi_, SimTimeType u64StartNs_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+  SimTimeType u64ByteNs = SimTwiByteTimeNs(psTwi_);
+  u32 u32InternalBytes;
+
+  if(!psTwi_->bMasterEnabled)
+  {
+    return;
+  }
+
+  /* Read: START with MREAD (a repeated start when the bus is held) */
+  if(psTwi_->bStartPending && (pRegs->TWI_MMR & AT91C_TWI_MREAD))
+  {
+    u32InternalBytes = (pRegs->TWI_MMR & AT91C_TWI_IADRSZ) >> 8;
+    psTwi_->bStartPending = FALSE;
+    psTwi_->bReading = TRUE;
+    psTwi_->bTxComp = FALSE;
+    psTwi_->bRxReady = FALSE;
+    psTwi_->eState = SIM_TWI_ADDRESS;
+
+    /* Address, internal address bytes, then the repeated-start read address */
+    psTwi_->u64PhaseDoneNs = u64StartNs_ + (1 + u32InternalBytes + (u32InternalBytes ? 1 : 0)) * u64ByteNs;
+    return;
+  }
+
+  /* Write: any data in THR or the PDC */
+  if(SimTwiTxAvailable(psTwi_) && !(pRegs->TWI_MMR & AT91C_TWI_MREAD))
+  {
+    psTwi_->bStartPending = FALSE;
+    psTwi_->bReading = FALSE;
+    psTwi_->bTxComp = FALSE;
+
+    if( (psTwi_->eState == SIM_TWI_HOLD) && (psTwi_->psSlave != NULL) )
+    {
+      (void)SimTwiFetchTx(psTwi_);
+      psTwi_->eState = SIM_TWI_WRITING;
+      psTwi_->u64PhaseDoneNs = u64StartNs_ + u64ByteNs;
+      return;
+    }
+
+    psTwi_->bRxReady = FALSE;
+    psTwi_->eState = SIM_TWI_ADDRESS;
+    psTwi_->u64PhaseDoneNs = u64StartNs_ + u64ByteNs;
+    return;
+  }
+
+  /* STOP with nothing left to send releases a held bus */
+  if( (psTwi_->eState == SIM_TWI_HOLD) && psTwi_->bStopPending )
+  {
+    SimTwiFinish(psTwi_);
+  }
+
+} /* end SimTwiStart() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiPhaseDone(SimTwiType* psTwi_)
+
+@brief Handles the end of an address or data phase.
+*/
+static void SimTwiPhaseDone(SimTwiType* psTwi_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+  SimTimeType u64Done = psTwi_->u64PhaseDoneNs;
+  SimTimeType u64ByteNs = SimTwiByteTimeNs(psTwi_);
+
+  switch(psTwi_->eState)
+  {
+    case SIM_TWI_ADDRESS:
+      psTwi_->psSlave = SimTwiFindSlave((u8)((pRegs->TWI_MMR & AT91C_TWI_DADR) >> 16));
+      if(psTwi_->psSlave == NULL)
+      {
+        psTwi_->bNack = TRUE;
+        psTwi_->u32Nacks++;
+        SimTwiFinish(psTwi_);
+        break;
+      }
+
+      if(psTwi_->bReading)
+      {
+        if(pRegs->TWI_MMR & AT91C_TWI_IADRSZ)
+        {
+          psTwi_->psSlave->u8Pointer = (u8)pRegs->TWI_IADR;
+          psTwi_->psSlave->bPointerSet = TRUE;
+        }
+        psTwi_->eState = SIM_TWI_READING;
+        psTwi_->u64PhaseDoneNs = u64Done + u64ByteNs;
+        break;
+      }
+
+      /* A new write addresses the device from scratch */
+      psTwi_->psSlave->bPointerSet = FALSE;
+      if(SimTwiFetchTx(psTwi_))
+      {
+        psTwi_->eState = SIM_TWI_WRITING;
+        psTwi_->u64PhaseDoneNs = u64Done + u64ByteNs;
+      }
+      else
+      {
+        psTwi_->eState = SIM_TWI_HOLD;
+      }
+      break;
+
+    case SIM_TWI_WRITING:
+      psTwi_->u32BytesWritten++;
+      SimTwiSlaveWrite(psTwi_->psSlave, psTwi_->u8TxShift);
+      if(SimTwiFetchTx(psTwi_))
+      {
+        psTwi_->u64PhaseDoneNs = u64Done + u64ByteNs;
+      }
+      else if(psTwi_->bStopPending)
+      {
+        SimTwiFinish(psTwi_);
+      }
+      else
+      {
+        psTwi_->eState = SIM_TWI_HOLD;
+      }
+      break;
+
+    case SIM_TWI_READING:
+    {
+      bool bLast = psTwi_->bStopPending;
+      bool bToPdc = ( (pRegs->TWI_PTSR & AT91C_PDC_RXTEN) && (pRegs->TWI_RCR != 0) ) ? TRUE : FALSE;
+
+      SimTwiStoreRx(psTwi_, SimTwiSlaveRead(psTwi_->psSlave));
+      if(bLast)
+      {
+        SimTwiFinish(psTwi_);
+      }
+      else if(bToPdc || !psTwi_->bRxReady)
+      {
+        psTwi_->u64PhaseDoneNs = u64Done + u64ByteNs;
+      }
+      else
+      {
+        /* RHR is full and nothing told the master to stop: the clock is stretched */
+        psTwi_->eState = SIM_TWI_HOLD;
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+} /* end SimTwiPhaseDone() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimTwiSyncOne(SimTwiType* psTwi_)
+
+@brief Consumes the write-only registers of one TWI.
+*/
+static void SimTwiSyncOne(SimTwiType* psTwi_)
+{
+  AT91PS_TWI pRegs = psTwi_->pRegisters;
+  u32 u32Value;
+
+  u32Value = pRegs->TWI_CR;
+  if(u32Value)
+  {
+    pRegs->TWI_CR = 0;
+    if(u32Value & AT91C_TWI_SWRST)
+    {
+      psTwi_->eState = SIM_TWI_IDLE;
+      psTwi_->bStartPending = FALSE;
+      psTwi_->bStopPending = FALSE;
+      psTwi_->bRxReady = FALSE;
+      psTwi_->bNack = FALSE;
+      psTwi_->bTxComp = TRUE;
+      pRegs->TWI_IMR = 0;
+      pRegs->TWI_THR = U32_SIM_THR_EMPTY;
+    }
+    if(u32Value & AT91C_TWI_MSEN)
+    {
+      psTwi_->bMasterEnabled = TRUE;
+    }
+    if(u32Value & AT91C_TWI_MSDIS)
+    {
+      psTwi_->bMasterEnabled = FALSE;
+    }
+    if(u32Value & AT91C_TWI_START)
+    {
+      psTwi_->bStartPending = TRUE;
+    }
+    if(u32Value & AT91C_TWI_STOP)
+    {
+      psTwi_->bStopPending = TRUE;
+    }
+  }
+
+  if(pRegs->TWI_IDR)
+  {
+    pRegs->TWI_IMR &= ~pRegs->TWI_IDR;
+    pRegs->TWI_IDR = 0;
+  }
+  if(pRegs->TWI_IER)
+  {
+    pRegs->TWI_IMR |= pRegs->TWI_IER;
+    pRegs->TWI_IER = 0;
+  }
+
+  u32Value = pRegs->TWI_PTCR;
+  if(u32Value)
+  {
+    pRegs->TWI_PTCR = 0;
+    if(u32Value & AT91C_PDC_RXTEN)
+    {
+      pRegs->TWI_PTSR |= AT91C_PDC_RXTEN;
+    }
+    if(u32Value & AT91C_PDC_RXTDIS)
+    {
+      pRegs->TWI_PTSR &= ~AT91C_PDC_RXTEN;
+    }
+    if(u32Value & AT91C_PDC_TXTEN)
+    {
+      pRegs->TWI_PTSR |= AT91C_PDC_TXTEN;
+    }
+    if(u32Value & AT91C_PDC_TXTDIS)
+    {
+      pRegs->TWI_PTSR &= ~AT91C_PDC_TXTEN;
+    }
+  }
+
+  if( (pRegs->TWI_TCR != psTwi_->u32Tcr) || (pRegs->TWI_TNCR != psTwi_->u32Tncr) )
+  {
+    if( (pRegs->TWI_TCR == 0) && (pRegs->TWI_TNCR != 0) )
+    {
+      pRegs->TWI_TPR  = pRegs->TWI_TNPR;
+      pRegs->TWI_TCR  = pRegs->TWI_TNCR;
+      pRegs->TWI_TNCR = 0;
+    }
+    psTwi_->bEndTx = (pRegs->TWI_TCR == 0) ? TRUE : FALSE;
+  }
+
+  if( (pRegs->TWI_RCR != psTwi_->u32Rcr) || (pRegs->TWI_RNCR != psTwi_->u32Rncr) )
+  {
+    if( (pRegs->TWI_RCR == 0) && (pRegs->TWI_RNCR != 0) )
+    {
+      pRegs->TWI_RPR  = pRegs->TWI_RNPR;
+      pRegs->TWI_RCR  = pRegs->TWI_RNCR;
+      pRegs->TWI_RNCR = 0;
+    }
+    psTwi_->bEndRx = (pRegs->TWI_RCR == 0) ? TRUE : FALSE;
+  }
+
+  if( (psTwi_->eState == SIM_TWI_IDLE) || (psTwi_->eState == SIM_TWI_HOLD) )
+  {
+    SimTwiStart(psTwi_, G_u64SimTimeNs);
+  }
+
+  SimTwiSnapshot(psTwi_);
+  SimTwiUpdateStatus(psTwi_);
+
+} /* end SimTwiSyncOne() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn bool SimTwiAttachSlave(SimTwiSlaveType* psSlave_)
+
+@brief Puts a simulated device on the bus (shared by TWI0 and TWI1).
+
+Requires:
+@param psSlave_ points to a device that stays valid for the whole simulation
+
+Promises:
+- Returns TRUE if the device was added; FALSE if the table is full or the address is taken
+*/
+bool SimTwiAttachSlave(SimTwiSlaveType* psSlave_)
+{
+  if(SimTwiFindSlave(psSlave_->u8Address) != NULL)
+  {
+    return(FALSE);
+  }
+
+  for(u8 i = 0; i < U8_SIM_MAX_TWI_SLAVES; i++)
+  {
+    if(Sim_apsTwiSlaves[i] == NULL)
+    {
+      Sim_apsTwiSlaves[i] = psSlave_;
+      return(TRUE);
+    }
+  }
+
+  return(FALSE);
+
+} /* end SimTwiAttachSlave() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn SimTwiSlaveType* SimTwiFindSlave(u8 u8Address_)
+
+@brief Returns the device at a 7-bit address or NULL.
+*/
+SimTwiSlaveType* SimTwiFindSlave(u8 u8Address_)
+{
+  for(u8 i = 0; i < U8_SIM_MAX_TWI_SLAVES; i++)
+  {
+    if( (Sim_apsTwiSlaves[i] != NULL) && (Sim_apsTwiSlaves[i]->u8Address == u8Address_) )
+    {
+      return(Sim_apsTwiSlaves[i]);
+    }
+  }
+
+  return(NULL);
+
+} /* end SimTwiFindSlave() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimTwiInitialize(void)
+
+@brief Loads reset values and attaches the default devices.
+*/
+void SimTwiInitialize(void)
+{
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    Sim_asTwis[i].pRegisters->TWI_THR = U32_SIM_THR_EMPTY;
+    Sim_asTwis[i].bTxComp = TRUE;
+    Sim_asTwis[i].bEndTx = TRUE;
+    Sim_asTwis[i].bEndRx = TRUE;
+    SimTwiSnapshot(&Sim_asTwis[i]);
+    SimTwiUpdateStatus(&Sim_asTwis[i]);
+  }
+
+  Sim_sLsm6dsl.pfnWrite = SimLsm6dslWrite;
+  Sim_sLsm6dsl.pfnRead = SimLsm6dslRead;
+  (void)SimTwiAttachSlave(&Sim_sLcd);
+  (void)SimTwiAttachSlave(&Sim_sLsm6dsl);
+
+  /* INT1 is push-pull and low until something is routed to it */
+  SimPioSetInput(AT91C_BASE_PIOA, U32_SIM_LSM6DSL_INT1_PIN, FALSE);
+
+} /* end SimTwiInitialize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimTwiSync(void)
+
+@brief Picks up register writes made by the firmware.
+*/
+void SimTwiSync(void)
+{
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    SimTwiSyncOne(&Sim_asTwis[i]);
+  }
+
+} /* end SimTwiSync() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimTwiUpdate(SimTimeType u64Now_)
+
+@brief Completes every bus phase that is due by u64Now_ and updates the LSM6DSL INT1 pin.
+*/
+void SimTwiUpdate(SimTimeType u64Now_)
+{
+  SimTwiType* psTwi;
+  SimTimeType u64Done;
+
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    psTwi = &Sim_asTwis[i];
+
+    while( (psTwi->eState == SIM_TWI_ADDRESS || psTwi->eState == SIM_TWI_WRITING ||
+            psTwi->eState == SIM_TWI_READING) && (psTwi->u64PhaseDoneNs <= u64Now_) )
+    {
+      u64Done = psTwi->u64PhaseDoneNs;
+      SimTwiPhaseDone(psTwi);
+
+      if( (psTwi->eState == SIM_TWI_IDLE) || (psTwi->eState == SIM_TWI_HOLD) )
+      {
+        SimTwiStart(psTwi, u64Done);
+      }
+    }
+
+    SimTwiSnapshot(psTwi);
+    SimTwiUpdateStatus(psTwi);
+  }
+
+  SimLsm6dslInt1Update();
+
+} /* end SimTwiUpdate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn SimTimeType SimTwiNextEvent(void)
+
+@brief Returns when the next bus phase finishes on any TWI or the LSM6DSL INT1 pin rises.
+*/
+SimTimeType SimTwiNextEvent(void)
+{
+  SimTimeType u64Next = SimLsm6dslInt1NextEvent();
+
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    if( (Sim_asTwis[i].eState == SIM_TWI_ADDRESS || Sim_asTwis[i].eState == SIM_TWI_WRITING ||
+         Sim_asTwis[i].eState == SIM_TWI_READING) && (Sim_asTwis[i].u64PhaseDoneNs < u64Next) )
+    {
+      u64Next = Sim_asTwis[i].u64PhaseDoneNs;
+    }
+  }
+
+  return(u64Next);
+
+} /* end SimTwiNextEvent() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 SimTwiPendingIrqs(void)
+
+@brief Returns a peripheral ID bit for every TWI with an enabled status bit set.
+*/
+u32 SimTwiPendingIrqs(void)
+{
+  u32 u32Pending = 0;
+
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    if(Sim_asTwis[i].pRegisters->TWI_SR & Sim_asTwis[i].pRegisters->TWI_IMR)
+    {
+      u32Pending |= (1u << Sim_asTwis[i].u8PeripheralId);
+    }
+  }
+
+  return(u32Pending);
+
+} /* end SimTwiPendingIrqs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimTwiIrqServiced(u8 u8PeripheralId_)
+
+@brief The ISR read SR, which clears NACK.
+*/
+void SimTwiIrqServiced(u8 u8PeripheralId_)
+{
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    if(Sim_asTwis[i].u8PeripheralId == u8PeripheralId_)
+    {
+      Sim_asTwis[i].bNack = FALSE;
+      SimTwiUpdateStatus(&Sim_asTwis[i]);
+    }
+  }
+
+} /* end SimTwiIrqServiced() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimTwiReport(void)
+
+@brief Prints bus and device statistics.
+*/
+void SimTwiReport(void)
+{
+  SimTwiType* psTwi;
+
+  for(u8 i = 0; i < U8_SIM_TWIS; i++)
+  {
+    psTwi = &Sim_asTwis[i];
+    if(psTwi->u32Transactions != 0)
+    {
+      fprintf(stderr, "sim: %-4s %u transfers, %u NACKs, %u bytes written, %u bytes read\n",
+              psTwi->pcName, psTwi->u32Transactions, psTwi->u32Nacks,
+              psTwi->u32BytesWritten, psTwi->u32BytesRead);
+    }
+  }
+
+  for(u8 i = 0; i < U8_SIM_MAX_TWI_SLAVES; i++)
+  {
+    if( (Sim_apsTwiSlaves[i] != NULL) &&
+        (Sim_apsTwiSlaves[i]->u32BytesWritten || Sim_apsTwiSlaves[i]->u32BytesRead) )
+    {
+      fprintf(stderr, "sim:      0x%02X %-8s %u bytes written, %u bytes read\n",
+              Sim_apsTwiSlaves[i]->u8Address, Sim_apsTwiSlaves[i]->pcName,
+              Sim_apsTwiSlaves[i]->u32BytesWritten, Sim_apsTwiSlaves[i]->u32BytesRead);
+    }
+  }
+
+  if(Sim_sLsm6dslFifo.u64Words != 0)
+  {
+    SimLsm6dslFifoFill();
+    fprintf(stderr, "sim:      LSM6DSL FIFO %llu words stored, %llu read or overwritten, %u overruns\n",
+            Sim_sLsm6dslFifo.u64Words, Sim_sLsm6dslFifo.u64WordsRead,
+            Sim_sLsm6dslFifo.u32Overruns);
+  }
+
+  if(Sim_sLsm6dslInt1.u32RisingEdges != 0)
+  {
+    fprintf(stderr, "sim:      LSM6DSL INT1 %u rising edges\n", Sim_sLsm6dslInt1.u32RisingEdges);
+  }
+
+} /* end SimTwiReport() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
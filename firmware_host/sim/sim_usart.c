@@ -0,0 +1,956 @@
+/*!*********************************************************************************************************************
+@file sim_usart.c
+@brief Simulated USART0-3 and DBGU with their PDC channels.
+
+The DBGU register block is laid out like a USART (including the PDC at offset 0x100) so both are
+handled by the same model.  Byte timing comes from BRGR/MR: asynchronous frames use the
+configured character length, parity and stop bits with 16x (or 8x with OVER) oversampling and 
+the fractional divider (FP), and SPI master mode clocks 8 bits per byte at MCK / CD.  SPI slave mode has no clock source in the
+simulation so it never transfers.
+
+THR is parked at U32_SIM_THR_EMPTY so firmware writes can be told apart from an empty holding
+register.  PDC counter writes are detected by comparing against the values the model left behind,
+which is how ENDTX/ENDRX are cleared when a new buffer is loaded.
+
+The receiver time-out (US_RTOR) restarts with every received character and sets TIMEOUT once the
+line has been idle for TO bit periods.  STTTO clears TIMEOUT and stops the counter until the next
+character; RETTO clears TIMEOUT and restarts the counter at once.
+
+In hardware handshaking mode the USART raises RTS while the receiver is disabled or the receive 
+PDC has no buffer (RXBUFF), and injected bytes wait until RTS drops instead of overrunning.  The 
+transmitter only starts a character while CTS is low; CTS is low unless SimUsartSetCts() raises it.
+
+------------------------------------------------------------------------------------------------------------------------
+GLOBALS
+- NONE
+
+CONSTANTS
+- NONE
+
+TYPES
+- SimUsartType
+
+PUBLIC FUNCTIONS
+- void SimUsartInjectRx(u8 u8PeripheralId_, const u8* pu8Data_, u32 u32Size_)
+- u32 SimUsartRxRoom(u8 u8PeripheralId_)
+- void SimUsartSetTxSink(u8 u8PeripheralId_, SimByteSinkType pfnSink_)
+- void SimUsartSetSpiSource(u8 u8PeripheralId_, SimByteSourceType pfnSource_)
+- void SimUsartSetCts(u8 u8PeripheralId_, bool bHigh_)
+
+PROTECTED FUNCTIONS
+- void SimUsartInitialize(void)
+- void SimUsartSync(void)
+- void SimUsartUpdate(SimTimeType u64Now_)
+- SimTimeType SimUsartNextEvent(void)
+- u32 SimUsartPendingIrqs(void)
+- void SimUsartIrqServiced(u8 u8PeripheralId_)
+- void SimUsartReport(void)
+
+**********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Constants / Definitions
+***********************************************************************************************************************/
+/* US_MR USART_MODE values missing from AT91SAM3U4.h */
+#define U32_SIM_USMODE_SPI_MASTER     (u32)0x0000000E
+#define U32_SIM_USMODE_SPI_SLAVE      (u32)0x0000000F
+
+
+/***********************************************************************************************************************
+Type Definitions
+***********************************************************************************************************************/
+
+/*!
+@struct SimUsartType
+@brief State of one simulated USART/DBGU and its PDC channel.
+*/
+typedef struct
+{
+  AT91PS_USART pRegisters;                     /*!< @brief Register block (DBGU is cast to the USART layout) */
+  u8 u8PeripheralId;                           /*!< @brief AT91C_ID_xxx */
+  const char* pcName;                          /*!< @brief Name for statistics */
+  bool bTxEnabled;                             /*!< @brief TXEN/TXDIS state */
+  bool bRxEnabled;                             /*!< @brief RXEN/RXDIS state */
+  bool bTxActive;                              /*!< @brief A byte is in the shift register */
+  u8 u8TxShift;                                /*!< @brief Byte being shifted out */
+  SimTimeType u64TxDoneNs;                     /*!< @brief When the byte in the shift register is finished */
+  bool bEndTx;                                 /*!< @brief ENDTX latch */
+  bool bEndRx;                                 /*!< @brief ENDRX latch */
+  bool bRxReady;                               /*!< @brief RHR holds an unread byte */
+  bool bOverrun;                               /*!< @brief OVRE latch */
+  bool bRxTimeout;                             /*!< @brief TIMEOUT latch */
+  bool bCtsHigh;                               /*!< @brief CTS input is high (transmitter held off in handshaking mode) */
+  SimTimeType u64RxTimeoutNs;                  /*!< @brief When TIMEOUT sets if no character arrives (U64_SIM_NEVER = stopped) */
+  u32 u32Tcr;                                  /*!< @brief TCR as last left by the model */
+  u32 u32Tncr;                                 /*!< @brief TNCR as last left by the model */
+  u32 u32Rcr;                                  /*!< @brief RCR as last left by the model */
+  u32 u32Rncr;                                 /*!< @brief RNCR as last left by the model */
+  SimByteSinkType pfnTxSink;                   /*!< @brief Where transmitted bytes go (NULL = discarded) */
+  SimByteSourceType pfnSpiSource;              /*!< @brief SPI master: supplies MISO bytes (NULL = 0xFF) */
+  u8 au8RxFifo[U16_SIM_RX_FIFO_SIZE];          /*!< @brief Bytes waiting to arrive at the receiver */
+  u16 u16RxFifoHead;                           /*!< @brief Next byte to arrive */
+  u16 u16RxFifoCount;                          /*!< @brief Bytes in au8RxFifo */
+  SimTimeType u64RxNextNs;                     /*!< @brief When the next FIFO byte arrives */
+  u32 u32TxBytes;                              /*!< @brief Statistics */
+  u32 u32RxBytes;                              /*!< @brief Statistics */
+  u32 u32RxDropped;                            /*!< @brief Statistics: bytes lost because the FIFO was full or RX disabled */
+  u32 u32Overruns;                             /*!< @brief Statistics */
+  u32 u32RtsHolds;                             /*!< @brief Statistics: times a received byte had to wait for RTS */
+} SimUsartType;
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+***********************************************************************************************************************/
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern SimTimeType G_u64SimTimeNs;                     /*!< @brief From sim_core.c */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Sim_<type>" and be declared as static.
+***********************************************************************************************************************/
+static SimUsartType Sim_asUsarts[] =
+{
+  {.pRegisters = (AT91PS_USART)AT91C_BASE_DBGU, .u8PeripheralId = AT91C_ID_DBGU, .pcName = "DBGU"},
+  {.pRegisters = AT91C_BASE_US0, .u8PeripheralId = AT91C_ID_US0, .pcName = "US0"},
+  {.pRegisters = AT91C_BASE_US1, .u8PeripheralId = AT91C_ID_US1, .pcName = "US1"},
+  {.pRegisters = AT91C_BASE_US2, .u8PeripheralId = AT91C_ID_US2, .pcName = "US2"},
+  {.pRegisters = AT91C_BASE_US3, .u8PeripheralId = AT91C_ID_US3, .pcName = "US3"}
+};
+
+#define U8_SIM_USARTS  (u8)(sizeof(Sim_asUsarts) / sizeof(SimUsartType))
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @privatesection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimUsartType* SimUsartFind(u8 u8PeripheralId_)
+
+@brief Returns the model for a peripheral ID or NULL.
+*/
+static SimUsartType* SimUsartFind(u8 u8PeripheralId_)
+{
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    if(Sim_asUsarts[i].u8PeripheralId == u8PeripheralId_)
+    {
+      return(&Sim_asUsarts[i]);
+    }
+  }
+
+  return(NULL);
+
+} /* end SimUsartFind() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimUsartIsSpiMaster(SimUsartType* psUsart_)
+
+@brief TRUE if a USART (not DBGU) is configured as SPI master.
+*/
+static bool SimUsartIsSpiMaster(SimUsartType* psUsart_)
+{
+  return( (psUsart_->u8PeripheralId != AT91C_ID_DBGU) &&
+          ((psUsart_->pRegisters->US_MR & AT91C_US_USMODE) == U32_SIM_USMODE_SPI_MASTER) );
+
+} /* end SimUsartIsSpiMaster() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimUsartIsHandshaking(SimUsartType* psUsart_)
+
+@brief TRUE if a USART (not DBGU) is in hardware handshaking mode.
+*/
+static bool SimUsartIsHandshaking(SimUsartType* psUsart_)
+{
+  return( (psUsart_->u8PeripheralId != AT91C_ID_DBGU) &&
+          ((psUsart_->pRegisters->US_MR & AT91C_US_USMODE) == AT91C_US_USMODE_HWHSH) );
+
+} /* end SimUsartIsHandshaking() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static bool SimUsartRtsHigh(SimUsartType* psUsart_)
+
+@brief TRUE if the USART is telling the other end to stop sending.
+*/
+static bool SimUsartRtsHigh(SimUsartType* psUsart_)
+{
+  AT91PS_USART pRegs = psUsart_->pRegisters;
+
+  return( SimUsartIsHandshaking(psUsart_) &&
+          ( !psUsart_->bRxEnabled || ((pRegs->US_RCR == 0) && (pRegs->US_RNCR == 0)) ) );
+
+} /* end SimUsartRtsHigh() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static u32 SimUsartFrameBits(u32 u32Mr_)
+
+@brief Returns the bits in one asynchronous frame: start + data + parity + stop.
+*/
+static u32 SimUsartFrameBits(u32 u32Mr_)
+{
+  u32 u32Bits = 1 + 5 + ((u32Mr_ & AT91C_US_CHRL) >> 6);
+
+  if(u32Mr_ & AT91C_US_MODE9)
+  {
+    u32Bits = 1 + 9;
+  }
+  if( (u32Mr_ & AT91C_US_PAR) < AT91C_US_PAR_NONE )
+  {
+    u32Bits++;
+  }
+  u32Bits += ((u32Mr_ & AT91C_US_NBSTOP) == AT91C_US_NBSTOP_2_BIT) ? 2 : 1;
+
+  return(u32Bits);
+
+} /* end SimUsartFrameBits() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimUsartByteTimeNs(SimUsartType* psUsart_)
+
+@brief Returns the time to move one byte with the current BRGR/MR settings (U64_SIM_NEVER if not clocked).
+*/
+static SimTimeType SimUsartByteTimeNs(SimUsartType* psUsart_)
+{
+  u32 u32Mr = psUsart_->pRegisters->US_MR;
+  u32 u32Cd = psUsart_->pRegisters->US_BRGR & 0xFFFF;
+  u32 u32Eighths = 8 * u32Cd;
+  u32 u32Bits = 10;
+  u32 u32Oversampling = 16;
+
+  if(u32Cd == 0)
+  {
+    return(U64_SIM_NEVER);
+  }
+
+  if(psUsart_->u8PeripheralId != AT91C_ID_DBGU)
+  {
+    switch(u32Mr & AT91C_US_USMODE)
+    {
+      case U32_SIM_USMODE_SPI_MASTER:
+        return( (SimTimeType)8 * u32Cd * 1000000000ULL / U32_SIM_MCK_HZ );
+
+      case U32_SIM_USMODE_SPI_SLAVE:
+        return(U64_SIM_NEVER);
+
+      default:
+        u32Bits = SimUsartFrameBits(u32Mr);
+        u32Eighths += (psUsart_->pRegisters->US_BRGR >> 16) & 0x7;
+        if(u32Mr & AT91C_US_OVER)
+        {
+          u32Oversampling = 8;
+        }
+        break;
+    }
+  }
+
+  return( (SimTimeType)u32Bits * u32Oversampling * u32Eighths * 1000000000ULL / (8ULL * U32_SIM_MCK_HZ) );
+
+} /* end SimUsartByteTimeNs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static SimTimeType SimUsartRxTimeoutAt(SimUsartType* psUsart_, SimTimeType u64From_)
+
+@brief Returns when TIMEOUT sets if the line stays idle from u64From_ (U64_SIM_NEVER if RTOR is 0).
+*/
+static SimTimeType SimUsartRxTimeoutAt(SimUsartType* psUsart_, SimTimeType u64From_)
+{
+  u32 u32Periods = psUsart_->pRegisters->US_RTOR & 0xFFFF;
+  SimTimeType u64ByteNs;
+
+  /* The DBGU has no receiver time-out */
+  if( (psUsart_->u8PeripheralId == AT91C_ID_DBGU) || (u32Periods == 0) || SimUsartIsSpiMaster(psUsart_) )
+  {
+    return(U64_SIM_NEVER);
+  }
+
+  u64ByteNs = SimUsartByteTimeNs(psUsart_);
+  if(u64ByteNs == U64_SIM_NEVER)
+  {
+    return(U64_SIM_NEVER);
+  }
+
+  return( u64From_ + (u64ByteNs * u32Periods / SimUsartFrameBits(psUsart_->pRegisters->US_MR)) );
+
+} /* end SimUsartRxTimeoutAt() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartSnapshot(SimUsartType* psUsart_)
+
+@brief Remembers the PDC counters so the next firmware write can be detected.
+*/
+static void SimUsartSnapshot(SimUsartType* psUsart_)
+{
+  psUsart_->u32Tcr  = psUsart_->pRegisters->US_TCR;
+  psUsart_->u32Tncr = psUsart_->pRegisters->US_TNCR;
+  psUsart_->u32Rcr  = psUsart_->pRegisters->US_RCR;
+  psUsart_->u32Rncr = psUsart_->pRegisters->US_RNCR;
+
+} /* end SimUsartSnapshot() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartUpdateStatus(SimUsartType* psUsart_)
+
+@brief Rebuilds CSR from the model state.
+*/
+static void SimUsartUpdateStatus(SimUsartType* psUsart_)
+{
+  AT91PS_USART pRegs = psUsart_->pRegisters;
+  u32 u32Csr = 0;
+
+  if(psUsart_->bRxReady)
+  {
+    u32Csr |= AT91C_US_RXRDY;
+  }
+  if(pRegs->US_THR == U32_SIM_THR_EMPTY)
+  {
+    u32Csr |= AT91C_US_TXRDY;
+  }
+  if(psUsart_->bEndRx)
+  {
+    u32Csr |= AT91C_US_ENDRX;
+  }
+  if(psUsart_->bEndTx)
+  {
+    u32Csr |= AT91C_US_ENDTX;
+  }
+  if(psUsart_->bOverrun)
+  {
+    u32Csr |= AT91C_US_OVRE;
+  }
+  if(psUsart_->bRxTimeout)
+  {
+    u32Csr |= AT91C_US_TIMEOUT;
+  }
+  if(psUsart_->bCtsHigh)
+  {
+    u32Csr |= AT91C_US_CTS;
+  }
+  if( !psUsart_->bTxActive && (pRegs->US_THR == U32_SIM_THR_EMPTY) )
+  {
+    u32Csr |= AT91C_US_TXEMPTY;
+  }
+  if( (pRegs->US_TCR == 0) && (pRegs->US_TNCR == 0) )
+  {
+    u32Csr |= AT91C_US_TXBUFE;
+  }
+  if( (pRegs->US_RCR == 0) && (pRegs->US_RNCR == 0) )
+  {
+    u32Csr |= AT91C_US_RXBUFF;
+  }
+
+  pRegs->US_CSR = u32Csr;
+
+} /* end SimUsartUpdateStatus() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartReceive(SimUsartType* psUsart_, u8 u8Byte_)
+
+@brief A byte arrives at the receiver: into the PDC buffer if one is armed, otherwise into RHR.
+*/
+static void SimUsartReceive(SimUsartType* psUsart_, u8 u8Byte_)
+{
+  AT91PS_USART pRegs = psUsart_->pRegisters;
+
+  if(!psUsart_->bRxEnabled)
+  {
+    psUsart_->u32RxDropped++;
+    return;
+  }
+
+  psUsart_->u32RxBytes++;
+  if( (pRegs->US_PTSR & AT91C_PDC_RXTEN) && (pRegs->US_RCR != 0) )
+  {
+    *(u8*)(uintptr_t)pRegs->US_RPR = u8Byte_;
+    pRegs->US_RPR++;
+    pRegs->US_RCR--;
+    if(pRegs->US_RCR == 0)
+    {
+      /* ENDRX stays latched across the reload until the firmware writes RCR or RNCR */
+      psUsart_->bEndRx = TRUE;
+      if(pRegs->US_RNCR != 0)
+      {
+        pRegs->US_RPR  = pRegs->US_RNPR;
+        pRegs->US_RCR  = pRegs->US_RNCR;
+        pRegs->US_RNCR = 0;
+      }
+    }
+    return;
+  }
+
+  if(psUsart_->bRxReady)
+  {
+    psUsart_->bOverrun = TRUE;
+    psUsart_->u32Overruns++;
+  }
+  pRegs->US_RHR = u8Byte_;
+  psUsart_->bRxReady = TRUE;
+
+} /* end SimUsartReceive() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartStartTx(SimUsartType* psUsart_, SimTimeType u64StartNs_)
+
+@brief Loads the shift register from THR or the PDC if there is anything to send.
+*/
+static void SimUsartStartTx(SimUsartType* psUsart_, SimTimeType u64StartNs_)
+{
+  AT91PS_USART pRegs = psUsart_->pRegisters;
+  SimTimeType u64ByteNs;
+
+  if(psUsart_->bTxActive || !psUsart_->bTxEnabled)
+  {
+    return;
+  }
+
+  if(psUsart_->bCtsHigh && SimUsartIsHandshaking(psUsart_))
+  {
+    return;
+  }
+
+  u64ByteNs = SimUsartByteTimeNs(psUsart_);
+  if(u64ByteNs == U64_SIM_NEVER)
+  {
+    return;
+  }
+
+  if(pRegs->US_THR != U32_SIM_THR_EMPTY)
+  {
+    psUsart_->u8TxShift = (u8)pRegs->US_THR;
+    pRegs->US_THR = U32_SIM_THR_EMPTY;
+  }
+  else if( (pRegs->US_PTSR & AT91C_PDC_TXTEN) && (pRegs->US_TCR != 0) )
+  {
+    psUsart_->u8TxShift = *(u8*)(uintptr_t)pRegs->US_TPR;
+    pRegs->US_TPR++;
+    pRegs->US_TCR--;
+    if(pRegs->US_TCR == 0)
+    {
+      /* ENDTX stays latched across the reload until the firmware writes TCR or TNCR */
+      psUsart_->bEndTx = TRUE;
+      if(pRegs->US_TNCR != 0)
+      {
+        pRegs->US_TPR  = pRegs->US_TNPR;
+        pRegs->US_TCR  = pRegs->US_TNCR;
+        pRegs->US_TNCR = 0;
+      }
+    }
+  }
+  else
+  {
+    return;
+  }
+
+  psUsart_->bTxActive = TRUE;
+  psUsart_->u64TxDoneNs = u64StartNs_ + u64ByteNs;
+
+} /* end SimUsartStartTx() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartScheduleRx(SimUsartType* psUsart_)
+
+@brief Times the arrival of the next injected byte if there is one waiting and RTS lets it come.
+*/
+static void SimUsartScheduleRx(SimUsartType* psUsart_)
+{
+  SimTimeType u64ByteNs;
+
+  if( (psUsart_->u16RxFifoCount != 0) && (psUsart_->u64RxNextNs == U64_SIM_NEVER) && !SimUsartRtsHigh(psUsart_) )
+  {
+    u64ByteNs = SimUsartByteTimeNs(psUsart_);
+    if(u64ByteNs != U64_SIM_NEVER)
+    {
+      psUsart_->u64RxNextNs = G_u64SimTimeNs + u64ByteNs;
+    }
+  }
+
+} /* end SimUsartScheduleRx() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn static void SimUsartSyncOne(SimUsartType* psUsart_)
+
+@brief Consumes the write-only registers of one USART.
+*/
+static void SimUsartSyncOne(SimUsartType* psUsart_)
+{
+  AT91PS_USART pRegs = psUsart_->pRegisters;
+  u32 u32Value;
+
+  /* Control register */
+  u32Value = pRegs->US_CR;
+  if(u32Value)
+  {
+    pRegs->US_CR = 0;
+    if(u32Value & AT91C_US_RSTRX)
+    {
+      psUsart_->bRxReady = FALSE;
+    }
+    if(u32Value & AT91C_US_RSTTX)
+    {
+      psUsart_->bTxActive = FALSE;
+      pRegs->US_THR = U32_SIM_THR_EMPTY;
+    }
+    if(u32Value & AT91C_US_RSTSTA)
+    {
+      psUsart_->bOverrun = FALSE;
+    }
+    if(u32Value & AT91C_US_STTTO)
+    {
+      psUsart_->bRxTimeout = FALSE;
+      psUsart_->u64RxTimeoutNs = U64_SIM_NEVER;
+    }
+    if(u32Value & AT91C_US_RETTO)
+    {
+      psUsart_->bRxTimeout = FALSE;
+      psUsart_->u64RxTimeoutNs = SimUsartRxTimeoutAt(psUsart_, G_u64SimTimeNs);
+    }
+    if(u32Value & AT91C_US_RXEN)
+    {
+      psUsart_->bRxEnabled = TRUE;
+    }
+    if(u32Value & AT91C_US_RXDIS)
+    {
+      psUsart_->bRxEnabled = FALSE;
+    }
+    if(u32Value & AT91C_US_TXEN)
+    {
+      psUsart_->bTxEnabled = TRUE;
+    }
+    if(u32Value & AT91C_US_TXDIS)
+    {
+      psUsart_->bTxEnabled = FALSE;
+    }
+  }
+
+  /* Interrupt mask */
+  if(pRegs->US_IDR)
+  {
+    pRegs->US_IMR &= ~pRegs->US_IDR;
+    pRegs->US_IDR = 0;
+  }
+  if(pRegs->US_IER)
+  {
+    pRegs->US_IMR |= pRegs->US_IER;
+    pRegs->US_IER = 0;
+  }
+
+  /* PDC transfer control */
+  u32Value = pRegs->US_PTCR;
+  if(u32Value)
+  {
+    pRegs->US_PTCR = 0;
+    if(u32Value & AT91C_PDC_RXTEN)
+    {
+      pRegs->US_PTSR |= AT91C_PDC_RXTEN;
+    }
+    if(u32Value & AT91C_PDC_RXTDIS)
+    {
+      pRegs->US_PTSR &= ~AT91C_PDC_RXTEN;
+    }
+    if(u32Value & AT91C_PDC_TXTEN)
+    {
+      pRegs->US_PTSR |= AT91C_PDC_TXTEN;
+    }
+    if(u32Value & AT91C_PDC_TXTDIS)
+    {
+      pRegs->US_PTSR &= ~AT91C_PDC_TXTEN;
+    }
+  }
+
+  /* A counter write loads a new buffer and clears the end-of-transfer latch */
+  if( (pRegs->US_TCR != psUsart_->u32Tcr) || (pRegs->US_TNCR != psUsart_->u32Tncr) )
+  {
+    if( (pRegs->US_TCR == 0) && (pRegs->US_TNCR != 0) )
+    {
+      pRegs->US_TPR  = pRegs->US_TNPR;
+      pRegs->US_TCR  = pRegs->US_TNCR;
+      pRegs->US_TNCR = 0;
+    }
+    psUsart_->bEndTx = (pRegs->US_TCR == 0) ? TRUE : FALSE;
+  }
+
+  if( (pRegs->US_RCR != psUsart_->u32Rcr) || (pRegs->US_RNCR != psUsart_->u32Rncr) )
+  {
+    if( (pRegs->US_RCR == 0) && (pRegs->US_RNCR != 0) )
+    {
+      pRegs->US_RPR  = pRegs->US_RNPR;
+      pRegs->US_RCR  = pRegs->US_RNCR;
+      pRegs->US_RNCR = 0;
+    }
+    psUsart_->bEndRx = (pRegs->US_RCR == 0) ? TRUE : FALSE;
+  }
+
+  /* A byte parked in RHR moves to a newly armed PDC buffer */
+  if( psUsart_->bRxReady && (pRegs->US_PTSR & AT91C_PDC_RXTEN) && (pRegs->US_RCR != 0) )
+  {
+    psUsart_->bRxReady = FALSE;
+    psUsart_->u32RxBytes--;
+    SimUsartReceive(psUsart_, (u8)pRegs->US_RHR);
+  }
+
+  /* Bytes held back by RTS start coming again once a buffer is loaded */
+  SimUsartScheduleRx(psUsart_);
+  SimUsartStartTx(psUsart_, G_u64SimTimeNs);
+  SimUsartSnapshot(psUsart_);
+  SimUsartUpdateStatus(psUsart_);
+
+} /* end SimUsartSyncOne() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @publicsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartInjectRx(u8 u8PeripheralId_, const u8* pu8Data_, u32 u32Size_)
+
+@brief Queues bytes to arrive at a USART receiver at the configured baud rate.
+
+Requires:
+@param u8PeripheralId_ is AT91C_ID_DBGU or AT91C_ID_US0..3
+@param pu8Data_ points to the bytes
+@param u32Size_ is the number of bytes
+
+Promises:
+- Bytes that do not fit in the FIFO are dropped and counted
+*/
+void SimUsartInjectRx(u8 u8PeripheralId_, const u8* pu8Data_, u32 u32Size_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if(psUsart == NULL)
+  {
+    return;
+  }
+
+  for(u32 i = 0; i < u32Size_; i++)
+  {
+    if(psUsart->u16RxFifoCount == U16_SIM_RX_FIFO_SIZE)
+    {
+      psUsart->u32RxDropped += u32Size_ - i;
+      break;
+    }
+    psUsart->au8RxFifo[(psUsart->u16RxFifoHead + psUsart->u16RxFifoCount) % U16_SIM_RX_FIFO_SIZE] = pu8Data_[i];
+    psUsart->u16RxFifoCount++;
+  }
+
+  SimUsartScheduleRx(psUsart);
+
+} /* end SimUsartInjectRx() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 SimUsartRxRoom(u8 u8PeripheralId_)
+
+@brief Returns how many bytes SimUsartInjectRx() can take without dropping any.
+
+The console reads no more than this from the host so a fast writer is held off instead of losing
+bytes.
+
+Requires:
+@param u8PeripheralId_ is AT91C_ID_DBGU or AT91C_ID_US0..3
+
+Promises:
+- Returns the free space in the receive FIFO (0 for an unknown peripheral)
+*/
+u32 SimUsartRxRoom(u8 u8PeripheralId_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if(psUsart == NULL)
+  {
+    return(0);
+  }
+
+  return( (u32)(U16_SIM_RX_FIFO_SIZE - psUsart->u16RxFifoCount) );
+
+} /* end SimUsartRxRoom() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartSetTxSink(u8 u8PeripheralId_, SimByteSinkType pfnSink_)
+
+@brief Connects the transmitter of a USART to a host function.
+*/
+void SimUsartSetTxSink(u8 u8PeripheralId_, SimByteSinkType pfnSink_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if(psUsart != NULL)
+  {
+    psUsart->pfnTxSink = pfnSink_;
+  }
+
+} /* end SimUsartSetTxSink() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartSetSpiSource(u8 u8PeripheralId_, SimByteSourceType pfnSource_)
+
+@brief Connects a simulated SPI slave to a USART in SPI master mode.
+*/
+void SimUsartSetSpiSource(u8 u8PeripheralId_, SimByteSourceType pfnSource_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if(psUsart != NULL)
+  {
+    psUsart->pfnSpiSource = pfnSource_;
+  }
+
+} /* end SimUsartSetSpiSource() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartSetCts(u8 u8PeripheralId_, bool bHigh_)
+
+@brief Drives the CTS input of a USART; high holds off its transmitter in hardware handshaking mode.
+*/
+void SimUsartSetCts(u8 u8PeripheralId_, bool bHigh_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if(psUsart != NULL)
+  {
+    psUsart->bCtsHigh = bHigh_;
+    SimUsartStartTx(psUsart, G_u64SimTimeNs);
+    SimUsartUpdateStatus(psUsart);
+  }
+
+} /* end SimUsartSetCts() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/*! @protectedsection */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartInitialize(void)
+
+@brief Loads reset values.
+*/
+void SimUsartInitialize(void)
+{
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    Sim_asUsarts[i].pRegisters->US_THR = U32_SIM_THR_EMPTY;
+    Sim_asUsarts[i].u64RxNextNs = U64_SIM_NEVER;
+    Sim_asUsarts[i].u64RxTimeoutNs = U64_SIM_NEVER;
+    Sim_asUsarts[i].bEndTx = TRUE;
+    Sim_asUsarts[i].bEndRx = TRUE;
+    SimUsartSnapshot(&Sim_asUsarts[i]);
+    SimUsartUpdateStatus(&Sim_asUsarts[i]);
+  }
+
+} /* end SimUsartInitialize() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartSync(void)
+
+@brief Picks up register writes made by the firmware.
+*/
+void SimUsartSync(void)
+{
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    SimUsartSyncOne(&Sim_asUsarts[i]);
+  }
+
+} /* end SimUsartSync() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartUpdate(SimTimeType u64Now_)
+
+@brief Moves every byte that is due by u64Now_.
+*/
+void SimUsartUpdate(SimTimeType u64Now_)
+{
+  SimUsartType* psUsart;
+  SimTimeType u64Done;
+  SimTimeType u64ByteNs;
+
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    psUsart = &Sim_asUsarts[i];
+
+    /* Transmitter (and the MISO side in SPI master mode) */
+    while(psUsart->bTxActive && (psUsart->u64TxDoneNs <= u64Now_))
+    {
+      u64Done = psUsart->u64TxDoneNs;
+      psUsart->bTxActive = FALSE;
+      psUsart->u32TxBytes++;
+      if(psUsart->pfnTxSink != NULL)
+      {
+        psUsart->pfnTxSink(psUsart->u8TxShift);
+      }
+
+      if(SimUsartIsSpiMaster(psUsart) && psUsart->bRxEnabled)
+      {
+        SimUsartReceive(psUsart, (psUsart->pfnSpiSource != NULL) ? psUsart->pfnSpiSource(psUsart->u8TxShift) : 0xFF);
+      }
+
+      /* Back-to-back bytes keep the line busy with no gap */
+      SimUsartStartTx(psUsart, u64Done);
+    }
+
+    /* Injected receive data */
+    while( (psUsart->u16RxFifoCount != 0) && (psUsart->u64RxNextNs <= u64Now_) )
+    {
+      /* RTS went high: the other end stops until the firmware loads a buffer */
+      if(SimUsartRtsHigh(psUsart))
+      {
+        psUsart->u64RxNextNs = U64_SIM_NEVER;
+        psUsart->u32RtsHolds++;
+        break;
+      }
+
+      SimUsartReceive(psUsart, psUsart->au8RxFifo[psUsart->u16RxFifoHead]);
+      psUsart->u64RxTimeoutNs = SimUsartRxTimeoutAt(psUsart, psUsart->u64RxNextNs);
+      psUsart->u16RxFifoHead = (psUsart->u16RxFifoHead + 1) % U16_SIM_RX_FIFO_SIZE;
+      psUsart->u16RxFifoCount--;
+
+      u64ByteNs = SimUsartByteTimeNs(psUsart);
+      psUsart->u64RxNextNs = ( (psUsart->u16RxFifoCount != 0) && (u64ByteNs != U64_SIM_NEVER) ) ?
+                             (psUsart->u64RxNextNs + u64ByteNs) : U64_SIM_NEVER;
+    }
+
+    /* Receiver time-out */
+    if(psUsart->u64RxTimeoutNs <= u64Now_)
+    {
+      psUsart->bRxTimeout = TRUE;
+      psUsart->u64RxTimeoutNs = U64_SIM_NEVER;
+    }
+
+    SimUsartSnapshot(psUsart);
+    SimUsartUpdateStatus(psUsart);
+  }
+
+} /* end SimUsartUpdate() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn SimTimeType SimUsartNextEvent(void)
+
+@brief Returns when the next byte finishes or a receiver time-out expires on any USART.
+*/
+SimTimeType SimUsartNextEvent(void)
+{
+  SimTimeType u64Next = U64_SIM_NEVER;
+
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    if(Sim_asUsarts[i].bTxActive && (Sim_asUsarts[i].u64TxDoneNs < u64Next))
+    {
+      u64Next = Sim_asUsarts[i].u64TxDoneNs;
+    }
+    if(Sim_asUsarts[i].u64RxNextNs < u64Next)
+    {
+      u64Next = Sim_asUsarts[i].u64RxNextNs;
+    }
+    if(Sim_asUsarts[i].u64RxTimeoutNs < u64Next)
+    {
+      u64Next = Sim_asUsarts[i].u64RxTimeoutNs;
+    }
+  }
+
+  return(u64Next);
+
+} /* end SimUsartNextEvent() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn u32 SimUsartPendingIrqs(void)
+
+@brief Returns a peripheral ID bit for every USART with an enabled status bit set.
+*/
+u32 SimUsartPendingIrqs(void)
+{
+  u32 u32Pending = 0;
+
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    if(Sim_asUsarts[i].pRegisters->US_CSR & Sim_asUsarts[i].pRegisters->US_IMR)
+    {
+      u32Pending |= (1u << Sim_asUsarts[i].u8PeripheralId);
+    }
+  }
+
+  return(u32Pending);
+
+} /* end SimUsartPendingIrqs() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartIrqServiced(u8 u8PeripheralId_)
+
+@brief An ISR that runs on RXRDY reads RHR, which clears RXRDY.
+*/
+void SimUsartIrqServiced(u8 u8PeripheralId_)
+{
+  SimUsartType* psUsart = SimUsartFind(u8PeripheralId_);
+
+  if( (psUsart != NULL) && (psUsart->pRegisters->US_IMR & AT91C_US_RXRDY) )
+  {
+    psUsart->bRxReady = FALSE;
+    SimUsartUpdateStatus(psUsart);
+  }
+
+} /* end SimUsartIrqServiced() */
+
+
+/*!---------------------------------------------------------------------------------------------------------------------
+@fn void SimUsartReport(void)
+
+@brief Prints traffic statistics for every USART that was used.
+*/
+void SimUsartReport(void)
+{
+  SimUsartType* psUsart;
+
+  for(u8 i = 0; i < U8_SIM_USARTS; i++)
+  {
+    psUsart = &Sim_asUsarts[i];
+    if(psUsart->u32TxBytes || psUsart->u32RxBytes || psUsart->u32RxDropped)
+    {
+      fprintf(stderr, "sim: %-4s tx %u bytes, rx %u bytes, %u dropped, %u overruns\n",
+              psUsart->pcName, psUsart->u32TxBytes, psUsart->u32RxBytes,
+              psUsart->u32RxDropped, psUsart->u32Overruns);
+      if(psUsart->u32RtsHolds)
+      {
+        fprintf(stderr, "sim:      %u RTS holds\n", psUsart->u32RtsHolds);
+      }
+    }
+  }
+
+} /* end SimUsartReport() */
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+# Drives the debug console (see DebugSM_Idle() in debug.c) from a script to measure command latency
+# and console throughput, or to soak the line editor and command parser with random input.
+#
+#   $ python3 firmware_host/tools/console_bench.py --sim ./build/firmware-ascii-host latency --repeat 20
+#   $ python3 firmware_host/tools/console_bench.py --sim ./build/firmware-ascii-host throughput
+#   $ python3 firmware_host/tools/console_bench.py --sim ./build/firmware-ascii-host --fast soak --seconds 60
+#   $ python3 firmware_host/tools/console_bench.py --port /dev/ttyUSB0 latency
+#
+# --sim runs the host build with EIE_SIM_PTY=1, which puts the debug UART on a pseudo-terminal (see
+# sim.h). --fast also sets EIE_SIM_REALTIME=0 so simulated time runs as fast as the host can go:
+# the console then takes input much faster than a real 115200 baud link, which is what the soak
+# test wants. Times are host (wall clock) times.
+#
+# soak never sends en+c xfer, which would leave the console for the binary transfer mode. It exits
+# with status 1 if the console stops answering en+c00 or the simulated board dies.
+
+import argparse
+import os
+import random
+import re
+import select
+import subprocess
+import sys
+import time
+
+READY = b"Initialization complete"
+MENU = b"Available commands"
+CLEAR_LINE = b"\x15"
+BOOT_TIMEOUT = 30.0
+CHECK_TRIES = 3
+CHECK_TIMEOUT = 3.0
+
+# Key sequences the line editor understands (see DEBUG_KEY_* in debug.h)
+EDIT_KEYS = [b"\x01", b"\x02", b"\x04", b"\x05", b"\x06", b"\x0e", b"\x10", b"\x15", b"\x08", b"\x7f", b"\t",
+             b"\x1b[A", b"\x1b[B", b"\x1b[C", b"\x1b[D", b"\x1b[H", b"\x1b[F", b"\x1b[3~", b"\x1b[1~", b"\x1b[4~"]
+
+# Commands that are safe to run at random: they print and return to the console
+SOAK_COMMANDS = [b"list", b"ledtest", b"systime", b"msgstats"]
+
+
+class Console:
+    """The debug UART of a board on a serial port, or of a simulated board on its pty."""
+
+    def __init__(self, port: str | None, sim: str | None, fast: bool, baud: int):
+        import termios
+        import tty
+
+        self.process = None
+        if sim is not None:
+            env = dict(os.environ, EIE_SIM_PTY="1", EIE_SIM_STATS="1")
+            if fast:
+                env["EIE_SIM_REALTIME"] = "0"
+            self.process = subprocess.Popen([sim], stdin=subprocess.DEVNULL, stderr=subprocess.PIPE, env=env)
+            line = self.process.stderr.readline().decode(errors="replace")
+            match = re.search(r"debug UART on (\S+)", line)
+            if match is None:
+                self.process.kill()
+                sys.exit(f"console_bench: {sim} did not open a pty ({line.strip() or 'no output'})")
+            port = match.group(1)
+
+        self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        if self.process is None:
+            speed = getattr(termios, f"B{baud}", None)
+            if speed is None:
+                sys.exit(f"console_bench: {baud} baud is not a standard termios rate")
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.received = 0
+
+    def alive(self) -> bool:
+        return self.process is None or self.process.poll() is None
+
+    def read(self, timeout: float) -> bytes:
+        """Returns what arrives within timeout seconds (b"" if nothing)."""
+        if not select.select([self.fd], [], [], max(timeout, 0))[0]:
+            return b""
+        try:
+            data = os.read(self.fd, 65536)
+        except OSError:
+            data = b""
+        self.received += len(data)
+        return data
+
+    def write(self, data: bytes):
+        """Sends data, reading (and dropping) output meanwhile so neither side can stall the other."""
+        view = memoryview(data)
+        while view:
+            readable, writable, _ = select.select([self.fd], [self.fd], [], 1.0)
+            if readable:
+                self.read(0)
+            if writable:
+                view = view[os.write(self.fd, view[:256]):]
+            elif not self.alive():
+                raise ConnectionError("the board went away")
+
+    def expect(self, pattern: bytes, timeout: float) -> bytes | None:
+        """Returns everything up to and including pattern, or None if it did not show up in time."""
+        data = bytearray()
+        deadline = time.monotonic() + timeout
+        while pattern not in data:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0 or not self.alive():
+                return None
+            data += self.read(remaining)
+        return bytes(data)
+
+    def drain(self, quiet: float = 0.2):
+        """Reads until the line has been quiet for quiet seconds."""
+        while self.read(quiet):
+            pass
+
+    def close(self):
+        if self.process is not None:
+            self.process.terminate()
+            stats = self.process.communicate()[1]
+            sys.stderr.write(stats.decode(errors="replace"))
+        os.close(self.fd)
+
+
+def command_number(console: Console, name: bytes) -> bytes:
+    """Looks up the en+c number of a command in the list the board prints."""
+    console.write(CLEAR_LINE + b"en+c00\r")
+    listing = console.expect(name + b" ", 5.0)
+    match = listing and re.search(rb"(\d+): " + re.escape(name) + b" ", listing)
+    if match is None:
+        sys.exit(f"console_bench: the board has no {name.decode()} command")
+    console.drain()
+    return match.group(1)
+
+
+def summary(what: str, samples: list[float]) -> str:
+    return f"{what} min {min(samples) * 1000:.1f} ms, avg {sum(samples) / len(samples) * 1000:.1f} ms, max {max(samples) * 1000:.1f} ms"
+
+
+def latency(console: Console, command: bytes, repeat: int, quiet: float):
+    """Times the first byte back (the echo) and the last byte of the reply to each command."""
+    first, last = [], []
+    for _ in range(repeat):
+        console.drain(quiet)
+        start = time.monotonic()
+        os.write(console.fd, command + b"\r")
+        data = console.read(5.0)
+        if not data:
+            sys.exit("console_bench: no reply from the board")
+        first.append(time.monotonic() - start)
+        end = time.monotonic()
+        while console.read(quiet):
+            end = time.monotonic()
+        last.append(end - start)
+    print(f"console_bench: {command.decode()} x{repeat}")
+    print(f"console_bench: {summary('first byte', first)}")
+    print(f"console_bench: {summary('reply done', last)}")
+
+
+def throughput(console: Console, total: int, quiet: float):
+    """Measures how fast typed lines are echoed and how fast en+c uarttest output arrives."""
+    # Lines shorter than the command buffer so every character is taken and echoed
+    line = b"".join(bytes([random.randint(0x20, 0x7E)]) for _ in range(48)).replace(b"+", b"-")
+    block = line + CLEAR_LINE
+    console.drain(quiet)
+    console.received = 0
+    start = time.monotonic()
+    sent = 0
+    while sent < total:
+        console.write(block)
+        sent += len(block)
+    end = time.monotonic()
+    while console.read(quiet):
+        end = time.monotonic()
+    seconds = end - start
+    print(f"console_bench: typed {sent} bytes in {seconds:.3f} s = {sent / seconds:.0f} bytes/s, "
+          f"{console.received} bytes echoed = {console.received / seconds:.0f} bytes/s")
+
+    number = command_number(console, b"uarttest")
+    console.received = 0
+    start = time.monotonic()
+    console.write(b"en+c" + number + b"\r")
+    report = console.expect(b"bytes/s), failed ", 30.0)
+    if report is None:
+        sys.exit("console_bench: en+c uarttest did not finish")
+    seconds = time.monotonic() - start
+    result = console.expect(b"\n", 1.0) or b""
+    print(f"console_bench: uarttest {console.received} bytes in {seconds:.3f} s = {console.received / seconds:.0f} bytes/s")
+    text = (report + result).decode(errors="replace")
+    print("console_bench: board says " + text[text.rfind("UART test:"):].strip())
+
+
+def soak_input(rng: random.Random) -> bytes:
+    """One burst of random typing: text, edit keys, partial or whole commands, escape sequences."""
+    choice = rng.random()
+    if choice < 0.3:
+        return bytes(rng.randint(0x20, 0x7E) for _ in range(rng.randint(1, 80)))
+    if choice < 0.5:
+        return b"".join(rng.choice(EDIT_KEYS) for _ in range(rng.randint(1, 10)))
+    if choice < 0.65:
+        name = rng.choice(SOAK_COMMANDS)
+        return b"en+c" + name[:rng.randint(0, len(name))] + rng.choice([b"\t", b"\t\t", b"\r", b""])
+    if choice < 0.75:
+        return b"\x1b[" + str(rng.randint(0, 300)).encode() + bytes([rng.randint(0x40, 0x7E)])
+    if choice < 0.85:
+        return bytes([rng.randint(0x00, 0x1F)])
+    # Random lines end with Enter; ones that spell a command prefix are made harmless
+    text = bytes(rng.randint(0x20, 0x7E) for _ in range(rng.randint(0, 70)))
+    return text.replace(b"en+c", b"en-c") + b"\r"
+
+
+def console_answers(console: Console, quiet: float) -> bool:
+    """Checks that en+c00 still brings up the command list.
+
+    Random input makes the console print faster than the line runs, so the system output budget
+    can drop the list (see DebugOutputAllowed() in debug.c). A quiet spell resets the budget, so a
+    dropped list is tried again and only a console that never answers fails.
+    """
+    for _ in range(CHECK_TRIES):
+        console.drain(quiet)
+        # Enter on its own first: an unfinished escape sequence would swallow the Ctrl-U
+        console.write(b"\r" + CLEAR_LINE + b"en+c00\r")
+        if console.expect(MENU, CHECK_TIMEOUT) is not None:
+            return True
+    return False
+
+
+def soak(console: Console, seconds: float, check_every: float, seed: int, quiet: float) -> bool:
+    """Sends random input, checking now and then that the console still answers en+c00."""
+    rng = random.Random(seed)
+    start = time.monotonic()
+    next_check = start + check_every
+    sent = checks = 0
+    while time.monotonic() - start < seconds:
+        burst = soak_input(rng)
+        console.write(burst)
+        sent += len(burst)
+        if time.monotonic() >= next_check:
+            if not console_answers(console, quiet):
+                print(f"console_bench: no command list after {sent} bytes (seed {seed})", file=sys.stderr)
+                return False
+            checks += 1
+            next_check = time.monotonic() + check_every
+
+    ok = console_answers(console, quiet)
+    elapsed = time.monotonic() - start
+    print(f"console_bench: soak sent {sent} bytes in {elapsed:.1f} s = {sent / elapsed:.0f} bytes/s, "
+          f"{checks + ok} checks passed (seed {seed})")
+    if not ok:
+        print("console_bench: no command list at the end of the soak", file=sys.stderr)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark and soak-test the debug console.")
+    parser.add_argument("--port", help="serial port of the board")
+    parser.add_argument("--sim", metavar="EXE", help="run a host build with its debug UART on a pty")
+    parser.add_argument("--fast", action="store_true", help="with --sim, run simulated time as fast as possible")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port baud rate (default 115200)")
+    parser.add_argument("--quiet", type=float, default=0.2, help="seconds of silence that end a reply")
+    commands = parser.add_subparsers(dest="command", required=True)
+    timing = commands.add_parser("latency", help="time the reply to a command")
+    timing.add_argument("--cmd", default="en+c00", help="command to send (default en+c00)")
+    timing.add_argument("--repeat", type=int, default=10)
+    rate = commands.add_parser("throughput", help="measure echo and en+c uarttest rates")
+    rate.add_argument("--bytes", type=int, default=8192, help="bytes to type for the echo test")
+    random_input = commands.add_parser("soak", help="send random input and check the console survives")
+    random_input.add_argument("--seconds", type=float, default=30.0)
+    random_input.add_argument("--check", type=float, default=2.0, help="seconds between en+c00 checks")
+    random_input.add_argument("--seed", type=int, default=None, help="seed to repeat a run")
+    opts = parser.parse_args()
+
+    if (opts.port is None) == (opts.sim is None):
+        parser.error("give either --port or --sim")
+    if opts.fast and opts.sim is None:
+        parser.error("--fast only applies to --sim")
+
+    console = Console(opts.port, opts.sim, opts.fast, opts.baud)
+    ok = True
+    try:
+        if opts.sim is not None and console.expect(READY, BOOT_TIMEOUT) is None:
+            sys.exit("console_bench: the board did not finish initializing")
+        console.drain(opts.quiet)
+
+        if opts.command == "latency":
+            latency(console, opts.cmd.encode(), opts.repeat, opts.quiet)
+        elif opts.command == "throughput":
+            throughput(console, opts.bytes, opts.quiet)
+        else:
+            seed = opts.seed if opts.seed is not None else random.randrange(1 << 32)
+            ok = soak(console, opts.seconds, opts.check, seed, opts.quiet)
+    except (ConnectionError, KeyboardInterrupt) as error:
+        print(f"console_bench: {error or 'interrupted'}", file=sys.stderr)
+        ok = False
+    finally:
+        died = not console.alive()
+        console.close()
+    if died:
+        print("console_bench: the simulated board died", file=sys.stderr)
+    sys.exit(0 if ok and not died else 1)
+
+
+if __name__ == "__main__":
+    main()
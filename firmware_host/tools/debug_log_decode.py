@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+# Decodes the binary DebugLog() frames sent by the debug task after en+c logbin (see debug.c).
+#
+# Everything that is not a frame is passed through as it is, so normal DebugPrintf() text still
+# shows up. The format strings are read from Debug_apu8LogFormats[] in debug.c, so the tool always
+# matches the firmware it was checked out with.
+#
+#   $ python3 firmware_host/tools/debug_log_decode.py /dev/ttyUSB0
+#   $ ./build/firmware-ascii-host | python3 firmware_host/tools/debug_log_decode.py --time
+#
+# A frame is:
+#
+#   0xA5 | format ID | argument count | time (u16, little endian) | arguments
+#
+# and each argument is 7 bits per byte, least significant first, with bit 7 set on every byte but
+# the last.
+
+import argparse
+import os
+import pathlib
+import re
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_HEADER_SIZE = 5
+
+DEFAULT_SOURCE = pathlib.Path(__file__).resolve().parents[2] / "firmware_common/application/debug.c"
+
+C_ESCAPES = {"n": "\n", "r": "\r", "t": "\t", "\\": "\\", '"': '"', "'": "'", "0": "\0"}
+
+
+def read_formats(source: pathlib.Path) -> list[str]:
+    """Returns the log format strings from Debug_apu8LogFormats[] in format ID order."""
+    text = source.read_text(encoding="latin-1")
+    table = re.search(r"Debug_apu8LogFormats\[[^\]]*\]\s*=\s*\{(.*?)\};", text, re.S)
+    if table is None:
+        sys.exit(f"debug_log_decode: no Debug_apu8LogFormats[] table in {source}")
+
+    # Comments can hold quotes, so drop them before picking out the string literals
+    body = re.sub(r"/\*.*?\*/", "", table.group(1), flags=re.S)
+    literals = re.findall(r'"((?:[^"\\]|\\.)*)"', body)
+    return [re.sub(r"\\(.)", lambda m: C_ESCAPES.get(m.group(1), m.group(1)), s) for s in literals]
+
+
+def render(fmt: str, args: list[int]) -> str:
+    """Formats a record the same way DebugLogRender() does on the board."""
+    out = []
+    args = iter(args)
+    i = 0
+    while i < len(fmt):
+        if fmt[i] != "%":
+            out.append(fmt[i])
+            i += 1
+            continue
+
+        spec = re.match(r"%(0?)(\d*)(.?)", fmt[i:])
+        i += len(spec.group(0))
+        pad = "0" if spec.group(1) else " "
+        width = int(spec.group(2) or 0)
+        conv = spec.group(3)
+
+        sign = ""
+        if conv == "d":
+            value = next(args, 0) & 0xFFFFFFFF
+            if value & 0x80000000:
+                sign, value = "-", (1 << 32) - value
+            digits = str(value)
+        elif conv == "u":
+            digits = str(next(args, 0) & 0xFFFFFFFF)
+        elif conv == "x":
+            digits = format(next(args, 0) & 0xFFFFFFFF, "x")
+        elif conv == "c":
+            digits = chr(next(args, 0) & 0xFF)
+        else:
+            digits = conv
+
+        fill = pad * max(0, width - len(sign) - len(digits))
+        out.append(sign + fill + digits if pad == "0" else fill + sign + digits)
+    return "".join(out)
+
+
+class Decoder:
+    """Splits a byte stream into pass-through text and decoded log frames."""
+
+    def __init__(self, formats: list[str], show_time: bool):
+        self.formats = formats
+        self.show_time = show_time
+        self.frame = bytearray()
+        self.last_time = None
+        self.time_base = 0
+
+    def feed(self, data: bytes) -> str:
+        out = []
+        for byte in data:
+            if self.frame:
+                self.frame.append(byte)
+                text = self.try_frame()
+                if text is not None:
+                    out.append(text)
+            elif byte == FRAME_SYNC:
+                self.frame.append(byte)
+            else:
+                out.append(chr(byte))
+        return "".join(out)
+
+    def try_frame(self) -> str | None:
+        """Returns the text once the frame is complete (or found to be bad), None while it is not."""
+        frame = self.frame
+        if len(frame) < FRAME_HEADER_SIZE:
+            return None
+
+        format_id, count = frame[1], frame[2]
+        if format_id >= len(self.formats):
+            return self.bad_frame(f"unknown format {format_id}")
+
+        args = []
+        value = shift = 0
+        for byte in frame[FRAME_HEADER_SIZE:]:
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                args.append(value)
+                value = shift = 0
+            elif shift > 28:
+                return self.bad_frame("argument too long")
+        if len(args) < count:
+            return None
+
+        self.frame = bytearray()
+        text = render(self.formats[format_id], args)
+        if self.show_time:
+            text = f"[{self.unwrap_time(frame[3] | (frame[4] << 8)):>10} ms] {text}"
+        return text
+
+    def bad_frame(self, reason: str) -> str:
+        self.frame = bytearray()
+        return f"\n[debug_log_decode: dropped frame, {reason}]\n"
+
+    def unwrap_time(self, time16: int) -> int:
+        """Extends the 16-bit frame time, assuming frames are less than 32 s apart.
+
+        A small step back is not a wrap: the dropped records report can come out ahead of older
+        records still in the ring.
+        """
+        if self.last_time is not None and time16 + 0x8000 < self.last_time:
+            self.time_base += 1 << 16
+        self.last_time = time16
+        return self.time_base + time16
+
+
+def open_input(path: str, baud: int = 115200):
+    """Opens a capture file, or a serial port set to <baud>-8-N-1 raw (match DEBUG_UART_BAUD in debug.h)."""
+    if path == "-":
+        return sys.stdin.buffer
+
+    stream = open(path, "rb", buffering=0)
+    if os.isatty(stream.fileno()):
+        import termios
+        import tty
+
+        speed = getattr(termios, f"B{baud}", None)
+        if speed is None:
+            sys.exit(f"debug_log_decode: {baud} baud is not a standard termios rate")
+        tty.setraw(stream.fileno())
+        attrs = termios.tcgetattr(stream.fileno())
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(stream.fileno(), termios.TCSANOW, attrs)
+    return stream
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary DebugLog() frames from the debug UART.")
+    parser.add_argument("input", nargs="?", default="-", help="serial port or capture file (default stdin)")
+    parser.add_argument("--source", type=pathlib.Path, default=DEFAULT_SOURCE, help="debug.c to read formats from")
+    parser.add_argument("--time", action="store_true", help="prefix decoded records with their time in ms")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port baud rate (default 115200)")
+    opts = parser.parse_args()
+
+    decoder = Decoder(read_formats(opts.source), opts.time)
+    stream = open_input(opts.input, opts.baud)
+    read = getattr(stream, "read1", stream.read)
+    try:
+        while data := read(256):
+            sys.stdout.write(decoder.feed(data))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
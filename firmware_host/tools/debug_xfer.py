@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+# Moves blocks of memory to and from the board with the binary transfer mode of the debug task
+# (en+c xfer, see DebugSM_Transfer() in debug.c).
+#
+# The board only exposes the regions that tasks registered with DebugXferRegister(), by name:
+#
+#   $ python3 firmware_host/tools/debug_xfer.py --port /dev/ttyUSB0 list
+#   $ python3 firmware_host/tools/debug_xfer.py --port /dev/ttyUSB0 read log log.bin
+#   $ python3 firmware_host/tools/debug_xfer.py --port /dev/ttyUSB0 write scratch pattern.bin --offset 256
+#   $ python3 firmware_host/tools/debug_xfer.py --sim ./build/firmware-ascii-host selftest
+#
+# --sim runs the host build on a pseudo-terminal instead of opening a serial port. A frame in
+# either direction is:
+#
+#   0xA7 | type | sequence number | payload size | payload | CRC-16/CCITT (u16, little endian)
+#
+# The CRC covers everything after the sync byte. DATA frames are sent go-back-N: up to a window of
+# frames ahead of the last ACK, which names the next sequence number wanted. Anything on the line
+# that is not a good frame (console text from other tasks) is skipped.
+
+import argparse
+import binascii
+import os
+import random
+import subprocess
+import sys
+import time
+
+FRAME_SYNC = 0xA7
+FRAME_HEADER_SIZE = 4
+FRAME_CRC_SIZE = 2
+FRAME_MAX_PAYLOAD = 120
+
+HELLO, LIST, INFO, READ, WRITE, DATA, ACK, NAK, DONE, ERROR, QUIT = (ord(c) for c in "HLIRWDANZXQ")
+
+ERRORS = {1: "no such region", 2: "offset or length outside the region", 3: "region is read-only", 4: "bad request"}
+
+REPLY_TIMEOUT = 0.5
+RETRIES = 10
+
+
+class TransferError(Exception):
+    pass
+
+
+class Link:
+    """Frames in and out of a raw serial port or the pty of a simulated board."""
+
+    def __init__(self, port: str | None, sim: str | None, baud: int):
+        self.process = None
+        if sim is not None:
+            import tty
+
+            self.fd, slave = os.openpty()
+            tty.setraw(slave)
+            env = dict(os.environ, EIE_SIM_REALTIME="1")
+            self.process = subprocess.Popen([sim], stdin=slave, stdout=slave, env=env)
+            os.close(slave)
+        else:
+            import termios
+            import tty
+
+            self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+            speed = getattr(termios, f"B{baud}", None)
+            if speed is None:
+                sys.exit(f"debug_xfer: {baud} baud is not a standard termios rate")
+            tty.setraw(self.fd)
+            attrs = termios.tcgetattr(self.fd)
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.buffer = bytearray()
+        self.bad_frames = 0
+
+    def send(self, kind: int, sequence: int = 0, payload: bytes = b""):
+        body = bytes([kind, sequence & 0xFF, len(payload)]) + payload
+        os.write(self.fd, bytes([FRAME_SYNC]) + body + binascii.crc_hqx(body, 0xFFFF).to_bytes(2, "little"))
+
+    def send_text(self, text: bytes):
+        os.write(self.fd, text)
+
+    def receive(self, timeout: float) -> tuple[int, int, bytes] | None:
+        """Returns the next good frame as (type, sequence, payload), or None after timeout seconds."""
+        import select
+
+        deadline = time.monotonic() + timeout
+        while True:
+            frame = self.take_frame()
+            if frame is not None:
+                return frame
+            remaining = deadline - time.monotonic()
+            if remaining <= 0 or not select.select([self.fd], [], [], remaining)[0]:
+                return None
+            try:
+                data = os.read(self.fd, 4096)
+            except OSError:
+                data = b""
+            if not data:
+                raise TransferError("the board went away")
+            self.buffer += data
+
+    def take_frame(self) -> tuple[int, int, bytes] | None:
+        while True:
+            start = self.buffer.find(FRAME_SYNC)
+            if start < 0:
+                self.buffer.clear()
+                return None
+            del self.buffer[:start]
+
+            if len(self.buffer) < FRAME_HEADER_SIZE:
+                return None
+            kind, sequence, size = self.buffer[1:FRAME_HEADER_SIZE]
+            frame_size = FRAME_HEADER_SIZE + size + FRAME_CRC_SIZE
+            if size <= FRAME_MAX_PAYLOAD and len(self.buffer) < frame_size:
+                return None
+
+            frame = bytes(self.buffer[:frame_size])
+            crc = int.from_bytes(frame[-FRAME_CRC_SIZE:], "little")
+            if size > FRAME_MAX_PAYLOAD or binascii.crc_hqx(frame[1:-FRAME_CRC_SIZE], 0xFFFF) != crc:
+                self.bad_frames += 1
+                del self.buffer[:1]
+                continue
+            del self.buffer[:frame_size]
+            return kind, sequence, frame[FRAME_HEADER_SIZE:-FRAME_CRC_SIZE]
+
+    def close(self):
+        if self.process is not None:
+            self.process.terminate()
+            self.process.wait()
+        os.close(self.fd)
+
+
+class Board:
+    """The host side of the transfer protocol."""
+
+    def __init__(self, link: Link):
+        self.link = link
+        self.window = 1
+        self.regions = None
+
+    def connect(self, timeout: float = 15.0):
+        """Starts transfer mode (or finds it already running) and reads the HELLO frame."""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            # The HELLO frame is answered if transfer mode is already on; otherwise the CR ends
+            # whatever the console made of it and the command starts transfer mode
+            self.link.send(HELLO)
+            self.link.send_text(b"\ren+c xfer\r")
+            reply_deadline = time.monotonic() + 1.0
+            while (frame := self.link.receive(reply_deadline - time.monotonic())) is not None:
+                kind, _, payload = frame
+                # The console echoes our own (empty) HELLO back, so only a full one counts
+                if kind == HELLO and len(payload) >= 4:
+                    version, self.window, max_payload, _ = payload[:4]
+                    if version != 1 or max_payload != FRAME_MAX_PAYLOAD:
+                        raise TransferError(f"unsupported protocol version {version}")
+                    return
+        raise TransferError("no answer from the board (is en+c xfer in its command list?)")
+
+    def quit(self):
+        for _ in range(3):
+            self.link.send(QUIT)
+            while (frame := self.link.receive(REPLY_TIMEOUT)) is not None:
+                if frame[0] == QUIT:
+                    return
+
+    def list(self) -> list[tuple[int, str, int, bool]]:
+        """Returns (ID, name, size, writable) for each region."""
+        for _ in range(RETRIES):
+            self.link.send(LIST)
+            regions = []
+            while (frame := self.link.receive(REPLY_TIMEOUT)) is not None:
+                kind, _, payload = frame
+                if kind != INFO:
+                    continue
+                if not payload:
+                    self.regions = regions
+                    return regions
+                regions.append((payload[0], payload[6:].decode("ascii"), int.from_bytes(payload[2:6], "little"), bool(payload[1])))
+        raise TransferError("no region list from the board")
+
+    def find(self, region: str) -> int:
+        for number, name, _, _ in self.regions or self.list():
+            if region in (name, str(number)):
+                return number
+        raise TransferError(f"no region {region!r} (see the list command)")
+
+    def read(self, region: int, offset: int = 0, length: int = 0) -> bytes:
+        request = bytes([region]) + offset.to_bytes(4, "little") + length.to_bytes(4, "little")
+        for _ in range(RETRIES):
+            self.link.send(READ, 0, request)
+            data = bytearray()
+            expected = 0
+            nak_sent = False
+            quiet = 0
+            while quiet < RETRIES:
+                frame = self.link.receive(REPLY_TIMEOUT)
+                if frame is None:
+                    if expected == 0:
+                        break
+                    # The board goes back by itself; the ACK covers a lost DONE frame
+                    quiet += 1
+                    self.link.send(ACK, expected)
+                    continue
+                quiet = 0
+                kind, sequence, payload = frame
+                if kind == ERROR:
+                    raise TransferError(ERRORS.get(payload[0] if payload else 0, "refused"))
+                if kind == DONE and sequence == expected & 0xFF:
+                    if int.from_bytes(payload[:4], "little") != len(data):
+                        raise TransferError(f"board sent {int.from_bytes(payload[:4], 'little')} bytes, got {len(data)}")
+                    return bytes(data)
+                if kind != DATA:
+                    continue
+                distance = (sequence - expected) & 0xFF
+                if distance == 0:
+                    data += payload
+                    expected += 1
+                    nak_sent = False
+                    self.link.send(ACK, expected)
+                elif distance < 128:
+                    if not nak_sent:
+                        self.link.send(NAK, expected)
+                        nak_sent = True
+                else:
+                    self.link.send(ACK, expected)
+            else:
+                raise TransferError(f"read stalled after {len(data)} bytes")
+        raise TransferError("no answer to the read request")
+
+    def write(self, region: int, data: bytes, offset: int = 0):
+        request = bytes([region]) + offset.to_bytes(4, "little") + len(data).to_bytes(4, "little")
+        for _ in range(RETRIES):
+            self.link.send(WRITE, 0, request)
+            frame = self.link.receive(REPLY_TIMEOUT)
+            while frame is not None and frame[0] not in (ACK, ERROR):
+                frame = self.link.receive(REPLY_TIMEOUT)
+            if frame is None:
+                continue
+            if frame[0] == ERROR:
+                raise TransferError(ERRORS.get(frame[2][0] if frame[2] else 0, "refused"))
+            if frame[1] == 0:
+                break
+        else:
+            raise TransferError("no answer to the write request")
+
+        blocks = [data[i:i + FRAME_MAX_PAYLOAD] for i in range(0, len(data), FRAME_MAX_PAYLOAD)]
+        base = next_frame = 0
+        quiet = 0
+        while base < len(blocks):
+            while next_frame < len(blocks) and next_frame - base < self.window:
+                self.link.send(DATA, next_frame, blocks[next_frame])
+                next_frame += 1
+
+            frame = self.link.receive(REPLY_TIMEOUT)
+            if frame is None:
+                quiet += 1
+                if quiet == RETRIES:
+                    raise TransferError(f"write stalled after {base * FRAME_MAX_PAYLOAD} bytes")
+                next_frame = base
+                continue
+            quiet = 0
+            kind, sequence, payload = frame
+            if kind == ERROR:
+                raise TransferError(ERRORS.get(payload[0] if payload else 0, "refused"))
+            if kind in (ACK, NAK):
+                distance = (sequence - base) & 0xFF
+                if distance <= next_frame - base:
+                    base += distance
+                    if kind == NAK:
+                        next_frame = base
+
+
+def report(what: str, size: int, seconds: float):
+    rate = size / seconds if seconds > 0 else 0
+    print(f"debug_xfer: {what} {size} bytes in {seconds:.3f} s = {rate:.0f} bytes/s", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Read and write board memory regions over the debug UART.")
+    parser.add_argument("--port", help="serial port of the board")
+    parser.add_argument("--sim", metavar="EXE", help="run a host build on a pty instead of opening a port")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port baud rate (default 115200)")
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("list", help="show the regions")
+    read = commands.add_parser("read", help="copy a region (or part of it) to a file")
+    read.add_argument("region", help="region name or ID")
+    read.add_argument("file", help="output file ('-' for stdout)")
+    read.add_argument("--offset", type=int, default=0)
+    read.add_argument("--length", type=int, default=0, help="bytes to read (default to the end of the region)")
+    write = commands.add_parser("write", help="copy a file into a writable region")
+    write.add_argument("region", help="region name or ID")
+    write.add_argument("file", help="input file ('-' for stdin)")
+    write.add_argument("--offset", type=int, default=0)
+    selftest = commands.add_parser("selftest", help="write random data to a region and read it back")
+    selftest.add_argument("--region", default="scratch")
+    selftest.add_argument("--passes", type=int, default=1, help="round trips to make (a board that just reset is slow at first)")
+    opts = parser.parse_args()
+
+    if (opts.port is None) == (opts.sim is None):
+        parser.error("give either --port or --sim")
+
+    link = Link(opts.port, opts.sim, opts.baud)
+    board = Board(link)
+    try:
+        board.connect()
+        if opts.command == "list":
+            for number, name, size, writable in board.list():
+                print(f"{number:3}  {name:<12} {size:8}  {'rw' if writable else 'r-'}")
+
+        elif opts.command == "read":
+            start = time.monotonic()
+            data = board.read(board.find(opts.region), opts.offset, opts.length)
+            report("read", len(data), time.monotonic() - start)
+            if opts.file == "-":
+                sys.stdout.buffer.write(data)
+            else:
+                with open(opts.file, "wb") as out:
+                    out.write(data)
+
+        elif opts.command == "write":
+            if opts.file == "-":
+                data = sys.stdin.buffer.read()
+            else:
+                with open(opts.file, "rb") as source:
+                    data = source.read()
+            start = time.monotonic()
+            board.write(board.find(opts.region), data, opts.offset)
+            report("wrote", len(data), time.monotonic() - start)
+
+        else:
+            region = board.find(opts.region)
+            size = next(size for number, _, size, _ in board.regions if number == region)
+            for _ in range(opts.passes):
+                data = random.randbytes(size)
+                start = time.monotonic()
+                board.write(region, data)
+                report("wrote", size, time.monotonic() - start)
+                start = time.monotonic()
+                back = board.read(region)
+                report("read", size, time.monotonic() - start)
+                if back != data:
+                    first = next(i for i in range(size) if i >= len(back) or back[i] != data[i])
+                    raise TransferError(f"selftest: read back differs from byte {first}")
+            print("debug_xfer: selftest passed", file=sys.stderr)
+
+        board.quit()
+    except TransferError as error:
+        sys.exit(f"debug_xfer: {error}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if link.bad_frames:
+            print(f"debug_xfer: {link.bad_frames} bytes looked like a frame start but failed the CRC", file=sys.stderr)
+        link.close()
+
+
+if __name__ == "__main__":
+    main()
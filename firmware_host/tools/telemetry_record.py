@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+# Records the telemetry frames sent by the debug task after en+c telemetry (see DebugTelemetrySend() in
+# debug.c) and writes each channel to its own CSV (or Parquet) file.
+#
+# Console text and DebugLog() frames are decoded with debug_log_decode.py and shown on stdout as
+# usual, so the recorder can be left running as the terminal.
+#
+#   $ python3 firmware_host/tools/telemetry_record.py /dev/ttyUSB0 --out capture
+#   $ ./build/firmware-ascii-host | python3 firmware_host/tools/telemetry_record.py --out capture
+#
+# A frame is:
+#
+#   0xA6 | channel | sequence number | payload size | payload | CRC-16/CCITT (u16, little endian)
+#
+# The CRC covers everything after the sync byte. A missing sequence number means the board could
+# not queue that frame; the number of lost frames per channel is printed at the end.
+
+import argparse
+import binascii
+import csv
+import pathlib
+import struct
+import sys
+import time
+
+import debug_log_decode
+
+FRAME_SYNC = 0xA6
+FRAME_HEADER_SIZE = 4
+FRAME_CRC_SIZE = 2
+FRAME_MAX_PAYLOAD = 120
+
+# Payload layout of each channel in DebugTelemetryChannelType order (see debug.h). A payload can hold
+# several samples back to back.
+CHANNELS = {
+    0: ("lsm6dsl", "<7h", ["temp", "gyro_x", "gyro_y", "gyro_z", "accel_x", "accel_y", "accel_z"]),
+    1: ("captouch", "<2B", ["horizontal", "vertical"]),
+    2: ("ant", "<6I", ["tx_bytes", "rx_bytes", "rx_timeouts", "unexpected_bytes", "app_messages", "outgoing_messages"]),
+    3: ("orientation", "<7h", ["qw", "qx", "qy", "qz", "rate_x", "rate_y", "rate_z"]),
+}
+
+
+class ChannelWriter:
+    """Collects the samples of one channel and writes them as CSV rows or one Parquet table."""
+
+    def __init__(self, out_dir: pathlib.Path, name: str, fields: list[str], parquet: bool):
+        self.columns = ["host_time", "sequence", "sample"] + fields
+        self.path = out_dir / f"{name}.{'parquet' if parquet else 'csv'}"
+        self.rows = [] if parquet else None
+        self.csv_file = None
+        if not parquet:
+            self.csv_file = open(self.path, "w", newline="")
+            self.csv = csv.writer(self.csv_file)
+            self.csv.writerow(self.columns)
+        self.frames = 0
+        self.lost = 0
+        self.next_sequence = None
+
+    def add(self, sequence: int, samples: list[tuple]):
+        if self.next_sequence is not None:
+            self.lost += (sequence - self.next_sequence) & 0xFF
+        self.next_sequence = (sequence + 1) & 0xFF
+        self.frames += 1
+
+        now = time.time()
+        for index, sample in enumerate(samples):
+            row = [f"{now:.6f}", sequence, index, *sample]
+            if self.rows is not None:
+                self.rows.append(row)
+            else:
+                self.csv.writerow(row)
+
+    def close(self):
+        if self.csv_file is not None:
+            self.csv_file.close()
+        elif self.rows:
+            import pyarrow
+            import pyarrow.parquet
+
+            table = pyarrow.table({name: [row[i] for row in self.rows] for i, name in enumerate(self.columns)})
+            pyarrow.parquet.write_table(table, self.path)
+
+
+class Recorder:
+    """Pulls telemetry frames out of the byte stream and hands everything else to the log decoder."""
+
+    def __init__(self, out_dir: pathlib.Path, parquet: bool, log: debug_log_decode.Decoder):
+        self.out_dir = out_dir
+        self.parquet = parquet
+        self.log = log
+        self.buffer = bytearray()
+        self.writers = {}
+        self.bad_frames = 0
+
+    def feed(self, data: bytes) -> str:
+        out = []
+        self.buffer += data
+        while self.buffer:
+            start = self.buffer.find(FRAME_SYNC)
+            if start != 0:
+                end = len(self.buffer) if start < 0 else start
+                out.append(self.log.feed(bytes(self.buffer[:end])))
+                del self.buffer[:end]
+                continue
+
+            if len(self.buffer) < FRAME_HEADER_SIZE:
+                break
+            channel, sequence, size = self.buffer[1:FRAME_HEADER_SIZE]
+            frame_size = FRAME_HEADER_SIZE + size + FRAME_CRC_SIZE
+            if size <= FRAME_MAX_PAYLOAD and len(self.buffer) < frame_size:
+                break
+
+            frame = bytes(self.buffer[:frame_size])
+            crc = int.from_bytes(frame[-FRAME_CRC_SIZE:], "little")
+            if size > FRAME_MAX_PAYLOAD or binascii.crc_hqx(frame[1:-FRAME_CRC_SIZE], 0xFFFF) != crc:
+                # Not a frame after all (0xA6 can be part of a DebugLog() frame): pass the byte on
+                self.bad_frames += 1
+                out.append(self.log.feed(bytes(self.buffer[:1])))
+                del self.buffer[:1]
+                continue
+
+            del self.buffer[:frame_size]
+            self.record(channel, sequence, frame[FRAME_HEADER_SIZE:-FRAME_CRC_SIZE])
+        return "".join(out)
+
+    def record(self, channel: int, sequence: int, payload: bytes):
+        name, layout, fields = CHANNELS.get(channel, (f"channel{channel}", "<B", ["byte"]))
+        if channel not in self.writers:
+            self.writers[channel] = ChannelWriter(self.out_dir, name, fields, self.parquet)
+
+        sample_size = struct.calcsize(layout)
+        usable = len(payload) - (len(payload) % sample_size)
+        samples = [struct.unpack_from(layout, payload, offset) for offset in range(0, usable, sample_size)]
+        self.writers[channel].add(sequence, samples)
+
+    def close(self):
+        for channel, writer in sorted(self.writers.items()):
+            writer.close()
+            print(f"telemetry_record: {writer.path}: {writer.frames} frames, {writer.lost} lost", file=sys.stderr)
+        if self.bad_frames:
+            print(f"telemetry_record: {self.bad_frames} bytes looked like a frame start but failed the CRC", file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record telemetry frames from the debug UART to CSV or Parquet.")
+    parser.add_argument("input", nargs="?", default="-", help="serial port or capture file (default stdin)")
+    parser.add_argument("--out", type=pathlib.Path, default=pathlib.Path("telemetry"), help="directory for the channel files")
+    parser.add_argument("--parquet", action="store_true", help="write Parquet files (needs pyarrow) instead of CSV")
+    parser.add_argument("--source", type=pathlib.Path, default=debug_log_decode.DEFAULT_SOURCE, help="debug.c to read log formats from")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port baud rate (default 115200)")
+    opts = parser.parse_args()
+
+    if opts.parquet:
+        try:
+            import pyarrow.parquet  # noqa: F401
+        except ImportError:
+            sys.exit("telemetry_record: --parquet needs the pyarrow package")
+
+    opts.out.mkdir(parents=True, exist_ok=True)
+    recorder = Recorder(opts.out, opts.parquet, debug_log_decode.Decoder(debug_log_decode.read_formats(opts.source), False))
+    stream = debug_log_decode.open_input(opts.input, opts.baud)
+    read = getattr(stream, "read1", stream.read)
+    try:
+        while data := read(256):
+            sys.stdout.write(recorder.feed(data))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        recorder.close()
+
+
+if __name__ == "__main__":
+    main()